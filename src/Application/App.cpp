@@ -54,6 +54,7 @@
 #include "TextEditor/TextLanguage.h"
 #include "TextEditor/TextStyle.h"
 #include "UI/SBrush.h"
+#include "Utility/ThreadPool.h"
 #include "Utility/Tokenizer.h"
 
 
@@ -583,6 +584,9 @@ void App::exit(bool save_config)
 	// Close all open archives
 	archive_manager.closeAll();
 
+	// Finish any background tasks and stop worker threads
+	ThreadPool::shutdown();
+
 	// Clean up
 	EntryType::cleanupEntryTypes();
 
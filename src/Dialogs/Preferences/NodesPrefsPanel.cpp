@@ -43,6 +43,9 @@
 // ----------------------------------------------------------------------------
 EXTERN_CVAR(String, nodebuilder_id)
 EXTERN_CVAR(String, nodebuilder_options)
+EXTERN_CVAR(Bool, map_build_blockmap)
+EXTERN_CVAR(Bool, map_build_blockmap_compress)
+EXTERN_CVAR(Bool, map_build_reject)
 
 
 // ----------------------------------------------------------------------------
@@ -89,6 +92,14 @@ NodesPrefsPanel::NodesPrefsPanel(wxWindow* parent, bool useframe) : PrefsPanelBa
 	clb_options_ = new wxCheckListBox(this, -1, wxDefaultPosition, wxDefaultSize);
 	sizer->Add(WxUtils::createLabelVBox(this, "Options:", clb_options_), { 2, 0 }, { 1, 3 }, wxEXPAND);
 
+	// Built-in BLOCKMAP/REJECT
+	cb_build_blockmap_ = new wxCheckBox(this, -1, "Build BLOCKMAP when saving binary format maps (if the node builder doesn't)");
+	sizer->Add(cb_build_blockmap_, { 3, 0 }, { 1, 3 }, wxEXPAND);
+	cb_build_blockmap_compress_ = new wxCheckBox(this, -1, "Compress BLOCKMAP (share identical blocklists)");
+	sizer->Add(cb_build_blockmap_compress_, { 4, 0 }, { 1, 3 }, wxEXPAND);
+	cb_build_reject_ = new wxCheckBox(this, -1, "Build REJECT when saving binary format maps (if the node builder doesn't)");
+	sizer->Add(cb_build_reject_, { 5, 0 }, { 1, 3 }, wxEXPAND);
+
 	sizer->AddGrowableCol(1, 1);
 	sizer->AddGrowableRow(2, 1);
 
@@ -99,6 +110,9 @@ NodesPrefsPanel::NodesPrefsPanel(wxWindow* parent, bool useframe) : PrefsPanelBa
 	// Init
 	choice_nodebuilder_->Select(sel);
 	populateOptions(nodebuilder_options);
+	cb_build_blockmap_->SetValue(map_build_blockmap);
+	cb_build_blockmap_compress_->SetValue(map_build_blockmap_compress);
+	cb_build_reject_->SetValue(map_build_reject);
 }
 
 // ----------------------------------------------------------------------------
@@ -128,6 +142,9 @@ void NodesPrefsPanel::init()
 	}
 	choice_nodebuilder_->Select(sel);
 	populateOptions(nodebuilder_options);
+	cb_build_blockmap_->SetValue(map_build_blockmap);
+	cb_build_blockmap_compress_->SetValue(map_build_blockmap_compress);
+	cb_build_reject_->SetValue(map_build_reject);
 }
 
 // ----------------------------------------------------------------------------
@@ -140,7 +157,7 @@ void NodesPrefsPanel::populateOptions(string options)
 {
 	// Get current builder
 	NodeBuilders::builder_t& builder = NodeBuilders::getBuilder(choice_nodebuilder_->GetSelection());
-	btn_browse_path_->Enable(builder.id != "none");
+	btn_browse_path_->Enable(builder.id != "none" && builder.id != "slade");
 
 	// Set builder path
 	text_path_->SetValue(builder.path);
@@ -179,6 +196,11 @@ void NodesPrefsPanel::applyPreferences()
 		}
 	}
 	nodebuilder_options = opt;
+
+	// Built-in BLOCKMAP/REJECT
+	map_build_blockmap = cb_build_blockmap_->GetValue();
+	map_build_blockmap_compress = cb_build_blockmap_compress_->GetValue();
+	map_build_reject = cb_build_reject_->GetValue();
 }
 
 
@@ -20,6 +20,9 @@ private:
 	wxButton*		btn_browse_path_;
 	wxTextCtrl*		text_path_;
 	wxCheckListBox*	clb_options_;
+	wxCheckBox*		cb_build_blockmap_;
+	wxCheckBox*		cb_build_blockmap_compress_;
+	wxCheckBox*		cb_build_reject_;
 
 	// Events
 	void	onChoiceBuilderChanged(wxCommandEvent& e);
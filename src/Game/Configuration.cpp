@@ -55,6 +55,12 @@ using namespace Game;
 EXTERN_CVAR(String, game_configuration)
 EXTERN_CVAR(String, port_configuration)
 CVAR(Bool, debug_configuration, false, CVAR_SAVE)
+namespace
+{
+	// Thing types above this go in the sparse lookup table rather than the
+	// dense one (some ports use very large editor numbers)
+	const int	max_dense_thing_type = 65535;
+}
 
 
 // ----------------------------------------------------------------------------
@@ -556,6 +562,8 @@ bool Configuration::readConfiguration(string& cfg, string source, uint8_t format
 		setDefaults();
 		action_specials_.clear();
 		thing_types_.clear();
+		thing_type_index_.clear();
+		thing_type_large_.clear();
 		flags_thing_.clear();
 		flags_line_.clear();
 		sector_types_.clear();
@@ -883,6 +891,8 @@ bool Configuration::readConfiguration(string& cfg, string source, uint8_t format
 			LOG_MESSAGE(1, "Warning: Unexpected game configuration section \"%s\", skipping", node->getName());
 	}
 
+	updateThingTypeLookup();
+
 	return true;
 }
 
@@ -1051,13 +1061,19 @@ string Configuration::actionSpecialName(int special)
 //
 // Returns the thing type definition for [type]
 // ----------------------------------------------------------------------------
-const ThingType& Configuration::thingType(unsigned type)
+const ThingType& Configuration::thingType(unsigned type) const
 {
-	auto& ttype = thing_types_[type];
-	if (ttype.defined())
-		return ttype;
-	else
-		return ThingType::unknown();
+	if (type < thing_type_index_.size())
+		return *thing_type_index_[type];
+
+	if (!thing_type_large_.empty())
+	{
+		auto ttype = thing_type_large_.find(type);
+		if (ttype != thing_type_large_.end())
+			return *ttype->second;
+	}
+
+	return ThingType::unknown();
 }
 
 // ----------------------------------------------------------------------------
@@ -1070,6 +1086,39 @@ const ThingType& Configuration::thingTypeGroupDefaults(const string& group)
 	return tt_group_defaults_[group];
 }
 
+// ----------------------------------------------------------------------------
+// Configuration::updateThingTypeLookup
+//
+// Rebuilds the thing type lookup tables used by thingType. Types up to the
+// highest defined type go in a directly indexed table (undefined types in
+// range point to the 'unknown' type), any very large types are put in a
+// separate hash table. Must be called after anything modifies thing_types_
+// ----------------------------------------------------------------------------
+void Configuration::updateThingTypeLookup()
+{
+	thing_type_index_.clear();
+	thing_type_large_.clear();
+
+	// Get dense table size
+	int max_type = -1;
+	for (auto& ttype : thing_types_)
+		if (ttype.second.defined() && ttype.first <= max_dense_thing_type)
+			max_type = MAX(max_type, ttype.first);
+
+	// Fill tables
+	thing_type_index_.resize(max_type + 1, &ThingType::unknown());
+	for (auto& ttype : thing_types_)
+	{
+		if (!ttype.second.defined() || ttype.first < 0)
+			continue;
+
+		if (ttype.first <= max_dense_thing_type)
+			thing_type_index_[ttype.first] = &ttype.second;
+		else
+			thing_type_large_[ttype.first] = &ttype.second;
+	}
+}
+
 // ----------------------------------------------------------------------------
 // Configuration::thingFlag
 //
@@ -1422,7 +1471,9 @@ void Configuration::setThingBasicFlag(string flag, MapThing* thing, int map_form
 // ----------------------------------------------------------------------------
 bool Configuration::parseDecorateDefs(Archive* archive)
 {
-	return Game::readDecorateDefs(archive, thing_types_, parsed_types_);
+	bool ok = Game::readDecorateDefs(archive, thing_types_, parsed_types_);
+	updateThingTypeLookup();
+	return ok;
 }
 
 // ----------------------------------------------------------------------------
@@ -1432,9 +1483,11 @@ bool Configuration::parseDecorateDefs(Archive* archive)
 // ----------------------------------------------------------------------------
 void Configuration::clearDecorateDefs()
 {
-	for (auto def : thing_types_)
+	for (auto& def : thing_types_)
 		if (def.second.decorate() && def.second.defined())
 			def.second.define(-1, "", "");
+
+	updateThingTypeLookup();
 }
 
 // ----------------------------------------------------------------------------
@@ -1445,6 +1498,7 @@ void Configuration::clearDecorateDefs()
 void Configuration::importZScriptDefs(ZScript::Definitions& defs)
 {
 	defs.exportThingTypes(thing_types_, parsed_types_);
+	updateThingTypeLookup();
 }
 
 // ----------------------------------------------------------------------------
@@ -1478,6 +1532,8 @@ void Configuration::linkDoomEdNums()
 			Log::info(2, S_FMT("Linked parsed class %s to DoomEdNum %d", CHR(parsed.className()), ednum));
 		}
 	}
+
+	updateThingTypeLookup();
 }
 
 // ----------------------------------------------------------------------------
@@ -1924,33 +1980,38 @@ void Configuration::cleanObjectUDMFProps(MapObject* object)
 	else
 		return;
 
-	// Go through properties
-	for (auto& i : *map)
+	// Go through the object's properties (backwards, since removing a property
+	// swaps the last one into its place). Only the object's own properties are
+	// checked, and looked up in the config, so nothing gets added to the object
+	auto& props = object->props().allProperties();
+	for (int a = (int)props.size() - 1; a >= 0; a--)
 	{
-		// Check if the object even has this property
-		if (!object->hasProp(i.first))
+		// Check the property has a value and is defined in the config
+		auto& prop = props[a];
+		if (!prop.value.hasValue())
+			continue;
+		auto i = map->find(prop.name());
+		if (i == map->end())
 			continue;
 
-		// Remove the property from the object if it is the default value
-		if (i.second.defaultValue().getType() == PROP_BOOL)
-		{
-			if (i.second.defaultValue().getBoolValue() == object->boolProperty(i.first))
-				object->props().removeProperty(i.first);
-		}
-		else if (i.second.defaultValue().getType() == PROP_INT)
-		{
-			if (i.second.defaultValue().getIntValue() == object->intProperty(i.first))
-				object->props().removeProperty(i.first);
-		}
-		else if (i.second.defaultValue().getType() == PROP_FLOAT)
-		{
-			if (i.second.defaultValue().getFloatValue() == object->floatProperty(i.first))
-				object->props().removeProperty(i.first);
-		}
-		else if (i.second.defaultValue().getType() == PROP_STRING)
+		// Check if it is the default value
+		auto& def = i->second.defaultValue();
+		bool is_default = false;
+		if (def.getType() == PROP_BOOL)
+			is_default = (def.getBoolValue() == prop.value.getBoolValue());
+		else if (def.getType() == PROP_INT)
+			is_default = (def.getIntValue() == prop.value.getIntValue());
+		else if (def.getType() == PROP_FLOAT)
+			is_default = (def.getFloatValue() == prop.value.getFloatValue());
+		else if (def.getType() == PROP_STRING)
+			is_default = (def.getStringValue() == prop.value.getStringValue());
+
+		// Remove the property from the object if it is
+		if (is_default)
 		{
-			if (i.second.defaultValue().getStringValue() == object->stringProperty(i.first))
-				object->props().removeProperty(i.first);
+			if (a < (int)props.size() - 1)
+				props[a] = props.back();
+			props.pop_back();
 		}
 	}
 }
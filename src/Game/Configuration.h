@@ -1,5 +1,6 @@
 #pragma once
 
+#include <unordered_map>
 #include "Game.h"
 #include "ActionSpecial.h"
 #include "ThingType.h"
@@ -114,7 +115,7 @@ namespace Game
 		string					actionSpecialName(int special);
 
 		// Thing types
-		const ThingType&	thingType(unsigned type);
+		const ThingType&	thingType(unsigned type) const;
 		const ThingType&	thingTypeGroupDefaults(const string& group);
 
 		// Thing flags
@@ -214,6 +215,11 @@ namespace Game
 		//std::map<string, ThingType> parsed_types_;		// ThingTypes parsed from definitions
 														// (DECORATE, ZScript etc.)
 
+		// Thing type lookup (pointers into thing_types_), rebuilt whenever
+		// thing types are added or removed
+		vector<const ThingType*>					thing_type_index_;	// Dense, indexed by type
+		std::unordered_map<int, const ThingType*>	thing_type_large_;	// Types too large for the dense table
+
 		// Flags
 		vector<Flag>	flags_thing_;
 		vector<Flag>	flags_line_;
@@ -249,5 +255,7 @@ namespace Game
 
 		// Special Presets
 		vector<SpecialPreset>	special_presets_;
+
+		void	updateThingTypeLookup();
 	};
 }
@@ -35,6 +35,8 @@
  * VARIABLES
  *******************************************************************/
 UndoManager*	current_undo_manager = nullptr;
+CVAR(Int, undo_memory_budget, 256, CVAR_SAVE)	// In MB, 0 = no limit
+CVAR(Int, undo_compress_after, 10, CVAR_SAVE)	// Levels, 0 = never compress
 
 
 /*******************************************************************
@@ -49,6 +51,7 @@ UndoLevel::UndoLevel(string name)
 	// Init variables
 	this->name = name;
 	this->timestamp = wxDateTime::Now();
+	this->compressed = false;
 }
 
 /* UndoLevel::~UndoLevel
@@ -74,12 +77,38 @@ string UndoLevel::getTimeStamp(bool date, bool time)
 		return timestamp.FormatISOCombined();
 }
 
+/* UndoLevel::memoryUsage
+ * Returns the (approximate) memory used by this level's undo steps,
+ * in bytes
+ *******************************************************************/
+size_t UndoLevel::memoryUsage()
+{
+	size_t total = 0;
+	for (unsigned a = 0; a < undo_steps.size(); a++)
+		total += undo_steps[a]->memoryUsage();
+
+	return total;
+}
+
+/* UndoLevel::compress
+ * Compresses the data for all undo steps in this level (if they
+ * support it)
+ *******************************************************************/
+void UndoLevel::compress()
+{
+	for (unsigned a = 0; a < undo_steps.size(); a++)
+		undo_steps[a]->compress();
+
+	compressed = true;
+}
+
 /* UndoLevel::doUndo
  * Performs all undo steps for this level
  *******************************************************************/
 bool UndoLevel::doUndo()
 {
 	LOG_MESSAGE(3, "Performing undo \"%s\" (%lu steps)", name, undo_steps.size());
+	compressed = false;	// Steps may have decompressed their data
 	bool ok = true;
 	for (int a = (int)undo_steps.size() - 1; a >= 0; a--)
 	{
@@ -96,6 +125,7 @@ bool UndoLevel::doUndo()
 bool UndoLevel::doRedo()
 {
 	LOG_MESSAGE(3, "Performing redo \"%s\" (%lu steps)", name, undo_steps.size());
+	compressed = false;	// Steps may have decompressed their data
 	bool ok = true;
 	for (unsigned a = 0; a < undo_steps.size(); a++)
 	{
@@ -215,6 +245,10 @@ void UndoManager::endRecord(bool success)
 	current_level = nullptr;
 	current_level_index = undo_levels.size() - 1;
 
+	// Keep memory usage down
+	compressOldLevels();
+	enforceMemoryBudget();
+
 	// Clear current undo manager
 	current_undo_manager = nullptr;
 
@@ -268,7 +302,7 @@ string UndoManager::undo()
 	current_undo_manager = this;
 	UndoLevel* level = undo_levels[current_level_index];
 	if (!level->doUndo())
-		LOG_MESSAGE(3, "Undo operation \"%s\" failed", level->getName());
+		LOG_MESSAGE(1, "Undo operation \"%s\" failed", level->getName());
 	undo_running = false;
 	current_undo_manager = nullptr;
 	current_level_index--;
@@ -296,15 +330,79 @@ string UndoManager::redo()
 	undo_running = true;
 	current_undo_manager = this;
 	UndoLevel* level = undo_levels[current_level_index];
-	level->doRedo();
+	if (!level->doRedo())
+		LOG_MESSAGE(1, "Redo operation \"%s\" failed", level->getName());
 	undo_running = false;
 	current_undo_manager = nullptr;
 
+	// Redoing may have decompressed levels that are old enough to be
+	// compressed again
+	compressOldLevels();
+
 	announce("redo");
 
 	return level->getName();
 }
 
+/* UndoManager::memoryUsage
+ * Returns the (approximate) memory used by all undo levels, in bytes
+ *******************************************************************/
+size_t UndoManager::memoryUsage()
+{
+	size_t total = 0;
+	for (unsigned a = 0; a < undo_levels.size(); a++)
+		total += undo_levels[a]->memoryUsage();
+
+	return total;
+}
+
+/* UndoManager::compressOldLevels
+ * Compresses all undo levels [undo_compress_after] or more levels
+ * before the current one that aren't already compressed (undoing or
+ * redoing a level leaves it uncompressed)
+ *******************************************************************/
+void UndoManager::compressOldLevels()
+{
+	if (undo_compress_after <= 0)
+		return;
+
+	int last = MIN(current_level_index - undo_compress_after, (int)undo_levels.size() - 1);
+	for (int a = 0; a <= last; a++)
+		if (!undo_levels[a]->isCompressed())
+			undo_levels[a]->compress();
+}
+
+/* UndoManager::enforceMemoryBudget
+ * Removes the oldest undo levels until the total memory used by all
+ * levels is within [undo_memory_budget]. The current level is always
+ * kept
+ *******************************************************************/
+void UndoManager::enforceMemoryBudget()
+{
+	if (undo_memory_budget <= 0)
+		return;
+
+	// Budget is limited to 1TB
+	uint64_t budget = (uint64_t)MIN((int)undo_memory_budget, 1024 * 1024) * 1024 * 1024;
+	uint64_t total = memoryUsage();
+	unsigned removed = 0;
+	while (total > budget && current_level_index > 0)
+	{
+		total -= undo_levels[0]->memoryUsage();
+		delete undo_levels[0];
+		undo_levels.erase(undo_levels.begin());
+		current_level_index--;
+		if (reset_point == 0)
+			reset_point = RESET_POINT_REMOVED;
+		else if (reset_point > 0)
+			reset_point--;
+		removed++;
+	}
+
+	if (removed > 0)
+		LOG_MESSAGE(2, "Undo memory budget exceeded, removed %d oldest undo levels", removed);
+}
+
 /* UndoManager::getAllLevels
  * Adds all undo level names to [list]
  *******************************************************************/
@@ -314,8 +412,16 @@ void UndoManager::getAllLevels(vector<string>& list)
 		list.push_back(undo_levels[a]->getName());
 }
 
+/* UndoManager::clearToResetPoint
+ * Removes all undo levels after the reset point. Does nothing if the
+ * reset point level was removed to keep within the memory budget,
+ * since the first remaining level isn't the reset point state
+ *******************************************************************/
 void UndoManager::clearToResetPoint()
 {
+	if (reset_point == RESET_POINT_REMOVED)
+		return;
+
 	while (current_level_index > reset_point)
 	{
 		undo_levels.pop_back();
@@ -18,6 +18,11 @@ public:
 	virtual bool	writeFile(MemChunk& mc) { return true; }
 	virtual bool	readFile(MemChunk& mc) { return true; }
 	virtual bool	isOk() { return true; }
+
+	// Memory usage (in bytes) and compression, for steps that can store
+	// their data compressed while not in use
+	virtual size_t	memoryUsage() { return 0; }
+	virtual void	compress() {}
 };
 
 class UndoLevel
@@ -26,6 +31,7 @@ private:
 	string				name;
 	vector<UndoStep*>	undo_steps;
 	wxDateTime			timestamp;
+	bool				compressed;	// Cleared when undone/redone
 
 public:
 	UndoLevel(string name);
@@ -36,6 +42,9 @@ public:
 	bool	doRedo();
 	void	addStep(UndoStep* step) { undo_steps.push_back(step); }
 	string	getTimeStamp(bool date, bool time);
+	size_t	memoryUsage();
+	bool	isCompressed() { return compressed; }
+	void	compress();
 
 	bool	writeFile(string filename);
 	bool	readFile(string filename);
@@ -46,6 +55,10 @@ class SLADEMap;
 class UndoManager : public Announcer
 {
 private:
+	// reset_point value when the level it pointed to was removed to keep
+	// within the undo memory budget
+	static const int RESET_POINT_REMOVED = -2;
+
 	vector<UndoLevel*>	undo_levels;
 	UndoLevel*			current_level;
 	int					current_level_index;
@@ -53,6 +66,9 @@ private:
 	bool				undo_running;
 	SLADEMap*			map;
 
+	void	compressOldLevels();
+	void	enforceMemoryBudget();
+
 public:
 	UndoManager(SLADEMap* map = nullptr);
 	~UndoManager();
@@ -62,6 +78,7 @@ public:
 	int			getCurrentIndex() { return current_level_index; }
 	unsigned	nUndoLevels() { return undo_levels.size(); }
 	UndoLevel*	undoLevel(unsigned index) { return undo_levels[index]; }
+	size_t		memoryUsage();
 
 	void	beginRecord(string name);
 	void	endRecord(bool success);
@@ -0,0 +1,1317 @@
+// ----------------------------------------------------------------------------
+// SLADE - It's a Doom Editor
+// Copyright(C) 2008 - 2017 Simon Judd
+//
+// Email:       sirjuddington@gmail.com
+// Web:         http://slade.mancubus.net
+// Filename:    BSPBuilder.cpp
+// Description: BSPBuilder class - builds vanilla, ZDoom extended and ZDoom GL
+//              nodes for a map in memory
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301, USA.
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+//
+// Includes
+//
+// ----------------------------------------------------------------------------
+#include "Main.h"
+#include "BSPBuilder.h"
+#include "SLADEMap/SLADEMap.h"
+#include "Utility/Compression.h"
+#include "Utility/MathStuff.h"
+#include "Utility/ThreadPool.h"
+#include <climits>
+
+
+// ----------------------------------------------------------------------------
+//
+// Variables
+//
+// ----------------------------------------------------------------------------
+namespace
+{
+	// Distance from a partition line within which a point counts as on it
+	const double	side_epsilon		= 0.001;
+
+	// Distance within which a GL subsector corner is snapped to a seg vertex
+	const double	snap_distance		= 0.001;
+
+	// Cost of splitting a seg when choosing a partition (balance between the
+	// left and right sides costs 1 per seg)
+	const int		split_cost			= 8;
+
+	// Maximum number of partition candidates checked per node. Nodes with
+	// more candidates than this check an evenly spaced selection of them
+	const unsigned	max_candidates		= 128;
+
+	// Candidates are only checked in parallel if (segs * candidates) is at
+	// least this, otherwise the threading overhead isn't worth it
+	const unsigned	parallel_min_work	= 16384;
+
+	const unsigned	subsector_flag		= 0x80000000;
+	const unsigned	no_partner			= 0xFFFFFFFF;
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// Local Functions
+//
+// ----------------------------------------------------------------------------
+namespace
+{
+	// Appends [value] to [data] (little-endian, like all other map lumps)
+	template<typename T> void put(vector<uint8_t>& data, T value)
+	{
+		const uint8_t* bytes = (const uint8_t*)&value;
+		data.insert(data.end(), bytes, bytes + sizeof(T));
+	}
+
+	// Reads values from a lump, with bounds checking
+	struct LumpReader
+	{
+		const uint8_t*	data;
+		size_t			size;
+		size_t			pos;
+
+		LumpReader(const uint8_t* data, size_t size) : data{ data }, size{ size }, pos{ 0 } {}
+
+		template<typename T> bool read(T& value)
+		{
+			if (pos + sizeof(T) > size)
+				return false;
+			memcpy(&value, data + pos, sizeof(T));
+			pos += sizeof(T);
+			return true;
+		}
+
+		bool skip(size_t bytes)
+		{
+			if (pos + bytes > size)
+				return false;
+			pos += bytes;
+			return true;
+		}
+	};
+
+	// Extends [bbox] to include [point], [first] is true if [bbox] is empty
+	void extendBBox(bbox_t& bbox, fpoint2_t point, bool& first)
+	{
+		if (first)
+		{
+			bbox.min = point;
+			bbox.max = point;
+			first = false;
+			return;
+		}
+
+		bbox.min.x = MIN(bbox.min.x, point.x);
+		bbox.min.y = MIN(bbox.min.y, point.y);
+		bbox.max.x = MAX(bbox.max.x, point.x);
+		bbox.max.y = MAX(bbox.max.y, point.y);
+	}
+
+	// Writes [bbox] as a node bounding box (top, bottom, left, right)
+	void putBBox(vector<uint8_t>& data, const bbox_t& bbox)
+	{
+		put<int16_t>(data, (int16_t)ceil(bbox.max.y));
+		put<int16_t>(data, (int16_t)floor(bbox.min.y));
+		put<int16_t>(data, (int16_t)floor(bbox.min.x));
+		put<int16_t>(data, (int16_t)ceil(bbox.max.x));
+	}
+
+	int32_t toFixed(double value)
+	{
+		return (int32_t)lround(value * 65536.0);
+	}
+
+	// Copies [data] into [mc]
+	void exportData(const vector<uint8_t>& data, MemChunk& mc)
+	{
+		mc.clear();
+		if (!data.empty())
+			mc.importMem(data.data(), data.size());
+	}
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// BSPBuilder::tree_t Struct Functions
+//
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::tree_t::sectorAt
+//
+// Returns the index of the sector that the subsector containing [x,y] belongs
+// to, or -1 if the tree is empty or invalid
+// ----------------------------------------------------------------------------
+int BSPBuilder::tree_t::sectorAt(double x, double y) const
+{
+	unsigned child = nodes.empty() ? subsector_flag : nodes.size() - 1;
+	for (unsigned a = 0; a <= nodes.size(); a++)
+	{
+		if (child & subsector_flag)
+		{
+			unsigned index = child & ~subsector_flag;
+			return index < subsector_sectors.size() ? subsector_sectors[index] : -1;
+		}
+
+		if (child >= nodes.size())
+			return -1;
+
+		const node_t& node = nodes[child];
+		double cross = node.dx * (y - node.y) - node.dy * (x - node.x);
+		child = node.child[cross > 0 ? 1 : 0];
+	}
+
+	// Loop in the tree
+	return -1;
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// BSPBuilder Class Functions
+//
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::clear
+//
+// Clears all input and built data
+// ----------------------------------------------------------------------------
+void BSPBuilder::clear()
+{
+	vertices_.clear();
+	lines_.clear();
+	n_map_vertices_ = 0;
+	segs_.clear();
+	vertex_map_.clear();
+	partition_stamp_.clear();
+	nodes_.clear();
+	subsectors_.clear();
+	out_segs_.clear();
+	gl_segs_.clear();
+	n_splits_ = 0;
+	depth_ = 0;
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::addVertex
+//
+// Adds a map vertex at [x,y]. All vertices must be added before building
+// ----------------------------------------------------------------------------
+void BSPBuilder::addVertex(double x, double y)
+{
+	vertices_.push_back(fpoint2_t(x, y));
+	n_map_vertices_ = vertices_.size();
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::addLine
+//
+// Adds a map line between vertices [v1] and [v2]. The sector indices are -1
+// if the line has no side there
+// ----------------------------------------------------------------------------
+void BSPBuilder::addLine(unsigned v1, unsigned v2, int front_sector, int back_sector)
+{
+	line_t line;
+	line.v1 = v1;
+	line.v2 = v2;
+	line.sector[0] = front_sector;
+	line.sector[1] = back_sector;
+	lines_.push_back(line);
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::loadMap
+//
+// Copies the vertices and lines of [map] as input
+// ----------------------------------------------------------------------------
+void BSPBuilder::loadMap(SLADEMap& map)
+{
+	clear();
+
+	vertices_.reserve(map.nVertices());
+	for (unsigned a = 0; a < map.nVertices(); a++)
+	{
+		MapVertex* vertex = map.getVertex(a);
+		addVertex(vertex->xPos(), vertex->yPos());
+	}
+
+	lines_.reserve(map.nLines());
+	for (unsigned a = 0; a < map.nLines(); a++)
+	{
+		MapLine* line = map.getLine(a);
+		MapSector* front = line->frontSector();
+		MapSector* back = line->backSector();
+		addLine(
+			line->v1Index(),
+			line->v2Index(),
+			front ? (int)front->getIndex() : -1,
+			back ? (int)back->getIndex() : -1
+		);
+	}
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::build
+//
+// Builds the BSP tree, including GL subsectors (closed with minisegs) if
+// [gl_nodes] is true. Returns false if there was nothing to build
+// ----------------------------------------------------------------------------
+bool BSPBuilder::build(bool gl_nodes)
+{
+	// Reset any previous build
+	vertices_.resize(n_map_vertices_);
+	segs_.clear();
+	nodes_.clear();
+	subsectors_.clear();
+	out_segs_.clear();
+	gl_segs_.clear();
+	n_splits_ = 0;
+	depth_ = 0;
+	gl_ = gl_nodes;
+
+	// Map vertices are reused if a split lands on one
+	vertex_map_.clear();
+	for (unsigned a = 0; a < vertices_.size(); a++)
+		vertex_map_.emplace(
+			((uint64_t)(uint32_t)lround(vertices_[a].x * 4096) << 32) | (uint32_t)lround(vertices_[a].y * 4096),
+			a
+		);
+
+	// Create initial segs (one per line side)
+	for (unsigned a = 0; a < lines_.size(); a++)
+	{
+		const line_t& line = lines_[a];
+		if (line.v1 >= n_map_vertices_ || line.v2 >= n_map_vertices_)
+			continue;
+		if (vertices_[line.v1].x == vertices_[line.v2].x && vertices_[line.v1].y == vertices_[line.v2].y)
+			continue;
+
+		if (line.sector[0] >= 0)
+			segs_.push_back({ line.v1, line.v2, a, 0 });
+		if (line.sector[1] >= 0)
+			segs_.push_back({ line.v2, line.v1, a, 1 });
+	}
+	if (segs_.empty())
+		return false;
+
+	// Initial cell (for GL subsectors) is the map bounds plus a margin
+	bbox_t bounds;
+	bool first = true;
+	for (unsigned a = 0; a < vertices_.size(); a++)
+		extendBBox(bounds, vertices_[a], first);
+	vector<fpoint2_t> cell;
+	if (gl_)
+	{
+		cell.push_back(fpoint2_t(bounds.min.x - 64, bounds.max.y + 64));
+		cell.push_back(fpoint2_t(bounds.max.x + 64, bounds.max.y + 64));
+		cell.push_back(fpoint2_t(bounds.max.x + 64, bounds.min.y - 64));
+		cell.push_back(fpoint2_t(bounds.min.x - 64, bounds.min.y - 64));
+	}
+
+	// Build tree
+	partition_stamp_.assign(lines_.size() * 2, 0);
+	stamp_ = 0;
+	vector<unsigned> segs(segs_.size());
+	for (unsigned a = 0; a < segs.size(); a++)
+		segs[a] = a;
+	bbox_t bbox;
+	buildNode(segs, cell, bbox, 1);
+
+	if (gl_)
+		linkGLPartners();
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::fitsVanilla
+//
+// Returns true if the built nodes are within the limits of the vanilla
+// nodes format
+// ----------------------------------------------------------------------------
+bool BSPBuilder::fitsVanilla() const
+{
+	return
+		vertices_.size() <= 65535 &&
+		out_segs_.size() <= 65535 &&
+		nodes_.size() < 32768 &&
+		subsectors_.size() < 32768 &&
+		lines_.size() <= 65535;
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::writeVanilla
+//
+// Writes the built nodes in vanilla format. [vertexes] gets the map vertices
+// followed by any new vertices created by seg splits. Returns false if the
+// nodes don't fit in the vanilla format
+// ----------------------------------------------------------------------------
+bool BSPBuilder::writeVanilla(MemChunk& vertexes, MemChunk& segs, MemChunk& ssectors, MemChunk& nodes) const
+{
+	if (!fitsVanilla())
+		return false;
+
+	vector<uint8_t> data;
+
+	// VERTEXES (map vertices are converted the same way as when saving)
+	data.reserve(vertices_.size() * 4);
+	for (unsigned a = 0; a < vertices_.size(); a++)
+	{
+		if (a < n_map_vertices_)
+		{
+			put<int16_t>(data, (short)vertices_[a].x);
+			put<int16_t>(data, (short)vertices_[a].y);
+		}
+		else
+		{
+			put<int16_t>(data, (short)lround(vertices_[a].x));
+			put<int16_t>(data, (short)lround(vertices_[a].y));
+		}
+	}
+	exportData(data, vertexes);
+
+	// SEGS
+	data.clear();
+	data.reserve(out_segs_.size() * 12);
+	for (unsigned a = 0; a < out_segs_.size(); a++)
+	{
+		const seg_t& seg = segs_[out_segs_[a]];
+		partition_t partition = segPartition(seg);
+		fpoint2_t start(partition.x, partition.y);
+		double angle = atan2(partition.dy, partition.dx);
+
+		put<uint16_t>(data, seg.v1);
+		put<uint16_t>(data, seg.v2);
+		put<uint16_t>(data, (uint16_t)(int)lround(angle * 32768.0 / PI));
+		put<uint16_t>(data, seg.line);
+		put<uint16_t>(data, seg.side);
+		put<int16_t>(data, (int16_t)lround(MathStuff::distance(start, vertices_[seg.v1])));
+	}
+	exportData(data, segs);
+
+	// SSECTORS
+	data.clear();
+	data.reserve(subsectors_.size() * 4);
+	for (unsigned a = 0; a < subsectors_.size(); a++)
+	{
+		put<uint16_t>(data, subsectors_[a].n_segs);
+		put<uint16_t>(data, subsectors_[a].first_seg);
+	}
+	exportData(data, ssectors);
+
+	// NODES
+	data.clear();
+	data.reserve(nodes_.size() * 28);
+	for (unsigned a = 0; a < nodes_.size(); a++)
+	{
+		const node_t& node = nodes_[a];
+		put<int16_t>(data, (int16_t)lround(node.partition.x));
+		put<int16_t>(data, (int16_t)lround(node.partition.y));
+		put<int16_t>(data, (int16_t)lround(node.partition.dx));
+		put<int16_t>(data, (int16_t)lround(node.partition.dy));
+		putBBox(data, node.bbox[0]);
+		putBBox(data, node.bbox[1]);
+		for (unsigned c = 0; c < 2; c++)
+		{
+			if (node.child[c] & subsector_flag)
+				put<uint16_t>(data, 0x8000 | (node.child[c] & ~subsector_flag));
+			else
+				put<uint16_t>(data, node.child[c]);
+		}
+	}
+	exportData(data, nodes);
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::writeExtended
+//
+// Writes the built nodes in ZDoom extended (XNOD) format, for the NODES lump.
+// The map vertices are not included, so VERTEXES can be left as it is
+// ----------------------------------------------------------------------------
+void BSPBuilder::writeExtended(MemChunk& nodes) const
+{
+	vector<uint8_t> data;
+	data.reserve(16 + (vertices_.size() - n_map_vertices_) * 8 + subsectors_.size() * 4 + out_segs_.size() * 11 + nodes_.size() * 32);
+	data.insert(data.end(), { 'X', 'N', 'O', 'D' });
+
+	// Vertices
+	put<uint32_t>(data, n_map_vertices_);
+	put<uint32_t>(data, vertices_.size() - n_map_vertices_);
+	for (unsigned a = n_map_vertices_; a < vertices_.size(); a++)
+	{
+		put<int32_t>(data, toFixed(vertices_[a].x));
+		put<int32_t>(data, toFixed(vertices_[a].y));
+	}
+
+	// Subsectors
+	put<uint32_t>(data, subsectors_.size());
+	for (unsigned a = 0; a < subsectors_.size(); a++)
+		put<uint32_t>(data, subsectors_[a].n_segs);
+
+	// Segs
+	put<uint32_t>(data, out_segs_.size());
+	for (unsigned a = 0; a < out_segs_.size(); a++)
+	{
+		const seg_t& seg = segs_[out_segs_[a]];
+		put<uint32_t>(data, seg.v1);
+		put<uint32_t>(data, seg.v2);
+		put<uint16_t>(data, seg.line);
+		put<uint8_t>(data, seg.side);
+	}
+
+	// Nodes
+	writeExtendedNodes(data, false);
+
+	exportData(data, nodes);
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::writeGL
+//
+// Writes the built nodes in ZDoom GL format, for the NODES lump (binary maps)
+// or ZNODES lump (UDMF). Uses XGLN if possible, XGL2 if there are too many
+// lines for 16-bit line indices or XGL3 if the map has non-integer vertices.
+// Returns false if GL nodes weren't built
+// ----------------------------------------------------------------------------
+bool BSPBuilder::writeGL(MemChunk& nodes) const
+{
+	if (!gl_)
+		return false;
+
+	// Check for fractional vertices (partition lines are always between map
+	// vertices)
+	bool fixed = false;
+	for (unsigned a = 0; a < n_map_vertices_; a++)
+	{
+		if (vertices_[a].x != floor(vertices_[a].x) || vertices_[a].y != floor(vertices_[a].y))
+		{
+			fixed = true;
+			break;
+		}
+	}
+	bool long_lines = fixed || lines_.size() >= 65535;
+
+	vector<uint8_t> data;
+	data.reserve(16 + (vertices_.size() - n_map_vertices_) * 8 + subsectors_.size() * 4 + gl_segs_.size() * 13 + nodes_.size() * 40);
+	if (fixed)
+		data.insert(data.end(), { 'X', 'G', 'L', '3' });
+	else if (long_lines)
+		data.insert(data.end(), { 'X', 'G', 'L', '2' });
+	else
+		data.insert(data.end(), { 'X', 'G', 'L', 'N' });
+
+	// Vertices
+	put<uint32_t>(data, n_map_vertices_);
+	put<uint32_t>(data, vertices_.size() - n_map_vertices_);
+	for (unsigned a = n_map_vertices_; a < vertices_.size(); a++)
+	{
+		put<int32_t>(data, toFixed(vertices_[a].x));
+		put<int32_t>(data, toFixed(vertices_[a].y));
+	}
+
+	// Subsectors
+	put<uint32_t>(data, subsectors_.size());
+	for (unsigned a = 0; a < subsectors_.size(); a++)
+		put<uint32_t>(data, subsectors_[a].n_gl_segs);
+
+	// Segs (the second vertex is implied by the next seg in the subsector)
+	put<uint32_t>(data, gl_segs_.size());
+	for (unsigned a = 0; a < gl_segs_.size(); a++)
+	{
+		const gl_seg_t& seg = gl_segs_[a];
+		put<uint32_t>(data, seg.v1);
+		put<uint32_t>(data, seg.partner);
+		if (long_lines)
+			put<uint32_t>(data, seg.line < 0 ? 0xFFFFFFFF : (uint32_t)seg.line);
+		else
+			put<uint16_t>(data, seg.line < 0 ? 0xFFFF : (uint16_t)seg.line);
+		put<uint8_t>(data, seg.side);
+	}
+
+	// Nodes
+	writeExtendedNodes(data, fixed);
+
+	exportData(data, nodes);
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::getTree
+//
+// Writes the built tree to [tree]
+// ----------------------------------------------------------------------------
+void BSPBuilder::getTree(tree_t& tree) const
+{
+	tree.nodes.resize(nodes_.size());
+	for (unsigned a = 0; a < nodes_.size(); a++)
+	{
+		const node_t& node = nodes_[a];
+		tree.nodes[a] = { node.partition.x, node.partition.y, node.partition.dx, node.partition.dy, { node.child[0], node.child[1] } };
+	}
+
+	tree.subsector_sectors.resize(subsectors_.size());
+	for (unsigned a = 0; a < subsectors_.size(); a++)
+	{
+		const seg_t& seg = segs_[out_segs_[subsectors_[a].first_seg]];
+		tree.subsector_sectors[a] = lineSector(seg.line, seg.side);
+	}
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::readTree
+//
+// Reads a BSP tree from [nodes] (and [segs]/[ssectors] for vanilla format
+// nodes) into [tree]. Supports vanilla, ZDoom extended and ZDoom GL nodes,
+// compressed or not. Returns false if the data is invalid
+// ----------------------------------------------------------------------------
+bool BSPBuilder::readTree(MemChunk& nodes, MemChunk* segs, MemChunk* ssectors, tree_t& tree) const
+{
+	tree.nodes.clear();
+	tree.subsector_sectors.clear();
+
+	// Check for ZDoom nodes
+	char format[5] = { 0, 0, 0, 0, 0 };
+	if (nodes.getSize() >= 4)
+		memcpy(format, nodes.getData(), 4);
+	if (strcmp(format, "XNOD") == 0 || strcmp(format, "ZNOD") == 0 ||
+		strcmp(format, "XGLN") == 0 || strcmp(format, "ZGLN") == 0 ||
+		strcmp(format, "XGL2") == 0 || strcmp(format, "ZGL2") == 0 ||
+		strcmp(format, "XGL3") == 0 || strcmp(format, "ZGL3") == 0)
+	{
+		// Decompress if needed
+		MemChunk data(nodes.getData() + 4, nodes.getSize() - 4);
+		if (format[0] == 'Z')
+		{
+			MemChunk compressed;
+			compressed.importMem(data.getData(), data.getSize());
+			if (!Compression::ZlibInflate(compressed, data))
+				return false;
+		}
+		LumpReader reader(data.getData(), data.getSize());
+		bool long_lines = format[3] == '2' || format[3] == '3';
+		bool fixed = format[3] == '3';
+
+		// Vertices (not needed)
+		uint32_t n_org_verts, n_new_verts;
+		if (!reader.read(n_org_verts) || !reader.read(n_new_verts) || !reader.skip((size_t)n_new_verts * 8))
+			return false;
+
+		// Subsector seg counts
+		uint32_t n_subsectors;
+		if (!reader.read(n_subsectors) || n_subsectors > data.getSize() / 4)
+			return false;
+		vector<uint32_t> seg_counts(n_subsectors);
+		for (unsigned a = 0; a < n_subsectors; a++)
+			if (!reader.read(seg_counts[a]))
+				return false;
+
+		// Segs (only line and side are needed)
+		uint32_t n_segs;
+		if (!reader.read(n_segs) || n_segs > data.getSize() / 11)
+			return false;
+		vector<int> seg_sectors(n_segs);
+		for (unsigned a = 0; a < n_segs; a++)
+		{
+			uint32_t line;
+			uint16_t short_line;
+			uint8_t side;
+			if (!reader.skip(8))
+				return false;
+			if (long_lines)
+			{
+				if (!reader.read(line))
+					return false;
+			}
+			else
+			{
+				if (!reader.read(short_line))
+					return false;
+				line = short_line == 0xFFFF ? 0xFFFFFFFF : short_line;
+			}
+			if (!reader.read(side))
+				return false;
+			seg_sectors[a] = line == 0xFFFFFFFF ? -1 : lineSector(line, side);
+		}
+
+		// Subsector sectors (from the first seg that isn't a miniseg)
+		tree.subsector_sectors.resize(n_subsectors, -1);
+		size_t first = 0;
+		for (unsigned a = 0; a < n_subsectors; a++)
+		{
+			for (size_t s = first; s < first + seg_counts[a] && s < n_segs; s++)
+			{
+				if (seg_sectors[s] >= 0)
+				{
+					tree.subsector_sectors[a] = seg_sectors[s];
+					break;
+				}
+			}
+			first += seg_counts[a];
+		}
+
+		// Nodes
+		uint32_t n_nodes;
+		if (!reader.read(n_nodes) || n_nodes > data.getSize() / 32)
+			return false;
+		tree.nodes.resize(n_nodes);
+		for (unsigned a = 0; a < n_nodes; a++)
+		{
+			tree_t::node_t& node = tree.nodes[a];
+			if (fixed)
+			{
+				int32_t partition[4];
+				for (unsigned p = 0; p < 4; p++)
+					if (!reader.read(partition[p]))
+						return false;
+				node.x = partition[0] / 65536.0;
+				node.y = partition[1] / 65536.0;
+				node.dx = partition[2] / 65536.0;
+				node.dy = partition[3] / 65536.0;
+			}
+			else
+			{
+				int16_t partition[4];
+				for (unsigned p = 0; p < 4; p++)
+					if (!reader.read(partition[p]))
+						return false;
+				node.x = partition[0];
+				node.y = partition[1];
+				node.dx = partition[2];
+				node.dy = partition[3];
+			}
+			uint32_t child[2];
+			if (!reader.skip(16) || !reader.read(child[0]) || !reader.read(child[1]))
+				return false;
+			node.child[0] = child[0];
+			node.child[1] = child[1];
+		}
+
+		return true;
+	}
+
+	// Vanilla nodes
+	if (!segs || !ssectors)
+		return false;
+
+	// Segs
+	LumpReader seg_reader(segs->getData(), segs->getSize());
+	vector<int> seg_sectors(segs->getSize() / 12);
+	for (unsigned a = 0; a < seg_sectors.size(); a++)
+	{
+		uint16_t line, side;
+		if (!seg_reader.skip(6) || !seg_reader.read(line) || !seg_reader.read(side) || !seg_reader.skip(2))
+			return false;
+		seg_sectors[a] = lineSector(line, side);
+	}
+
+	// Subsectors
+	LumpReader ss_reader(ssectors->getData(), ssectors->getSize());
+	tree.subsector_sectors.resize(ssectors->getSize() / 4, -1);
+	for (unsigned a = 0; a < tree.subsector_sectors.size(); a++)
+	{
+		uint16_t count, first;
+		if (!ss_reader.read(count) || !ss_reader.read(first))
+			return false;
+		if (count > 0 && first < seg_sectors.size())
+			tree.subsector_sectors[a] = seg_sectors[first];
+	}
+
+	// Nodes
+	LumpReader node_reader(nodes.getData(), nodes.getSize());
+	tree.nodes.resize(nodes.getSize() / 28);
+	for (unsigned a = 0; a < tree.nodes.size(); a++)
+	{
+		tree_t::node_t& node = tree.nodes[a];
+		int16_t partition[4];
+		uint16_t child[2];
+		for (unsigned p = 0; p < 4; p++)
+			if (!node_reader.read(partition[p]))
+				return false;
+		if (!node_reader.skip(16) || !node_reader.read(child[0]) || !node_reader.read(child[1]))
+			return false;
+
+		node.x = partition[0];
+		node.y = partition[1];
+		node.dx = partition[2];
+		node.dy = partition[3];
+		for (unsigned c = 0; c < 2; c++)
+			node.child[c] = (child[c] & 0x8000) ? (subsector_flag | (child[c] & 0x7FFF)) : child[c];
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::segPartition
+//
+// Returns the partition line along [seg]. This always goes between the
+// original vertices of the seg's line, so it is exact even if the seg was
+// split
+// ----------------------------------------------------------------------------
+BSPBuilder::partition_t BSPBuilder::segPartition(const seg_t& seg) const
+{
+	const line_t& line = lines_[seg.line];
+	fpoint2_t start = vertices_[seg.side == 0 ? line.v1 : line.v2];
+	fpoint2_t end = vertices_[seg.side == 0 ? line.v2 : line.v1];
+
+	partition_t partition;
+	partition.x = start.x;
+	partition.y = start.y;
+	partition.dx = end.x - start.x;
+	partition.dy = end.y - start.y;
+	partition.length = sqrt(partition.dx * partition.dx + partition.dy * partition.dy);
+	return partition;
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::pointSide
+//
+// Returns the distance of [point] from [partition], positive if it is on the
+// right (front) side
+// ----------------------------------------------------------------------------
+double BSPBuilder::pointSide(const partition_t& partition, fpoint2_t point)
+{
+	return (partition.dy * (point.x - partition.x) - partition.dx * (point.y - partition.y)) / partition.length;
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::classifySeg
+//
+// Returns 0 if [seg] is in front of [partition], 1 if it is behind or 2 if it
+// needs splitting. Segs along the partition line go in front if they face
+// the same way. The distances of the seg vertices from the partition are
+// written to [d1] and [d2]
+// ----------------------------------------------------------------------------
+int BSPBuilder::classifySeg(const partition_t& partition, const seg_t& seg, double& d1, double& d2) const
+{
+	const fpoint2_t& v1 = vertices_[seg.v1];
+	const fpoint2_t& v2 = vertices_[seg.v2];
+	d1 = pointSide(partition, v1);
+	d2 = pointSide(partition, v2);
+
+	// Along partition
+	if (fabs(d1) < side_epsilon && fabs(d2) < side_epsilon)
+		return ((v2.x - v1.x) * partition.dx + (v2.y - v1.y) * partition.dy) > 0 ? 0 : 1;
+
+	if (d1 > -side_epsilon && d2 > -side_epsilon)
+		return 0;
+	if (d1 < side_epsilon && d2 < side_epsilon)
+		return 1;
+
+	return 2;
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::vertexAt
+//
+// Returns the index of the vertex at [x,y], adding a new one if needed
+// ----------------------------------------------------------------------------
+unsigned BSPBuilder::vertexAt(double x, double y)
+{
+	uint64_t key = ((uint64_t)(uint32_t)lround(x * 4096) << 32) | (uint32_t)lround(y * 4096);
+	auto inserted = vertex_map_.emplace(key, vertices_.size());
+	if (inserted.second)
+		vertices_.push_back(fpoint2_t(x, y));
+
+	return inserted.first->second;
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::lineSector
+//
+// Returns the sector on [side] of [line], or -1 if invalid
+// ----------------------------------------------------------------------------
+int BSPBuilder::lineSector(unsigned line, unsigned side) const
+{
+	if (line >= lines_.size() || side > 1)
+		return -1;
+
+	return lines_[line].sector[side];
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::chooseCandidate
+//
+// Returns the index of the seg in [segs] to partition along, or -1 if [segs]
+// form a convex region and don't need partitioning
+// ----------------------------------------------------------------------------
+int BSPBuilder::chooseCandidate(const vector<unsigned>& segs)
+{
+	// Get one candidate seg per line side
+	stamp_++;
+	vector<unsigned> all_candidates;
+	for (unsigned a = 0; a < segs.size(); a++)
+	{
+		const seg_t& seg = segs_[segs[a]];
+		unsigned& stamp = partition_stamp_[seg.line * 2 + seg.side];
+		if (stamp != stamp_)
+		{
+			stamp = stamp_;
+			all_candidates.push_back(segs[a]);
+		}
+	}
+
+	// Select evenly spaced candidates if there are too many
+	vector<unsigned> candidates;
+	if (all_candidates.size() > max_candidates)
+	{
+		for (unsigned a = 0; a < max_candidates; a++)
+			candidates.push_back(all_candidates[(size_t)a * all_candidates.size() / max_candidates]);
+	}
+	else
+		candidates.swap(all_candidates);
+
+	// Checks candidates [begin, end), returning the first with the lowest cost
+	auto check_range = [&](const vector<unsigned>& list, size_t begin, size_t end)
+	{
+		candidate_t best = { 0, INT_MAX };
+		for (size_t a = begin; a < end; a++)
+		{
+			candidate_t candidate = evaluateCandidate(list[a], segs, best.cost);
+			if (candidate.cost < best.cost)
+				best = candidate;
+		}
+		return best;
+	};
+
+	// Checks all [candidates], in parallel if worthwhile. The result is the
+	// same as checking them in order
+	auto check_all = [&](const vector<unsigned>& list)
+	{
+		if (segs.size() * list.size() < parallel_min_work)
+			return check_range(list, 0, list.size());
+
+		vector<candidate_t> range_best(ThreadPool::nThreads() + 1, { 0, INT_MAX });
+		unsigned n_ranges = ThreadPool::parallelForRanges(
+			list.size(),
+			[&](size_t begin, size_t end, unsigned range) { range_best[range] = check_range(list, begin, end); },
+			4
+		);
+
+		candidate_t best = { 0, INT_MAX };
+		for (unsigned a = 0; a < n_ranges; a++)
+			if (range_best[a].cost < best.cost)
+				best = range_best[a];
+		return best;
+	};
+
+	candidate_t best = check_all(candidates);
+
+	// If none of the selected candidates divide the segs, check the rest
+	// before deciding they are convex
+	if (best.cost == INT_MAX && !all_candidates.empty())
+		best = check_all(all_candidates);
+
+	return best.cost == INT_MAX ? -1 : (int)best.seg;
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::evaluateCandidate
+//
+// Returns the cost of partitioning [segs] along [candidate]. The cost is
+// INT_MAX if the partition doesn't divide the segs, or if it is found to be
+// more than [best_cost] (no point continuing then)
+// ----------------------------------------------------------------------------
+BSPBuilder::candidate_t BSPBuilder::evaluateCandidate(unsigned candidate, const vector<unsigned>& segs, int best_cost) const
+{
+	partition_t partition = segPartition(segs_[candidate]);
+	int front = 0;
+	int back = 0;
+	int splits = 0;
+	double d1, d2;
+	for (unsigned a = 0; a < segs.size(); a++)
+	{
+		switch (classifySeg(partition, segs_[segs[a]], d1, d2))
+		{
+		case 0: front++; break;
+		case 1: back++; break;
+		default:
+			front++;
+			back++;
+			splits++;
+			if (splits * split_cost > best_cost)
+				return { candidate, INT_MAX };
+			break;
+		}
+	}
+
+	if (front == 0 || back == 0)
+		return { candidate, INT_MAX };
+
+	return { candidate, splits * split_cost + abs(front - back) };
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::splitSegs
+//
+// Sorts [segs] into [front] and [back] of [partition], splitting any that
+// cross it. [segs] is cleared
+// ----------------------------------------------------------------------------
+void BSPBuilder::splitSegs(const partition_t& partition, vector<unsigned>& segs, vector<unsigned>& front, vector<unsigned>& back)
+{
+	double d1, d2;
+	for (unsigned a = 0; a < segs.size(); a++)
+	{
+		unsigned index = segs[a];
+		int side = classifySeg(partition, segs_[index], d1, d2);
+		if (side == 0)
+		{
+			front.push_back(index);
+			continue;
+		}
+		if (side == 1)
+		{
+			back.push_back(index);
+			continue;
+		}
+
+		// Split at the intersection
+		seg_t seg = segs_[index];
+		const fpoint2_t v1 = vertices_[seg.v1];
+		const fpoint2_t v2 = vertices_[seg.v2];
+		double t = d1 / (d1 - d2);
+		unsigned vertex = vertexAt(v1.x + t * (v2.x - v1.x), v1.y + t * (v2.y - v1.y));
+
+		// Don't split if the split point ended up at one of the ends, just
+		// put the seg on the side it is mostly on
+		if (vertex == seg.v1 || vertex == seg.v2)
+		{
+			if (fabs(d1) > fabs(d2))
+				(d1 > 0 ? front : back).push_back(index);
+			else
+				(d2 > 0 ? front : back).push_back(index);
+			continue;
+		}
+
+		seg_t second = seg;
+		second.v1 = vertex;
+		segs_[index].v2 = vertex;
+		segs_.push_back(second);
+		n_splits_++;
+
+		(d1 > 0 ? front : back).push_back(index);
+		(d2 > 0 ? front : back).push_back(segs_.size() - 1);
+	}
+
+	segs.clear();
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::buildNode
+//
+// Builds the subtree for [segs] (which is cleared), with [cell] being the
+// convex area covered by the subtree. Returns the index of the new node, or
+// the new subsector's index with subsector_flag set if [segs] is convex.
+// The bounds of the subtree are written to [bbox]
+// ----------------------------------------------------------------------------
+unsigned BSPBuilder::buildNode(vector<unsigned>& segs, const vector<fpoint2_t>& cell, bbox_t& bbox, unsigned depth)
+{
+	depth_ = MAX(depth_, depth);
+
+	// Create a subsector if no partition is needed
+	int candidate = chooseCandidate(segs);
+	if (candidate < 0)
+		return buildSubsector(segs, cell, bbox) | subsector_flag;
+
+	// Split segs
+	node_t node;
+	node.partition = segPartition(segs_[candidate]);
+	vector<unsigned> front, back;
+	splitSegs(node.partition, segs, front, back);
+	vector<unsigned>().swap(segs);
+
+	// Split cell
+	vector<fpoint2_t> cell_front, cell_back;
+	if (gl_)
+	{
+		clipCell(cell, node.partition, true, cell_front);
+		clipCell(cell, node.partition, false, cell_back);
+	}
+
+	// Build children
+	node.child[0] = buildNode(front, cell_front, node.bbox[0], depth + 1);
+	node.child[1] = buildNode(back, cell_back, node.bbox[1], depth + 1);
+	nodes_.push_back(node);
+
+	bool first = true;
+	for (unsigned c = 0; c < 2; c++)
+	{
+		extendBBox(bbox, node.bbox[c].min, first);
+		extendBBox(bbox, node.bbox[c].max, first);
+	}
+
+	return nodes_.size() - 1;
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::buildSubsector
+//
+// Creates a subsector from [segs] and returns its index. [cell] is the
+// convex area covered by the subsector (for GL nodes). The bounds of the
+// subsector are written to [bbox]
+// ----------------------------------------------------------------------------
+unsigned BSPBuilder::buildSubsector(const vector<unsigned>& segs, const vector<fpoint2_t>& cell, bbox_t& bbox)
+{
+	subsector_t subsector;
+	subsector.first_seg = out_segs_.size();
+	subsector.n_segs = segs.size();
+	out_segs_.insert(out_segs_.end(), segs.begin(), segs.end());
+
+	bool first = true;
+	for (unsigned a = 0; a < segs.size(); a++)
+	{
+		extendBBox(bbox, vertices_[segs_[segs[a]].v1], first);
+		extendBBox(bbox, vertices_[segs_[segs[a]].v2], first);
+	}
+
+	subsector.first_gl_seg = gl_segs_.size();
+	subsector.n_gl_segs = 0;
+	if (gl_)
+	{
+		buildGLLoop(segs, cell);
+		subsector.n_gl_segs = gl_segs_.size() - subsector.first_gl_seg;
+		for (unsigned a = subsector.first_gl_seg; a < gl_segs_.size(); a++)
+			extendBBox(bbox, vertices_[gl_segs_[a].v1], first);
+	}
+
+	subsectors_.push_back(subsector);
+	return subsectors_.size() - 1;
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::buildGLLoop
+//
+// Adds GL segs for a subsector made of [segs], in clockwise order and with
+// any gaps between them (where the subsector is bounded by partition lines
+// rather than map lines) closed with minisegs. The corners of the subsector
+// are found by clipping its [cell] to the front of all its segs
+// ----------------------------------------------------------------------------
+void BSPBuilder::buildGLLoop(const vector<unsigned>& segs, const vector<fpoint2_t>& cell)
+{
+	// Get subsector area
+	vector<fpoint2_t> polygon = cell;
+	vector<fpoint2_t> clipped;
+	for (unsigned a = 0; a < segs.size() && polygon.size() >= 3; a++)
+	{
+		clipCell(polygon, segPartition(segs_[segs[a]]), true, clipped);
+		polygon.swap(clipped);
+	}
+
+	// Get loop points - seg vertices plus area corners (snapped to seg
+	// vertices where close enough)
+	vector<unsigned> points;
+	for (unsigned a = 0; a < segs.size(); a++)
+	{
+		points.push_back(segs_[segs[a]].v1);
+		points.push_back(segs_[segs[a]].v2);
+	}
+	unsigned n_seg_points = points.size();
+	if (polygon.size() >= 3)
+	{
+		for (unsigned a = 0; a < polygon.size(); a++)
+		{
+			int snap = -1;
+			double snap_dist = snap_distance;
+			for (unsigned p = 0; p < n_seg_points; p++)
+			{
+				double dist = MathStuff::distance(polygon[a], vertices_[points[p]]);
+				if (dist < snap_dist)
+				{
+					snap = points[p];
+					snap_dist = dist;
+				}
+			}
+			points.push_back(snap >= 0 ? (unsigned)snap : vertexAt(polygon[a].x, polygon[a].y));
+		}
+	}
+	std::sort(points.begin(), points.end());
+	points.erase(std::unique(points.begin(), points.end()), points.end());
+
+	// Sort points clockwise around the centre
+	fpoint2_t centre;
+	for (unsigned a = 0; a < points.size(); a++)
+	{
+		centre.x += vertices_[points[a]].x;
+		centre.y += vertices_[points[a]].y;
+	}
+	centre.x /= points.size();
+	centre.y /= points.size();
+	vector<std::pair<double, unsigned>> sorted(points.size());
+	for (unsigned a = 0; a < points.size(); a++)
+	{
+		const fpoint2_t& point = vertices_[points[a]];
+		sorted[a] = std::make_pair(-atan2(point.y - centre.y, point.x - centre.x), points[a]);
+	}
+	std::sort(sorted.begin(), sorted.end());
+	unsigned n = sorted.size();
+
+	// Start the loop at the start of a seg, so the subsector's first GL seg
+	// is a real one
+	auto position = [&](unsigned vertex)
+	{
+		for (unsigned a = 0; a < n; a++)
+			if (sorted[a].second == vertex)
+				return a;
+		return n;
+	};
+	unsigned pos = position(segs_[segs[0]].v1);
+
+	// Go around the loop, following segs where they exist and adding
+	// minisegs between them
+	vector<bool> used(segs.size(), false);
+	unsigned travelled = 0;
+	while (travelled < n)
+	{
+		unsigned vertex = sorted[pos].second;
+
+		// Find the unused seg starting here that goes the shortest way
+		// around
+		int next_seg = -1;
+		unsigned next_step = n + 1;
+		unsigned next_pos = 0;
+		for (unsigned a = 0; a < segs.size(); a++)
+		{
+			const seg_t& seg = segs_[segs[a]];
+			if (used[a] || seg.v1 != vertex)
+				continue;
+
+			unsigned end = position(seg.v2);
+			unsigned step = (end + n - pos) % n;
+			if (step == 0)
+				step = n;
+			if (step < next_step)
+			{
+				next_seg = a;
+				next_step = step;
+				next_pos = end;
+			}
+		}
+
+		if (next_seg >= 0)
+		{
+			const seg_t& seg = segs_[segs[next_seg]];
+			gl_segs_.push_back({ seg.v1, seg.v2, (int)seg.line, seg.side, no_partner });
+			used[next_seg] = true;
+			travelled += next_step;
+			pos = next_pos;
+		}
+		else
+		{
+			// Miniseg to the next point
+			unsigned next = (pos + 1) % n;
+			gl_segs_.push_back({ vertex, sorted[next].second, -1, 0, no_partner });
+			travelled++;
+			pos = next;
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::linkGLPartners
+//
+// Sets the partner of each GL seg to the seg going the opposite way between
+// the same vertices, if there is one
+// ----------------------------------------------------------------------------
+void BSPBuilder::linkGLPartners()
+{
+	std::unordered_map<uint64_t, unsigned> seg_map;
+	seg_map.reserve(gl_segs_.size());
+	for (unsigned a = 0; a < gl_segs_.size(); a++)
+		seg_map[((uint64_t)gl_segs_[a].v1 << 32) | gl_segs_[a].v2] = a;
+
+	for (unsigned a = 0; a < gl_segs_.size(); a++)
+	{
+		auto partner = seg_map.find(((uint64_t)gl_segs_[a].v2 << 32) | gl_segs_[a].v1);
+		if (partner != seg_map.end())
+			gl_segs_[a].partner = partner->second;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::writeExtendedNodes
+//
+// Writes the nodes section of ZDoom extended/GL nodes to [data], with fixed
+// point partition lines if [fixed] is true
+// ----------------------------------------------------------------------------
+void BSPBuilder::writeExtendedNodes(vector<uint8_t>& data, bool fixed) const
+{
+	put<uint32_t>(data, nodes_.size());
+	for (unsigned a = 0; a < nodes_.size(); a++)
+	{
+		const node_t& node = nodes_[a];
+		if (fixed)
+		{
+			put<int32_t>(data, toFixed(node.partition.x));
+			put<int32_t>(data, toFixed(node.partition.y));
+			put<int32_t>(data, toFixed(node.partition.dx));
+			put<int32_t>(data, toFixed(node.partition.dy));
+		}
+		else
+		{
+			put<int16_t>(data, (int16_t)lround(node.partition.x));
+			put<int16_t>(data, (int16_t)lround(node.partition.y));
+			put<int16_t>(data, (int16_t)lround(node.partition.dx));
+			put<int16_t>(data, (int16_t)lround(node.partition.dy));
+		}
+		putBBox(data, node.bbox[0]);
+		putBBox(data, node.bbox[1]);
+		put<uint32_t>(data, node.child[0]);
+		put<uint32_t>(data, node.child[1]);
+	}
+}
+
+// ----------------------------------------------------------------------------
+// BSPBuilder::clipCell
+//
+// Clips the convex polygon [cell] to the [front] (or back) side of
+// [partition], writing the result to [out]
+// ----------------------------------------------------------------------------
+void BSPBuilder::clipCell(const vector<fpoint2_t>& cell, const partition_t& partition, bool front, vector<fpoint2_t>& out)
+{
+	out.clear();
+	for (unsigned a = 0; a < cell.size(); a++)
+	{
+		const fpoint2_t& p1 = cell[a];
+		const fpoint2_t& p2 = cell[(a + 1) % cell.size()];
+		double d1 = pointSide(partition, p1);
+		double d2 = pointSide(partition, p2);
+		if (!front)
+		{
+			d1 = -d1;
+			d2 = -d2;
+		}
+
+		if (d1 > -side_epsilon)
+			out.push_back(p1);
+		if ((d1 > side_epsilon && d2 < -side_epsilon) || (d1 < -side_epsilon && d2 > side_epsilon))
+		{
+			double t = d1 / (d1 - d2);
+			out.push_back(fpoint2_t(p1.x + t * (p2.x - p1.x), p1.y + t * (p2.y - p1.y)));
+		}
+	}
+}
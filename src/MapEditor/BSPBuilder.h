@@ -0,0 +1,158 @@
+#pragma once
+
+#include <unordered_map>
+
+class MemChunk;
+class SLADEMap;
+
+// Builds BSP nodes for a map in memory, without going through an external
+// node builder. The map geometry is copied in (via loadMap or addVertex/
+// addLine), build() generates the tree and the result can then be written in
+// vanilla (VERTEXES/SEGS/SSECTORS/NODES), ZDoom extended or ZDoom GL format.
+//
+// Partition candidates for each node are evaluated in parallel on the thread
+// pool. The choice of partition doesn't depend on the number of threads, so
+// the output is always the same for the same map
+class BSPBuilder
+{
+public:
+	// A BSP tree read back from nodes lumps, used to check which sector a
+	// point is in (for validating built nodes)
+	struct tree_t
+	{
+		struct node_t
+		{
+			double		x, y, dx, dy;
+			unsigned	child[2];	// Right, left
+		};
+
+		vector<node_t>	nodes;					// Root node is last
+		vector<int>		subsector_sectors;
+
+		int	sectorAt(double x, double y) const;
+	};
+
+	BSPBuilder() {}
+	~BSPBuilder() {}
+
+	// Input
+	void	clear();
+	void	addVertex(double x, double y);
+	void	addLine(unsigned v1, unsigned v2, int front_sector, int back_sector);
+	void	loadMap(SLADEMap& map);
+
+	// Building
+	bool	build(bool gl_nodes);
+
+	unsigned	nNodes() const { return nodes_.size(); }
+	unsigned	nSubsectors() const { return subsectors_.size(); }
+	unsigned	nSegs() const { return out_segs_.size(); }
+	unsigned	nGLSegs() const { return gl_segs_.size(); }
+	unsigned	nSplits() const { return n_splits_; }
+	unsigned	nNewVertices() const { return vertices_.size() - n_map_vertices_; }
+	unsigned	depth() const { return depth_; }
+	bool		fitsVanilla() const;
+
+	// Output
+	bool	writeVanilla(MemChunk& vertexes, MemChunk& segs, MemChunk& ssectors, MemChunk& nodes) const;
+	void	writeExtended(MemChunk& nodes) const;
+	bool	writeGL(MemChunk& nodes) const;
+	void	getTree(tree_t& tree) const;
+
+	// Reads nodes built by this or any other node builder. [segs] and
+	// [ssectors] are only needed for vanilla format nodes. Subsector sectors
+	// are taken from the lines given as input
+	bool	readTree(MemChunk& nodes, MemChunk* segs, MemChunk* ssectors, tree_t& tree) const;
+
+private:
+	struct line_t
+	{
+		unsigned	v1;
+		unsigned	v2;
+		int			sector[2];	// Front, back (-1 if no side)
+	};
+
+	struct seg_t
+	{
+		unsigned	v1;
+		unsigned	v2;
+		unsigned	line;
+		uint8_t		side;
+	};
+
+	struct partition_t
+	{
+		double	x, y, dx, dy;
+		double	length;
+	};
+
+	struct node_t
+	{
+		partition_t	partition;
+		bbox_t		bbox[2];	// Right, left
+		unsigned	child[2];	// Right, left (subsectors have the top bit set)
+	};
+
+	struct subsector_t
+	{
+		unsigned	first_seg;
+		unsigned	n_segs;
+		unsigned	first_gl_seg;
+		unsigned	n_gl_segs;
+	};
+
+	// GL segs include minisegs (line -1) and always form a closed loop
+	// around their subsector
+	struct gl_seg_t
+	{
+		unsigned	v1;
+		unsigned	v2;
+		int			line;
+		uint8_t		side;
+		unsigned	partner;
+	};
+
+	struct candidate_t
+	{
+		unsigned	seg;
+		int			cost;
+	};
+
+	// Input
+	vector<fpoint2_t>	vertices_;
+	vector<line_t>		lines_;
+	unsigned			n_map_vertices_	= 0;
+
+	// Working data
+	vector<seg_t>								segs_;
+	std::unordered_map<uint64_t, unsigned>		vertex_map_;
+	vector<unsigned>							partition_stamp_;
+	unsigned									stamp_			= 0;
+	bool										gl_				= false;
+	unsigned									n_splits_		= 0;
+	unsigned									depth_			= 0;
+
+	// Output
+	vector<node_t>		nodes_;
+	vector<subsector_t>	subsectors_;
+	vector<unsigned>	out_segs_;		// Indices into segs_
+	vector<gl_seg_t>	gl_segs_;
+
+	partition_t	segPartition(const seg_t& seg) const;
+	int			classifySeg(const partition_t& partition, const seg_t& seg, double& d1, double& d2) const;
+	unsigned	vertexAt(double x, double y);
+
+	int			chooseCandidate(const vector<unsigned>& segs);
+	candidate_t	evaluateCandidate(unsigned candidate, const vector<unsigned>& segs, int best_cost) const;
+	void		splitSegs(const partition_t& partition, vector<unsigned>& segs, vector<unsigned>& front, vector<unsigned>& back);
+	unsigned	buildNode(vector<unsigned>& segs, const vector<fpoint2_t>& cell, bbox_t& bbox, unsigned depth);
+	unsigned	buildSubsector(const vector<unsigned>& segs, const vector<fpoint2_t>& cell, bbox_t& bbox);
+	void		buildGLLoop(const vector<unsigned>& segs, const vector<fpoint2_t>& cell);
+	void		linkGLPartners();
+
+	void		writeExtendedNodes(vector<uint8_t>& data, bool fixed) const;
+	int			lineSector(unsigned line, unsigned side) const;
+
+	static double	pointSide(const partition_t& partition, fpoint2_t point);
+	static void		clipCell(const vector<fpoint2_t>& cell, const partition_t& partition, bool front, vector<fpoint2_t>& out);
+};
@@ -0,0 +1,230 @@
+// ----------------------------------------------------------------------------
+// SLADE - It's a Doom Editor
+// Copyright(C) 2008 - 2017 Simon Judd
+//
+// Email:       sirjuddington@gmail.com
+// Web:         http://slade.mancubus.net
+// Filename:    BlockmapBuilder.cpp
+// Description: BlockmapBuilder class - builds BLOCKMAP lumps for binary
+//              format maps
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301, USA.
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+//
+// Includes
+//
+// ----------------------------------------------------------------------------
+#include "Main.h"
+#include "BlockmapBuilder.h"
+#include "SLADEMap/SLADEMap.h"
+
+
+// ----------------------------------------------------------------------------
+//
+// Variables
+//
+// ----------------------------------------------------------------------------
+namespace
+{
+	const int	block_size	= 128;
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// BlockmapBuilder Class Functions
+//
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+// BlockmapBuilder::clear
+//
+// Clears all lines
+// ----------------------------------------------------------------------------
+void BlockmapBuilder::clear()
+{
+	lines_.clear();
+	origin_x_ = 0;
+	origin_y_ = 0;
+	columns_ = 0;
+	rows_ = 0;
+	n_blocklists_ = 0;
+}
+
+// ----------------------------------------------------------------------------
+// BlockmapBuilder::addLine
+//
+// Adds a line from [v1] to [v2]. Lines are numbered in the order they are
+// added
+// ----------------------------------------------------------------------------
+void BlockmapBuilder::addLine(fpoint2_t v1, fpoint2_t v2)
+{
+	lines_.push_back({ v1, v2 });
+}
+
+// ----------------------------------------------------------------------------
+// BlockmapBuilder::loadMap
+//
+// Adds all lines in [map], with the vertex positions they are saved with
+// ----------------------------------------------------------------------------
+void BlockmapBuilder::loadMap(SLADEMap& map)
+{
+	clear();
+	lines_.reserve(map.nLines());
+	for (unsigned a = 0; a < map.nLines(); a++)
+	{
+		MapLine* line = map.getLine(a);
+		addLine(
+			fpoint2_t((short)line->x1(), (short)line->y1()),
+			fpoint2_t((short)line->x2(), (short)line->y2())
+		);
+	}
+}
+
+// ----------------------------------------------------------------------------
+// BlockmapBuilder::build
+//
+// Builds the BLOCKMAP lump data into [out], sharing identical blocklists if
+// [compress] is true. Returns false (and leaves [out] empty) if there are no
+// lines or the result doesn't fit in the BLOCKMAP format
+// ----------------------------------------------------------------------------
+bool BlockmapBuilder::build(MemChunk& out, bool compress)
+{
+	out.clear();
+	columns_ = 0;
+	rows_ = 0;
+	n_blocklists_ = 0;
+	if (lines_.empty() || lines_.size() > 65535)
+		return false;
+
+	// Get grid origin and size
+	double min_x = lines_[0].v1.x;
+	double min_y = lines_[0].v1.y;
+	double max_x = min_x;
+	double max_y = min_y;
+	for (unsigned a = 0; a < lines_.size(); a++)
+	{
+		min_x = MIN(min_x, MIN(lines_[a].v1.x, lines_[a].v2.x));
+		min_y = MIN(min_y, MIN(lines_[a].v1.y, lines_[a].v2.y));
+		max_x = MAX(max_x, MAX(lines_[a].v1.x, lines_[a].v2.x));
+		max_y = MAX(max_y, MAX(lines_[a].v1.y, lines_[a].v2.y));
+	}
+	origin_x_ = (int)floor(min_x) - 8;
+	origin_y_ = (int)floor(min_y) - 8;
+	columns_ = (unsigned)((max_x - origin_x_) / block_size) + 1;
+	rows_ = (unsigned)((max_y - origin_y_) / block_size) + 1;
+	if (origin_x_ < -32768 || origin_y_ < -32768 || columns_ > 32767 || rows_ > 32767)
+		return false;
+
+	// Calls [func] for each block [line] passes through or touches
+	auto for_line_blocks = [&](const line_t& line, const std::function<void(unsigned)>& func)
+	{
+		double x1 = line.v1.x - origin_x_;
+		double y1 = line.v1.y - origin_y_;
+		double x2 = line.v2.x - origin_x_;
+		double y2 = line.v2.y - origin_y_;
+		if (x1 > x2)
+		{
+			std::swap(x1, x2);
+			std::swap(y1, y2);
+		}
+
+		// Go through each column the line crosses (including the column to
+		// the left if it starts exactly on a column edge)
+		int c1 = (int)floor(x1 / block_size);
+		if (x1 == c1 * block_size)
+			c1--;
+		int c2 = (int)floor(x2 / block_size);
+		for (int c = MAX(c1, 0); c <= c2 && c < (int)columns_; c++)
+		{
+			// Get the y range of the line within the column
+			double xa = MAX(x1, c * block_size);
+			double xb = MIN(x2, (c + 1) * block_size);
+			double ya = y1;
+			double yb = y2;
+			if (x1 != x2)
+			{
+				ya = y1 + (xa - x1) * (y2 - y1) / (x2 - x1);
+				yb = y1 + (xb - x1) * (y2 - y1) / (x2 - x1);
+			}
+			if (ya > yb)
+				std::swap(ya, yb);
+
+			int r1 = (int)floor(ya / block_size);
+			if (ya == r1 * block_size)
+				r1--;
+			int r2 = (int)floor(yb / block_size);
+			for (int r = MAX(r1, 0); r <= r2 && r < (int)rows_; r++)
+				func(r * columns_ + c);
+		}
+	};
+
+	// Build blocklists (count first, then fill, so each list is in line
+	// order)
+	unsigned n_blocks = columns_ * rows_;
+	vector<unsigned> list_start(n_blocks + 1, 0);
+	for (unsigned a = 0; a < lines_.size(); a++)
+		for_line_blocks(lines_[a], [&](unsigned block) { list_start[block + 1]++; });
+	for (unsigned a = 0; a < n_blocks; a++)
+		list_start[a + 1] += list_start[a];
+	vector<uint16_t> list_lines(list_start[n_blocks]);
+	vector<unsigned> list_pos(list_start.begin(), list_start.end() - 1);
+	for (unsigned a = 0; a < lines_.size(); a++)
+		for_line_blocks(lines_[a], [&](unsigned block) { list_lines[list_pos[block]++] = a; });
+
+	// Write header and blocklists. Each list starts with a 0 and ends with
+	// -1, as the original Doom node builder wrote them (the 0 is skipped by
+	// most ports, but vanilla checks line 0 in every block)
+	vector<uint16_t> data;
+	data.push_back((uint16_t)origin_x_);
+	data.push_back((uint16_t)origin_y_);
+	data.push_back(columns_);
+	data.push_back(rows_);
+	data.resize(4 + n_blocks);
+	std::map<vector<uint16_t>, unsigned> shared;
+	vector<uint16_t> list;
+	for (unsigned a = 0; a < n_blocks; a++)
+	{
+		// Check for an identical previous list
+		if (compress)
+		{
+			list.assign(list_lines.begin() + list_start[a], list_lines.begin() + list_start[a + 1]);
+			auto existing = shared.find(list);
+			if (existing != shared.end())
+			{
+				data[4 + a] = existing->second;
+				continue;
+			}
+			shared[list] = data.size();
+		}
+
+		// Offsets are 16-bit
+		if (data.size() > 65535)
+			return false;
+
+		data[4 + a] = data.size();
+		data.push_back(0);
+		data.insert(data.end(), list_lines.begin() + list_start[a], list_lines.begin() + list_start[a + 1]);
+		data.push_back(0xFFFF);
+		n_blocklists_++;
+	}
+
+	out.importMem((const uint8_t*)data.data(), data.size() * 2);
+	return true;
+}
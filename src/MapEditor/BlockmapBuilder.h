@@ -0,0 +1,38 @@
+#pragma once
+
+class MemChunk;
+class SLADEMap;
+
+// Builds a BLOCKMAP lump - a grid of 128x128 blocks over the map, each with a
+// list of the lines that pass through it. Lines touching a block edge are
+// included in the blocks on both sides. If compression is enabled, blocks
+// with identical line lists share a single list in the lump
+class BlockmapBuilder
+{
+public:
+	BlockmapBuilder() {}
+	~BlockmapBuilder() {}
+
+	void	clear();
+	void	addLine(fpoint2_t v1, fpoint2_t v2);
+	void	loadMap(SLADEMap& map);
+	bool	build(MemChunk& out, bool compress);
+
+	unsigned	nColumns() const { return columns_; }
+	unsigned	nRows() const { return rows_; }
+	unsigned	nBlocklists() const { return n_blocklists_; }
+
+private:
+	struct line_t
+	{
+		fpoint2_t	v1;
+		fpoint2_t	v2;
+	};
+
+	vector<line_t>	lines_;
+	int				origin_x_		= 0;
+	int				origin_y_		= 0;
+	unsigned		columns_		= 0;
+	unsigned		rows_			= 0;
+	unsigned		n_blocklists_	= 0;
+};
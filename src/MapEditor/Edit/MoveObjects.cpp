@@ -161,6 +161,9 @@ void MoveObjects::end(bool accept)
 {
 	using MapEditor::Mode;
 
+	// Remember selected objects, since merging can change their indices
+	context_.selection().storeObjectIds();
+
 	// Un-filter objects
 	for (unsigned a = 0; a < context_.map().nLines(); a++)
 		context_.map().getLine(a)->filter(false);
@@ -251,4 +254,5 @@ void MoveObjects::end(bool accept)
 
 	// Update map item indices
 	context_.map().refreshIndices();
+	context_.selection().restoreObjectIds();
 }
@@ -51,7 +51,8 @@ using MapEditor::SectorMode;
 ItemSelection::ItemSelection(MapEditContext* context) :
 	hilight_{ -1, ItemType::Any },
 	hilight_lock_{ false },
-	context_{ context }
+	context_{ context },
+	hilight_id_{ 0 }
 {
 }
 
@@ -180,10 +181,12 @@ void ItemSelection::clear()
 	// Update change set
 	last_change_.clear();
 	for (auto& item : selection_)
-		last_change_[item] = false;
+		recordChange(item, false);
 
 	// Clear selection
 	selection_.clear();
+	for (auto& flags : selected_)
+		flags.clear();
 
 	if (context_)
 		context_->selectionUpdated();
@@ -212,8 +215,44 @@ void ItemSelection::select(const vector<MapEditor::Item>& items, bool select, bo
 	if (new_change)
 		last_change_.clear();
 
+	// Selecting
+	if (select)
+	{
+		for (auto& item : items)
+			selectItem(item, true);
+
+		return;
+	}
+
+	// Deselecting, clear the flags for all items first and then remove them
+	// from the selection in one pass
+	unsigned n_deselected = 0;
 	for (auto& item : items)
-		selectItem(item, select);
+	{
+		MapEditor::Item selected = item;
+		if (!isSet(item.index, item.type))
+		{
+			if (!isSet(item.index, ItemType::Any))
+				continue;
+			selected.type = ItemType::Any;
+		}
+
+		setFlag(selected, false);
+		recordChange(item, false);
+		n_deselected++;
+	}
+
+	if (n_deselected > 0)
+	{
+		selection_.erase(
+			std::remove_if(
+				selection_.begin(),
+				selection_.end(),
+				[this](const MapEditor::Item& item) { return !isSet(item.index, item.type); }
+			),
+			selection_.end()
+		);
+	}
 }
 
 /* ItemSelection::selectAll
@@ -695,6 +734,135 @@ void ItemSelection::migrate(Mode from_edit_mode, Mode to_edit_mode)
 
 	// Apply new selection
 	selection_.assign(new_selection.begin(), new_selection.end());
+	refreshIndex();
+}
+
+/* ItemSelection::storeObjectIds
+ * Remembers the map objects currently selected and hilighted, so
+ * that restoreObjectIds can update the item indices after the map's
+ * object indices change (eg. when objects are merged or removed)
+ *******************************************************************/
+void ItemSelection::storeObjectIds()
+{
+	selection_ids_.clear();
+	for (auto& item : selection_)
+	{
+		auto object = itemObject(item);
+		selection_ids_.push_back(object ? object->getId() : 0);
+	}
+
+	auto object = itemObject(hilight_);
+	hilight_id_ = object ? object->getId() : 0;
+}
+
+/* ItemSelection::restoreObjectIds
+ * Updates the selected and hilighted item indices to those of the
+ * objects remembered by storeObjectIds. Items whose objects are no
+ * longer in the map are removed
+ *******************************************************************/
+void ItemSelection::restoreObjectIds()
+{
+	if (!context_)
+		return;
+
+	auto& map = context_->map();
+	auto current_index = [&map](unsigned id)
+	{
+		return id > 0 && map.objectInMap(id) ? (int)map.getObjectById(id)->getIndex() : -1;
+	};
+
+	// Selection
+	vector<MapEditor::Item> selection;
+	for (unsigned a = 0; a < selection_.size() && a < selection_ids_.size(); a++)
+	{
+		int index = current_index(selection_ids_[a]);
+		if (index >= 0)
+			selection.push_back({ index, selection_[a].type });
+	}
+	selection_.swap(selection);
+	selection_ids_.clear();
+	refreshIndex();
+
+	// Hilight
+	hilight_.index = current_index(hilight_id_);
+	hilight_id_ = 0;
+}
+
+/* ItemSelection::refreshIndex
+ * Rebuilds the selected item flags from the selection list. Must be
+ * called if the selection list was changed directly
+ *******************************************************************/
+void ItemSelection::refreshIndex()
+{
+	for (auto& flags : selected_)
+		flags.clear();
+
+	for (auto& item : selection_)
+		setFlag(item, true);
+}
+
+/* ItemSelection::itemObject
+ * Returns the map object for [item], or nullptr if there isn't one.
+ * Items of type Any are taken to be of the current edit mode's type
+ *******************************************************************/
+MapObject* ItemSelection::itemObject(const MapEditor::Item& item) const
+{
+	if (!context_ || item.index < 0)
+		return nullptr;
+
+	auto type = MapEditor::baseItemType(item.type);
+	if (item.type == ItemType::Any)
+	{
+		switch (context_->editMode())
+		{
+		case Mode::Vertices:	type = ItemType::Vertex; break;
+		case Mode::Lines:		type = ItemType::Line; break;
+		case Mode::Sectors:		type = ItemType::Sector; break;
+		case Mode::Things:		type = ItemType::Thing; break;
+		default:				return nullptr;
+		}
+	}
+
+	auto& map = context_->map();
+	switch (type)
+	{
+	case ItemType::Vertex:	return map.getVertex(item.index);
+	case ItemType::Line:	return map.getLine(item.index);
+	case ItemType::Side:	return map.getSide(item.index);
+	case ItemType::Sector:	return map.getSector(item.index);
+	case ItemType::Thing:	return map.getThing(item.index);
+	default:				return nullptr;
+	}
+}
+
+/* ItemSelection::setFlag
+ * Sets the selected flag for [item] to [set]
+ *******************************************************************/
+void ItemSelection::setFlag(const MapEditor::Item& item, bool set)
+{
+	if (item.index < 0)
+		return;
+
+	auto& flags = selected_[(int)item.type];
+	if ((unsigned)item.index >= flags.size())
+	{
+		if (!set)
+			return;
+		flags.resize(item.index + 1, false);
+	}
+
+	flags[item.index] = set;
+}
+
+/* ItemSelection::recordChange
+ * Records that [item] was [selected] or deselected in the current
+ * ChangeSet. Items are usually added in increasing order (eg. when
+ * selecting all), so the end of the set is used as an insertion hint
+ *******************************************************************/
+void ItemSelection::recordChange(const MapEditor::Item& item, bool selected)
+{
+	auto i = last_change_.emplace_hint(last_change_.end(), item, selected);
+	i->second = selected;
 }
 
 /* ItemSelection::selectItem
@@ -704,17 +872,20 @@ void ItemSelection::migrate(Mode from_edit_mode, Mode to_edit_mode)
 void ItemSelection::selectItem(const MapEditor::Item& item, bool select)
 {
 	// Check if already selected
-	bool selected = VECTOR_EXISTS(selection_, item);
+	bool selected = isSelected(item);
 
 	// (De)Select and update change set
 	if (select && !selected)
 	{
 		selection_.push_back(item);
-		last_change_[item] = true;
+		setFlag(item, true);
+		recordChange(item, true);
 	}
 	if (!select && selected)
 	{
-		VECTOR_REMOVE(selection_, item);
-		last_change_[item] = false;
+		auto i = std::find(selection_.begin(), selection_.end(), item);
+		setFlag(*i, false);
+		selection_.erase(i);
+		recordChange(item, false);
 	}
 }
@@ -16,7 +16,7 @@ class ItemSelection
 public:
 	typedef std::map<MapEditor::Item, bool> ChangeSet;
 	typedef vector<MapEditor::Item>::const_iterator const_iterator;
-	typedef vector<MapEditor::Item>::iterator iterator;
+	typedef vector<MapEditor::Item>::const_iterator iterator;	// Read-only, to keep selected_ in sync
 	typedef vector<MapEditor::Item>::value_type value_type;
 
 	ItemSelection(MapEditContext* context = nullptr);
@@ -29,9 +29,6 @@ public:
 	// Access to selection
 	const_iterator begin() const { return selection_.begin(); }
 	const_iterator end() const { return selection_.end(); }
-	iterator begin() { return selection_.begin(); }
-	iterator end() { return selection_.end(); }
-	MapEditor::Item& operator[] (unsigned index) { return selection_[index]; }
 	const MapEditor::Item& operator[] (unsigned index) const { return selection_[index]; }
 
 	vector<MapEditor::Item>	selectionOrHilight();
@@ -47,7 +44,11 @@ public:
 
 	bool	hasHilight() const { return hilight_.index >= 0; }
 	bool	hasHilightOrSelection() const { return !selection_.empty() || hilight_.index >= 0; }
-	bool	isSelected(const MapEditor::Item& item) const { return VECTOR_EXISTS(selection_, item); }
+	bool	isSelected(const MapEditor::Item& item) const
+	{
+		// An item selected with type Any matches any type (see Item::operator==)
+		return isSet(item.index, item.type) || isSet(item.index, MapEditor::ItemType::Any);
+	}
 	bool	isHilighted(const MapEditor::Item& item) const { return item == hilight_; }
 
 	bool	updateHilight(fpoint2_t mouse_pos, double dist_scale);
@@ -77,6 +78,8 @@ public:
 	vector<MapObject*>	selectedObjects(bool try_hilight = true) const;
 
 	void	migrate(MapEditor::Mode from_edit_mode, MapEditor::Mode to_edit_mode);
+	void	storeObjectIds();
+	void	restoreObjectIds();
 
 	//void	showItem(int index);
 	//void	selectItem3d(MapEditor::Item item, int sel);
@@ -88,5 +91,21 @@ private:
 	ChangeSet				last_change_;
 	MapEditContext*			context_;
 
+	// Selected flags for each item type, indexed by item index
+	vector<bool>	selected_[(int)MapEditor::ItemType::Any + 1];
+
+	// Map object ids of the selection and hilight (see storeObjectIds)
+	vector<unsigned>	selection_ids_;
+	unsigned			hilight_id_;
+
+	bool	isSet(int index, MapEditor::ItemType type) const
+	{
+		auto& flags = selected_[(int)type];
+		return index >= 0 && (unsigned)index < flags.size() && flags[index];
+	}
+	void		refreshIndex();
+	void		setFlag(const MapEditor::Item& item, bool set);
+	MapObject*	itemObject(const MapEditor::Item& item) const;
 	void	selectItem(const MapEditor::Item& item, bool select = true);
+	void	recordChange(const MapEditor::Item& item, bool selected);
 };
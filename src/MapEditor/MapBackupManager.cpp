@@ -30,17 +30,21 @@
 #include "Main.h"
 #include "App.h"
 #include "MapBackupManager.h"
-#include "Archive/Formats/ZipArchive.h"
+#include "Archive/Formats/WadArchive.h"
 #include "General/Misc.h"
 #include "MapEditor.h"
 #include "UI/MapBackupPanel.h"
 #include "UI/SDialog.h"
+#include "Utility/Compression.h"
+#include "Utility/ThreadPool.h"
+#include <unordered_map>
 
 
 /*******************************************************************
  * VARIABLES
  *******************************************************************/
 CVAR(Int, max_map_backups, 25, CVAR_SAVE)
+CVAR(Int, map_backup_compact_size, 4, CVAR_SAVE)	// Min blob file size (MB) before unused blobs are cleaned up
 
 // List of entry names to be ignored for backups
 string mb_ignore_entries[] =
@@ -57,15 +61,442 @@ string mb_ignore_entries[] =
 	"GL_NODES"
 };
 
+namespace
+{
+	const uint32_t	BLOB_MAGIC = 0x42424D53;	// 'SMBB'
+	const uint32_t	BLOB_COMPRESSED = 1;
+
+	// Header for each blob in the blob file, followed by [stored_size]
+	// bytes of (possibly zlib-compressed) data
+	struct blob_header_t
+	{
+		uint32_t	magic;
+		uint32_t	flags;
+		uint64_t	hash;
+		uint32_t	size;
+		uint32_t	stored_size;
+	};
+
+	// Returns the 64-bit FNV-1a hash of [data]
+	uint64_t blobHash(const uint8_t* data, uint32_t size)
+	{
+		uint64_t hash = 0xcbf29ce484222325ULL;
+		for (uint32_t a = 0; a < size; a++)
+		{
+			hash ^= data[a];
+			hash *= 0x100000001b3ULL;
+		}
+
+		// Mix in the size as well
+		hash ^= size;
+		hash *= 0x100000001b3ULL;
+		return hash;
+	}
+
+	string hashString(uint64_t hash)
+	{
+		return S_FMT("%08x%08x", (uint32_t)(hash >> 32), (uint32_t)hash);
+	}
+
+	uint64_t parseHash(const string& str)
+	{
+		unsigned long long hash = 0;
+		str.ToULongLong(&hash, 16);
+		return hash;
+	}
+
+	// Returns the backup store directory for [archive_name]
+	string storePath(string archive_name)
+	{
+		archive_name.Replace(".", "_");
+		return App::path("backups", App::Dir::User) + "/" + archive_name + "_backup";
+	}
+}
+
+
+/*******************************************************************
+ * MAPBACKUPSTORE STRUCT
+ *******************************************************************
+ * A content-addressed backup store for a single archive, made up of:
+ *
+ * blobs.dat - unique lump data, as blob_header_t + data records.
+ *   New blobs are only ever appended to the end.
+ * index.txt - tab-separated lines describing the backups:
+ *   B <map> <timestamp>          - start of a backup (the timestamp
+ *                                  gets a .<n> suffix if there was
+ *                                  already a backup that second)
+ *   E <entry name> <hash> <size> - an entry in the backup
+ *   C                            - end of a (complete) backup
+ *   R <map> <timestamp>          - the backup was removed
+ *
+ * Backups that were never completed (eg. SLADE crashed while writing
+ * them) are ignored. Removed backups leave unused blobs in blobs.dat,
+ * which are cleaned up once they take up over half of the file
+ *******************************************************************/
+struct MapBackupStore
+{
+	struct blob_t
+	{
+		wxFileOffset	offset;		// Offset of the blob data (after the header)
+		uint32_t		size;
+		uint32_t		stored_size;
+		bool			compressed;
+	};
+
+	struct entry_t
+	{
+		string		name;
+		uint64_t	hash;
+		uint32_t	size;
+	};
+
+	struct backup_t
+	{
+		string			map_name;
+		string			timestamp;
+		vector<entry_t>	entries;
+	};
+
+	string									archive_name;
+	string									path;
+	bool									loaded;
+	std::unordered_map<uint64_t, blob_t>	blobs;
+	vector<backup_t>						backups;
+	wxFileOffset							blob_file_size;	// Size of valid data in the blob file
+	bool									index_newline;	// Index file doesn't end with a newline
+
+	MapBackupStore(string archive_name) :
+		archive_name{ archive_name },
+		path{ storePath(archive_name) },
+		loaded{ false },
+		blob_file_size{ 0 },
+		index_newline{ false } {}
+
+	string blobFile() const { return path + "/blobs.dat"; }
+	string indexFile() const { return path + "/index.txt"; }
+
+	bool hasBackup(const string& map_name, const string& timestamp) const
+	{
+		for (auto& backup : backups)
+			if (backup.map_name == map_name && backup.timestamp == timestamp)
+				return true;
+		return false;
+	}
+
+	/* MapBackupStore::load
+	 * Reads the blob headers and backup index from disk, if it hasn't
+	 * been done already
+	 *******************************************************************/
+	void load()
+	{
+		if (loaded)
+			return;
+		loaded = true;
+		blobs.clear();
+		backups.clear();
+		blob_file_size = 0;
+		index_newline = false;
+
+		// Blobs (only the headers are read)
+		wxFile file;
+		if (wxFileExists(blobFile()) && file.Open(blobFile()))
+		{
+			wxFileOffset length = file.Length();
+			blob_header_t header;
+			while (file.Tell() + (wxFileOffset)sizeof(header) <= length)
+			{
+				if (file.Read(&header, sizeof(header)) != sizeof(header) || header.magic != BLOB_MAGIC)
+					break;
+
+				// Check for truncated blob
+				wxFileOffset offset = file.Tell();
+				if (offset + header.stored_size > length)
+					break;
+
+				blobs[header.hash] = { offset, header.size, header.stored_size, (header.flags & BLOB_COMPRESSED) != 0 };
+				file.Seek(header.stored_size, wxFromCurrent);
+				blob_file_size = file.Tell();
+			}
+			file.Close();
+		}
+
+		// Index
+		if (!wxFileExists(indexFile()) || !file.Open(indexFile()))
+			return;
+		MemChunk mc;
+		mc.importFileStream(file);
+		index_newline = mc.getSize() > 0 && mc[mc.getSize() - 1] != '\n';
+		wxArrayString lines = wxSplit(wxString::FromUTF8((const char*)mc.getData(), mc.getSize()), '\n');
+
+		backup_t current;
+		bool in_backup = false;
+		for (auto& line : lines)
+		{
+			wxArrayString cols = wxSplit(line, '\t', 0);
+			if (cols.empty())
+				continue;
+
+			if (cols[0] == "B" && cols.size() >= 3)
+			{
+				current = { cols[1], cols[2], {} };
+				in_backup = true;
+			}
+			else if (cols[0] == "E" && cols.size() >= 4 && in_backup)
+			{
+				unsigned long size = 0;
+				cols[3].ToULong(&size);
+				current.entries.push_back({ cols[1], parseHash(cols[2]), (uint32_t)size });
+			}
+			else if (cols[0] == "C" && in_backup)
+			{
+				backups.push_back(current);
+				in_backup = false;
+			}
+			else if (cols[0] == "R" && cols.size() >= 3)
+			{
+				for (unsigned a = 0; a < backups.size(); a++)
+					if (backups[a].map_name == cols[1] && backups[a].timestamp == cols[2])
+					{
+						backups.erase(backups.begin() + a);
+						break;
+					}
+			}
+		}
+	}
+
+	/* MapBackupStore::appendIndex
+	 * Appends [lines] to the index file
+	 *******************************************************************/
+	bool appendIndex(const string& lines)
+	{
+		wxFile file(indexFile(), wxFile::write_append);
+		if (!file.IsOpened())
+			return false;
+
+		// Finish off any partially written line first
+		wxScopedCharBuffer utf8 = (index_newline ? "\n" + lines : lines).ToUTF8();
+		bool ok = file.Write(utf8.data(), utf8.length()) == utf8.length();
+		index_newline = !ok;
+		return file.Flush() && ok;
+	}
+
+	/* MapBackupStore::findBlob
+	 * Sets [key] to the key of the stored blob with the same content as
+	 * [mc] and returns true, or returns false if there isn't one. In
+	 * that case [key] is set to the key [mc] should be stored under -
+	 * normally its hash, but data that collides with a different blob's
+	 * hash is given the next free key
+	 *******************************************************************/
+	bool findBlob(MemChunk& mc, uint64_t& key)
+	{
+		key = blobHash(mc.getData(), mc.getSize());
+		MemChunk existing;
+		while (true)
+		{
+			auto i = blobs.find(key);
+			if (i == blobs.end())
+				return false;
+
+			// Compare the actual data to rule out a hash collision
+			if (i->second.size == mc.getSize() &&
+				readBlob(key, existing) &&
+				existing.getSize() == mc.getSize() &&
+				(mc.getSize() == 0 || memcmp(existing.getData(), mc.getData(), mc.getSize()) == 0))
+				return true;
+
+			key++;
+		}
+	}
+
+	/* MapBackupStore::addBlobs
+	 * Appends all of [data] that isn't already stored to the blob
+	 * file, returning the blob key of each item in [hashes]. Blobs are
+	 * written after the last valid blob, so any partially written data
+	 * at the end of the file is overwritten
+	 *******************************************************************/
+	bool addBlobs(vector<std::unique_ptr<MemChunk>>& data, vector<uint64_t>& hashes)
+	{
+		wxFile file;
+		for (unsigned a = 0; a < data.size(); a++)
+		{
+			MemChunk& mc = *data[a];
+			uint64_t hash;
+
+			// Check if we already have it
+			bool exists = findBlob(mc, hash);
+			hashes.push_back(hash);
+			if (exists)
+				continue;
+
+			// Compress (if worthwhile)
+			MemChunk packed;
+			bool compressed = mc.getSize() > 32 &&
+				Compression::ZlibDeflate(mc, packed, 6) &&
+				packed.getSize() < mc.getSize();
+			MemChunk& stored = compressed ? packed : mc;
+
+			if (!file.IsOpened())
+			{
+				if (!wxFileExists(blobFile()) && !file.Create(blobFile()))
+					return false;
+				file.Close();
+				if (!file.Open(blobFile(), wxFile::read_write) || file.Seek(blob_file_size) == wxInvalidOffset)
+					return false;
+			}
+
+			// Write blob
+			blob_header_t header{ BLOB_MAGIC, compressed ? BLOB_COMPRESSED : 0, hash, mc.getSize(), stored.getSize() };
+			if (file.Write(&header, sizeof(header)) != sizeof(header) ||
+				file.Write(stored.getData(), stored.getSize()) != stored.getSize())
+				return false;
+
+			blob_file_size = file.Tell();
+			blobs[hash] = { blob_file_size - stored.getSize(), mc.getSize(), stored.getSize(), compressed };
+		}
+
+		// Make sure blobs are on disk before they are referenced in the index
+		return !file.IsOpened() || file.Flush();
+	}
+
+	/* MapBackupStore::readBlob
+	 * Reads the blob with [hash] into [out]
+	 *******************************************************************/
+	bool readBlob(uint64_t hash, MemChunk& out)
+	{
+		auto i = blobs.find(hash);
+		if (i == blobs.end())
+			return false;
+
+		wxFile file(blobFile());
+		if (!file.IsOpened())
+			return false;
+
+		const blob_t& blob = i->second;
+		if (blob.stored_size == 0)
+		{
+			out.clear();
+			return true;
+		}
+
+		MemChunk stored;
+		file.Seek(blob.offset);
+		if (!stored.importFileStream(file, blob.stored_size) || stored.getSize() != blob.stored_size)
+			return false;
+
+		if (!blob.compressed)
+			return out.importMem(stored.getData(), stored.getSize());
+
+		return Compression::ZlibInflate(stored, out, blob.size) && out.getSize() == blob.size;
+	}
+
+	/* MapBackupStore::compact
+	 * Rewrites the blob file and index with only the blobs and backups
+	 * that are still in use. Only done when unused blobs take up most
+	 * of the blob file
+	 *******************************************************************/
+	void compact()
+	{
+		// Get used blobs
+		std::unordered_map<uint64_t, bool> used;
+		wxFileOffset used_size = 0;
+		for (auto& backup : backups)
+			for (auto& entry : backup.entries)
+				if (!used[entry.hash])
+				{
+					used[entry.hash] = true;
+					auto blob = blobs.find(entry.hash);
+					if (blob != blobs.end())
+						used_size += sizeof(blob_header_t) + blob->second.stored_size;
+				}
+
+		// Check if it's worth doing
+		if (blob_file_size < (wxFileOffset)map_backup_compact_size * 1024 * 1024 ||
+			used_size * 2 > blob_file_size)
+			return;
+
+		// Write used blobs to a new file
+		wxFile in(blobFile());
+		wxFile out(blobFile() + ".tmp", wxFile::write);
+		if (!in.IsOpened() || !out.IsOpened())
+			return;
+		std::unordered_map<uint64_t, blob_t> new_blobs;
+		MemChunk data;
+		for (auto& blob : blobs)
+		{
+			if (!used[blob.first])
+				continue;
+
+			data.clear();
+			in.Seek(blob.second.offset);
+			if (blob.second.stored_size > 0 &&
+				(!data.importFileStream(in, blob.second.stored_size) || data.getSize() != blob.second.stored_size))
+				return;
+
+			blob_header_t header{
+				BLOB_MAGIC,
+				blob.second.compressed ? BLOB_COMPRESSED : 0,
+				blob.first,
+				blob.second.size,
+				blob.second.stored_size
+			};
+			out.Write(&header, sizeof(header));
+			blob_t new_blob = blob.second;
+			new_blob.offset = out.Tell();
+			if (out.Write(data.getData(), data.getSize()) != data.getSize())
+				return;
+			new_blobs[blob.first] = new_blob;
+		}
+		in.Close();
+		if (!out.Flush())
+			return;
+		out.Close();
+
+		// Write index with only the current backups
+		string index;
+		for (auto& backup : backups)
+		{
+			index += "B\t" + backup.map_name + "\t" + backup.timestamp + "\n";
+			for (auto& entry : backup.entries)
+				index += S_FMT("E\t%s\t%s\t%u\n", entry.name, hashString(entry.hash), entry.size);
+			index += "C\n";
+		}
+		wxFile index_file(indexFile() + ".tmp", wxFile::write);
+		wxScopedCharBuffer utf8 = index.ToUTF8();
+		if (!index_file.IsOpened() || index_file.Write(utf8.data(), utf8.length()) != utf8.length())
+			return;
+		index_file.Close();
+
+		// Replace the old files. The old index is still valid with the new
+		// blob file, since it only references blobs that were kept
+		if (!wxRenameFile(blobFile() + ".tmp", blobFile(), true))
+			return;
+		blobs = new_blobs;
+		blob_file_size = wxFileName::GetSize(blobFile()).GetValue();
+		wxRenameFile(indexFile() + ".tmp", indexFile(), true);
+	}
+};
+
 
 /*******************************************************************
  * MAPBACKUPMANAGER CLASS FUNCTIONS
  *******************************************************************/
 
+// A pending backup, with copies of the map data to write
+struct MapBackupManager::job_t
+{
+	string				archive_name;
+	string				map_name;
+	string				timestamp;
+	vector<string>		names;
+	vector<std::unique_ptr<MemChunk>>	data;
+};
+
 /* MapBackupManager::MapBackupManager
  * MapBackupManager class constructor
  *******************************************************************/
-MapBackupManager::MapBackupManager()
+MapBackupManager::MapBackupManager() :
+	worker_running_{ false },
+	backup_failed_{ false }
 {
 }
 
@@ -74,27 +505,25 @@ MapBackupManager::MapBackupManager()
  *******************************************************************/
 MapBackupManager::~MapBackupManager()
 {
+	// (Any pending backups are finished when the thread pool shuts down)
 }
 
 /* MapBackupManager::writeBackup
- * Writes a backup for [map_name] in [archive_name], with the map
- * data entries in [map_data]
+ * Queues a backup for [map_name] in [archive_name], with the map
+ * data entries in [map_data]. The data is copied, and the backup is
+ * written in the background. Returns false if any backup queued
+ * before this one failed to be written (since the last call)
  *******************************************************************/
 bool MapBackupManager::writeBackup(vector<ArchiveEntry*>& map_data, string archive_name, string map_name)
 {
-	// Create backup directory if needed
-	string backup_dir = App::path("backups", App::Dir::User);
-	if (!wxDirExists(backup_dir)) wxMkdir(backup_dir);
-
-	// Open or create backup zip
-	ZipArchive backup;
-	archive_name.Replace(".", "_");
-	string backup_file = backup_dir + "/" + archive_name + "_backup.zip";
-	if (!backup.open(backup_file))
-		backup.setFilename(backup_file);
+	// Setup backup job
+	auto job = std::make_unique<job_t>();
+	job->archive_name = archive_name;
+	job->map_name = map_name;
+	job->timestamp = wxDateTime::Now().FormatISOCombined('_');
+	job->timestamp.Replace(":", "");
 
-	// Filter ignored entries
-	vector<ArchiveEntry*> backup_entries;
+	// Copy map data (filtering ignored entries)
 	for (unsigned a = 0; a < map_data.size(); a++)
 	{
 		// Check for ignored entry
@@ -109,64 +538,243 @@ bool MapBackupManager::writeBackup(vector<ArchiveEntry*>& map_data, string archi
 		}
 
 		if (!ignored)
-			backup_entries.push_back(map_data[a]);
+		{
+			job->names.push_back(map_data[a]->getName());
+			job->data.emplace_back(new MemChunk(map_data[a]->getData(), map_data[a]->getSize()));
+		}
 	}
 
-	// Compare with last backup (if any)
-	ArchiveTreeNode* map_dir = backup.getDir(map_name);
-	if (map_dir && map_dir->nChildren() > 0)
+	// Queue it, starting the worker task if needed
+	bool start_worker = false;
+	bool failed;
 	{
-		ArchiveTreeNode* last_backup = (ArchiveTreeNode*)map_dir->getChild(map_dir->nChildren() - 1);
-		bool same = true;
-		if (last_backup->numEntries() != backup_entries.size())
-			same = false;
-		else
+		std::lock_guard<std::mutex> lock(mutex_);
+		jobs_.push_back(std::move(job));
+		if (!worker_running_)
+			worker_running_ = start_worker = true;
+
+		failed = backup_failed_;
+		backup_failed_ = false;
+	}
+	if (start_worker)
+		ThreadPool::run([this]() { processJobs(); });
+
+	return !failed;
+}
+
+/* MapBackupManager::waitForBackups
+ * Blocks until all queued backups have been written
+ *******************************************************************/
+void MapBackupManager::waitForBackups()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	cv_jobs_done_.wait(lock, [this]() { return !worker_running_; });
+}
+
+/* MapBackupManager::processJobs
+ * Writes all queued backups (run on a worker thread)
+ *******************************************************************/
+void MapBackupManager::processJobs()
+{
+	while (true)
+	{
+		std::unique_ptr<job_t> job;
 		{
-			for (unsigned a = 0; a < last_backup->numEntries(); a++)
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (jobs_.empty())
 			{
-				ArchiveEntry* e1 = backup_entries[a];
-				ArchiveEntry* e2 = last_backup->entryAt(a);
-				if (e1->getSize() != e2->getSize())
-				{
-					same = false;
-					break;
-				}
+				worker_running_ = false;
+				cv_jobs_done_.notify_all();
+				return;
+			}
 
-				uint32_t crc1 = Misc::crc(e1->getData(), e1->getSize());
-				uint32_t crc2 = Misc::crc(e2->getData(), e2->getSize());
-				if (crc1 != crc2)
-				{
-					same = false;
-					break;
-				}
+			job = std::move(jobs_.front());
+			jobs_.pop_front();
+		}
+
+		if (!doBackup(*job))
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				backup_failed_ = true;
 			}
+
+			string map_name = job->map_name;
+			wxTheApp->CallAfter([map_name]()
+			{
+				Log::warning(S_FMT("Warning: Failed to backup map data for %s", map_name));
+			});
 		}
+	}
+}
 
-		if (same)
+/* MapBackupManager::getStore
+ * Returns the backup store for [archive_name], creating it if needed.
+ * Only to be used from the worker task, or after waitForBackups
+ *******************************************************************/
+MapBackupStore* MapBackupManager::getStore(string archive_name)
+{
+	for (auto& store : stores_)
+		if (store->archive_name == archive_name)
 		{
-			LOG_MESSAGE(2, "Same data as previous backup - ignoring");
-			return true;
+			store->load();
+			return store.get();
 		}
+
+	stores_.emplace_back(new MapBackupStore(archive_name));
+	stores_.back()->load();
+	return stores_.back().get();
+}
+
+/* MapBackupManager::doBackup
+ * Writes the backup for [job] to its archive's backup store
+ *******************************************************************/
+bool MapBackupManager::doBackup(job_t& job)
+{
+	// Create backup directories if needed
+	string backup_dir = App::path("backups", App::Dir::User);
+	if (!wxDirExists(backup_dir)) wxMkdir(backup_dir);
+	MapBackupStore* store = getStore(job.archive_name);
+	if (!wxDirExists(store->path)) wxMkdir(store->path);
+
+	// Write any new data
+	vector<uint64_t> hashes;
+	if (!store->addBlobs(job.data, hashes))
+	{
+		store->loaded = false;
+		return false;
+	}
+
+	// Compare with last backup (if any)
+	for (int a = (int)store->backups.size() - 1; a >= 0; a--)
+	{
+		auto& last = store->backups[a];
+		if (last.map_name != job.map_name)
+			continue;
+
+		bool same = last.entries.size() == hashes.size();
+		for (unsigned b = 0; same && b < hashes.size(); b++)
+			if (last.entries[b].hash != hashes[b])
+				same = false;
+
+		if (same)
+			return true;
+
+		break;
 	}
 
-	// Add map data to backup
-	string timestamp = wxDateTime::Now().FormatISOCombined('_');
-	timestamp.Replace(":", "");
-	string dir = map_name + "/" + timestamp;
-	for (unsigned a = 0; a < backup_entries.size(); a++)
-		backup.addEntry(backup_entries[a], dir, true);
+	// Make the timestamp unique if there is already a backup from the
+	// same second
+	string timestamp = job.timestamp;
+	for (unsigned seq = 1; store->hasBackup(job.map_name, timestamp); seq++)
+		timestamp = S_FMT("%s.%u", job.timestamp, seq);
+
+	// Add backup to index
+	MapBackupStore::backup_t backup{ job.map_name, timestamp, {} };
+	string index = "B\t" + job.map_name + "\t" + timestamp + "\n";
+	for (unsigned a = 0; a < hashes.size(); a++)
+	{
+		backup.entries.push_back({ job.names[a], hashes[a], job.data[a]->getSize() });
+		index += S_FMT("E\t%s\t%s\t%u\n", job.names[a], hashString(hashes[a]), job.data[a]->getSize());
+	}
+	index += "C\n";
 
 	// Check for max backups & remove old ones if over
-	map_dir = backup.getDir(map_name);
-	while ((int)map_dir->nChildren() > max_map_backups)
-		backup.removeDir(map_dir->getChild(0)->getName(), map_dir);
+	unsigned count = 1;
+	for (auto& b : store->backups)
+		if (b.map_name == job.map_name)
+			count++;
+	for (unsigned a = 0; a < store->backups.size() && (int)count > max_map_backups;)
+	{
+		if (store->backups[a].map_name == job.map_name)
+		{
+			index += "R\t" + job.map_name + "\t" + store->backups[a].timestamp + "\n";
+			store->backups.erase(store->backups.begin() + a);
+			count--;
+		}
+		else
+			a++;
+	}
 
-	// Save backup file
-	Archive::save_backup = false;
-	bool ok = backup.save();
-	Archive::save_backup = true;
+	if (!store->appendIndex(index))
+	{
+		store->loaded = false;
+		return false;
+	}
+	store->backups.push_back(backup);
+
+	// Clean up unused blobs if needed
+	store->compact();
 
-	return ok;
+	return true;
+}
+
+/* MapBackupManager::hasBackups
+ * Returns true if there are any backups stored for [archive_name]
+ *******************************************************************/
+bool MapBackupManager::hasBackups(string archive_name)
+{
+	waitForBackups();
+
+	if (!wxDirExists(storePath(archive_name)))
+		return false;
+
+	return !getStore(archive_name)->backups.empty();
+}
+
+/* MapBackupManager::getBackupList
+ * Adds the timestamps of all backups for [map_name] in [archive_name]
+ * to [timestamps], oldest first
+ *******************************************************************/
+void MapBackupManager::getBackupList(string archive_name, string map_name, vector<string>& timestamps)
+{
+	waitForBackups();
+
+	if (!wxDirExists(storePath(archive_name)))
+		return;
+
+	for (auto& backup : getStore(archive_name)->backups)
+		if (backup.map_name == map_name)
+			timestamps.push_back(backup.timestamp);
+}
+
+/* MapBackupManager::readBackup
+ * Returns a new WadArchive containing the backup of [map_name] in
+ * [archive_name] made at [timestamp], or nullptr if it wasn't found
+ *******************************************************************/
+Archive* MapBackupManager::readBackup(string archive_name, string map_name, string timestamp)
+{
+	waitForBackups();
+
+	if (!wxDirExists(storePath(archive_name)))
+		return nullptr;
+
+	MapBackupStore* store = getStore(archive_name);
+	for (auto& backup : store->backups)
+	{
+		if (backup.map_name != map_name || backup.timestamp != timestamp)
+			continue;
+
+		auto wad = new WadArchive();
+		for (auto& entry : backup.entries)
+		{
+			MemChunk data;
+			if (!store->readBlob(entry.hash, data))
+			{
+				LOG_MESSAGE(1, "Error: Map backup data for %s is missing or corrupt", entry.name);
+				delete wad;
+				return nullptr;
+			}
+
+			auto new_entry = new ArchiveEntry(entry.name);
+			new_entry->importMemChunk(data);
+			wad->addEntry(new_entry, "");
+		}
+
+		return wad;
+	}
+
+	return nullptr;
 }
 
 /* MapBackupManager::openBackp
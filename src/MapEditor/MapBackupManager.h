@@ -2,18 +2,46 @@
 #ifndef __MAP_BACKUP_MANAGER_H__
 #define __MAP_BACKUP_MANAGER_H__
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
 class ArchiveEntry;
 class Archive;
+struct MapBackupStore;
+
+// Map backups are written on a worker thread to a per-archive backup store.
+// Each store is a content-addressed blob file (every unique lump is stored
+// once, compressed, and only ever appended to) plus an append-only index of
+// which blobs make up each backup. See MapBackupManager.cpp for the format
 class MapBackupManager
 {
-private:
-
 public:
 	MapBackupManager();
 	~MapBackupManager();
 
 	bool		writeBackup(vector<ArchiveEntry*>& map_data, string archive_name, string map_name);
 	Archive*	openBackup(string archive_name, string map_name);
+	void		waitForBackups();
+
+	// Reading backups (these wait for any pending backups first)
+	bool		hasBackups(string archive_name);
+	void		getBackupList(string archive_name, string map_name, vector<string>& timestamps);
+	Archive*	readBackup(string archive_name, string map_name, string timestamp);
+
+private:
+	struct job_t;
+
+	std::mutex								mutex_;
+	std::condition_variable					cv_jobs_done_;
+	std::deque<std::unique_ptr<job_t>>		jobs_;
+	bool									worker_running_;
+	bool									backup_failed_;	// A backup failed since the last writeBackup call
+	vector<std::unique_ptr<MapBackupStore>>	stores_;
+
+	MapBackupStore*	getStore(string archive_name);
+	void			processJobs();
+	bool			doBackup(job_t& job);
 };
 
 #endif//__MAP_BACKUP_MANAGER_H__
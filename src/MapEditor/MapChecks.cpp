@@ -546,16 +546,28 @@ public:
 		// Clear existing intersections
 		intersections.clear();
 
+		// Get line bounding boxes
+		const MapGeometryStore& geometry = map_->geometryStore();
+		const vector<double>& min_x = geometry.lineMinX();
+		const vector<double>& min_y = geometry.lineMinY();
+		const vector<double>& max_x = geometry.lineMaxX();
+		const vector<double>& max_y = geometry.lineMaxY();
+
 		// Go through lines
 		for (unsigned a = 0; a < lines.size(); a++)
 		{
 			line1 = lines[a];
+			unsigned l1 = line1->getIndex();
 
 			// Go through uncompared lines
 			for (unsigned b = a + 1; b < lines.size(); b++)
 			{
 				line2 = lines[b];
 
+				// Lines can't intersect if their bounding boxes don't
+				if (!geometry.lineBBoxIntersects(line2->getIndex(), min_x[l1], min_y[l1], max_x[l1], max_y[l1]))
+					continue;
+
 				// Check intersection
 				if (map_->linesIntersect(line1, line2, x, y))
 					intersections.push_back(line_intersect_t(line1, line2, x, y));
@@ -687,22 +699,40 @@ public:
 
 	void doCheck() override
 	{
-		// Go through lines
-		for (unsigned a = 0; a < map_->nLines(); a++)
+		// Sort lines by their (ordered) vertex indices, so lines sharing
+		// both vertices end up next to each other
+		const MapGeometryStore& geometry = map_->geometryStore();
+		const vector<unsigned>& line_v1 = geometry.lineV1();
+		const vector<unsigned>& line_v2 = geometry.lineV2();
+		vector<std::pair<uint64_t, unsigned>> keys(geometry.nLines());
+		for (unsigned a = 0; a < geometry.nLines(); a++)
+		{
+			uint64_t lo = MIN(line_v1[a], line_v2[a]);
+			uint64_t hi = MAX(line_v1[a], line_v2[a]);
+			keys[a] = std::make_pair((lo << 32) | hi, a);
+		}
+		std::sort(keys.begin(), keys.end());
+
+		// Go through groups of lines with the same vertices
+		vector<std::pair<unsigned, unsigned>> pairs;
+		for (unsigned start = 0; start < keys.size();)
 		{
-			MapLine* line1 = map_->getLine(a);
+			unsigned end = start + 1;
+			while (end < keys.size() && keys[end].first == keys[start].first)
+				end++;
 
-			// Go through uncompared lines
-			for (unsigned b = a + 1; b < map_->nLines(); b++)
-			{
-				MapLine* line2 = map_->getLine(b);
+			// Every line in the group overlaps every other
+			for (unsigned a = start; a < end; a++)
+				for (unsigned b = a + 1; b < end; b++)
+					pairs.push_back(std::make_pair(keys[a].second, keys[b].second));
 
-				// Check for overlap (both vertices shared)
-				if ((line1->v1() == line2->v1() && line1->v2() == line2->v2()) ||
-					(line1->v2() == line2->v1() && line1->v1() == line2->v2()))
-					overlaps.push_back(line_overlap_t(line1, line2));
-			}
+			start = end;
 		}
+
+		// Add overlaps in line order
+		std::sort(pairs.begin(), pairs.end());
+		for (auto& pair : pairs)
+			overlaps.push_back(line_overlap_t(map_->getLine(pair.first), map_->getLine(pair.second)));
 	}
 
 	unsigned nProblems() override
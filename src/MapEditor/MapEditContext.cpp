@@ -33,22 +33,30 @@
 // ----------------------------------------------------------------------------
 #include "Main.h"
 #include "App.h"
+#include "Archive/Formats/WadArchive.h"
+#include "BlockmapBuilder.h"
+#include "BSPBuilder.h"
 #include "Game/Configuration.h"
 #include "General/Clipboard.h"
 #include "General/Console/Console.h"
 #include "General/UndoRedo.h"
 #include "MapChecks.h"
 #include "MapEditContext.h"
+#include "MapEditor/Renderer/BufferMirror.h"
 #include "MapEditor/Renderer/Overlays/LineTextureOverlay.h"
 #include "MapEditor/Renderer/Overlays/QuickTextureOverlay3d.h"
 #include "MapEditor/Renderer/Overlays/SectorTextureOverlay.h"
+#include "MapEditor/Renderer/PortalVisibility.h"
 #include "MapEditor/UI/Dialogs/ActionSpecialDialog.h"
 #include "MapEditor/UI/Dialogs/SectorSpecialDialog.h"
 #include "MapEditor/UI/Dialogs/ShowItemDialog.h"
 #include "MapTextureManager.h"
+#include "NodeBuilders.h"
+#include "RejectBuilder.h"
 #include "UI/MapCanvas.h"
 #include "UI/MapEditorWindow.h"
 #include "UndoSteps.h"
+#include "Utility/ThreadPool.h"
 
 using MapEditor::Mode;
 using MapEditor::SectorMode;
@@ -97,6 +105,7 @@ CVAR(Bool, hilight_smooth, true, CVAR_SAVE)
 //
 // ----------------------------------------------------------------------------
 EXTERN_CVAR(Int, flat_drawtype)
+EXTERN_CVAR(String, nodebuilder_id)
 
 
 // ----------------------------------------------------------------------------
@@ -282,17 +291,24 @@ void MapEditContext::lockMouse(bool lock)
 // ----------------------------------------------------------------------------
 // MapEditContext::update
 //
-// Updates the current map editor state (hilight, animations, etc.)
+// Updates the current map editor state (hilight, animations, etc.).
+// Returns true if anything changed that needs the canvas to be redrawn
 // ----------------------------------------------------------------------------
 bool MapEditContext::update(long frametime)
 {
-	// Force an update if animations are active
-	if (renderer_.animationsActive() || selection_.hasHilight())
+	// Force an update if animations (including the hilight flash) are active
+	if (renderer_.animationsActive())
+	{
 		next_frame_length_ = 2;
+		redraw_ = true;
+	}
 
-	// Ignore if we aren't ready to update
+	// Ignore if we aren't ready to update (try again next time)
 	if (frametime < next_frame_length_)
+	{
+		redraw_ = true;
 		return false;
+	}
 
 	// Get frame time multiplier
 	double mult = (double)frametime / 10.0f;
@@ -302,7 +318,10 @@ bool MapEditContext::update(long frametime)
 	{
 		// Update camera
 		if (input_.updateCamera3d(mult))
+		{
 			next_frame_length_ = 2;
+			redraw_ = true;
+		}
 
 		// Update status bar
 		auto pos = renderer_.renderer3D().camPosition();
@@ -327,6 +346,7 @@ bool MapEditContext::update(long frametime)
 
 				// Animation
 				renderer_.animateHilightChange(old_hl);
+				redraw_ = true;
 			}
 		}
 	}
@@ -345,7 +365,10 @@ bool MapEditContext::update(long frametime)
 
 		// Do item moving if needed
 		if (input_.mouseState() == MapEditor::Input::MouseState::Move)
+		{
 			move_objects_.update(input_.mousePosMap());
+			redraw_ = true;
+		}
 
 		// Check if we have to update the info overlay
 		if (selection_.hilight() != prev_hl)
@@ -353,17 +376,44 @@ bool MapEditContext::update(long frametime)
 			// Update info overlay depending on edit mode
 			updateInfoOverlay();
 			info_showing_ = selection_.hasHilight();
+			redraw_ = true;
 		}
 	}
 
 	// Update overlay animation (if active)
 	if (overlayActive())
+	{
 		overlay_current_->update(frametime);
+		redraw_ = true;
+	}
+
+	// Keep redrawing while editor messages are fading out (plus a little
+	// extra so the last frame clears them)
+	for (unsigned a = 0; a < editor_messages_.size(); a++)
+		if (editorMessageTime(a) < 2100)
+			redraw_ = true;
 
 	// Update animations
 	renderer_.updateAnimations(mult);
+	if (renderer_.animationsActive())
+		redraw_ = true;
 
-	return true;
+	bool redraw = redraw_;
+	redraw_ = false;
+	return redraw;
+}
+
+// ----------------------------------------------------------------------------
+// MapEditContext::requestRedraw
+//
+// Flags the canvas as needing to be redrawn, and wakes up its update timer
+// if it is sleeping
+// ----------------------------------------------------------------------------
+void MapEditContext::requestRedraw()
+{
+	redraw_ = true;
+	if (canvas_)
+		canvas_->wake();
 }
 
 // ----------------------------------------------------------------------------
@@ -476,6 +526,8 @@ void MapEditContext::showItem(int index)
 		selection_.select({ index, type });
 		renderer_.viewFitToObjects(selection_.selectedObjects(false));
 	}
+
+	requestRedraw();
 }
 
 // ----------------------------------------------------------------------------
@@ -527,6 +579,7 @@ void MapEditContext::setCursor(UI::MouseCursor cursor) const
 void MapEditContext::forceRefreshRenderer()
 {
 	next_frame_length_ = 2;
+	requestRedraw();
 }
 
 // ----------------------------------------------------------------------------
@@ -714,6 +767,10 @@ void MapEditContext::updateTagged()
 			}
 		}
 	}
+
+	// Flash the new hilight and tagged objects
+	if (selection_.hasHilight())
+		renderer_.startFlash();
 }
 
 // ----------------------------------------------------------------------------
@@ -972,6 +1029,8 @@ void MapEditContext::addEditorMessage(string message)
 	msg.message = message;
 	msg.act_time = App::runTimer();
 	editor_messages_.push_back(msg);
+
+	requestRedraw();
 }
 
 // ----------------------------------------------------------------------------
@@ -983,6 +1042,7 @@ void MapEditContext::setFeatureHelp(const vector<string>& lines)
 {
 	feature_help_lines_.clear();
 	feature_help_lines_ = lines;
+	requestRedraw();
 
 	Log::debug("Set Feature Help Text:");
 	for (auto& l : feature_help_lines_)
@@ -1353,6 +1413,7 @@ void MapEditContext::endUndoRecord(bool success)
 	updateThingLists();
 	us_create_delete_ = nullptr;
 	map_.recomputeSpecials();
+	requestRedraw();
 }
 
 // ----------------------------------------------------------------------------
@@ -1400,6 +1461,7 @@ void MapEditContext::doUndo()
 	}
 	updateThingLists();
 	map_.recomputeSpecials();
+	requestRedraw();
 }
 
 // ----------------------------------------------------------------------------
@@ -1436,6 +1498,7 @@ void MapEditContext::doRedo()
 	}
 	updateThingLists();
 	map_.recomputeSpecials();
+	requestRedraw();
 }
 
 // ----------------------------------------------------------------------------
@@ -1619,6 +1682,7 @@ void MapEditContext::drawInfoOverlay(const point2_t& size, float alpha)
 	case Mode::Things:
 		info_thing_.draw(size.y, size.x, alpha); return;
 	case Mode::Visual:
+		info_3d_.setRenderStats(renderer_.renderer3D().nDrawCalls(), renderer_.renderer3D().nTextureBinds());
 		info_3d_.draw(size.y, size.x, size.x * 0.5, alpha); return;
 	}
 }
@@ -1642,6 +1706,9 @@ bool MapEditContext::handleAction(string id)
 	if (overlayActive())
 		return false;
 
+	// Most actions change what is shown on the canvas
+	requestRedraw();
+
 	// Vertices mode
 	if (id == "mapw_mode_vertices")
 	{
@@ -2101,6 +2168,627 @@ CONSOLE_COMMAND(m_test_sector, 0, false)
 	LOG_MESSAGE(1, "Took %ldms", ms);
 }
 
+CONSOLE_COMMAND(m_bench_udmf_save, 0, false)
+{
+	long n_objects = 100000;
+	long iterations = 5;
+	if (args.size() > 0) args[0].ToLong(&n_objects);
+	if (args.size() > 1) args[1].ToLong(&iterations);
+	if (iterations < 1) iterations = 1;
+
+	// Generate a grid of square sectors, each made up of 4 vertices,
+	// 4 lines, 4 sides, 1 sector and 1 thing
+	long n_cells = MAX(1l, n_objects / 14);
+	long grid = (long)ceil(sqrt((double)n_cells));
+	std::string text = "namespace=\"zdoom\";\n";
+	for (long a = 0; a < n_cells; a++)
+	{
+		int x = (a % grid) * 128;
+		int y = (a / grid) * 128;
+		text += S_FMT("thing{x=%d.5;y=%d.25;type=3001;angle=90;skill1=true;skill2=true;}\n", x + 64, y + 64).ToStdString();
+		text += S_FMT("vertex{x=%d.0;y=%d.0;}\nvertex{x=%d.0;y=%d.0;}\n", x, y, x, y + 64).ToStdString();
+		text += S_FMT("vertex{x=%d.0;y=%d.0;}\nvertex{x=%d.0;y=%d.0;}\n", x + 64, y + 64, x + 64, y).ToStdString();
+		for (int l = 0; l < 4; l++)
+		{
+			long v = a * 4;
+			text += S_FMT("linedef{v1=%ld;v2=%ld;sidefront=%ld;blocking=true;alpha=0.75;}\n", v + l, v + (l + 1) % 4, v + l).ToStdString();
+			text += S_FMT("sidedef{sector=%ld;texturemiddle=\"STARTAN2\";offsetx=%d;comment=\"side \\\"%d\\\"\";}\n", a, l * 16, l).ToStdString();
+		}
+		text += S_FMT("sector{texturefloor=\"FLAT1\";textureceiling=\"CEIL1_1\";heightceiling=128;lightlevel=192;id=%ld;}\n", a).ToStdString();
+	}
+
+	// Build a temporary wad containing the map
+	WadArchive wad;
+	wad.addNewEntry("MAP01");
+	ArchiveEntry* textmap = wad.addNewEntry("TEXTMAP");
+	textmap->importMem(text.data(), text.size());
+	wad.addNewEntry("ENDMAP");
+	vector<Archive::MapDesc> maps = wad.detectMaps();
+	if (maps.empty())
+	{
+		LOG_MESSAGE(1, "Failed to generate test map");
+		return;
+	}
+
+	// Load it
+	SLADEMap map;
+	long start = App::runTimer();
+	if (!map.readMap(maps[0]))
+	{
+		LOG_MESSAGE(1, "Failed to load test map");
+		return;
+	}
+	long load_time = App::runTimer() - start;
+	unsigned total = map.nVertices() + map.nLines() + map.nSides() + map.nSectors() + map.nThings();
+	LOG_MESSAGE(1, "Loaded %u objects (%u bytes) in %ldms", total, (unsigned)text.size(), load_time);
+
+	// Write it
+	ArchiveEntry out;
+	start = App::runTimer();
+	for (long a = 0; a < iterations; a++)
+		map.writeUDMFMap(&out);
+	long write_time = App::runTimer() - start;
+	LOG_MESSAGE(
+		1,
+		"Wrote %u objects (%u bytes) in %ldms average over %ld iterations (%u threads)",
+		total,
+		out.getSize(),
+		write_time / iterations,
+		iterations,
+		ThreadPool::nThreads()
+	);
+}
+
+CONSOLE_COMMAND(m_test_polygons, 0, false)
+{
+	SLADEMap& map = MapEditor::editContext().map();
+	int iterations = 1;
+	if (args.size() > 0)
+		iterations = MAX(1, atoi(CHR(args[0])));
+
+	// Triangulator
+	Polygon2D poly;
+	unsigned triangles = 0;
+	unsigned failed = 0;
+	sf::Clock clock;
+	for (int i = 0; i < iterations; i++)
+	{
+		for (unsigned a = 0; a < map.nSectors(); a++)
+		{
+			if (!poly.openSector(map.getSector(a)))
+				failed++;
+			else if (i == 0)
+				triangles += poly.totalVertices() / 3;
+		}
+	}
+	LOG_MESSAGE(1, "Triangulator: %dms, %u triangles, %u failed", clock.getElapsedTime().asMilliseconds(), triangles, failed / iterations);
+
+	// Old polygon splitter
+	unsigned subpolys = 0;
+	failed = 0;
+	clock.restart();
+	for (int i = 0; i < iterations; i++)
+	{
+		for (unsigned a = 0; a < map.nSectors(); a++)
+		{
+			if (!poly.openSectorSplitter(map.getSector(a)))
+				failed++;
+			else if (i == 0)
+				subpolys += poly.nSubPolys();
+		}
+	}
+	LOG_MESSAGE(1, "Polygon splitter: %dms, %u sub-polygons, %u failed", clock.getElapsedTime().asMilliseconds(), subpolys, failed / iterations);
+}
+
+CONSOLE_COMMAND(m_test_text_points, 0, false)
+{
+	SLADEMap& map = MapEditor::editContext().map();
+	int iterations = 1;
+	if (args.size() > 0)
+		iterations = MAX(1, atoi(CHR(args[0])));
+
+	// Get sector edges first, so only the text point calculation is timed
+	vector<vector<MapSectorGeometry::edge_t>> edges(map.nSectors());
+	vector<bbox_t> bboxes(map.nSectors());
+	for (unsigned a = 0; a < map.nSectors(); a++)
+	{
+		MapSectorGeometry::getEdges(map.getSector(a), edges[a]);
+		bboxes[a] = MapSectorGeometry::edgesBBox(edges[a]);
+	}
+
+	sf::Clock clock;
+	unsigned outside = 0;
+	for (int i = 0; i < iterations; i++)
+	{
+		for (unsigned a = 0; a < edges.size(); a++)
+		{
+			fpoint2_t point = MapSectorGeometry::findTextPoint(edges[a], bboxes[a]);
+			if (i == 0 && !edges[a].empty() && !MapSectorGeometry::pointWithin(edges[a], point))
+				outside++;
+		}
+	}
+	LOG_MESSAGE(
+		1,
+		"Text points for %u sectors: %dms over %d iterations (%u outside their sector)",
+		map.nSectors(),
+		clock.getElapsedTime().asMilliseconds(),
+		iterations,
+		outside
+	);
+}
+
+CONSOLE_COMMAND(m_test_nodes, 0, false)
+{
+	SLADEMap& map = MapEditor::editContext().map();
+	int format = MapEditor::editContext().mapDesc().format;
+
+	// Build with the built-in node builder
+	BSPBuilder bsp;
+	sf::Clock clock;
+	bsp.loadMap(map);
+	if (!bsp.build(false))
+	{
+		Log::console("Map has no lines");
+		return;
+	}
+	int time_normal = clock.getElapsedTime().asMilliseconds();
+	BSPBuilder::tree_t tree;
+	bsp.getTree(tree);
+	clock.restart();
+	bsp.build(true);
+	int time_gl = clock.getElapsedTime().asMilliseconds();
+	LOG_MESSAGE(
+		1,
+		"Built-in: %dms (%dms with GL nodes), %u nodes, %u subsectors, %u segs (%u GL), %u splits, %u new vertices, depth %u%s",
+		time_normal,
+		time_gl,
+		bsp.nNodes(),
+		bsp.nSubsectors(),
+		bsp.nSegs(),
+		bsp.nGLSegs(),
+		bsp.nSplits(),
+		bsp.nNewVertices(),
+		bsp.depth(),
+		bsp.fitsVanilla() ? "" : " (too large for vanilla nodes)"
+	);
+
+	// Check subsector sectors match map sectors at random points (away from
+	// lines, where the result can differ depending on rounding)
+	bbox_t bounds = map.getMapBBox();
+	vector<fpoint2_t> points;
+	vector<int> sectors;
+	srand(1);
+	for (unsigned a = 0; a < 10000 && points.size() < 2000; a++)
+	{
+		fpoint2_t point(
+			bounds.min.x + bounds.width() * rand() / RAND_MAX,
+			bounds.min.y + bounds.height() * rand() / RAND_MAX
+		);
+		int sector = map.sectorAt(point);
+		if (sector < 0 || map.nearestLine(point, 1) >= 0)
+			continue;
+		points.push_back(point);
+		sectors.push_back(sector);
+	}
+	unsigned wrong = 0;
+	for (unsigned a = 0; a < points.size(); a++)
+		if (tree.sectorAt(points[a].x, points[a].y) != sectors[a])
+			wrong++;
+	LOG_MESSAGE(1, "Built-in: %u/%lu sample points in the wrong sector", wrong, points.size());
+
+	// Compare with an external node builder (the given one or the currently
+	// selected one)
+	NodeBuilders::builder_t& builder = NodeBuilders::getBuilder(args.size() > 0 ? args[0] : string(nodebuilder_id));
+	if (!wxFileExists(builder.path))
+	{
+		LOG_MESSAGE(1, "Node builder \"%s\" isn't set up, not comparing", builder.id);
+		return;
+	}
+
+	// Write map to a temp wad
+	vector<ArchiveEntry*> entries;
+	if (format == MAP_DOOM)
+		map.writeDoomMap(entries);
+	else if (format == MAP_HEXEN)
+		map.writeHexenMap(entries);
+	else if (format == MAP_UDMF)
+	{
+		ArchiveEntry* textmap = new ArchiveEntry("TEXTMAP");
+		map.writeUDMFMap(textmap);
+		entries.push_back(textmap);
+		entries.push_back(new ArchiveEntry("ENDMAP"));
+	}
+	else
+		return;
+	WadArchive wad;
+	wad.addNewEntry("MAP01");
+	for (unsigned a = 0; a < entries.size(); a++)
+		wad.addEntry(entries[a]);
+	string filename = App::path("sladetemp_nodes.wad", App::Dir::Temp);
+	wad.save(filename);
+	wad.close();
+
+	// Run node builder
+	string command = builder.command;
+	command.Replace("$f", S_FMT("\"%s\"", filename));
+	command.Replace("$o", "");
+	wxArrayString out;
+	clock.restart();
+	wxExecute(S_FMT("\"%s\" %s", builder.path, command), out, wxEXEC_HIDE_CONSOLE);
+	int time_external = clock.getElapsedTime().asMilliseconds();
+
+	// Read nodes
+	wad.open(filename);
+	ArchiveEntry* nodes = wad.getEntry(format == MAP_UDMF ? "ZNODES" : "NODES");
+	ArchiveEntry* segs = wad.getEntry("SEGS");
+	ArchiveEntry* ssectors = wad.getEntry("SSECTORS");
+	BSPBuilder::tree_t external;
+	if (!nodes || !bsp.readTree(
+			nodes->getMCData(),
+			segs ? &segs->getMCData() : nullptr,
+			ssectors ? &ssectors->getMCData() : nullptr,
+			external))
+	{
+		LOG_MESSAGE(1, "%s: Unable to read nodes", builder.name);
+		return;
+	}
+
+	wrong = 0;
+	unsigned differ = 0;
+	for (unsigned a = 0; a < points.size(); a++)
+	{
+		int sector = external.sectorAt(points[a].x, points[a].y);
+		if (sector != sectors[a])
+			wrong++;
+		if (sector != tree.sectorAt(points[a].x, points[a].y))
+			differ++;
+	}
+	LOG_MESSAGE(
+		1,
+		"%s: %dms (including file i/o), %lu nodes, %lu subsectors, %u/%lu sample points in the wrong sector, %u differ from built-in",
+		builder.name,
+		time_external,
+		external.nodes.size(),
+		external.subsector_sectors.size(),
+		wrong,
+		points.size(),
+		differ
+	);
+}
+
+CONSOLE_COMMAND(m_test_blockmap_reject, 0, false)
+{
+	SLADEMap& map = MapEditor::editContext().map();
+	int iterations = 1;
+	if (args.size() > 0)
+		iterations = MAX(1, atoi(CHR(args[0])));
+
+	auto same = [](MemChunk& mc1, MemChunk& mc2)
+	{
+		return mc1.getSize() == mc2.getSize() &&
+			(mc1.getSize() == 0 || memcmp(mc1.getData(), mc2.getData(), mc1.getSize()) == 0);
+	};
+
+	// BLOCKMAP, compressed and uncompressed. Every build should give exactly
+	// the same data
+	BlockmapBuilder blockmap;
+	blockmap.loadMap(map);
+	MemChunk bm_first[2];
+	MemChunk data;
+	unsigned bm_differ = 0;
+	int bm_time[2] = { 0, 0 };
+	for (int compress = 0; compress < 2; compress++)
+	{
+		sf::Clock clock;
+		for (int i = 0; i < iterations; i++)
+		{
+			if (!blockmap.build(i == 0 ? bm_first[compress] : data, compress != 0))
+			{
+				Log::console("Map is empty or too large for a BLOCKMAP");
+				return;
+			}
+			if (i > 0 && !same(data, bm_first[compress]))
+				bm_differ++;
+		}
+		bm_time[compress] = clock.getElapsedTime().asMilliseconds();
+	}
+	LOG_MESSAGE(
+		1,
+		"BLOCKMAP: %dx%d blocks, %d bytes in %dms, %d bytes in %dms compressed (%d blocklists), over %d iterations, %d builds differ",
+		blockmap.nColumns(),
+		blockmap.nRows(),
+		bm_first[0].getSize(),
+		bm_time[0],
+		bm_first[1].getSize(),
+		bm_time[1],
+		blockmap.nBlocklists(),
+		iterations,
+		bm_differ
+	);
+
+	// REJECT, in parallel and on a single thread. Again every build should
+	// give exactly the same data
+	RejectBuilder reject;
+	reject.loadMap(map);
+	MemChunk rej_first;
+	unsigned rej_differ = 0;
+	int rej_time[2] = { 0, 0 };
+	for (int serial = 0; serial < 2; serial++)
+	{
+		sf::Clock clock;
+		for (int i = 0; i < iterations; i++)
+		{
+			bool first = (serial == 0 && i == 0);
+			reject.build(first ? rej_first : data, serial == 0);
+			if (!first && !same(data, rej_first))
+				rej_differ++;
+		}
+		rej_time[serial] = clock.getElapsedTime().asMilliseconds();
+	}
+	LOG_MESSAGE(
+		1,
+		"REJECT: %dms in parallel, %dms single threaded over %d iterations, %d/%d sector pairs hidden (%d sectors too complex), %d builds differ",
+		rej_time[0],
+		rej_time[1],
+		iterations,
+		reject.nHiddenPairs(),
+		map.nSectors() * map.nSectors(),
+		reject.nOverflows(),
+		rej_differ
+	);
+}
+
+CONSOLE_COMMAND(m_test_thing_types, 0, false)
+{
+	SLADEMap& map = MapEditor::editContext().map();
+	int iterations = 1000;
+	if (args.size() > 0)
+		iterations = MAX(1, atoi(CHR(args[0])));
+
+	// Go through all things once per iteration, as the renderer does each
+	// frame. Sum the radius so the lookups can't be optimised away
+	auto& config = Game::configuration();
+	double total = 0;
+	sf::Clock clock;
+	for (int i = 0; i < iterations; i++)
+		for (unsigned a = 0; a < map.nThings(); a++)
+			total += config.thingType(map.getThing(a)->getType()).radius();
+	int time_lookup = clock.getElapsedTime().asMilliseconds();
+
+	// Same again, searching the full thing types map
+	auto& types = config.allThingTypes();
+	double total_map = 0;
+	clock.restart();
+	for (int i = 0; i < iterations; i++)
+		for (unsigned a = 0; a < map.nThings(); a++)
+		{
+			auto ttype = types.find(map.getThing(a)->getType());
+			if (ttype != types.end() && ttype->second.defined())
+				total_map += ttype->second.radius();
+			else
+				total_map += Game::ThingType::unknown().radius();
+		}
+	int time_map = clock.getElapsedTime().asMilliseconds();
+
+	LOG_MESSAGE(
+		1,
+		"Thing types for %d things over %d iterations: %dms lookup table, %dms map search%s",
+		map.nThings(),
+		iterations,
+		time_lookup,
+		time_map,
+		total == total_map ? "" : " (results differ!)"
+	);
+}
+
+CONSOLE_COMMAND(m_test_visibility, 0, false)
+{
+	SLADEMap& map = MapEditor::editContext().map();
+	int iterations = 1000;
+	if (args.size() > 0)
+		iterations = MAX(1, atoi(CHR(args[0])));
+
+	// Build grids
+	MapRenderer2D renderer(&map);
+	renderer.setScale(1.0);
+	sf::Clock clock;
+	renderer.updateVisibilityGrids(true);
+	int time_build = clock.getElapsedTime().asMilliseconds();
+
+	// Pan a 1024x768 view diagonally across the map
+	bbox_t bbox = map.getMapBBox();
+	double visited = 0;
+	double visible = 0;
+	clock.restart();
+	for (int i = 0; i < iterations; i++)
+	{
+		double t = (double)i / iterations;
+		fpoint2_t tl(bbox.min.x + (bbox.width() - 1024) * t, bbox.min.y + (bbox.height() - 768) * t);
+		renderer.updateVisibility(tl, fpoint2_t(tl.x + 1024, tl.y + 768));
+		visited += renderer.visitedObjects();
+		visible += renderer.nVisibleObjects();
+	}
+	int time_query = clock.getElapsedTime().asMilliseconds();
+
+	unsigned total = map.nVertices() + map.nLines() + map.nSectors() + map.nThings();
+	LOG_MESSAGE(
+		1,
+		"Visibility over %d views: %dms (grids built in %dms), %1.1f objects visited and %1.1f visible per view of %d",
+		iterations,
+		time_query,
+		time_build,
+		visited / iterations,
+		visible / iterations,
+		total
+	);
+}
+
+CONSOLE_COMMAND(m_test_buffer_mirror, 0, false)
+{
+	typedef BufferMirror<int>::range_t range_t;
+	unsigned failed = 0;
+	auto check = [&failed](const char* name, const vector<range_t>& ranges, const vector<range_t>& expected)
+	{
+		bool ok = ranges.size() == expected.size();
+		for (unsigned a = 0; ok && a < ranges.size(); a++)
+			ok = ranges[a].first == expected[a].first && ranges[a].count == expected[a].count;
+
+		string got;
+		for (auto& range : ranges)
+			got += S_FMT(" %u+%u", range.first, range.count);
+		LOG_MESSAGE(1, "%s: %s (ranges:%s)", name, ok ? "OK" : "FAILED", got.empty() ? " none" : got);
+		if (!ok)
+			failed++;
+	};
+
+	BufferMirror<int> mirror;
+	mirror.reset(500, 2);
+
+	// A reset needs a full upload, once
+	check("Full upload after reset", mirror.takeDirtyRanges(), { { 0, 500 } });
+	check("Nothing changed", mirror.takeDirtyRanges(), {});
+
+	// Nearby changes are merged, distant ones aren't, and changing an object
+	// twice only counts once
+	mirror.set(40)[0] = 1;
+	mirror.set(5)[0] = 1;
+	mirror.set(7)[1] = 1;
+	mirror.set(5)[1] = 1;
+	check("Merge within gap", mirror.takeDirtyRanges(8, 16), { { 5, 3 }, { 40, 1 } });
+	mirror.set(10);
+	mirror.set(11);
+	mirror.set(12);
+	check("Adjacent objects", mirror.takeDirtyRanges(8, 0), { { 10, 3 } });
+
+	// The gap is widened until there are no more than max_ranges ranges
+	mirror.set(300);
+	mirror.set(0);
+	mirror.set(200);
+	mirror.set(100);
+	check("Max ranges", mirror.takeDirtyRanges(2, 0), { { 0, 301 } });
+	mirror.set(0);
+	mirror.set(100);
+	mirror.set(400);
+	check("Max ranges (partial merge)", mirror.takeDirtyRanges(2, 0), { { 0, 101 }, { 400, 1 } });
+
+	// Data is kept when changed flags are taken, and the buffer can only
+	// grow into its reserved space
+	bool data_ok = mirror.get(5)[0] == 1 && mirror.get(5)[1] == 1 && mirror.get(7)[1] == 1 && mirror.get(6)[0] == 0;
+	bool resize_ok = mirror.resize(mirror.capacity()) && !mirror.resize(mirror.capacity() + 1);
+	LOG_MESSAGE(1, "Data kept: %s", data_ok ? "OK" : "FAILED");
+	LOG_MESSAGE(1, "Resize within capacity: %s", resize_ok ? "OK" : "FAILED");
+	if (!data_ok) failed++;
+	if (!resize_ok) failed++;
+
+	if (failed == 0)
+		LOG_MESSAGE(1, "BufferMirror: All checks passed");
+	else
+		LOG_MESSAGE(1, "BufferMirror: %u checks failed", failed);
+}
+
+CONSOLE_COMMAND(m_test_portal_vis, 0, false)
+{
+	// Build a small map by hand:
+	// 0: Room, with a window into 1 (east) and a door into 4 (north)
+	// 1: Room, with an opening into 2 that can't be seen through the window
+	//    from the top of 0
+	// 2: Room beyond 1
+	// 3: Room not connected to anything
+	// 4: Door sector (closed doors don't block, since heights are ignored)
+	// 5: Room beyond the door
+	vector<PortalVisibility::line_t> lines;
+	auto line = [&lines](double x1, double y1, double x2, double y2, int front, int back)
+	{
+		lines.push_back({ fpoint2_t(x1, y1), fpoint2_t(x2, y2), front, back });
+	};
+
+	// Sector 0
+	line(0, 0, 0, 100, 0, -1);
+	line(0, 100, 40, 100, 0, -1);
+	line(40, 100, 60, 100, 0, 4);	// Door
+	line(60, 100, 100, 100, 0, -1);
+	line(100, 100, 100, 60, 0, -1);
+	line(100, 60, 100, 40, 0, 1);	// Window
+	line(100, 40, 100, 0, 0, -1);
+	line(100, 0, 0, 0, 0, -1);
+
+	// Sector 1
+	line(100, 0, 100, 40, 1, -1);
+	line(100, 60, 100, 100, 1, -1);
+	line(100, 100, 200, 100, 1, -1);
+	line(200, 100, 200, 80, 1, 2);	// Opening
+	line(200, 80, 200, 0, 1, -1);
+	line(200, 0, 100, 0, 1, -1);
+
+	// Sector 2
+	line(200, 0, 200, 80, 2, -1);
+	line(200, 100, 300, 100, 2, -1);
+	line(300, 100, 300, 0, 2, -1);
+	line(300, 0, 200, 0, 2, -1);
+
+	// Sector 3
+	line(500, 0, 500, 100, 3, -1);
+	line(500, 100, 600, 100, 3, -1);
+	line(600, 100, 600, 0, 3, -1);
+	line(600, 0, 500, 0, 3, -1);
+
+	// Sector 4
+	line(40, 100, 40, 108, 4, -1);
+	line(40, 108, 60, 108, 4, 5);
+	line(60, 108, 60, 100, 4, -1);
+
+	// Sector 5
+	line(0, 108, 0, 208, 5, -1);
+	line(0, 208, 100, 208, 5, -1);
+	line(100, 208, 100, 108, 5, -1);
+	line(100, 108, 60, 108, 5, -1);
+	line(40, 108, 0, 108, 5, -1);
+
+	PortalVisibility vis;
+	vis.setGeometry(lines, 6);
+	vis.setThings({ fpoint2_t(150, 50), fpoint2_t(50, 150), fpoint2_t(250, 50), fpoint2_t(550, 50) });
+
+	unsigned failed = 0;
+	auto check = [&failed](const char* name, const vector<unsigned>& result, const vector<unsigned>& expected)
+	{
+		string got;
+		for (unsigned index : result)
+			got += S_FMT(" %u", index);
+		LOG_MESSAGE(1, "%s: %s (got%s)", name, result == expected ? "OK" : "FAILED", got.empty() ? " none" : got);
+		if (result != expected)
+			failed++;
+	};
+	auto sector_at = [&vis](double x, double y) { return (unsigned)(vis.sectorAt(fpoint2_t(x, y)) + 1); };
+
+	// (Sector indices are offset by 1 so -1 can be checked for)
+	check("Sector lookup", { sector_at(10, 90), sector_at(550, 50), sector_at(400, 50) }, { 1, 4, 0 });
+
+	// From the middle of 0, 2 is hidden behind the wall around the window. The
+	// closed door doesn't block anything, and 3 is never reached
+	vis.update(fpoint2_t(50, 50), 0, 0, PI);
+	check("Through window and door", vis.visibleSectors(), { 0, 1, 4, 5 });
+	check("Things through window and door", vis.visibleThings(), { 0, 1 });
+
+	// From the bottom of 0, 2 can be seen through both the window and the
+	// opening
+	vis.update(fpoint2_t(10, 10), 0, 0, PI);
+	check("Through window and opening", vis.visibleSectors(), { 0, 1, 2, 4, 5 });
+
+	// Looking away from the window and door
+	vis.update(fpoint2_t(50, 50), 0, -PI * 0.5, PI * 0.25);
+	check("Facing a wall", vis.visibleSectors(), { 0 });
+
+	// From within the disconnected room
+	vis.update(fpoint2_t(550, 50), 3, 0, PI);
+	check("Disconnected room", vis.visibleSectors(), { 3 });
+	check("Things in disconnected room", vis.visibleThings(), { 3 });
+
+	if (failed == 0)
+		LOG_MESSAGE(1, "PortalVisibility: All checks passed");
+	else
+		LOG_MESSAGE(1, "PortalVisibility: %u checks failed", failed);
+}
+
 CONSOLE_COMMAND(m_test_mobj_backup, 0, false)
 {
 	sf::Clock clock;
@@ -2140,6 +2828,110 @@ CONSOLE_COMMAND(m_test_mobj_backup, 0, false)
 	LOG_MESSAGE(1, "Total: %dms", totalClock.getElapsedTime().asMilliseconds());
 }
 
+CONSOLE_COMMAND(m_test_geometry_scan, 0, false)
+{
+	SLADEMap& map = MapEditor::editContext().map();
+	int iterations = 100;
+	if (args.size() > 0)
+		iterations = MAX(1, atoi(CHR(args[0])));
+
+	// Test points spread over the map
+	bbox_t bbox = map.getMapBBox();
+	vector<fpoint2_t> points;
+	for (int a = 0; a < iterations; a++)
+		points.push_back(fpoint2_t(
+			bbox.min.x + (bbox.max.x - bbox.min.x) * ((a * 37) % 101) / 100.0,
+			bbox.min.y + (bbox.max.y - bbox.min.y) * ((a * 61) % 101) / 100.0
+		));
+
+	// Nearest vertex, via object pointers
+	sf::Clock clock;
+	long check_ptr = 0;
+	for (auto& point : points)
+	{
+		double min_dist = 999999999;
+		int index = -1;
+		for (unsigned a = 0; a < map.nVertices(); a++)
+		{
+			double dist = point.taxicab_distance_to(map.getVertex(a)->point());
+			if (dist < min_dist)
+			{
+				min_dist = dist;
+				index = a;
+			}
+		}
+		check_ptr += index;
+	}
+	long ms_ptr = clock.getElapsedTime().asMilliseconds();
+
+	// Nearest vertex, via geometry store
+	clock.restart();
+	long check_soa = 0;
+	for (auto& point : points)
+		check_soa += map.nearestVertex(point, 999999999);
+	long ms_soa = clock.getElapsedTime().asMilliseconds();
+	Log::console(S_FMT(
+		"Nearest vertex (%d scans of %u vertices): %ldms via objects, %ldms via geometry store%s",
+		iterations,
+		(unsigned)map.nVertices(),
+		ms_ptr,
+		ms_soa,
+		check_ptr == check_soa ? "" : " (MISMATCH)"
+	));
+
+	// Line bbox query, via object pointers
+	clock.restart();
+	check_ptr = 0;
+	for (auto& point : points)
+	{
+		for (unsigned a = 0; a < map.nLines(); a++)
+		{
+			fseg2_t seg = map.getLine(a)->seg();
+			seg.expand(64, 64);
+			if (seg.contains(point))
+				check_ptr++;
+		}
+	}
+	ms_ptr = clock.getElapsedTime().asMilliseconds();
+
+	// Line bbox query, via geometry store
+	clock.restart();
+	check_soa = 0;
+	const MapGeometryStore& geometry = map.geometryStore();
+	for (auto& point : points)
+	{
+		for (unsigned a = 0; a < geometry.nLines(); a++)
+			if (geometry.lineBBoxIntersects(a, point.x - 64, point.y - 64, point.x + 64, point.y + 64))
+				check_soa++;
+	}
+	ms_soa = clock.getElapsedTime().asMilliseconds();
+	Log::console(S_FMT(
+		"Line bbox query (%d scans of %u lines): %ldms via objects, %ldms via geometry store%s",
+		iterations,
+		(unsigned)map.nLines(),
+		ms_ptr,
+		ms_soa,
+		check_ptr == check_soa ? "" : " (MISMATCH)"
+	));
+}
+
+CONSOLE_COMMAND(m_pool_stats, 0, false)
+{
+	Log::console(MapEditor::editContext().map().objectPoolStats());
+}
+
+CONSOLE_COMMAND(m_geometry_update_stats, 0, false)
+{
+	auto& stats = MapEditor::editContext().map().lastGeometryUpdate();
+	Log::console(S_FMT(
+		"Last geometry update: %u vertices, %u lines, %u sectors (%u duplicate sector updates skipped)",
+		stats.vertices,
+		stats.lines,
+		stats.sectors,
+		stats.sector_resets_saved
+	));
+}
+
 CONSOLE_COMMAND(m_vertex_attached, 1, false)
 {
 	MapVertex* vertex = MapEditor::editContext().map().getVertex(atoi(CHR(args[0])));
@@ -66,6 +66,8 @@ public:
 
 	// General
 	bool	update(long frametime);
+	void	requestRedraw();
+	bool	redrawPending() const { return redraw_; }
 
 	// Map loading
 	bool	openMap(Archive::MapDesc map);
@@ -147,6 +149,7 @@ private:
 	MapCanvas*			canvas_				= nullptr;
 	Archive::MapDesc	map_desc_;
 	long				next_frame_length_	= 0;
+	bool				redraw_				= true;
 
 	// Undo/Redo stuff
 	std::unique_ptr<UndoManager>	undo_manager_		= nullptr;
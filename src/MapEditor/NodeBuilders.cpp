@@ -62,6 +62,16 @@ void NodeBuilders::init()
 	none.name = "Don't Build Nodes";
 	builders.push_back(none);
 
+	// Built-in node builder (see BSPBuilder)
+	builder_t builtin;
+	builtin.id = "slade";
+	builtin.name = "SLADE (Built-in)";
+	builtin.options.push_back("gl");
+	builtin.option_desc.push_back("Build GL nodes (ZDoom format)");
+	builtin.options.push_back("extended");
+	builtin.option_desc.push_back("Always build extended nodes (ZDoom format)");
+	builders.push_back(builtin);
+
 	// Get nodebuilders configuration from slade.pk3
 	Archive* archive = App::archiveManager().programResourceArchive();
 	ArchiveEntry* config = archive->entryAtPath("config/nodebuilders.cfg");
@@ -0,0 +1,519 @@
+// ----------------------------------------------------------------------------
+// SLADE - It's a Doom Editor
+// Copyright(C) 2008 - 2017 Simon Judd
+//
+// Email:       sirjuddington@gmail.com
+// Web:         http://slade.mancubus.net
+// Filename:    RejectBuilder.cpp
+// Description: RejectBuilder class - builds REJECT lumps for binary format
+//              maps by flooding sector visibility through portals
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301, USA.
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+//
+// Includes
+//
+// ----------------------------------------------------------------------------
+#include "Main.h"
+#include "RejectBuilder.h"
+#include "SLADEMap/SLADEMap.h"
+#include "Utility/ThreadPool.h"
+
+
+// ----------------------------------------------------------------------------
+//
+// Variables
+//
+// ----------------------------------------------------------------------------
+namespace
+{
+	// Distance a point can be outside a clipping line and still be kept, so
+	// rounding never hides something that is (just) visible
+	const double	clip_epsilon		= 0.01;
+
+	// Portal openings narrower than this are treated as closed
+	const double	min_opening			= 0.001;
+
+	// Maximum portals checked when flooding from a single sector. If this is
+	// reached, everything that might be seen through the sector's portals is
+	// marked visible instead
+	const unsigned	max_flood_steps		= 20000;
+
+	// Maximum memory (in bytes) used for the sets of sectors that might be seen
+	// through each portal
+	const double	max_might_see_size	= 256 * 1024 * 1024;
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// Local Functions
+//
+// ----------------------------------------------------------------------------
+namespace
+{
+	// Returns the distance of [point] from the line [a]->[b], positive if it
+	// is on the left
+	double lineSide(fpoint2_t a, fpoint2_t b, fpoint2_t point)
+	{
+		double dx = b.x - a.x;
+		double dy = b.y - a.y;
+		double length = sqrt(dx * dx + dy * dy);
+		if (length == 0)
+			return 0;
+
+		return (dx * (point.y - a.y) - dy * (point.x - a.x)) / length;
+	}
+
+	// Clips the segment [p1]-[p2] to the left of the line [a]->[b]. Returns
+	// false if nothing is left
+	bool clipLeft(fpoint2_t& p1, fpoint2_t& p2, fpoint2_t a, fpoint2_t b)
+	{
+		if (a.x == b.x && a.y == b.y)
+			return true;
+
+		double d1 = lineSide(a, b, p1) + clip_epsilon;
+		double d2 = lineSide(a, b, p2) + clip_epsilon;
+		if (d1 < 0 && d2 < 0)
+			return false;
+		if (d1 >= 0 && d2 >= 0)
+			return true;
+
+		double t = d1 / (d1 - d2);
+		fpoint2_t split(p1.x + t * (p2.x - p1.x), p1.y + t * (p2.y - p1.y));
+		if (d1 < 0)
+			p1 = split;
+		else
+			p2 = split;
+
+		return (fabs(p2.x - p1.x) + fabs(p2.y - p1.y)) >= min_opening;
+	}
+
+	// Clips the segment [t1]-[t2] to the area that can be seen from the
+	// segment [s1]-[s2] through the segment [p1]-[p2]. That area is bounded
+	// by the separating lines that go through one end of each of the source
+	// and pass segments, with the two segments on opposite sides
+	bool clipToSeparators(fpoint2_t& t1, fpoint2_t& t2, fpoint2_t s1, fpoint2_t s2, fpoint2_t p1, fpoint2_t p2)
+	{
+		fpoint2_t source[2] = { s1, s2 };
+		fpoint2_t pass[2] = { p1, p2 };
+		for (unsigned s = 0; s < 2; s++)
+		{
+			for (unsigned p = 0; p < 2; p++)
+			{
+				fpoint2_t a = source[s];
+				fpoint2_t b = pass[p];
+				if (fabs(a.x - b.x) + fabs(a.y - b.y) < min_opening)
+					continue;
+
+				// Check the other ends are on opposite sides (or on the line)
+				double ds = lineSide(a, b, source[1 - s]);
+				double dp = lineSide(a, b, pass[1 - p]);
+				if (fabs(ds) < 1e-6)
+					ds = 0;
+				if (fabs(dp) < 1e-6)
+					dp = 0;
+				if ((ds > 0 && dp > 0) || (ds < 0 && dp < 0) || (ds == 0 && dp == 0))
+					continue;
+
+				// Keep the side the other end of the pass segment is on
+				bool keep_left = dp != 0 ? dp > 0 : ds < 0;
+				if (!(keep_left ? clipLeft(t1, t2, a, b) : clipLeft(t1, t2, b, a)))
+					return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// RejectBuilder Class Functions
+//
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+// RejectBuilder::clear
+//
+// Clears all sectors and lines
+// ----------------------------------------------------------------------------
+void RejectBuilder::clear()
+{
+	n_sectors_ = 0;
+	n_words_ = 0;
+	portals_.clear();
+	sector_portals_.clear();
+	might_see_.clear();
+	n_lines_ = 0;
+	n_hidden_ = 0;
+	n_overflows_ = 0;
+}
+
+// ----------------------------------------------------------------------------
+// RejectBuilder::addLine
+//
+// Adds a line from [v1] to [v2] between [front_sector] and [back_sector] (-1
+// if the line has no side there). Only two-sided lines between different
+// sectors matter, anything else is ignored
+// ----------------------------------------------------------------------------
+void RejectBuilder::addLine(fpoint2_t v1, fpoint2_t v2, int front_sector, int back_sector)
+{
+	unsigned line = n_lines_++;
+	if (front_sector < 0 || back_sector < 0 || front_sector == back_sector)
+		return;
+	if (front_sector >= (int)n_sectors_ || back_sector >= (int)n_sectors_)
+		return;
+
+	// Front sector is on the right of v1->v2
+	portals_.push_back({ v1, v2, line, (unsigned)front_sector, (unsigned)back_sector });
+	portals_.push_back({ v2, v1, line, (unsigned)back_sector, (unsigned)front_sector });
+}
+
+// ----------------------------------------------------------------------------
+// RejectBuilder::loadMap
+//
+// Adds all sectors and lines in [map]
+// ----------------------------------------------------------------------------
+void RejectBuilder::loadMap(SLADEMap& map)
+{
+	clear();
+	setNumSectors(map.nSectors());
+	for (unsigned a = 0; a < map.nLines(); a++)
+	{
+		MapLine* line = map.getLine(a);
+		MapSector* front = line->frontSector();
+		MapSector* back = line->backSector();
+		addLine(
+			line->v1()->point(),
+			line->v2()->point(),
+			front ? (int)front->getIndex() : -1,
+			back ? (int)back->getIndex() : -1
+		);
+	}
+}
+
+// ----------------------------------------------------------------------------
+// RejectBuilder::build
+//
+// Builds the REJECT lump data into [out]. Sectors are flooded across the
+// thread pool if [parallel] is true (the result is the same either way)
+// ----------------------------------------------------------------------------
+void RejectBuilder::build(MemChunk& out, bool parallel)
+{
+	out.clear();
+	n_hidden_ = 0;
+	n_overflows_ = 0;
+	if (n_sectors_ == 0)
+		return;
+
+	// Get portals leaving each sector
+	sector_portals_.assign(n_sectors_, vector<unsigned>());
+	for (unsigned a = 0; a < portals_.size(); a++)
+		sector_portals_[portals_[a].from].push_back(a);
+
+	// Get sectors that might be seen through each portal (skipped if it would
+	// take up too much memory, paths just aren't cut short then)
+	n_words_ = (n_sectors_ + 63) / 64;
+	might_see_.clear();
+	if ((double)portals_.size() * n_words_ * 8 <= max_might_see_size)
+	{
+		might_see_.assign((size_t)portals_.size() * n_words_, 0);
+		auto might_range = [&](size_t begin, size_t end)
+		{
+			vector<unsigned> open;
+			vector<uint8_t> reached(portals_.size(), 0);
+			for (size_t portal = begin; portal < end; portal++)
+				buildMightSee(portal, open, reached);
+		};
+		if (parallel)
+			ThreadPool::parallelFor(portals_.size(), might_range, 64);
+		else
+			might_range(0, portals_.size());
+	}
+
+	// Flood each sector, each gets its own row of the visibility table
+	vector<uint64_t> visible((size_t)n_words_ * n_sectors_, 0);
+	vector<uint8_t> overflows(n_sectors_, 0);
+	auto flood_range = [&](size_t begin, size_t end)
+	{
+		flood_t flood;
+		flood.on_path.assign(n_lines_, 0);
+		for (size_t sector = begin; sector < end; sector++)
+		{
+			flood.visible.assign(n_words_, 0);
+			flood.steps = 0;
+			flood.overflow = false;
+			floodSector(sector, flood);
+			if (flood.overflow)
+			{
+				overflows[sector] = 1;
+				floodAll(sector, flood);
+			}
+
+			std::copy(flood.visible.begin(), flood.visible.end(), visible.begin() + sector * n_words_);
+		}
+	};
+	if (parallel)
+		ThreadPool::parallelFor(n_sectors_, flood_range, 16);
+	else
+		flood_range(0, n_sectors_);
+
+	// Write reject table (a set bit means the sectors can't see each other).
+	// Visibility is made symmetrical, in case the flood found a way one way
+	// and not the other
+	auto is_visible = [&](unsigned from, unsigned to)
+	{
+		return (visible[(size_t)from * n_words_ + (to >> 6)] >> (to & 63)) & 1;
+	};
+	vector<uint8_t> reject(((size_t)n_sectors_ * n_sectors_ + 7) / 8, 0);
+	for (unsigned s1 = 0; s1 < n_sectors_; s1++)
+	{
+		n_overflows_ += overflows[s1];
+		for (unsigned s2 = 0; s2 < n_sectors_; s2++)
+		{
+			if (is_visible(s1, s2) || is_visible(s2, s1))
+				continue;
+
+			size_t bit = (size_t)s1 * n_sectors_ + s2;
+			reject[bit >> 3] |= 1 << (bit & 7);
+			n_hidden_++;
+		}
+	}
+
+	out.importMem(reject.data(), reject.size());
+}
+
+// ----------------------------------------------------------------------------
+// RejectBuilder::buildMightSee
+//
+// Finds all sectors that could possibly be seen through [portal]: those
+// reachable through portals that are (partly) in front of [portal] and the
+// portal before them. This is a rough superset of what is actually visible,
+// but is quick to work out since each portal only needs to be checked once.
+// [open] and [reached] are working space, [reached] must be all zero
+// ----------------------------------------------------------------------------
+void RejectBuilder::buildMightSee(unsigned portal, vector<unsigned>& open, vector<uint8_t>& reached)
+{
+	const portal_t& base = portals_[portal];
+	uint64_t* might = might_see_.data() + (size_t)portal * n_words_;
+	might[base.to >> 6] |= uint64_t(1) << (base.to & 63);
+
+	open.clear();
+	open.push_back(portal);
+	reached[portal] = 1;
+	for (unsigned a = 0; a < open.size(); a++)
+	{
+		const portal_t& pass = portals_[open[a]];
+		for (unsigned index : sector_portals_[pass.to])
+		{
+			const portal_t& next = portals_[index];
+			if (reached[index] || next.line == base.line)
+				continue;
+
+			fpoint2_t p1 = next.p1;
+			fpoint2_t p2 = next.p2;
+			if (!clipLeft(p1, p2, pass.p1, pass.p2) || !clipLeft(p1, p2, base.p1, base.p2))
+				continue;
+
+			reached[index] = 1;
+			open.push_back(index);
+			might[next.to >> 6] |= uint64_t(1) << (next.to & 63);
+		}
+	}
+
+	for (unsigned index : open)
+		reached[index] = 0;
+}
+
+// ----------------------------------------------------------------------------
+// RejectBuilder::narrowMight
+//
+// Narrows the sectors that might be seen at [step] of the current path in
+// [flood] down to those that might be seen through [portal], for the next
+// step. Returns false if none of them aren't already visible, meaning the
+// path isn't worth following any further
+// ----------------------------------------------------------------------------
+bool RejectBuilder::narrowMight(flood_t& flood, unsigned step, unsigned portal) const
+{
+	if (might_see_.empty())
+		return true;
+
+	if (flood.might.size() < (size_t)(step + 2) * n_words_)
+		flood.might.resize((size_t)(step + 2) * n_words_);
+
+	const uint64_t* current = step > 0 ? flood.might.data() + (size_t)step * n_words_ : nullptr;
+	const uint64_t* portal_might = might_see_.data() + (size_t)portal * n_words_;
+	uint64_t* next = flood.might.data() + (size_t)(step + 1) * n_words_;
+	uint64_t unseen = 0;
+	for (unsigned a = 0; a < n_words_; a++)
+	{
+		next[a] = current ? current[a] & portal_might[a] : portal_might[a];
+		unseen |= next[a] & ~flood.visible[a];
+	}
+
+	return unseen != 0;
+}
+
+// ----------------------------------------------------------------------------
+// RejectBuilder::floodSector
+//
+// Marks all sectors that can be seen from [sector] in [flood]
+// ----------------------------------------------------------------------------
+void RejectBuilder::floodSector(unsigned sector, flood_t& flood) const
+{
+	auto set_visible = [&](unsigned s) { flood.visible[s >> 6] |= uint64_t(1) << (s & 63); };
+
+	set_visible(sector);
+	for (unsigned source_index : sector_portals_[sector])
+	{
+		// Neighbouring sectors are always visible
+		const portal_t& source = portals_[source_index];
+		set_visible(source.to);
+		if (!narrowMight(flood, 0, source_index))
+			continue;
+		flood.on_path[source.line] = 1;
+
+		// Any part of the neighbour's portals beyond the first portal is
+		// visible through it
+		for (unsigned pass_index : sector_portals_[source.to])
+		{
+			const portal_t& pass = portals_[pass_index];
+			if (flood.on_path[pass.line])
+				continue;
+
+			segment_t target = { pass.p1, pass.p2 };
+			if (!clipLeft(target.p1, target.p2, source.p1, source.p2))
+				continue;
+
+			set_visible(pass.to);
+			if (!narrowMight(flood, 1, pass_index))
+				continue;
+
+			flood.on_path[pass.line] = 1;
+			floodThrough({ source.p1, source.p2 }, target, pass.to, 2, flood);
+			flood.on_path[pass.line] = 0;
+
+			if (flood.overflow)
+				break;
+		}
+
+		flood.on_path[source.line] = 0;
+		if (flood.overflow)
+			return;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// RejectBuilder::floodThrough
+//
+// Continues flooding into [sector], which is seen from [source] through
+// [pass] (the portal into [sector]). [step] is the number of portals passed
+// so far
+// ----------------------------------------------------------------------------
+void RejectBuilder::floodThrough(
+	const segment_t& source,
+	const segment_t& pass,
+	unsigned sector,
+	unsigned step,
+	flood_t& flood
+) const
+{
+	if (++flood.steps > max_flood_steps)
+	{
+		flood.overflow = true;
+		return;
+	}
+
+	for (unsigned index : sector_portals_[sector])
+	{
+		const portal_t& portal = portals_[index];
+		if (flood.on_path[portal.line])
+			continue;
+
+		// Clip the portal to what can be seen of it
+		segment_t target = { portal.p1, portal.p2 };
+		if (!clipLeft(target.p1, target.p2, pass.p1, pass.p2) ||
+			!clipLeft(target.p1, target.p2, source.p1, source.p2) ||
+			!clipToSeparators(target.p1, target.p2, source.p1, source.p2, pass.p1, pass.p2))
+			continue;
+
+		flood.visible[portal.to >> 6] |= uint64_t(1) << (portal.to & 63);
+		if (!narrowMight(flood, step, index))
+			continue;
+
+		// Narrow the source down to the part that can see the target
+		segment_t narrowed = source;
+		if (!clipToSeparators(narrowed.p1, narrowed.p2, target.p1, target.p2, pass.p1, pass.p2))
+			narrowed = source;
+
+		flood.on_path[portal.line] = 1;
+		floodThrough(narrowed, target, portal.to, step + 1, flood);
+		flood.on_path[portal.line] = 0;
+
+		if (flood.overflow)
+			return;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// RejectBuilder::floodAll
+//
+// Marks all sectors that might be seen through any of [sector]'s portals as
+// visible, for when flooding from it properly took too long. If there are no
+// 'might see' sets, all sectors connected to [sector] via portals are marked
+// visible instead
+// ----------------------------------------------------------------------------
+void RejectBuilder::floodAll(unsigned sector, flood_t& flood) const
+{
+	flood.visible[sector >> 6] |= uint64_t(1) << (sector & 63);
+	if (!might_see_.empty())
+	{
+		for (unsigned index : sector_portals_[sector])
+		{
+			const uint64_t* might = might_see_.data() + (size_t)index * n_words_;
+			for (unsigned a = 0; a < n_words_; a++)
+				flood.visible[a] |= might[a];
+		}
+		return;
+	}
+
+	// Sectors already marked visible by an overflowed flood still need to be
+	// gone through, so track reached sectors separately
+	vector<uint8_t> reached(n_sectors_, 0);
+	vector<unsigned> open;
+	open.push_back(sector);
+	reached[sector] = 1;
+	while (!open.empty())
+	{
+		unsigned current = open.back();
+		open.pop_back();
+		flood.visible[current >> 6] |= uint64_t(1) << (current & 63);
+		for (unsigned index : sector_portals_[current])
+		{
+			unsigned to = portals_[index].to;
+			if (!reached[to])
+			{
+				reached[to] = 1;
+				open.push_back(to);
+			}
+		}
+	}
+}
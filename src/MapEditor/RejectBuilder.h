@@ -0,0 +1,83 @@
+#pragma once
+
+class MemChunk;
+class SLADEMap;
+
+// Builds a REJECT lump - a bit table of which sectors can't possibly see each
+// other, letting the game skip line of sight checks between them.
+//
+// Sight is traced through portals (two-sided lines) by flooding out from each
+// sector: a portal is only followed if some straight line can pass through
+// it and all previous portals on the way there, which is narrowed at each
+// step by clipping to the separating lines between the source and the last
+// portal passed. Paths are cut short once they can't reach any sector that
+// isn't already visible, using a rough set of sectors that might be seen
+// through each portal (as Quake's vis does). Walls and sector heights are
+// ignored, so the result only ever errs on the side of sectors being
+// visible. Sectors are processed in parallel, and the output doesn't depend
+// on the number of threads
+class RejectBuilder
+{
+public:
+	RejectBuilder() {}
+	~RejectBuilder() {}
+
+	void	clear();
+	void	setNumSectors(unsigned count) { n_sectors_ = count; }
+	void	addLine(fpoint2_t v1, fpoint2_t v2, int front_sector, int back_sector);
+	void	loadMap(SLADEMap& map);
+	void	build(MemChunk& out, bool parallel = true);
+
+	unsigned	nHiddenPairs() const { return n_hidden_; }
+	unsigned	nOverflows() const { return n_overflows_; }
+
+private:
+	// A two-sided line, going from sector [from] to sector [to]. [to] is on
+	// the left of p1->p2
+	struct portal_t
+	{
+		fpoint2_t	p1;
+		fpoint2_t	p2;
+		unsigned	line;
+		unsigned	from;
+		unsigned	to;
+	};
+
+	struct segment_t
+	{
+		fpoint2_t	p1;
+		fpoint2_t	p2;
+	};
+
+	// State for flooding out from a single sector. Sector sets are bit sets of
+	// n_words_ 64-bit words
+	struct flood_t
+	{
+		vector<uint64_t>	visible;
+		vector<uint64_t>	might;		// Sectors that might be seen, for each step of the current path
+		vector<uint8_t>		on_path;	// Per line
+		unsigned			steps;
+		bool				overflow;
+	};
+
+	unsigned					n_sectors_		= 0;
+	unsigned					n_words_		= 0;
+	vector<portal_t>			portals_;
+	vector<vector<unsigned>>	sector_portals_;	// Portals leaving each sector
+	vector<uint64_t>			might_see_;			// Sectors that might be seen through each portal
+	unsigned					n_lines_		= 0;
+	unsigned					n_hidden_		= 0;
+	unsigned					n_overflows_	= 0;
+
+	void	buildMightSee(unsigned portal, vector<unsigned>& open, vector<uint8_t>& reached);
+	bool	narrowMight(flood_t& flood, unsigned step, unsigned portal) const;
+	void	floodSector(unsigned sector, flood_t& flood) const;
+	void	floodThrough(
+				const segment_t& source,
+				const segment_t& pass,
+				unsigned sector,
+				unsigned step,
+				flood_t& flood
+			) const;
+	void	floodAll(unsigned sector, flood_t& flood) const;
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+
+// A CPU-side copy of a vertex buffer made up of fixed-size objects (eg. a map
+// line is 2 or 4 vertices), which keeps track of the objects that have changed
+// since the buffer was last uploaded. Changed objects are coalesced into a
+// small number of ranges, so only those parts of the buffer need to be
+// uploaded again.
+//
+// Space is reserved for more objects than are used, so objects can be added
+// without having to reallocate (and re-upload) the whole buffer
+template<class T>
+class BufferMirror
+{
+public:
+	// A range of objects to upload
+	struct range_t
+	{
+		unsigned	first;
+		unsigned	count;
+	};
+
+	BufferMirror() : stride_{ 0 }, n_objects_{ 0 }, capacity_{ 0 }, full_{ true } {}
+
+	unsigned	stride() const { return stride_; }
+	unsigned	nObjects() const { return n_objects_; }
+	unsigned	capacity() const { return capacity_; }
+	unsigned	nDirty() const { return dirty_.size(); }
+	bool		needsFullUpload() const { return full_; }
+
+	// Buffer data, for uploading
+	const T*	data() const { return data_.data(); }
+	size_t		dataSize() const { return data_.size() * sizeof(T); }
+	size_t		objectSize() const { return stride_ * sizeof(T); }
+
+	// Clears all data and sets up for [n_objects] objects of [stride] items
+	// each. The whole buffer will need to be uploaded
+	void reset(unsigned n_objects, unsigned stride)
+	{
+		stride_ = stride;
+		n_objects_ = n_objects;
+		capacity_ = n_objects + n_objects / 4 + 64;
+		data_.assign(capacity_ * stride_, T());
+		dirty_.clear();
+		is_dirty_.assign(capacity_, 0);
+		full_ = true;
+	}
+
+	// Changes the number of objects in use. Returns false if there isn't
+	// enough space reserved, in which case the buffer needs to be reset
+	bool resize(unsigned n_objects)
+	{
+		if (n_objects > capacity_)
+			return false;
+
+		n_objects_ = n_objects;
+		return true;
+	}
+
+	// Returns the items for object [index]
+	const T* get(unsigned index) const { return &data_[index * stride_]; }
+
+	// Returns the items for object [index] to be modified, and flags it as
+	// changed
+	T* set(unsigned index)
+	{
+		if (!is_dirty_[index])
+		{
+			is_dirty_[index] = 1;
+			dirty_.push_back(index);
+		}
+		return &data_[index * stride_];
+	}
+
+	// Returns ranges covering all changed objects and clears the changed
+	// flags. Nearby changes are merged into one range (uploading a few extra
+	// objects is cheaper than an extra upload), and the gap allowed between
+	// changes is increased until there are no more than [max_ranges]
+	vector<range_t> takeDirtyRanges(unsigned max_ranges = 8, unsigned max_gap = 16)
+	{
+		vector<range_t> ranges;
+		if (full_)
+		{
+			if (n_objects_ > 0)
+				ranges.push_back({ 0, n_objects_ });
+		}
+		else if (!dirty_.empty())
+		{
+			std::sort(dirty_.begin(), dirty_.end());
+			if (max_ranges < 1) max_ranges = 1;
+			while (true)
+			{
+				ranges.clear();
+				for (unsigned index : dirty_)
+				{
+					if (!ranges.empty() && index <= ranges.back().first + ranges.back().count + max_gap)
+						ranges.back().count = index - ranges.back().first + 1;
+					else
+						ranges.push_back({ index, 1 });
+				}
+
+				if (ranges.size() <= max_ranges)
+					break;
+				max_gap = max_gap * 2 + 1;
+			}
+		}
+
+		for (unsigned index : dirty_)
+			is_dirty_[index] = 0;
+		dirty_.clear();
+		full_ = false;
+
+		return ranges;
+	}
+
+private:
+	vector<T>			data_;
+	unsigned			stride_;
+	unsigned			n_objects_;
+	unsigned			capacity_;
+	vector<unsigned>	dirty_;
+	vector<uint8_t>		is_dirty_;
+	bool				full_;
+};
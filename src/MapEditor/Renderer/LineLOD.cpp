@@ -0,0 +1,528 @@
+// ----------------------------------------------------------------------------
+// SLADE - It's a Doom Editor
+// Copyright(C) 2008 - 2017 Simon Judd
+//
+// Email:       sirjuddington@gmail.com
+// Web:         http://slade.mancubus.net
+// Filename:    LineLOD.cpp
+// Description: LineLOD class - builds simplified versions of map lines and
+//              vertices for drawing the 2d map view when zoomed out
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301, USA.
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+//
+// Includes
+//
+// ----------------------------------------------------------------------------
+#include "Main.h"
+#include "LineLOD.h"
+#include "Utility/ThreadPool.h"
+#include <unordered_map>
+#include <unordered_set>
+
+
+// ----------------------------------------------------------------------------
+//
+// Variables
+//
+// ----------------------------------------------------------------------------
+namespace
+{
+	// Size of a tile (in map units)
+	const double	tile_size		= 2048;
+
+	// Map units per pixel for the most detailed level, each level after that
+	// doubles it
+	const double	base_level_size	= 2;
+	const unsigned	n_levels		= 8;
+
+	// Limit on the number of lines merged into one
+	const unsigned	max_chain		= 64;
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// Local Functions
+//
+// ----------------------------------------------------------------------------
+namespace
+{
+	// Returns a key for the cell of [size] containing [x,y]
+	int64_t cellKey(double x, double y, double size)
+	{
+		int64_t cx = (int64_t)floor(x / size);
+		int64_t cy = (int64_t)floor(y / size);
+		return (cx << 32) | (uint32_t)cy;
+	}
+
+	// Returns the tile containing the middle of [line]
+	int64_t lineTile(const LineLOD::line_t& line)
+	{
+		return cellKey((line.v1.x + line.v2.x) * 0.5, (line.v1.y + line.v2.y) * 0.5, tile_size);
+	}
+
+	// Returns true if [a] and [b] are exactly the same
+	bool sameLine(const LineLOD::line_t& a, const LineLOD::line_t& b)
+	{
+		return memcmp(&a, &b, sizeof(LineLOD::line_t)) == 0;
+	}
+
+	// Returns true if [a] and [b] have the same colour
+	bool sameColour(const LineLOD::vert_t& a, const LineLOD::vert_t& b)
+	{
+		return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+	}
+
+	// Returns the squared distance from [p] to the line segment [a]->[b]
+	double distanceSq(fpoint2_t p, fpoint2_t a, fpoint2_t b)
+	{
+		double dx = b.x - a.x;
+		double dy = b.y - a.y;
+		double len_sq = dx * dx + dy * dy;
+		double t = 0;
+		if (len_sq > 0)
+			t = MAX(0.0, MIN(1.0, ((p.x - a.x) * dx + (p.y - a.y) * dy) / len_sq));
+
+		double ox = a.x + dx * t - p.x;
+		double oy = a.y + dy * t - p.y;
+		return ox * ox + oy * oy;
+	}
+
+	// Returns true if [a] and [b] overlap (or touch)
+	bool overlaps(const bbox_t& a, const bbox_t& b)
+	{
+		return a.max.x >= b.min.x && a.min.x <= b.max.x && a.max.y >= b.min.y && a.min.y <= b.max.y;
+	}
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// LineLOD Class Functions
+//
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+// LineLOD::clear
+//
+// Clears all levels and geometry (any build in progress is discarded)
+// ----------------------------------------------------------------------------
+void LineLOD::clear()
+{
+	job_.reset();
+	lines_.clear();
+	line_tiles_.clear();
+	vertices_.clear();
+	vertex_tiles_.clear();
+	tiles_.clear();
+	dirty_.clear();
+	n_tiles_rebuilt_ = 0;
+}
+
+// ----------------------------------------------------------------------------
+// LineLOD::setLines
+//
+// Sets the lines to build levels from. Only the tiles containing lines that
+// differ from the previous set are marked for rebuilding
+// ----------------------------------------------------------------------------
+void LineLOD::setLines(const vector<line_t>& lines)
+{
+	unsigned n = MAX(lines.size(), lines_.size());
+	line_tiles_.resize(lines.size());
+	for (unsigned a = 0; a < n; a++)
+	{
+		bool is_old = a < lines_.size();
+		bool is_new = a < lines.size();
+		if (is_old && is_new && sameLine(lines_[a], lines[a]))
+			continue;
+
+		// Line changed, mark both its old and new tiles
+		if (is_old)
+			dirty_.insert(lineTile(lines_[a]));
+		if (is_new)
+		{
+			line_tiles_[a] = lineTile(lines[a]);
+			dirty_.insert(line_tiles_[a]);
+		}
+	}
+
+	lines_ = lines;
+}
+
+// ----------------------------------------------------------------------------
+// LineLOD::setVertices
+//
+// Sets the vertices to build levels from. Only the tiles containing vertices
+// that differ from the previous set are marked for rebuilding
+// ----------------------------------------------------------------------------
+void LineLOD::setVertices(const vector<fpoint2_t>& vertices)
+{
+	unsigned n = MAX(vertices.size(), vertices_.size());
+	vertex_tiles_.resize(vertices.size());
+	for (unsigned a = 0; a < n; a++)
+	{
+		bool is_old = a < vertices_.size();
+		bool is_new = a < vertices.size();
+		if (is_old && is_new && vertices_[a] == vertices[a])
+			continue;
+
+		if (is_old)
+			dirty_.insert(cellKey(vertices_[a].x, vertices_[a].y, tile_size));
+		if (is_new)
+		{
+			vertex_tiles_[a] = cellKey(vertices[a].x, vertices[a].y, tile_size);
+			dirty_.insert(vertex_tiles_[a]);
+		}
+	}
+
+	vertices_ = vertices;
+}
+
+// ----------------------------------------------------------------------------
+// LineLOD::getLevel
+//
+// Adds the level for [view_scale] (in pixels per map unit) of each tile
+// overlapping [view] to [out]. Returns false if the view is zoomed in too far
+// for any level to be used, or if the levels are out of date (a rebuild is
+// started if needed)
+// ----------------------------------------------------------------------------
+bool LineLOD::getLevel(double view_scale, const bbox_t& view, vector<const level_t*>& out)
+{
+	out.clear();
+
+	// Pick the least detailed level that doesn't simplify anything smaller
+	// than a pixel
+	double pixel_size = 1.0 / view_scale;
+	if (pixel_size < levelSize(0))
+		return false;
+	unsigned level = 0;
+	while (level + 1 < n_levels && levelSize(level + 1) <= pixel_size)
+		level++;
+
+	// Check levels are up to date
+	if (job_ && job_->done.load(std::memory_order_acquire))
+		finishJob();
+	if (!job_ && !dirty_.empty())
+		startJob();
+	if (job_)
+		return false;
+
+	// Get visible tiles
+	for (auto& i : tiles_)
+		if (overlaps(i.second.bbox, view))
+			out.push_back(&i.second.levels[level]);
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// LineLOD::nLevels
+//
+// Returns the number of levels built for each tile
+// ----------------------------------------------------------------------------
+unsigned LineLOD::nLevels()
+{
+	return n_levels;
+}
+
+// ----------------------------------------------------------------------------
+// LineLOD::levelSize
+//
+// Returns the size of a pixel (in map units) that [level] is built for
+// ----------------------------------------------------------------------------
+double LineLOD::levelSize(unsigned level)
+{
+	return base_level_size * (double)(1 << level);
+}
+
+// ----------------------------------------------------------------------------
+// LineLOD::startJob
+//
+// Takes a snapshot of the lines and vertices in all dirty tiles and starts
+// rebuilding them on the thread pool
+// ----------------------------------------------------------------------------
+void LineLOD::startJob()
+{
+	auto job = std::make_shared<job_t>();
+	job->tiles.assign(dirty_.begin(), dirty_.end());
+	for (unsigned a = 0; a < lines_.size(); a++)
+	{
+		if (dirty_.count(line_tiles_[a]))
+		{
+			job->lines.push_back(lines_[a]);
+			job->line_tiles.push_back(line_tiles_[a]);
+		}
+	}
+	for (unsigned a = 0; a < vertices_.size(); a++)
+	{
+		if (dirty_.count(vertex_tiles_[a]))
+		{
+			job->vertices.push_back(vertices_[a]);
+			job->vertex_tiles.push_back(vertex_tiles_[a]);
+		}
+	}
+	dirty_.clear();
+
+	job_ = job;
+	ThreadPool::run([job]()
+	{
+		build(*job);
+		job->done.store(true, std::memory_order_release);
+	});
+}
+
+// ----------------------------------------------------------------------------
+// LineLOD::finishJob
+//
+// Replaces the rebuilt tiles with the results of the finished job
+// ----------------------------------------------------------------------------
+void LineLOD::finishJob()
+{
+	for (auto key : job_->tiles)
+	{
+		auto result = job_->results.find(key);
+		if (result == job_->results.end())
+			tiles_.erase(key);
+		else
+			tiles_[key] = std::move(result->second);
+	}
+
+	n_tiles_rebuilt_ = job_->tiles.size();
+	job_.reset();
+}
+
+// ----------------------------------------------------------------------------
+// LineLOD::build
+//
+// Builds all levels for each tile in [job] (on a worker thread). Tiles left
+// with no lines or vertices are not added to the results
+// ----------------------------------------------------------------------------
+void LineLOD::build(job_t& job)
+{
+	// Sort lines and vertices into tiles (job tiles are in ascending order)
+	unsigned n_tiles = job.tiles.size();
+	auto tile_index = [&job](int64_t key)
+	{
+		return std::lower_bound(job.tiles.begin(), job.tiles.end(), key) - job.tiles.begin();
+	};
+	vector<vector<const line_t*>> tile_lines(n_tiles);
+	vector<vector<fpoint2_t>> tile_vertices(n_tiles);
+	for (unsigned a = 0; a < job.lines.size(); a++)
+		tile_lines[tile_index(job.line_tiles[a])].push_back(&job.lines[a]);
+	for (unsigned a = 0; a < job.vertices.size(); a++)
+		tile_vertices[tile_index(job.vertex_tiles[a])].push_back(job.vertices[a]);
+
+	// Add results for non-empty tiles (before building, so the map isn't
+	// modified while building in parallel)
+	vector<tile_t*> results(n_tiles, nullptr);
+	for (unsigned a = 0; a < n_tiles; a++)
+		if (!tile_lines[a].empty() || !tile_vertices[a].empty())
+			results[a] = &job.results[job.tiles[a]];
+
+	ThreadPool::parallelFor(n_tiles, [&](size_t first, size_t last)
+	{
+		for (size_t t = first; t < last; t++)
+		{
+			tile_t* tile = results[t];
+			if (!tile)
+				continue;
+
+			// Bounding box (lines can extend past the tile)
+			bbox_t& bbox = tile->bbox;
+			fpoint2_t first_point = tile_lines[t].empty() ?
+				tile_vertices[t][0] :
+				fpoint2_t(tile_lines[t][0]->v1.x, tile_lines[t][0]->v1.y);
+			bbox.min = bbox.max = first_point;
+			auto extend = [&bbox](double x, double y)
+			{
+				bbox.min.x = MIN(bbox.min.x, x);
+				bbox.min.y = MIN(bbox.min.y, y);
+				bbox.max.x = MAX(bbox.max.x, x);
+				bbox.max.y = MAX(bbox.max.y, y);
+			};
+			for (auto line : tile_lines[t])
+			{
+				extend(line->v1.x, line->v1.y);
+				extend(line->v2.x, line->v2.y);
+			}
+			for (auto& vertex : tile_vertices[t])
+				extend(vertex.x, vertex.y);
+
+			// Levels
+			tile->levels.resize(n_levels);
+			for (unsigned l = 0; l < n_levels; l++)
+				buildLevel(tile_lines[t], tile_vertices[t], levelSize(l), tile->levels[l]);
+		}
+	});
+}
+
+// ----------------------------------------------------------------------------
+// LineLOD::buildLevel
+//
+// Builds [level] from [lines] and [vertices], for pixels of [size] map units.
+// Line ends are snapped to the middle of the pixel they're in, and chains of
+// same-coloured lines that stay within half a pixel of a straight line are
+// merged into one
+// ----------------------------------------------------------------------------
+void LineLOD::buildLevel(const vector<const line_t*>& lines, const vector<fpoint2_t>& vertices, double size, level_t& level)
+{
+	level.lines.clear();
+	level.points.clear();
+
+	// Snapped line ends ('nodes')
+	std::unordered_map<int64_t, unsigned> node_index;
+	vector<fpoint2_t> nodes;
+	vector<vector<unsigned>> node_edges;
+	auto get_node = [&](double x, double y)
+	{
+		auto key = cellKey(x, y, size);
+		auto i = node_index.find(key);
+		if (i != node_index.end())
+			return i->second;
+
+		unsigned index = nodes.size();
+		node_index[key] = index;
+		nodes.push_back(fpoint2_t((floor(x / size) + 0.5) * size, (floor(y / size) + 0.5) * size));
+		node_edges.emplace_back();
+		return index;
+	};
+
+	// Snapped lines ('edges'), skipping any within a single pixel or
+	// duplicating another
+	struct edge_t
+	{
+		unsigned		n1;
+		unsigned		n2;
+		const vert_t*	colour;
+	};
+	vector<edge_t> edges;
+	std::unordered_set<uint64_t> edge_keys;
+	for (auto line : lines)
+	{
+		unsigned n1 = get_node(line->v1.x, line->v1.y);
+		unsigned n2 = get_node(line->v2.x, line->v2.y);
+		if (n1 == n2)
+			continue;
+
+		uint64_t key = ((uint64_t)MIN(n1, n2) << 32) | MAX(n1, n2);
+		if (!edge_keys.insert(key).second)
+			continue;
+
+		node_edges[n1].push_back(edges.size());
+		node_edges[n2].push_back(edges.size());
+		edges.push_back({ n1, n2, &line->v1 });
+	}
+
+	// Merge chains of edges, starting from [start] along [edge]
+	vector<uint8_t> edge_done(edges.size(), 0);
+	vector<fpoint2_t> chain;
+	double max_dist_sq = size * size * 0.25;
+	auto add_chain = [&](unsigned start, unsigned edge)
+	{
+		edge_done[edge] = 1;
+		const vert_t* colour = edges[edge].colour;
+		unsigned node = edges[edge].n1 == start ? edges[edge].n2 : edges[edge].n1;
+		chain.clear();
+		while (node_edges[node].size() == 2 && chain.size() < max_chain)
+		{
+			// Get the edge continuing the chain
+			unsigned next = node_edges[node][0] == edge ? node_edges[node][1] : node_edges[node][0];
+			if (edge_done[next] || !sameColour(*edges[next].colour, *colour))
+				break;
+			unsigned next_node = edges[next].n1 == node ? edges[next].n2 : edges[next].n1;
+
+			// Check everything in between stays close enough to a straight
+			// line from the start
+			chain.push_back(nodes[node]);
+			bool straight = true;
+			for (auto& point : chain)
+			{
+				if (distanceSq(point, nodes[start], nodes[next_node]) > max_dist_sq)
+				{
+					straight = false;
+					break;
+				}
+			}
+			if (!straight)
+				break;
+
+			edge_done[next] = 1;
+			edge = next;
+			node = next_node;
+		}
+
+		// Add merged line
+		vert_t v1 = *colour;
+		vert_t v2 = *colour;
+		v1.x = nodes[start].x;
+		v1.y = nodes[start].y;
+		v2.x = nodes[node].x;
+		v2.y = nodes[node].y;
+		level.lines.push_back(v1);
+		level.lines.push_back(v2);
+
+		// Continue from the end if the chain was broken mid-way
+		return node;
+	};
+
+	// Start chains from ends and junctions first, then anything left over
+	// (closed loops)
+	for (unsigned n = 0; n < nodes.size(); n++)
+	{
+		if (node_edges[n].size() == 2)
+			continue;
+
+		for (unsigned e : node_edges[n])
+		{
+			if (edge_done[e])
+				continue;
+
+			// Keep going past any breaks in the chain
+			unsigned start = n;
+			unsigned edge = e;
+			while (true)
+			{
+				start = add_chain(start, edge);
+				if (node_edges[start].size() != 2)
+					break;
+
+				edge = node_edges[start][0];
+				if (edge_done[edge])
+					edge = node_edges[start][1];
+				if (edge_done[edge])
+					break;
+			}
+		}
+	}
+	for (unsigned e = 0; e < edges.size(); e++)
+		if (!edge_done[e])
+			add_chain(edges[e].n1, e);
+
+	// Vertices (one per pixel)
+	std::unordered_set<int64_t> vertex_cells;
+	for (auto& vertex : vertices)
+	{
+		if (!vertex_cells.insert(cellKey(vertex.x, vertex.y, size)).second)
+			continue;
+
+		level.points.push_back((floor(vertex.x / size) + 0.5) * size);
+		level.points.push_back((floor(vertex.y / size) + 0.5) * size);
+	}
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <set>
+
+// Simplified versions of the map's lines and vertices for drawing the 2d view
+// when zoomed out. Each level of detail is for a range of zoom levels where a
+// screen pixel covers a certain number of map units: line ends are snapped
+// together within each pixel, lines that end up within a single pixel are
+// dropped, chains of lines that are (near enough) straight at that scale are
+// merged, and only one vertex is kept per pixel.
+//
+// The map is split into tiles, and only tiles containing lines or vertices
+// that changed since the last update are rebuilt. Building is done on the
+// thread pool from a snapshot, and no levels are available while a build is
+// in progress (the full geometry should be drawn instead)
+class LineLOD
+{
+public:
+	// Same layout as the renderer's VBO vertices, so lines can be drawn the
+	// same way
+	struct vert_t
+	{
+		float x, y;
+		float r, g, b, a;
+	};
+	struct line_t
+	{
+		vert_t	v1;
+		vert_t	v2;
+	};
+
+	// Lines (2 vertices each) and vertex points (x,y pairs) in one tile of a
+	// level
+	struct level_t
+	{
+		vector<vert_t>	lines;
+		vector<float>	points;
+	};
+
+	LineLOD() {}
+	~LineLOD() { clear(); }
+
+	void	clear();
+	void	setLines(const vector<line_t>& lines);
+	void	setVertices(const vector<fpoint2_t>& vertices);
+	bool	getLevel(double view_scale, const bbox_t& view, vector<const level_t*>& out);
+
+	bool		isBuilding() const { return (bool)job_; }
+	unsigned	nTiles() const { return tiles_.size(); }
+	unsigned	nTilesRebuilt() const { return n_tiles_rebuilt_; }
+
+	static unsigned	nLevels();
+	static double	levelSize(unsigned level);
+
+private:
+	struct tile_t
+	{
+		bbox_t			bbox;
+		vector<level_t>	levels;
+	};
+
+	// Shared with the worker task, so it stays valid if the renderer is
+	// deleted before it finishes
+	struct job_t
+	{
+		std::atomic<bool>			done;
+		vector<int64_t>				tiles;
+		vector<line_t>				lines;
+		vector<int64_t>				line_tiles;
+		vector<fpoint2_t>			vertices;
+		vector<int64_t>				vertex_tiles;
+		std::map<int64_t, tile_t>	results;
+
+		job_t() : done{ false } {}
+	};
+
+	vector<line_t>				lines_;
+	vector<int64_t>				line_tiles_;
+	vector<fpoint2_t>			vertices_;
+	vector<int64_t>				vertex_tiles_;
+	std::map<int64_t, tile_t>	tiles_;
+	std::set<int64_t>			dirty_;
+	std::shared_ptr<job_t>		job_;
+	unsigned					n_tiles_rebuilt_	= 0;
+
+	void		startJob();
+	void		finishJob();
+	static void	build(job_t& job);
+	static void	buildLevel(const vector<const line_t*>& lines, const vector<fpoint2_t>& vertices, double size, level_t& level);
+};
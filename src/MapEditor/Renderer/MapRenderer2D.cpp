@@ -41,7 +41,11 @@
 #include "OpenGL/Drawing.h"
 #include "OpenGL/GLTexture.h"
 #include "OpenGL/OpenGL.h"
+#include "RenderProfile.h"
 #include "Utility/Polygon2D.h"
+#include "Utility/SpatialGrid.h"
+
+using RenderProfile::Phase;
 
 
 /*******************************************************************
@@ -65,6 +69,7 @@ CVAR(Bool, map_animate_tagged, true, CVAR_SAVE)
 CVAR(Float, arrow_alpha, 1.0f, CVAR_SAVE)
 CVAR(Bool, arrow_colour, false, CVAR_SAVE)
 CVAR(Bool, flats_use_vbo, true, CVAR_SAVE)
+CVAR(Bool, map_2d_lod, true, CVAR_SAVE)
 CVAR(Int, halo_width, 5, CVAR_SAVE)
 CVAR(Float, arrowhead_angle, 0.7854f, CVAR_SAVE)
 CVAR(Float, arrowhead_length, 25.f, CVAR_SAVE)
@@ -81,6 +86,27 @@ float sq_thing_tc[] = { 0.0f, 1.0f,
 
 CVAR(Bool, test_ssplit, false, CVAR_SAVE)
 
+namespace
+{
+	// Atoms for properties read while drawing
+	const MobjPropertyList::Atom atom_xpanningfloor = MobjPropertyList::atom("xpanningfloor");
+	const MobjPropertyList::Atom atom_ypanningfloor = MobjPropertyList::atom("ypanningfloor");
+	const MobjPropertyList::Atom atom_xscalefloor = MobjPropertyList::atom("xscalefloor");
+	const MobjPropertyList::Atom atom_yscalefloor = MobjPropertyList::atom("yscalefloor");
+	const MobjPropertyList::Atom atom_rotationfloor = MobjPropertyList::atom("rotationfloor");
+	const MobjPropertyList::Atom atom_xpanningceiling = MobjPropertyList::atom("xpanningceiling");
+	const MobjPropertyList::Atom atom_ypanningceiling = MobjPropertyList::atom("ypanningceiling");
+	const MobjPropertyList::Atom atom_xscaleceiling = MobjPropertyList::atom("xscaleceiling");
+	const MobjPropertyList::Atom atom_yscaleceiling = MobjPropertyList::atom("yscaleceiling");
+	const MobjPropertyList::Atom atom_rotationceiling = MobjPropertyList::atom("rotationceiling");
+	const MobjPropertyList::Atom atom_id = MobjPropertyList::atom("id");
+	const MobjPropertyList::Atom atom_arg0 = MobjPropertyList::atom("arg0");
+	const MobjPropertyList::Atom atom_arg1 = MobjPropertyList::atom("arg1");
+	const MobjPropertyList::Atom atom_arg2 = MobjPropertyList::atom("arg2");
+	const MobjPropertyList::Atom atom_arg3 = MobjPropertyList::atom("arg3");
+	const MobjPropertyList::Atom atom_arg4 = MobjPropertyList::atom("arg4");
+}
+
 
 /*******************************************************************
  * EXTERNAL VARIABLES
@@ -108,6 +134,10 @@ MapRenderer2D::MapRenderer2D(SLADEMap* map)
 	this->n_vertices = 0;
 	this->n_lines = 0;
 	this->n_things = 0;
+	this->vis_visited = 0;
+	this->grids_geometry_updated = -1;
+	this->grids_things_updated = -1;
+	this->mirror_lines_alpha = 1.0f;
 }
 
 /* MapRenderer2D::~MapRenderer2D
@@ -185,6 +215,8 @@ void MapRenderer2D::renderVertices(float alpha)
 	if (alpha <= 0.01f)
 		return;
 
+	RenderProfile::ScopedTimer timer(Phase::Lines);
+
 	// Setup rendering properties
 	bool point = setupVertexRendering(1.0f);
 
@@ -212,6 +244,9 @@ void MapRenderer2D::renderVertices(float alpha)
  *******************************************************************/
 void MapRenderer2D::renderVerticesImmediate()
 {
+	RenderProfile::addObjects(map->nVertices());
+	RenderProfile::addDrawCalls();
+
 	if (list_vertices > 0 && 
 			map->nVertices() == n_vertices && 
 			map->geometryUpdated() <= vertices_updated &&
@@ -227,9 +262,10 @@ void MapRenderer2D::renderVerticesImmediate()
 		glNewList(list_vertices, GL_COMPILE_AND_EXECUTE);
 
 		// Draw all vertices
+		const MapGeometryStore& geometry = map->geometryStore();
 		glBegin(GL_POINTS);
-		for (unsigned a = 0; a < map->nVertices(); a++)
-			glVertex2d(map->getVertex(a)->xPos(), map->getVertex(a)->yPos());
+		for (unsigned a = 0; a < geometry.nVertices(); a++)
+			glVertex2d(geometry.vertexX()[a], geometry.vertexY()[a]);
 		glEnd();
 
 		glEndList();
@@ -256,12 +292,30 @@ void MapRenderer2D::renderVerticesVBO()
 	glDisableClientState(GL_COLOR_ARRAY);
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 
-	// Setup VBO pointers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_vertices);
-	glVertexPointer(2, GL_FLOAT, 0, nullptr);
+	if (getLODLevels(false))
+	{
+		// Render simplified vertices
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		for (auto level : lod_levels)
+		{
+			if (level->points.empty())
+				continue;
 
-	// Render the VBO
-	glDrawArrays(GL_POINTS, 0, map->nVertices());
+			glVertexPointer(2, GL_FLOAT, 0, level->points.data());
+			glDrawArrays(GL_POINTS, 0, level->points.size() / 2);
+			RenderProfile::addObjects(level->points.size() / 2);
+			RenderProfile::addDrawCalls();
+		}
+	}
+	else
+	{
+		// Setup VBO pointers
+		glBindBuffer(GL_ARRAY_BUFFER, vbo_vertices);
+		glVertexPointer(2, GL_FLOAT, 0, nullptr);
+
+		// Render the visible part of the VBO
+		drawVisibleRuns(vis_runs_v, GL_POINTS, 1, map->nVertices());
+	}
 
 	// Cleanup state
 	glDisableClientState(GL_VERTEX_ARRAY);
@@ -385,6 +439,8 @@ void MapRenderer2D::renderLines(bool show_direction, float alpha)
 	if (alpha <= 0.01f)
 		return;
 
+	RenderProfile::ScopedTimer timer(Phase::Lines);
+
 	// Setup rendering properties
 	glLineWidth(line_width);
 	if (line_smooth)
@@ -405,6 +461,9 @@ void MapRenderer2D::renderLines(bool show_direction, float alpha)
  *******************************************************************/
 void MapRenderer2D::renderLinesImmediate(bool show_direction, float alpha)
 {
+	RenderProfile::addObjects(map->nLines());
+	RenderProfile::addDrawCalls();
+
 	// Use display list if it's built
 	if (list_lines > 0 &&
 		show_direction == lines_dirs &&
@@ -425,6 +484,9 @@ void MapRenderer2D::renderLinesImmediate(bool show_direction, float alpha)
 	glNewList(list_lines, GL_COMPILE_AND_EXECUTE);
 
 	// Draw all lines
+	const MapGeometryStore& geometry = map->geometryStore();
+	const vector<double>& vx = geometry.vertexX();
+	const vector<double>& vy = geometry.vertexY();
 	rgba_t col;
 	MapLine* line = nullptr;
 	double x1, y1, x2, y2;
@@ -433,10 +495,10 @@ void MapRenderer2D::renderLinesImmediate(bool show_direction, float alpha)
 	{
 		// Get line info
 		line = map->getLine(a);
-		x1 = line->v1()->xPos();
-		y1 = line->v1()->yPos();
-		x2 = line->v2()->xPos();
-		y2 = line->v2()->yPos();
+		x1 = vx[geometry.lineV1()[a]];
+		y1 = vy[geometry.lineV1()[a]];
+		x2 = vx[geometry.lineV2()[a]];
+		y2 = vy[geometry.lineV2()[a]];
 
 		// Get line colour
 		col = lineColour(line);
@@ -489,17 +551,33 @@ void MapRenderer2D::renderLinesVBO(bool show_direction, float alpha)
 	glEnableClientState(GL_COLOR_ARRAY);
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 
-	// Setup VBO pointers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_lines);
-	glVertexPointer(2, GL_FLOAT, 24, nullptr);
-
-	glColorPointer(4, GL_FLOAT, 24, ((char*)nullptr + 8));
+	if (getLODLevels(show_direction))
+	{
+		// Render simplified lines
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		for (auto level : lod_levels)
+		{
+			if (level->lines.empty())
+				continue;
 
-	// Render the VBO
-	if (show_direction)
-		glDrawArrays(GL_LINES, 0, map->nLines()*4);
+			glVertexPointer(2, GL_FLOAT, 24, &level->lines[0].x);
+			glColorPointer(4, GL_FLOAT, 24, &level->lines[0].r);
+			glDrawArrays(GL_LINES, 0, level->lines.size());
+			RenderProfile::addObjects(level->lines.size() / 2);
+			RenderProfile::addDrawCalls();
+		}
+	}
 	else
-		glDrawArrays(GL_LINES, 0, map->nLines()*2);
+	{
+		// Setup VBO pointers
+		glBindBuffer(GL_ARRAY_BUFFER, vbo_lines);
+		glVertexPointer(2, GL_FLOAT, 24, nullptr);
+
+		glColorPointer(4, GL_FLOAT, 24, ((char*)nullptr + 8));
+
+		// Render the visible part of the VBO
+		drawVisibleRuns(vis_runs_l, GL_LINES, show_direction ? 4 : 2, map->nLines());
+	}
 
 	// Clean state
 	glDisableClientState(GL_VERTEX_ARRAY);
@@ -828,6 +906,7 @@ void MapRenderer2D::renderRoundThing(double x, double y, double angle, const Gam
 	{
 		tex->bind();
 		tex_last = tex;
+		RenderProfile::addTextureBinds();
 	}
 
 	// Rotate if needed
@@ -842,6 +921,7 @@ void MapRenderer2D::renderRoundThing(double x, double y, double angle, const Gam
 	// Draw thing
 	double radius = tt.radius() * radius_mult;
 	if (tt.shrinkOnZoom()) radius = scaledRadius(radius);
+	RenderProfile::addDrawCalls();
 	glBegin(GL_QUADS);
 	glTexCoord2f(0.0f, 1.0f);	glVertex2d(x-radius, y-radius);
 	glTexCoord2f(0.0f, 0.0f);	glVertex2d(x-radius, y+radius);
@@ -910,6 +990,7 @@ bool MapRenderer2D::renderSpriteThing(double x, double y, double angle, const Ga
 	{
 		tex->bind();
 		tex_last = tex;
+		RenderProfile::addTextureBinds();
 	}
 
 	// Draw thing
@@ -930,6 +1011,7 @@ bool MapRenderer2D::renderSpriteThing(double x, double y, double angle, const Ga
 		double sz = (min(hw, hh))*0.1;
 		if (sz < 1) sz = 1;
 		glColor4f(0.0f, 0.0f, 0.0f, alpha*(thing_shadow*0.7));
+		RenderProfile::addDrawCalls(2);
 		glBegin(GL_QUADS);
 		glTexCoord2f(0.0f, 1.0f);	glVertex2d(x-hw-sz, y-hh-sz);
 		glTexCoord2f(0.0f, 0.0f);	glVertex2d(x-hw-sz, y+hh+sz);
@@ -945,6 +1027,7 @@ bool MapRenderer2D::renderSpriteThing(double x, double y, double angle, const Ga
 	}
 	// Draw thing
 	glColor4f(1.0f, 1.0f, 1.0f, alpha);
+	RenderProfile::addDrawCalls();
 	glBegin(GL_QUADS);
 	glTexCoord2f(0.0f, 1.0f);	glVertex2d(x-hw, y-hh);
 	glTexCoord2f(0.0f, 0.0f);	glVertex2d(x-hw, y+hh);
@@ -1040,11 +1123,13 @@ bool MapRenderer2D::renderSquareThing(double x, double y, double angle, const Ga
 	{
 		tex->bind();
 		tex_last = tex;
+		RenderProfile::addTextureBinds();
 	}
 
 	// Draw thing
 	double radius = tt.radius();
 	if (tt.shrinkOnZoom()) radius = scaledRadius(radius);
+	RenderProfile::addDrawCalls();
 	glBegin(GL_QUADS);
 	int tc = tc_start;
 	glTexCoord2f(sq_thing_tc[tc], sq_thing_tc[tc+1]);
@@ -1079,6 +1164,7 @@ void MapRenderer2D::renderSimpleSquareThing(double x, double y, double angle, co
 	// Move to thing position
 	glPushMatrix();
 	glTranslated(x, y, 0);
+	RenderProfile::addDrawCalls((tt.angled() || thing_force_dir) ? 3 : 2);
 
 	// Draw background
 	glColor4f(0.0f, 0.0f, 0.0f, alpha);
@@ -1123,6 +1209,7 @@ void MapRenderer2D::renderThings(float alpha, bool force_dir)
 	if (alpha <= 0.01f)
 		return;
 
+	RenderProfile::ScopedTimer timer(Phase::Things);
 	things_angles = force_dir;
 	renderThingsImmediate(alpha);
 }
@@ -1146,6 +1233,7 @@ void MapRenderer2D::renderThingsImmediate(float alpha)
 	double x, y, angle;
 	vector<int> things_arrows;
 	long last_update = thing_sprites_updated;
+	RenderProfile::addObjects(vis_list_t.size());
 
 	// Draw thing shadows if needed
 	if (thing_shadow > 0.01f && thing_drawtype != TDT_SPRITE)
@@ -1157,6 +1245,7 @@ void MapRenderer2D::renderThingsImmediate(float alpha)
 		if (tex_shadow)
 		{
 			tex_shadow->bind();
+			RenderProfile::addTextureBinds();
 			glColor4f(0.0f, 0.0f, 0.0f, alpha*thing_shadow);
 
 			// Setup point sprites if supported
@@ -1168,7 +1257,7 @@ void MapRenderer2D::renderThingsImmediate(float alpha)
 				point = true;
 			}
 
-			for (unsigned a = 0; a < map->nThings(); a++)
+			for (unsigned a : vis_list_t)
 			{
 				if (vis_t[a] > 0)
 					continue;
@@ -1187,6 +1276,7 @@ void MapRenderer2D::renderThingsImmediate(float alpha)
 				y = thing->yPos();
 
 				// Draw shadow
+				RenderProfile::addDrawCalls();
 				if (point && radius*2*view_scale <= OpenGL::maxPointSize())
 				{
 					// Point sprite
@@ -1216,7 +1306,7 @@ void MapRenderer2D::renderThingsImmediate(float alpha)
 
 	// Draw things
 	double talpha;
-	for (unsigned a = 0; a < map->nThings(); a++)
+	for (unsigned a : vis_list_t)
 	{
 		if (vis_t[a] > 0)
 			continue;
@@ -1261,7 +1351,7 @@ void MapRenderer2D::renderThingsImmediate(float alpha)
 	{
 		glEnable(GL_TEXTURE_2D);
 
-		for (unsigned a = 0; a < map->nThings(); a++)
+		for (unsigned a : vis_list_t)
 		{
 			if (vis_t[a] > 0)
 				continue;
@@ -1297,6 +1387,8 @@ void MapRenderer2D::renderThingsImmediate(float alpha)
 		{
 			glEnable(GL_TEXTURE_2D);
 			tex_arrow->bind();
+			RenderProfile::addTextureBinds();
+			RenderProfile::addDrawCalls(things_arrows.size());
 
 			for (unsigned a = 0; a < things_arrows.size(); a++)
 			{
@@ -1623,7 +1715,7 @@ void MapRenderer2D::renderPathedThings(vector<MapThing*>& things)
 			// Dragon Path
 			if (tt.flags() & Game::ThingType::FLAG_DRAGON)
 			{
-				MapThing* first = map->getFirstThingWithId(thing->intProperty("id"));
+				MapThing* first = map->getFirstThingWithId(thing->intProp(atom_id));
 				if (first)
 				{
 					path.from_index = thing->getIndex();
@@ -1636,21 +1728,21 @@ void MapRenderer2D::renderPathedThings(vector<MapThing*>& things)
 					map->getDragonTargets(first, dragon_things);
 					for (unsigned d = 0; d < dragon_things.size(); ++d)
 					{
-						int id1 = dragon_things[d]->intProperty("id");
-						int a11 = dragon_things[d]->intProperty("arg0");
-						int a12 = dragon_things[d]->intProperty("arg1");
-						int a13 = dragon_things[d]->intProperty("arg2");
-						int a14 = dragon_things[d]->intProperty("arg3");
-						int a15 = dragon_things[d]->intProperty("arg4");
+						int id1 = dragon_things[d]->intProp(atom_id);
+						int a11 = dragon_things[d]->intProp(atom_arg0);
+						int a12 = dragon_things[d]->intProp(atom_arg1);
+						int a13 = dragon_things[d]->intProp(atom_arg2);
+						int a14 = dragon_things[d]->intProp(atom_arg3);
+						int a15 = dragon_things[d]->intProp(atom_arg4);
 						auto& tt1 = Game::configuration().thingType(dragon_things[d]->getType());
 						for (unsigned e = d + 1; e < dragon_things.size(); ++e)
 						{
-							int id2 = dragon_things[e]->intProperty("id");
-							int a21 = dragon_things[e]->intProperty("arg0");
-							int a22 = dragon_things[e]->intProperty("arg1");
-							int a23 = dragon_things[e]->intProperty("arg2");
-							int a24 = dragon_things[e]->intProperty("arg3");
-							int a25 = dragon_things[e]->intProperty("arg4");
+							int id2 = dragon_things[e]->intProp(atom_id);
+							int a21 = dragon_things[e]->intProp(atom_arg0);
+							int a22 = dragon_things[e]->intProp(atom_arg1);
+							int a23 = dragon_things[e]->intProp(atom_arg2);
+							int a24 = dragon_things[e]->intProp(atom_arg3);
+							int a25 = dragon_things[e]->intProp(atom_arg4);
 							auto& tt2 = Game::configuration().thingType(dragon_things[e]->getType());
 							bool l1to2 = ((a11 == id2) || (a12 == id2) || (a13 == id2) || (a14 == id2) || (a15 == id2));
 							bool l2to1 = ((a21 == id1) || (a22 == id1) || (a23 == id1) || (a24 == id1) || (a25 == id1));
@@ -1716,13 +1808,13 @@ void MapRenderer2D::renderPathedThings(vector<MapThing*>& things)
 						na[3] = ('0' + pos - 1);
 						tid2 += (256 * thing2->intProperty(na));
 					}
-					if (thing2->intProperty("id") == tid)
+					if (thing2->intProp(atom_id) == tid)
 					{
 						path.from_index = thing->getIndex();
 						path.to_index = thing2->getIndex();
-						path.type = (tid2 == thing->intProperty("id")) ? PATH_NORMAL_BOTH : PATH_NORMAL;
+						path.type = (tid2 == thing->intProp(atom_id)) ? PATH_NORMAL_BOTH : PATH_NORMAL;
 					}
-					else if (thing->intProperty("id") == tid2)
+					else if (thing->intProp(atom_id) == tid2)
 					{
 						path.from_index = thing2->getIndex();
 						path.to_index = thing->getIndex();
@@ -1746,7 +1838,7 @@ void MapRenderer2D::renderPathedThings(vector<MapThing*>& things)
 
 		MapThing *from = map->getThing(thing_paths[a].from_index);
 
-		if (from && ((from->intProperty("arg3") | (from->intProperty("arg4") << 8)) > 0))
+		if (from && ((from->intProp(atom_arg3) | (from->intProp(atom_arg4) << 8)) > 0))
 		{
 			MapThing *to = map->getThing(thing_paths[a].to_index);
 			if (!to)
@@ -1770,6 +1862,7 @@ void MapRenderer2D::renderFlats(int type, bool texture, float alpha)
 	if (alpha <= 0.01f)
 		return;
 
+	RenderProfile::ScopedTimer timer(Phase::Flats);
 	if (OpenGL::vboSupport() && flats_use_vbo)
 		renderFlatsVBO(type, texture, alpha);
 	else
@@ -1818,11 +1911,11 @@ void MapRenderer2D::renderFlatsImmediate(int type, bool texture, float alpha)
 	// Go through sectors
 	GLTexture* tex_last = nullptr;
 	GLTexture* tex = nullptr;
-	for (unsigned a = 0; a < map->nSectors(); a++)
+	for (unsigned a : vis_list_s)
 	{
 		MapSector* sector = map->getSector(a);
 
-		// Skip if sector is out of view
+		// Skip if sector is too small to see
 		if (vis_s[a] > 0)
 			continue;
 
@@ -1857,7 +1950,10 @@ void MapRenderer2D::renderFlatsImmediate(int type, bool texture, float alpha)
 				if (!tex_last)
 					glEnable(GL_TEXTURE_2D);
 				if (tex != tex_last)
+				{
 					tex->bind();
+					RenderProfile::addTextureBinds();
+				}
 			}
 			else if (tex_last)
 				glDisable(GL_TEXTURE_2D);
@@ -1885,32 +1981,32 @@ void MapRenderer2D::renderFlatsImmediate(int type, bool texture, float alpha)
 				{
 					if (Game::configuration().featureSupported(UDMFFeature::FlatPanning))
 					{
-						ox = sector->floatProperty("xpanningfloor");
-						oy = sector->floatProperty("ypanningfloor");
+						ox = sector->floatProp(atom_xpanningfloor);
+						oy = sector->floatProp(atom_ypanningfloor);
 					}
 					if (Game::configuration().featureSupported(UDMFFeature::FlatScaling))
 					{
-						sx *= (1.0 / sector->floatProperty("xscalefloor"));
-						sy *= (1.0 / sector->floatProperty("yscalefloor"));
+						sx *= (1.0 / sector->floatProp(atom_xscalefloor));
+						sy *= (1.0 / sector->floatProp(atom_yscalefloor));
 					}
 					if (Game::configuration().featureSupported(UDMFFeature::FlatRotation))
-						rot = sector->floatProperty("rotationfloor");
+						rot = sector->floatProp(atom_rotationfloor);
 				}
 				// Ceiling
 				else
 				{
 					if (Game::configuration().featureSupported(UDMFFeature::FlatPanning))
 					{
-						ox = sector->floatProperty("xpanningceiling");
-						oy = sector->floatProperty("ypanningceiling");
+						ox = sector->floatProp(atom_xpanningceiling);
+						oy = sector->floatProp(atom_ypanningceiling);
 					}
 					if (Game::configuration().featureSupported(UDMFFeature::FlatScaling))
 					{
-						sx *= (1.0 / sector->floatProperty("xscaleceiling"));
-						sy *= (1.0 / sector->floatProperty("yscaleceiling"));
+						sx *= (1.0 / sector->floatProp(atom_xscaleceiling));
+						sy *= (1.0 / sector->floatProp(atom_yscaleceiling));
 					}
 					if (Game::configuration().featureSupported(UDMFFeature::FlatRotation))
-						rot = sector->floatProperty("rotationceiling");
+						rot = sector->floatProp(atom_rotationceiling);
 				}
 			}
 
@@ -1925,6 +2021,8 @@ void MapRenderer2D::renderFlatsImmediate(int type, bool texture, float alpha)
 			glColor4f(col.fr(), col.fg(), col.fb(), alpha);
 		}
 		poly->render();
+		RenderProfile::addObjects(1);
+		RenderProfile::addDrawCalls(poly->nSubPolys());
 	}
 
 	if (texture)
@@ -1961,20 +2059,18 @@ void MapRenderer2D::renderFlatsVBO(int type, bool texture, float alpha)
 		last_flat_type = type;
 	}
 
-	// First, check if any polygon vertex data has changed (in this case we need to refresh the entire vbo)
+	// First, check if any polygon vertex data has changed. Polygons are
+	// updated in place if they still fit, otherwise the entire vbo is rebuilt
+	vector<unsigned> changed;
 	for (unsigned a = 0; a < map->nSectors(); a++)
 	{
 		Polygon2D* poly = map->getSector(a)->getPolygon();
 		if (poly && poly->vboUpdate() > 1)
-		{
-			//LOG_MESSAGE(1, "Updating sector %d polygon vbo data", a);
-			updateFlatsVBO();
-			vbo_updated = true;
-		}
+			changed.push_back(a);
 	}
 
-	// Create VBO if necessary
-	if (!vbo_updated && vbo_flats == 0)
+	// Create or rebuild VBO if necessary
+	if (vbo_flats == 0 || (!changed.empty() && !updateChangedFlats(changed)))
 	{
 		updateFlatsVBO();
 		vbo_updated = true;
@@ -1995,11 +2091,11 @@ void MapRenderer2D::renderFlatsVBO(int type, bool texture, float alpha)
 	GLTexture* tex = nullptr;
 	bool first = true;
 	unsigned update = 0;
-	for (unsigned a = 0; a < map->nSectors(); a++)
+	for (unsigned a : vis_list_s)
 	{
 		MapSector* sector = map->getSector(a);
 
-		// Skip if sector is out of view
+		// Skip if sector is too small to see
 		if (vis_s[a] > 0)
 			continue;
 
@@ -2040,32 +2136,32 @@ void MapRenderer2D::renderFlatsVBO(int type, bool texture, float alpha)
 				{
 					if (Game::configuration().featureSupported(UDMFFeature::FlatPanning))
 					{
-						ox = sector->floatProperty("xpanningfloor");
-						oy = sector->floatProperty("ypanningfloor");
+						ox = sector->floatProp(atom_xpanningfloor);
+						oy = sector->floatProp(atom_ypanningfloor);
 					}
 					if (Game::configuration().featureSupported(UDMFFeature::FlatScaling))
 					{
-						sx *= (1.0 / sector->floatProperty("xscalefloor"));
-						sy *= (1.0 / sector->floatProperty("yscalefloor"));
+						sx *= (1.0 / sector->floatProp(atom_xscalefloor));
+						sy *= (1.0 / sector->floatProp(atom_yscalefloor));
 					}
 					if (Game::configuration().featureSupported(UDMFFeature::FlatRotation))
-						rot = sector->floatProperty("rotationfloor");
+						rot = sector->floatProp(atom_rotationfloor);
 				}
 				// Ceiling
 				else
 				{
 					if (Game::configuration().featureSupported(UDMFFeature::FlatPanning))
 					{
-						ox = sector->floatProperty("xpanningceiling");
-						oy = sector->floatProperty("ypanningceiling");
+						ox = sector->floatProp(atom_xpanningceiling);
+						oy = sector->floatProp(atom_ypanningceiling);
 					}
 					if (Game::configuration().featureSupported(UDMFFeature::FlatScaling))
 					{
-						sx *= (1.0 / sector->floatProperty("xscaleceiling"));
-						sy *= (1.0 / sector->floatProperty("yscaleceiling"));
+						sx *= (1.0 / sector->floatProp(atom_xscaleceiling));
+						sy *= (1.0 / sector->floatProp(atom_yscaleceiling));
 					}
 					if (Game::configuration().featureSupported(UDMFFeature::FlatRotation))
-						rot = sector->floatProperty("rotationceiling");
+						rot = sector->floatProp(atom_rotationceiling);
 				}
 			}
 			// Scaling applies to offsets as well.
@@ -2079,6 +2175,7 @@ void MapRenderer2D::renderFlatsVBO(int type, bool texture, float alpha)
 		// Update polygon VBO data if needed
 		if (poly->vboUpdate() > 0)
 		{
+			RenderProfile::ScopedTimer buffers_timer(Phase::Buffers);
 			poly->updateVBOData();
 			update++;
 			if (update > 200)
@@ -2091,7 +2188,10 @@ void MapRenderer2D::renderFlatsVBO(int type, bool texture, float alpha)
 			if (!tex_last || first)
 				glEnable(GL_TEXTURE_2D);
 			if (tex != tex_last)
+			{
 				tex->bind();
+				RenderProfile::addTextureBinds();
+			}
 		}
 		else if (!tex_last || first)
 			glDisable(GL_TEXTURE_2D);
@@ -2105,6 +2205,8 @@ void MapRenderer2D::renderFlatsVBO(int type, bool texture, float alpha)
 			glColor4f(col.fr(), col.fg(), col.fb(), alpha);
 		}
 		poly->renderVBO(false);
+		RenderProfile::addObjects(1);
+		RenderProfile::addDrawCalls(poly->nSubPolys());
 	}
 	glDisableClientState(GL_VERTEX_ARRAY);
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -2200,7 +2302,7 @@ void MapRenderer2D::renderFlatSelection(const ItemSelection& selection, float fa
 	for (unsigned a = 0; a < selection.size(); a++)
 	{
 		// Don't draw if outside screen (but still draw if it's small)
-		if (vis_s[selection[a].index] > 0 && vis_s[selection[a].index] != VIS_SMALL)
+		if (vis_s[selection[a].index] == VIS_OUTSIDE)
 			continue;
 
 		auto sector = map->getSector(selection[a].index);
@@ -2803,28 +2905,59 @@ void MapRenderer2D::renderObjectEditGroup(ObjectEditGroup* group)
 }
 
 /* MapRenderer2D::updateVerticesVBO
- * (Re)builds the map vertices VBO
+ * Updates the map vertices VBO. Only vertices that moved since the
+ * last update are uploaded, unless the VBO needs to be rebuilt
  *******************************************************************/
 void MapRenderer2D::updateVerticesVBO()
 {
+	RenderProfile::ScopedTimer timer(Phase::Buffers);
 	// Create VBO if needed
+	bool rebuild = false;
 	if (vbo_vertices == 0)
+	{
 		glGenBuffers(1, &vbo_vertices);
+		rebuild = true;
+	}
 
-	// Fill vertices VBO
-	int nfloats = map->nVertices()*2;
-	GLfloat* verts = new GLfloat[nfloats];
-	unsigned i = 0;
-	for (unsigned a = 0; a < map->nVertices(); a++)
+	// Rebuild if there isn't enough room for the vertices
+	const MapGeometryStore& geometry = map->geometryStore();
+	if (rebuild || mirror_vertices.stride() != 2 || !mirror_vertices.resize(geometry.nVertices()))
+		mirror_vertices.reset(geometry.nVertices(), 2);
+
+	// Update changed vertices
+	const vector<double>& vx = geometry.vertexX();
+	const vector<double>& vy = geometry.vertexY();
+	vector<fpoint2_t> lod_vertices(geometry.nVertices());
+	bool full = mirror_vertices.needsFullUpload();
+	for (unsigned a = 0; a < geometry.nVertices(); a++)
 	{
-		verts[i++] = map->getVertex(a)->xPos();
-		verts[i++] = map->getVertex(a)->yPos();
+		lod_vertices[a].set(vx[a], vy[a]);
+
+		const float* old = mirror_vertices.get(a);
+		if (!full && old[0] == (float)vx[a] && old[1] == (float)vy[a])
+			continue;
+
+		float* vert = mirror_vertices.set(a);
+		vert[0] = vx[a];
+		vert[1] = vy[a];
 	}
+
+	// Upload
 	glBindBuffer(GL_ARRAY_BUFFER, vbo_vertices);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat)*nfloats, verts, GL_STATIC_DRAW);
+	auto ranges = mirror_vertices.takeDirtyRanges();
+	if (full)
+		glBufferData(GL_ARRAY_BUFFER, mirror_vertices.dataSize(), mirror_vertices.data(), GL_DYNAMIC_DRAW);
+	else
+	{
+		size_t size = mirror_vertices.objectSize();
+		for (auto& range : ranges)
+			glBufferSubData(GL_ARRAY_BUFFER, range.first * size, range.count * size, mirror_vertices.get(range.first));
+	}
+
+	// Update simplified vertices (only changed areas are rebuilt)
+	lod.setVertices(lod_vertices);
 
 	// Clean up
-	delete[] verts;
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 	n_vertices = map->nVertices();
@@ -2832,71 +2965,124 @@ void MapRenderer2D::updateVerticesVBO()
 }
 
 /* MapRenderer2D::updateLinesVBO
- * (Re)builds the map lines VBO
+ * Updates the map lines VBO. Only lines that changed since the last
+ * update are uploaded, unless the VBO needs to be rebuilt
  *******************************************************************/
 void MapRenderer2D::updateLinesVBO(bool show_direction, float base_alpha)
 {
+	RenderProfile::ScopedTimer timer(Phase::Buffers);
 	LOG_MESSAGE(3, "Updating lines VBO");
 
 	// Create VBO if needed
+	bool rebuild = false;
 	if (vbo_lines == 0)
+	{
 		glGenBuffers(1, &vbo_lines);
+		rebuild = true;
+	}
 
 	// Determine the number of vertices per line
-	int vpl = 2;
+	unsigned vpl = 2;
 	if (show_direction) vpl = 4;
 
-	// Fill lines VBO
-	int nverts = map->nLines()*vpl;
-	glvert_t* lines = new glvert_t[nverts];
-	unsigned v = 0;
+	// Rebuild if direction tabs were toggled, the line alpha changed or
+	// there isn't enough room for the lines
+	if (rebuild ||
+		mirror_lines.stride() != vpl ||
+		mirror_lines_alpha != base_alpha ||
+		!mirror_lines.resize(map->nLines()))
+	{
+		mirror_lines.reset(map->nLines(), vpl);
+		mirror_lines_alpha = base_alpha;
+	}
+	bool full = mirror_lines.needsFullUpload();
+
+	// Update changed lines
+	const MapGeometryStore& geometry = map->geometryStore();
+	const vector<double>& vx = geometry.vertexX();
+	const vector<double>& vy = geometry.vertexY();
+	vbo_line_info.resize(map->nLines());
 	rgba_t col;
 	float alpha;
 	for (unsigned a = 0; a < map->nLines(); a++)
 	{
 		MapLine* line = map->getLine(a);
+		unsigned v1 = geometry.lineV1()[a];
+		unsigned v2 = geometry.lineV2()[a];
+
+		// Check if the line changed
+		vbo_line_t& info = vbo_line_info[a];
+		const glvert_t* old = mirror_lines.get(a);
+		if (!full &&
+			info.line == line &&
+			info.s1 == line->s1() &&
+			info.s2 == line->s2() &&
+			line->modifiedTime() <= lines_updated &&
+			old[0].x == (float)vx[v1] && old[0].y == (float)vy[v1] &&
+			old[1].x == (float)vx[v2] && old[1].y == (float)vy[v2])
+			continue;
+
+		info.line = line;
+		info.s1 = line->s1();
+		info.s2 = line->s2();
+		glvert_t* verts = mirror_lines.set(a);
 
 		// Get line colour
 		col = lineColour(line);
-		alpha = base_alpha*col.fa();
+		alpha = mirror_lines_alpha*col.fa();
 
 		// Set line vertices
-		lines[v].x = line->v1()->xPos();
-		lines[v].y = line->v1()->yPos();
-		lines[v+1].x = line->v2()->xPos();
-		lines[v+1].y = line->v2()->yPos();
+		verts[0].x = vx[v1];
+		verts[0].y = vy[v1];
+		verts[1].x = vx[v2];
+		verts[1].y = vy[v2];
 
 		// Set line colour(s)
-		lines[v].r = lines[v+1].r = col.fr();
-		lines[v].g = lines[v+1].g = col.fg();
-		lines[v].b = lines[v+1].b = col.fb();
-		lines[v].a = lines[v+1].a = alpha;
+		verts[0].r = verts[1].r = col.fr();
+		verts[0].g = verts[1].g = col.fg();
+		verts[0].b = verts[1].b = col.fb();
+		verts[0].a = verts[1].a = alpha;
 
 		// Direction tab if needed
 		if (show_direction)
 		{
 			fpoint2_t mid = line->getPoint(MOBJ_POINT_MID);
 			fpoint2_t tab = line->dirTabPoint();
-			lines[v+2].x = mid.x;
-			lines[v+2].y = mid.y;
-			lines[v+3].x = tab.x;
-			lines[v+3].y = tab.y;
+			verts[2].x = mid.x;
+			verts[2].y = mid.y;
+			verts[3].x = tab.x;
+			verts[3].y = tab.y;
 
 			// Colours
-			lines[v+2].r = lines[v+3].r = col.fr();
-			lines[v+2].g = lines[v+3].g = col.fg();
-			lines[v+2].b = lines[v+3].b = col.fb();
-			lines[v+2].a = lines[v+3].a = alpha*0.6f;
+			verts[2].r = verts[3].r = col.fr();
+			verts[2].g = verts[3].g = col.fg();
+			verts[2].b = verts[3].b = col.fb();
+			verts[2].a = verts[3].a = alpha*0.6f;
 		}
-
-		// Next line
-		v += vpl;
 	}
+
+	// Upload
 	glBindBuffer(GL_ARRAY_BUFFER, vbo_lines);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(glvert_t)*nverts, lines, GL_STATIC_DRAW);
+	auto ranges = mirror_lines.takeDirtyRanges();
+	if (full)
+		glBufferData(GL_ARRAY_BUFFER, mirror_lines.dataSize(), mirror_lines.data(), GL_DYNAMIC_DRAW);
+	else
+	{
+		size_t size = mirror_lines.objectSize();
+		for (auto& range : ranges)
+			glBufferSubData(GL_ARRAY_BUFFER, range.first * size, range.count * size, mirror_lines.get(range.first));
+	}
+
+	// Update simplified lines (only changed areas are rebuilt)
+	vector<LineLOD::line_t> lod_lines(map->nLines());
+	for (unsigned a = 0; a < map->nLines(); a++)
+	{
+		lod_lines[a].v1 = mirror_lines.get(a)[0];
+		lod_lines[a].v2 = mirror_lines.get(a)[1];
+	}
+	lod.setLines(lod_lines);
 
 	// Clean up
-	delete[] lines;
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 	n_lines = map->nLines();
@@ -2911,6 +3097,8 @@ void MapRenderer2D::updateFlatsVBO()
 	if (!flats_use_vbo)
 		return;
 
+	RenderProfile::ScopedTimer timer(Phase::Buffers);
+
 	// Create VBO if needed
 	if (vbo_flats == 0)
 		glGenBuffers(1, &vbo_flats);
@@ -2925,14 +3113,16 @@ void MapRenderer2D::updateFlatsVBO()
 
 	// Allocate buffer data
 	glBindBuffer(GL_ARRAY_BUFFER, vbo_flats);
-	glBufferData(GL_ARRAY_BUFFER, totalsize, nullptr, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, totalsize, nullptr, GL_DYNAMIC_DRAW);
 
 	// Write polygon data to VBO
 	unsigned offset = 0;
 	unsigned index = 0;
+	vbo_flat_info.resize(map->nSectors());
 	for (unsigned a = 0; a < map->nSectors(); a++)
 	{
 		Polygon2D* poly = map->getSector(a)->getPolygon();
+		vbo_flat_info[a] = { offset, index, poly->vboDataSize() };
 		offset = poly->writeToVBO(offset, index);
 		index += poly->totalVertices();
 	}
@@ -2943,62 +3133,254 @@ void MapRenderer2D::updateFlatsVBO()
 	flats_updated = App::runTimer();
 }
 
+/* MapRenderer2D::updateChangedFlats
+ * Writes the polygons of sectors in [sectors] to the flats VBO, in
+ * the same place they were before. Returns false if any of them no
+ * longer fit there, in which case the VBO needs to be rebuilt
+ *******************************************************************/
+bool MapRenderer2D::updateChangedFlats(const vector<unsigned>& sectors)
+{
+	if (vbo_flat_info.size() != map->nSectors())
+		return false;
+
+	for (unsigned a : sectors)
+		if (map->getSector(a)->getPolygon()->vboDataSize() != vbo_flat_info[a].size)
+			return false;
+
+	RenderProfile::ScopedTimer timer(Phase::Buffers);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_flats);
+	for (unsigned a : sectors)
+		map->getSector(a)->getPolygon()->writeToVBO(vbo_flat_info[a].offset, vbo_flat_info[a].index);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	flats_updated = App::runTimer();
+	return true;
+}
+
 /* MapRenderer2D::updateVisibility
- * Updates map object visibility info depending on the current view
+ * Updates map object visibility info depending on the current view.
+ * Only objects found via the spatial grids are checked, so this
+ * depends on the size of the view rather than the size of the map
  *******************************************************************/
 void MapRenderer2D::updateVisibility(fpoint2_t view_tl, fpoint2_t view_br)
 {
+	RenderProfile::ScopedTimer timer(Phase::Visibility);
+	updateVisibilityGrids();
+	vis_visited = 0;
+
+	bbox_t view;
+	view.min = view_tl;
+	view.max = view_br;
+	auto expand = [](bbox_t box, double amount)
+	{
+		box.min.x -= amount;
+		box.min.y -= amount;
+		box.max.x += amount;
+		box.max.y += amount;
+		return box;
+	};
+
+	// Merges a list of indices into runs of consecutive indices (small gaps
+	// are included in the runs, drawing a few extra objects is cheaper than
+	// an extra draw)
+	auto build_runs = [](const vector<unsigned>& list, vector<vis_run_t>& runs)
+	{
+		runs.clear();
+		for (unsigned index : list)
+		{
+			if (!runs.empty() && index <= runs.back().first + runs.back().count + 8)
+				runs.back().count = index - runs.back().first + 1;
+			else
+				runs.push_back({ index, 1 });
+		}
+	};
+
+	// Area to get simplified lines/vertices for
+	vis_view = expand(view, 16 + MAX((double)line_width, (double)vertex_size) * view_scale_inv);
+
+	// Vertices (allow for point size)
+	vis_visited += grid_v.query(expand(view, vertex_size * view_scale_inv), vis_list_v);
+	build_runs(vis_list_v, vis_runs_v);
+
+	// Lines (allow for direction tabs and line width)
+	vis_visited += grid_l.query(expand(view, 16 + line_width * view_scale_inv), vis_list_l);
+	build_runs(vis_list_l, vis_runs_l);
+
 	// Sector visibility
 	if (map->nSectors() != vis_s.size())
 	{
 		// Number of sectors changed, reset array
-		vis_s.clear();
-		for (unsigned a = 0; a < map->nSectors(); a++)
-			vis_s.push_back(0);
+		vis_s.assign(map->nSectors(), VIS_OUTSIDE);
+		vis_list_s.clear();
 	}
-	for (unsigned a = 0; a < map->nSectors(); a++)
+	for (unsigned index : vis_list_s)
+		vis_s[index] = VIS_OUTSIDE;
+	vis_visited += grid_s.query(view, vis_list_s);
+	for (unsigned index : vis_list_s)
 	{
-		// Check against sector bounding box
-		bbox_t bbox = map->getSector(a)->boundingBox();
-		vis_s[a] = 0;
-		if (bbox.max.x < view_tl.x) vis_s[a] = VIS_LEFT;
-		if (bbox.max.y < view_tl.y) vis_s[a] = VIS_ABOVE;
-		if (bbox.min.x > view_br.x) vis_s[a] = VIS_RIGHT;
-		if (bbox.min.y > view_br.y) vis_s[a] = VIS_BELOW;
-
 		// Check if the sector is worth drawing
+		bbox_t bbox = map->getSector(index)->boundingBox();
 		if ((bbox.max.x - bbox.min.x) * view_scale < 4 ||
 				(bbox.max.y - bbox.min.y) * view_scale < 4)
-			vis_s[a] = VIS_SMALL;
+			vis_s[index] = VIS_SMALL;
+		else
+			vis_s[index] = 0;
 	}
 
-	// Thing visibility
+	// Thing visibility (grid boxes are already sized to the thing radius)
 	if (map->nThings() != vis_t.size())
 	{
 		// Number of things changed, reset array
-		vis_t.clear();
-		for (unsigned a = 0; a < map->nThings(); a++)
-			vis_t.push_back(0);
+		vis_t.assign(map->nThings(), VIS_OUTSIDE);
+		vis_list_t.clear();
 	}
-	double x, y;
-	double radius;
-	for (unsigned a = 0; a < vis_t.size(); a++)
+	for (unsigned index : vis_list_t)
+		vis_t[index] = VIS_OUTSIDE;
+	vis_visited += grid_t.query(view, vis_list_t);
+	for (unsigned index : vis_list_t)
 	{
-		vis_t[a] = 0;
-		x = map->getThing(a)->xPos();
-		y = map->getThing(a)->yPos();
+		// Check if the thing is worth drawing
+		auto& tt = Game::configuration().thingType(map->getThing(index)->getType());
+		if (tt.radius() * 1.3 * view_scale < 2)
+			vis_t[index] = VIS_SMALL;
+		else
+			vis_t[index] = 0;
+	}
+}
 
-		// Get thing type properties from game configuration
-		auto& tt = Game::configuration().thingType(map->getThing(a)->getType());
-		radius = tt.radius() * 1.3;
+/* MapRenderer2D::gridsDeferred
+ * Returns true if rebuilding the spatial grids after a map change
+ * should wait until the current mouse drag has ended. The grids from
+ * before the drag are kept meanwhile, unless the number of objects
+ * changed (the visibility lists are indexed by object)
+ *******************************************************************/
+bool MapRenderer2D::gridsDeferred()
+{
+	if (MapEditor::editContext().input().mouseState() == MapEditor::Input::MouseState::Normal)
+		return false;
 
-		// Ignore if outside of screen
-		if (x+radius < view_tl.x || x-radius > view_br.x || y+radius < view_tl.y || y-radius > view_br.y)
-			vis_t[a] = 1;
+	return grid_v.nObjects() == map->nVertices() &&
+		grid_l.nObjects() == map->nLines() &&
+		grid_s.nObjects() == map->nSectors() &&
+		grid_t.nObjects() == map->nThings();
+}
 
-		// Check if the thing is worth drawing
-		else if (radius*view_scale < 2)
-			vis_t[a] = VIS_SMALL;
+/* MapRenderer2D::updateVisibilityGrids
+ * Rebuilds the spatial grids used to find visible objects if the
+ * map has changed since they were built (or if [force] is true).
+ * Only the grids for the kind of object that changed are rebuilt,
+ * and not at all while dragging (see gridsDeferred)
+ *******************************************************************/
+void MapRenderer2D::updateVisibilityGrids(bool force)
+{
+	bool deferred = !force && gridsDeferred();
+	bool update_geometry = force ||
+		(!deferred && map->geometryUpdated() != grids_geometry_updated) ||
+		grid_v.nObjects() != map->nVertices() ||
+		grid_l.nObjects() != map->nLines() ||
+		grid_s.nObjects() != map->nSectors();
+	bool update_things = force ||
+		(!deferred && map->thingsUpdated() != grids_things_updated) ||
+		grid_t.nObjects() != map->nThings();
+	vector<bbox_t> boxes;
+
+	if (update_geometry)
+	{
+		const MapGeometryStore& geometry = map->geometryStore();
+
+		// Vertices
+		boxes.resize(geometry.nVertices());
+		for (unsigned a = 0; a < geometry.nVertices(); a++)
+		{
+			boxes[a].min.set(geometry.vertexX()[a], geometry.vertexY()[a]);
+			boxes[a].max = boxes[a].min;
+		}
+		grid_v.build(boxes);
+
+		// Lines
+		boxes.resize(geometry.nLines());
+		for (unsigned a = 0; a < geometry.nLines(); a++)
+		{
+			boxes[a].min.set(geometry.lineMinX()[a], geometry.lineMinY()[a]);
+			boxes[a].max.set(geometry.lineMaxX()[a], geometry.lineMaxY()[a]);
+		}
+		grid_l.build(boxes);
+
+		// Sectors
+		boxes.resize(map->nSectors());
+		for (unsigned a = 0; a < map->nSectors(); a++)
+			boxes[a] = map->getSector(a)->boundingBox();
+		grid_s.build(boxes);
+
+		grids_geometry_updated = map->geometryUpdated();
+	}
+
+	if (update_things)
+	{
+		boxes.resize(map->nThings());
+		for (unsigned a = 0; a < map->nThings(); a++)
+		{
+			MapThing* thing = map->getThing(a);
+			double radius = Game::configuration().thingType(thing->getType()).radius() * 1.3;
+			boxes[a].min.set(thing->xPos() - radius, thing->yPos() - radius);
+			boxes[a].max.set(thing->xPos() + radius, thing->yPos() + radius);
+		}
+		grid_t.build(boxes);
+
+		grids_things_updated = map->thingsUpdated();
+	}
+}
+
+/* MapRenderer2D::getLODLevels
+ * Gets the simplified lines/vertices covering the current view into
+ * lod_levels. Returns false if the full geometry should be drawn
+ * instead - if zoomed in too far, the simplified geometry is still
+ * being built, or [direction_tabs] is true and the tabs are still
+ * big enough to see (simplified lines have no tabs)
+ *******************************************************************/
+bool MapRenderer2D::getLODLevels(bool direction_tabs)
+{
+	if (!map_2d_lod)
+		return false;
+
+	// Direction tabs are at most 16 units long
+	if (direction_tabs && view_scale_inv < 8)
+		return false;
+
+	return lod.getLevel(view_scale, vis_view, lod_levels);
+}
+
+/* MapRenderer2D::drawVisibleRuns
+ * Draws [runs] of objects from the currently bound VBO, where each
+ * object has [verts_per_object] vertices. Runs past [max_objects]
+ * are clipped
+ *******************************************************************/
+void MapRenderer2D::drawVisibleRuns(const vector<vis_run_t>& runs, unsigned mode, unsigned verts_per_object, unsigned max_objects)
+{
+	vector<GLint> firsts;
+	vector<GLsizei> counts;
+	for (auto& run : runs)
+	{
+		if (run.first >= max_objects)
+			break;
+
+		unsigned count = MIN(run.count, max_objects - run.first);
+		firsts.push_back(run.first * verts_per_object);
+		counts.push_back(count * verts_per_object);
+		RenderProfile::addObjects(count);
+	}
+
+	if (firsts.size() > 1 && glMultiDrawArrays)
+	{
+		glMultiDrawArrays(mode, firsts.data(), counts.data(), firsts.size());
+		RenderProfile::addDrawCalls();
+	}
+	else
+	{
+		for (unsigned a = 0; a < firsts.size(); a++)
+			glDrawArrays(mode, firsts[a], counts[a]);
+		RenderProfile::addDrawCalls(firsts.size());
 	}
 }
 
@@ -3013,8 +3395,15 @@ void MapRenderer2D::forceUpdate(float line_alpha)
 	thing_sprites.clear();
 	thing_paths.clear();
 
+	// Rebuild visibility grids next frame (thing sizes may have changed)
+	grids_geometry_updated = -1;
+	grids_things_updated = -1;
+
 	if (OpenGL::vboSupport())
 	{
+		// Rebuild (rather than update) the vertex and line VBOs
+		mirror_vertices.reset(0, 0);
+		mirror_lines.reset(0, 0);
 		updateVerticesVBO();
 		updateLinesVBO(lines_dirs, line_alpha);
 	}
@@ -3058,6 +3447,14 @@ bool MapRenderer2D::visOK()
 	if (map->nSectors() != vis_s.size() ||
 			map->nThings() != vis_t.size())
 		return false;
+
+	// Grids (and so visibility) are kept as-is while dragging
+	if (gridsDeferred())
+		return true;
+
+	if (map->geometryUpdated() != grids_geometry_updated ||
+			map->thingsUpdated() != grids_things_updated)
+		return false;
 	else
 		return true;
 }
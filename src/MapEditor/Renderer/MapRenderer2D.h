@@ -3,11 +3,15 @@
 #define __MAP_RENDERER_2D__
 
 #include "MapEditor/MapEditor.h"
+#include "BufferMirror.h"
+#include "LineLOD.h"
+#include "Utility/SpatialGrid.h"
 
 // Forward declarations
 class GLTexture;
 class ItemSelection;
 class MapLine;
+class MapSide;
 class MapSector;
 class MapThing;
 class ObjectEditGroup;
@@ -35,29 +39,70 @@ private:
 	// Visibility
 	enum
 	{
-	    VIS_LEFT	= 1,
-	    VIS_RIGHT	= 2,
-	    VIS_ABOVE	= 4,
-	    VIS_BELOW	= 8,
-	    VIS_SMALL	= 16,
+	    VIS_OUTSIDE	= 1,
+	    VIS_SMALL	= 2,
 	};
-	vector<uint8_t>	vis_v;
-	vector<uint8_t>	vis_l;
-	vector<uint8_t>	vis_t;
-	vector<uint8_t>	vis_s;
+	vector<uint8_t>		vis_t;
+	vector<uint8_t>		vis_s;
+	vector<unsigned>	vis_list_v;	// Indices of objects overlapping the view (including small ones)
+	vector<unsigned>	vis_list_l;
+	vector<unsigned>	vis_list_t;
+	vector<unsigned>	vis_list_s;
+	unsigned			vis_visited;
 
-	// Structs
-	struct glvert_t
+	// Runs of consecutive visible vertices/lines, for drawing from the VBOs
+	struct vis_run_t
 	{
-		float x, y;
-		float r, g, b, a;
+		unsigned	first;
+		unsigned	count;
 	};
+	vector<vis_run_t>	vis_runs_v;
+	vector<vis_run_t>	vis_runs_l;
+
+	// Spatial grids for finding objects in view
+	SpatialGrid	grid_v;
+	SpatialGrid	grid_l;
+	SpatialGrid	grid_t;
+	SpatialGrid	grid_s;
+	long		grids_geometry_updated;
+	long		grids_things_updated;
+	bbox_t		vis_view;
+
+	// Simplified lines/vertices for zoomed out views
+	LineLOD							lod;
+	vector<const LineLOD::level_t*>	lod_levels;
+
+	// Structs
+	typedef LineLOD::vert_t glvert_t;
 	struct glline_t
 	{
 		glvert_t v1, v2;	// The line itself
 		glvert_t dv1, dv2;	// Direction tab
 	};
 
+	// CPU-side copies of the VBOs, so only changed parts are uploaded
+	BufferMirror<float>		mirror_vertices;
+	BufferMirror<glvert_t>	mirror_lines;
+	float					mirror_lines_alpha;
+
+	// What each line in the lines VBO was built from (to check for changes)
+	struct vbo_line_t
+	{
+		MapLine*	line;
+		MapSide*	s1;
+		MapSide*	s2;
+	};
+	vector<vbo_line_t>	vbo_line_info;
+
+	// Where each sector's polygon is in the flats VBO
+	struct vbo_flat_t
+	{
+		unsigned	offset;
+		unsigned	index;
+		unsigned	size;
+	};
+	vector<vbo_flat_t>	vbo_flat_info;
+
 	// Other
 	bool	lines_dirs;
 	int		n_vertices;
@@ -182,10 +227,17 @@ public:
 	void	updateVerticesVBO();
 	void	updateLinesVBO(bool show_direction, float alpha);
 	void	updateFlatsVBO();
+	bool	updateChangedFlats(const vector<unsigned>& sectors);
 
 	// Misc
 	void	setScale(double scale) { view_scale = scale; view_scale_inv = 1.0 / scale; }
 	void	updateVisibility(fpoint2_t view_tl, fpoint2_t view_br);
+	void	updateVisibilityGrids(bool force = false);
+	bool	gridsDeferred();
+	bool	getLODLevels(bool direction_tabs);
+	void	drawVisibleRuns(const vector<vis_run_t>& runs, unsigned mode, unsigned verts_per_object, unsigned max_objects);
+	unsigned	visitedObjects() { return vis_visited; }
+	unsigned	nVisibleObjects() { return vis_list_v.size() + vis_list_l.size() + vis_list_t.size() + vis_list_s.size(); }
 	void	forceUpdate(float line_alpha = 1.0f);
 	double	scaledRadius(int radius);
 	bool	visOK();
@@ -40,8 +40,13 @@
 #include "MapEditor/SLADEMap/SLADEMap.h"
 #include "MapRenderer3D.h"
 #include "OpenGL/OpenGL.h"
+#include "RenderProfile.h"
 #include "UI/Controls/PaletteChooser.h"
+#include "Utility/AABBTree.h"
 #include "Utility/MathStuff.h"
+#include "Utility/ThreadPool.h"
+
+using RenderProfile::Phase;
 
 
 /*******************************************************************
@@ -61,6 +66,8 @@ CVAR(Float, render_3d_brightness, 1, CVAR_SAVE)
 CVAR(Float, render_fog_distance, 1500, CVAR_SAVE)
 CVAR(Bool, render_fog_new_formula, true, CVAR_SAVE)
 CVAR(Bool, render_shade_orthogonal_lines, true, CVAR_SAVE)
+CVAR(Bool, render_3d_portal_vis, true, CVAR_SAVE)
+CVAR(Bool, render_3d_batch, true, CVAR_SAVE)
 CVAR(Bool, mlook_invert_y, false, CVAR_SAVE)
 CVAR(Float, camera_3d_sensitivity_x, 1.0f, CVAR_SAVE)
 CVAR(Float, camera_3d_sensitivity_y, 1.0f, CVAR_SAVE)
@@ -73,6 +80,49 @@ EXTERN_CVAR(Bool, flats_use_vbo)
 EXTERN_CVAR(Bool, use_zeth_icons)
 
 
+namespace
+{
+	// Atoms for properties read while building geometry
+	const MobjPropertyList::Atom atom_xpanningfloor = MobjPropertyList::atom("xpanningfloor");
+	const MobjPropertyList::Atom atom_ypanningfloor = MobjPropertyList::atom("ypanningfloor");
+	const MobjPropertyList::Atom atom_xscalefloor = MobjPropertyList::atom("xscalefloor");
+	const MobjPropertyList::Atom atom_yscalefloor = MobjPropertyList::atom("yscalefloor");
+	const MobjPropertyList::Atom atom_rotationfloor = MobjPropertyList::atom("rotationfloor");
+	const MobjPropertyList::Atom atom_xpanningceiling = MobjPropertyList::atom("xpanningceiling");
+	const MobjPropertyList::Atom atom_ypanningceiling = MobjPropertyList::atom("ypanningceiling");
+	const MobjPropertyList::Atom atom_xscaleceiling = MobjPropertyList::atom("xscaleceiling");
+	const MobjPropertyList::Atom atom_yscaleceiling = MobjPropertyList::atom("yscaleceiling");
+	const MobjPropertyList::Atom atom_rotationceiling = MobjPropertyList::atom("rotationceiling");
+	const MobjPropertyList::Atom atom_offsetx_mid = MobjPropertyList::atom("offsetx_mid");
+	const MobjPropertyList::Atom atom_offsety_mid = MobjPropertyList::atom("offsety_mid");
+	const MobjPropertyList::Atom atom_scalex_mid = MobjPropertyList::atom("scalex_mid");
+	const MobjPropertyList::Atom atom_scaley_mid = MobjPropertyList::atom("scaley_mid");
+	const MobjPropertyList::Atom atom_offsetx_top = MobjPropertyList::atom("offsetx_top");
+	const MobjPropertyList::Atom atom_offsety_top = MobjPropertyList::atom("offsety_top");
+	const MobjPropertyList::Atom atom_scalex_top = MobjPropertyList::atom("scalex_top");
+	const MobjPropertyList::Atom atom_scaley_top = MobjPropertyList::atom("scaley_top");
+	const MobjPropertyList::Atom atom_offsetx_bottom = MobjPropertyList::atom("offsetx_bottom");
+	const MobjPropertyList::Atom atom_offsety_bottom = MobjPropertyList::atom("offsety_bottom");
+	const MobjPropertyList::Atom atom_scalex_bottom = MobjPropertyList::atom("scalex_bottom");
+	const MobjPropertyList::Atom atom_scaley_bottom = MobjPropertyList::atom("scaley_bottom");
+	const MobjPropertyList::Atom atom_alpha = MobjPropertyList::atom("alpha");
+	const MobjPropertyList::Atom atom_renderstyle = MobjPropertyList::atom("renderstyle");
+	const MobjPropertyList::Atom atom_wrapmidtex = MobjPropertyList::atom("wrapmidtex");
+	const MobjPropertyList::Atom atom_flags = MobjPropertyList::atom("flags");
+	const MobjPropertyList::Atom atom_height = MobjPropertyList::atom("height");
+
+	// Writes [colour] with rgb multiplied by [mult] (clamped to 255) to
+	// the 4 bytes at [dest]
+	void writeLitColour(uint8_t* dest, const rgba_t& colour, float mult)
+	{
+		dest[0] = MIN(255, (int)(colour.r * mult));
+		dest[1] = MIN(255, (int)(colour.g * mult));
+		dest[2] = MIN(255, (int)(colour.b * mult));
+		dest[3] = colour.a;
+	}
+}
+
+
 /*******************************************************************
  * MAPRENDERER3D CLASS FUNCTIONS
  *******************************************************************/
@@ -90,6 +140,14 @@ MapRenderer3D::MapRenderer3D(SLADEMap* map)
 	this->vbo_ceilings = 0;
 	this->vbo_floors = 0;
 	this->vbo_walls = 0;
+	this->vbo_floor_colours = 0;
+	this->vbo_ceiling_colours = 0;
+	this->vbo_wall_colours = 0;
+	this->walls_vbo_rebuild = true;
+	this->vbo_fullbright = false;
+	this->vbo_brightness = render_3d_brightness;
+	this->n_draw_calls = 0;
+	this->n_texture_binds = 0;
 	this->skytex1 = "SKY1";
 	this->quads = nullptr;
 	this->flats = nullptr;
@@ -99,6 +157,14 @@ MapRenderer3D::MapRenderer3D(SLADEMap* map)
 	this->flat_last = 0;
 	this->render_hilight = true;
 	this->render_selection = true;
+	this->pick_geometry_updated = -1;
+	this->pick_things_updated = -1;
+	this->pick_icon_size = 0;
+	this->vis_portals_active = false;
+	this->vis_geometry_updated = -1;
+	this->vis_things_updated = -1;
+	this->vis_cam_sector = -1;
+	this->view_aspect = 1.2f;
 
 	// Build skybox circle
 	buildSkyCircle();
@@ -121,6 +187,13 @@ MapRenderer3D::~MapRenderer3D()
 	if (vbo_ceilings > 0)	glDeleteBuffers(1, &vbo_ceilings);
 	if (vbo_floors > 0)		glDeleteBuffers(1, &vbo_floors);
 	if (vbo_walls > 0)		glDeleteBuffers(1, &vbo_walls);
+	if (vbo_floor_colours > 0)
+	{
+		glDeleteBuffers(1, &vbo_floor_colours);
+		glDeleteBuffers(1, &vbo_ceiling_colours);
+	}
+	if (vbo_wall_colours > 0)
+		glDeleteBuffers(1, &vbo_wall_colours);
 }
 
 /* MapRenderer3D::init
@@ -165,10 +238,34 @@ void MapRenderer3D::refresh()
 		glDeleteBuffers(1, &vbo_ceilings);
 		vbo_floors = vbo_ceilings = 0;
 	}
+	if (vbo_floor_colours != 0)
+	{
+		glDeleteBuffers(1, &vbo_floor_colours);
+		glDeleteBuffers(1, &vbo_ceiling_colours);
+		vbo_floor_colours = vbo_ceiling_colours = 0;
+	}
+	if (vbo_walls != 0)
+	{
+		glDeleteBuffers(1, &vbo_walls);
+		glDeleteBuffers(1, &vbo_wall_colours);
+		vbo_walls = vbo_wall_colours = 0;
+	}
+	walls_vbo_rebuild = true;
 
 	floors.clear();
 	ceilings.clear();
 
+	// Clear picking trees
+	pick_walls.clear();
+	pick_flats.clear();
+	pick_things.clear();
+
+	// Clear portal visibility data
+	vis_portals.clear();
+	vis_portals_active = false;
+	vis_geometry_updated = -1;
+	vis_things_updated = -1;
+
 	// Set sky texture
 	auto minf = Game::configuration().mapInfo(map->mapName());
 	skytex1 = minf.sky1;
@@ -444,6 +541,7 @@ void MapRenderer3D::setupView(int width, int height)
 	// Calculate aspect ratio
 	float aspect = (1.6f / 1.333333f) * ((float)width / (float)height);
 	float fovy = 2 * MathStuff::radToDeg(atan(tan(MathStuff::degToRad(90) / 2) / aspect));
+	view_aspect = aspect;
 
 	// Setup projection
 	glMatrixMode(GL_PROJECTION);
@@ -465,11 +563,10 @@ void MapRenderer3D::setupView(int width, int height)
 	          up.x, up.y, up.z);
 }
 
-/* MapRenderer3D::setLight
- * Sets the OpenGL colour for rendering an object using [colour]
- * and [light] level
+/* MapRenderer3D::lightMult
+ * Returns the colour multiplier for [light] level
  *******************************************************************/
-void MapRenderer3D::setLight(rgba_t& colour, uint8_t light, float alpha)
+float MapRenderer3D::lightMult(uint8_t light)
 {
 	// Force 255 light in fullbright mode
 	if (fullbright)
@@ -483,6 +580,16 @@ void MapRenderer3D::setLight(rgba_t& colour, uint8_t light, float alpha)
 	// closer resemble the software renderer light level
 	float mult = (float)light / 255.0f;
 	mult *= (mult * 1.3f);
+	return mult;
+}
+
+/* MapRenderer3D::setLight
+ * Sets the OpenGL colour for rendering an object using [colour]
+ * and [light] level
+ *******************************************************************/
+void MapRenderer3D::setLight(rgba_t& colour, uint8_t light, float alpha)
+{
+	float mult = lightMult(light);
 	glColor4f(colour.fr()*mult, colour.fg()*mult, colour.fb()*mult, colour.fa()*alpha);
 }
 
@@ -537,6 +644,8 @@ void MapRenderer3D::renderMap()
 
 	// Init
 	tex_last = nullptr;
+	n_draw_calls = 0;
+	n_texture_binds = 0;
 
 	// Init VBO stuff
 	if (OpenGL::vboSupport())
@@ -577,13 +686,29 @@ void MapRenderer3D::renderMap()
 	if (things.size() != map->nThings())
 		things.resize(map->nThings());
 
-	// Quick distance vis check
+	// Lit vertex colours in the VBOs need updating if the lighting changed
+	if (vbo_fullbright != fullbright || vbo_brightness != render_3d_brightness)
+	{
+		RenderProfile::ScopedTimer timer(Phase::Buffers);
+		vbo_fullbright = fullbright;
+		vbo_brightness = render_3d_brightness;
+		walls_vbo_rebuild = true;
+		for (unsigned a = 0; a < floors.size(); a++)
+			updateFlatColours(a);
+	}
+
+	// Determine visible sectors/lines/things (fall back to a quick
+	// distance check if the camera isn't in a sector)
 	sf::Clock clock;
-	quickVisDiscard();
+	{
+		RenderProfile::ScopedTimer timer(Phase::Visibility);
+		if (!portalVisDiscard())
+			quickVisDiscard();
 
-	// Build lists of quads and flats to render
-	checkVisibleFlats();
-	checkVisibleQuads();
+		// Build lists of quads and flats to render
+		checkVisibleFlats();
+		checkVisibleQuads();
+	}
 
 	// Render sky
 	if (render_3d_sky)
@@ -652,6 +777,7 @@ void MapRenderer3D::renderSkySlice(float top, float bottom, float atop, float ab
 	float tc_y1 = (-top + 1.0f) * (ty * 0.5f);
 	float tc_y2 = (-bottom + 1.0f) * (ty * 0.5f);
 
+	n_draw_calls++;
 	glBegin(GL_QUADS);
 
 	// Go through circular points
@@ -710,6 +836,7 @@ void MapRenderer3D::renderSky()
 	{
 		// Bind texture
 		sky->bind();
+		n_texture_binds++;
 
 		// Get average colour if needed
 		if (skycol_top.a == 0)
@@ -721,6 +848,7 @@ void MapRenderer3D::renderSky()
 
 		// Render top cap
 		float size = 64.0f;
+		n_draw_calls += 2;
 		glDisable(GL_TEXTURE_2D);
 		OpenGL::setColour(skycol_top, false);
 		glBegin(GL_QUADS);
@@ -794,27 +922,23 @@ void MapRenderer3D::renderSky()
 	glEnable(GL_TEXTURE_2D);
 }
 
-/* MapRenderer3D::updateFlatTexCoords
- * Updates the vertex texture coordinates of all polygons for sector
- * [index]
+/* MapRenderer3D::getFlatCoords
+ * Gets the texture scaling, offsets and rotation for the floor or
+ * ceiling (if [floor] is false) of sector [index] into [coords]
  *******************************************************************/
-void MapRenderer3D::updateFlatTexCoords(unsigned index, bool floor)
+void MapRenderer3D::getFlatCoords(unsigned index, bool floor, flat_coords_t& coords)
 {
 	using Game::UDMFFeature;
 
-	// Check index
-	if (index >= map->nSectors())
-		return;
-
 	// Get sector
 	MapSector* sector = map->getSector(index);
 
 	// Get scaling/offset info
-	double ox = 0;
-	double oy = 0;
-	double sx = floor ? floors[index].texture->getScaleX() : ceilings[index].texture->getScaleX();
-	double sy = floor ? floors[index].texture->getScaleY() : ceilings[index].texture->getScaleY();
-	double rot = 0;
+	coords.ox = 0;
+	coords.oy = 0;
+	coords.sx = floor ? floors[index].texture->getScaleX() : ceilings[index].texture->getScaleX();
+	coords.sy = floor ? floors[index].texture->getScaleY() : ceilings[index].texture->getScaleY();
+	coords.rot = 0;
 
 	// Check for UDMF + panning/scaling/rotation
 	if (MapEditor::editContext().mapDesc().format == MAP_UDMF)
@@ -823,56 +947,65 @@ void MapRenderer3D::updateFlatTexCoords(unsigned index, bool floor)
 		{
 			if (Game::configuration().featureSupported(UDMFFeature::FlatPanning))
 			{
-				ox = sector->floatProperty("xpanningfloor");
-				oy = sector->floatProperty("ypanningfloor");
+				coords.ox = sector->floatProp(atom_xpanningfloor);
+				coords.oy = sector->floatProp(atom_ypanningfloor);
 			}
 			if (Game::configuration().featureSupported(UDMFFeature::FlatScaling))
 			{
-				sx *= (1.0 / sector->floatProperty("xscalefloor"));
-				sy *= (1.0 / sector->floatProperty("yscalefloor"));
+				coords.sx *= (1.0 / sector->floatProp(atom_xscalefloor));
+				coords.sy *= (1.0 / sector->floatProp(atom_yscalefloor));
 			}
 			if (Game::configuration().featureSupported(UDMFFeature::FlatRotation))
-				rot = sector->floatProperty("rotationfloor");
+				coords.rot = sector->floatProp(atom_rotationfloor);
 		}
 		else
 		{
 			if (Game::configuration().featureSupported(UDMFFeature::FlatPanning))
 			{
-				ox = sector->floatProperty("xpanningceiling");
-				oy = sector->floatProperty("ypanningceiling");
+				coords.ox = sector->floatProp(atom_xpanningceiling);
+				coords.oy = sector->floatProp(atom_ypanningceiling);
 			}
 			if (Game::configuration().featureSupported(UDMFFeature::FlatScaling))
 			{
-				sx *= (1.0 / sector->floatProperty("xscaleceiling"));
-				sy *= (1.0 / sector->floatProperty("yscaleceiling"));
+				coords.sx *= (1.0 / sector->floatProp(atom_xscaleceiling));
+				coords.sy *= (1.0 / sector->floatProp(atom_yscaleceiling));
 			}
 			if (Game::configuration().featureSupported(UDMFFeature::FlatRotation))
-				rot = sector->floatProperty("rotationceiling");
+				coords.rot = sector->floatProp(atom_rotationceiling);
 		}
 	}
 
 	// Scaling applies to offsets as well.
 	// Note for posterity: worldpanning only applies to textures, not flats
-	ox /= sx;
-	oy /= sy;
-
-	// Update polygon texture coordinates
-	if (floor)
-		sector->getPolygon()->setTexture(floors[index].texture);
-	else
-		sector->getPolygon()->setTexture(ceilings[index].texture);
-	sector->getPolygon()->updateTextureCoords(sx, sy, ox, oy, rot);
+	coords.ox /= coords.sx;
+	coords.oy /= coords.sy;
 }
 
-/* MapRenderer3D::updateSector
- * Updates cached rendering data for sector [index]
+/* MapRenderer3D::updateFlatTexCoords
+ * Updates the vertex texture coordinates of all polygons for sector
+ * [index]
  *******************************************************************/
-void MapRenderer3D::updateSector(unsigned index)
+void MapRenderer3D::updateFlatTexCoords(unsigned index, bool floor)
 {
 	// Check index
 	if (index >= map->nSectors())
 		return;
 
+	flat_coords_t coords;
+	getFlatCoords(index, floor, coords);
+
+	// Update polygon texture coordinates
+	Polygon2D* poly = map->getSector(index)->getPolygon();
+	poly->setTexture(floor ? floors[index].texture : ceilings[index].texture);
+	poly->updateTextureCoords(coords.sx, coords.sy, coords.ox, coords.oy, coords.rot);
+}
+
+/* MapRenderer3D::updateFlatInfo
+ * Updates the floor and ceiling info (texture, colour, plane, etc.)
+ * for sector [index]
+ *******************************************************************/
+void MapRenderer3D::updateFlatInfo(unsigned index)
+{
 	// Update floor
 	MapSector* sector = map->getSector(index);
 	floors[index].sector = sector;
@@ -888,16 +1021,6 @@ void MapRenderer3D::updateSector(unsigned index)
 	if (S_CMPNOCASE(sector->getFloorTex(), Game::configuration().skyFlat()))
 		floors[index].flags |= SKY;
 
-	// Update floor VBO
-	if (OpenGL::vboSupport())
-	{
-		updateFlatTexCoords(index, true);
-		glBindBuffer(GL_ARRAY_BUFFER, vbo_floors);
-		Polygon2D::setupVBOPointers();
-		sector->getPolygon()->setZ(floors[index].plane);
-		sector->getPolygon()->updateVBOData();
-	}
-
 	// Update ceiling
 	ceilings[index].sector = sector;
 	ceilings[index].texture = MapEditor::textureManager().getFlat(
@@ -911,24 +1034,115 @@ void MapRenderer3D::updateSector(unsigned index)
 	ceilings[index].plane = sector->getCeilingPlane();
 	if (S_CMPNOCASE(sector->getCeilingTex(), Game::configuration().skyFlat()))
 		ceilings[index].flags |= SKY;
+}
 
-	// Update ceiling VBO
-	if (OpenGL::vboSupport())
+/* MapRenderer3D::updateSector
+ * Updates cached rendering data for sector [index]
+ *******************************************************************/
+void MapRenderer3D::updateSector(unsigned index)
+{
+	updateSectors(vector<unsigned>(1, index));
+}
+
+/* MapRenderer3D::updateSectors
+ * Updates cached rendering data for all sectors in [indices]. The
+ * flat info is looked up on the main thread, then the floor and
+ * ceiling vertices for each sector are generated on worker threads,
+ * and finally uploaded to the flat VBOs
+ *******************************************************************/
+void MapRenderer3D::updateSectors(const vector<unsigned>& indices)
+{
+	RenderProfile::ScopedTimer timer(Phase::Buffers);
+
+	// Update flat info
+	bool vbo = OpenGL::vboSupport();
+	vector<unsigned> update;
+	vector<flat_coords_t> coords;
+	update.reserve(indices.size());
+	for (unsigned index : indices)
 	{
-		updateFlatTexCoords(index, false);
-		glBindBuffer(GL_ARRAY_BUFFER, vbo_ceilings);
-		Polygon2D::setupVBOPointers();
-		sector->getPolygon()->setZ(ceilings[index].plane);
-		sector->getPolygon()->updateVBOData();
+		// Check index
+		if (index >= map->nSectors())
+			continue;
+
+		updateFlatInfo(index);
+		update.push_back(index);
+
+		// Texture coordinates (and polygon, which is built on first use)
+		if (vbo)
+		{
+			coords.resize(coords.size() + 2);
+			getFlatCoords(index, true, coords[coords.size() - 2]);
+			getFlatCoords(index, false, coords[coords.size() - 1]);
+			map->getSector(index)->getPolygon();
+		}
 	}
 
-	// Finish up
-	floors[index].updated_time = App::runTimer();
-	ceilings[index].updated_time = App::runTimer();
-	if (OpenGL::vboSupport())
+	// Generate floor and ceiling vertices (each sector has its own
+	// polygon, so they can be done in parallel)
+	if (vbo)
 	{
+		vector<vector<::gl_vertex_t>> vertices(update.size() * 2);
+		ThreadPool::parallelFor(update.size(), [&](size_t begin, size_t end)
+		{
+			for (size_t a = begin; a < end; a++)
+			{
+				unsigned index = update[a];
+				Polygon2D* poly = map->getSector(index)->getPolygon();
+				for (unsigned f = 0; f < 2; f++)
+				{
+					const flat_3d_t& flat = f == 0 ? floors[index] : ceilings[index];
+					const flat_coords_t& fc = coords[a * 2 + f];
+					poly->setTexture(flat.texture);
+					poly->updateTextureCoords(fc.sx, fc.sy, fc.ox, fc.oy, fc.rot);
+					poly->setZ(flat.plane);
+
+					vector<::gl_vertex_t>& verts = vertices[a * 2 + f];
+					verts.reserve(poly->totalVertices());
+					for (unsigned p = 0; p < poly->nSubPolys(); p++)
+					{
+						gl_polygon_t* sub = poly->getSubPoly(p);
+						verts.insert(verts.end(), sub->vertices, sub->vertices + sub->n_vertices);
+					}
+				}
+				poly->setZ(0);
+			}
+		}, 16);
+
+		// Upload to VBOs
+		for (unsigned f = 0; f < 2; f++)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, f == 0 ? vbo_floors : vbo_ceilings);
+			for (unsigned a = 0; a < update.size(); a++)
+			{
+				Polygon2D* poly = map->getSector(update[a])->getPolygon();
+				const ::gl_vertex_t* verts = vertices[a * 2 + f].data();
+				for (unsigned p = 0; p < poly->nSubPolys(); p++)
+				{
+					gl_polygon_t* sub = poly->getSubPoly(p);
+					glBufferSubData(GL_ARRAY_BUFFER, sub->vbo_offset, sub->n_vertices * 20, verts);
+					verts += sub->n_vertices;
+				}
+			}
+		}
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		sector->getPolygon()->setZ(0);
+
+		// Update lit colours
+		for (unsigned index : update)
+			updateFlatColours(index);
+	}
+
+	// Finish up
+	long time = App::runTimer();
+	for (unsigned index : update)
+	{
+		floors[index].updated_time = time;
+		ceilings[index].updated_time = time;
+		if (pick_flats.nObjects() == floors.size() * 2)
+		{
+			pick_flats.refit(index * 2, flatBox(index, false));
+			pick_flats.refit(index * 2 + 1, flatBox(index, true));
+		}
 	}
 }
 
@@ -982,6 +1196,7 @@ void MapRenderer3D::renderFlat(flat_3d_t* flat)
 
 		// Render
 		flat->sector->getPolygon()->renderVBO(false);
+		n_draw_calls += flat->sector->getPolygon()->nSubPolys();
 	}
 	else
 	{
@@ -1001,6 +1216,7 @@ void MapRenderer3D::renderFlat(flat_3d_t* flat)
 
 		// Render
 		flat->sector->getPolygon()->render();
+		n_draw_calls += flat->sector->getPolygon()->nSubPolys();
 
 		glPopMatrix();
 	}
@@ -1019,12 +1235,41 @@ void MapRenderer3D::renderFlats()
 	if (!map)
 		return;
 
+	RenderProfile::ScopedTimer timer(Phase::Flats);
+
 	// Init textures
 	glEnable(GL_TEXTURE_2D);
 
-	// Render all visible flats, ordered by texture
+	// Render batched from the flat VBOs if possible
 	unsigned a = 0;
 	flat_last = 0;
+	if (useBatches(true))
+	{
+		// Sort flats into batches, flats being faded out with distance
+		// are rendered separately
+		batch_items.clear();
+		unsigned n_faded = 0;
+		for (a = 0; a < n_flats; a++)
+		{
+			flat_3d_t* flat = flats[a];
+			if (!flat->sector)
+				continue;
+
+			if (flat->alpha < 1.0f)
+				flats[n_faded++] = flat;
+			else
+			{
+				uint8_t flags = flat->flags & CEIL;
+				if (render_3d_sky)
+					flags |= flat->flags & SKY;
+				batch_items.push_back({ flat->texture, batchState(flags, flat->light, flat->fogcolour), 0, flat });
+			}
+		}
+		n_flats = n_faded;
+		renderBatches(true);
+	}
+
+	// Render all visible flats, ordered by texture
 	while (n_flats > 0)
 	{
 		tex_last = nullptr;
@@ -1036,6 +1281,7 @@ void MapRenderer3D::renderFlats()
 			{
 				tex_last = flats[a]->texture;
 				flats[a]->texture->bind();
+				n_texture_binds++;
 			}
 			if (flats[a]->texture != tex_last)
 			{
@@ -1203,44 +1449,173 @@ void MapRenderer3D::setupQuadTexCoords(MapRenderer3D::quad_3d_t* quad, int lengt
  * Updates cached rendering data for line [index]
  *******************************************************************/
 void MapRenderer3D::updateLine(unsigned index)
+{
+	updateLines(vector<unsigned>(1, index));
+}
+
+/* MapRenderer3D::updateLines
+ * Updates cached rendering data for all lines in [indices]. Anything
+ * that has to be done on the main thread (line specials, texture
+ * loading and configuration lookups) is done for all lines first,
+ * then the quads for each line are built on worker threads
+ *******************************************************************/
+void MapRenderer3D::updateLines(const vector<unsigned>& indices)
+{
+	RenderProfile::ScopedTimer timer(Phase::Buffers);
+
+	// Process line specials (these can change sector planes, so they
+	// all need to be done before any quads are built)
+	vector<unsigned> update;
+	update.reserve(indices.size());
+	for (unsigned index : indices)
+	{
+		// Check index
+		if (index >= lines.size())
+			continue;
+
+		// Skip invalid line
+		MapLine* line = map->getLine(index);
+		lines[index].line = line;
+		if (!line->s1())
+		{
+			lines[index].quads.clear();
+			lines[index].updated_time = App::runTimer();
+			if (pick_walls.nObjects() == lines.size())
+				pick_walls.refit(index, AABBTree::box_t());
+			continue;
+		}
+
+		map->mapSpecials()->processLineSpecial(line);
+		update.push_back(index);
+	}
+
+	// Get line info
+	vector<line_info_t> info(update.size());
+	for (unsigned a = 0; a < update.size(); a++)
+		getLineInfo(update[a], info[a]);
+
+	// Build quads
+	ThreadPool::parallelFor(update.size(), [&](size_t begin, size_t end)
+	{
+		for (size_t a = begin; a < end; a++)
+			buildLineQuads(update[a], info[a]);
+	}, 64);
+
+	// Finish up
+	long time = App::runTimer();
+	bool update_vbo = useBatches(false) && !walls_vbo_rebuild;
+	for (unsigned index : update)
+	{
+		lines[index].updated_time = time;
+		if (pick_walls.nObjects() == lines.size())
+			pick_walls.refit(index, wallBox(index));
+		if (update_vbo)
+			updateLineVBO(index);
+	}
+}
+
+/* MapRenderer3D::getLineInfo
+ * Gets everything needed to build the quads for line [index] that
+ * can't be looked up from a worker thread into [info]. Textures are
+ * only looked up for the parts of the line that will be drawn
+ *******************************************************************/
+void MapRenderer3D::getLineInfo(unsigned index, line_info_t& info)
 {
 	using Game::Feature;
 	using Game::UDMFFeature;
 
-	// Check index
-	if (index > lines.size())
-		return;
+	MapLine* line = map->getLine(index);
+	int map_format = MapEditor::editContext().mapDesc().format;
+	bool mixed = Game::configuration().featureSupported(Feature::MixTexFlats);
 
-	// Clear current line data
-	lines[index].quads.clear();
+	// Flags
+	info.upeg = Game::configuration().lineBasicFlagSet("dontpegtop", line, map_format);
+	info.lpeg = Game::configuration().lineBasicFlagSet("dontpegbottom", line, map_format);
+	info.show_midtex = (map->currentFormat() != MAP_DOOM64) || (line->intProp(atom_flags) & 512);
+	info.wrap_midtex = (map->currentFormat() == MAP_DOOM64) || (map->currentFormat() == MAP_UDMF &&
+		Game::configuration().featureSupported(UDMFFeature::SideMidtexWrapping) &&
+		line->boolProp(atom_wrapmidtex));
+	info.tex_offsets = Game::configuration().featureSupported(UDMFFeature::TextureOffsets);
+	info.tex_scaling = Game::configuration().featureSupported(UDMFFeature::TextureScaling);
+
+	// Side colours/lighting
+	for (unsigned a = 0; a < 6; a++)
+		info.textures[a] = nullptr;
+	MapSide* sides[2] = { line->s1(), line->s2() };
+	for (unsigned a = 0; a < 2; a++)
+	{
+		if (!sides[a])
+			continue;
 
-	// Skip invalid line
-	MapLine* line = map->getLine(index);
-	if (!line->s1())
+		info.colour[a] = sides[a]->getSector()->getColour(0, true);
+		info.fogcolour[a] = sides[a]->getSector()->getFogColour();
+		info.light[a] = sides[a]->getLight();
+	}
+
+	// One-sided line textures
+	if (!line->s2())
+	{
+		info.textures[1] = MapEditor::textureManager().getTexture(line->s1()->getTexMiddle(), mixed);
 		return;
+	}
 
-	// Process line special
-	map->mapSpecials()->processLineSpecial(line);
+	// Two-sided line textures
+	plane_t fp1 = line->frontSector()->getFloorPlane();
+	plane_t cp1 = line->frontSector()->getCeilingPlane();
+	plane_t fp2 = line->backSector()->getFloorPlane();
+	plane_t cp2 = line->backSector()->getCeilingPlane();
+	double f1h1 = fp1.height_at(line->x1(), line->y1());
+	double f1h2 = fp1.height_at(line->x2(), line->y2());
+	double f2h1 = fp2.height_at(line->x1(), line->y1());
+	double f2h2 = fp2.height_at(line->x2(), line->y2());
+	double c1h1 = cp1.height_at(line->x1(), line->y1());
+	double c1h2 = cp1.height_at(line->x2(), line->y2());
+	double c2h1 = cp2.height_at(line->x1(), line->y1());
+	double c2h2 = cp2.height_at(line->x2(), line->y2());
+	string hidden_tex = map->currentFormat() == MAP_DOOM64 ? "?" : "-";
+	string midtex1 = line->s1()->getTexMiddle();
+	string midtex2 = line->s2()->getTexMiddle();
+	if (f2h1 > f1h1 || f2h2 > f1h2)
+		info.textures[0] = MapEditor::textureManager().getTexture(line->s1()->getTexLower(), mixed);
+	if (!midtex1.IsEmpty() && midtex1 != hidden_tex && info.show_midtex)
+		info.textures[1] = MapEditor::textureManager().getTexture(midtex1, mixed);
+	if (c1h1 > c2h1 || c1h2 > c2h2)
+		info.textures[2] = MapEditor::textureManager().getTexture(line->s1()->getTexUpper(), mixed);
+	if (f1h1 > f2h1 || f1h2 > f2h2)
+		info.textures[3] = MapEditor::textureManager().getTexture(line->s2()->getTexLower(), mixed);
+	if (!midtex2.IsEmpty() && midtex2 != hidden_tex && info.show_midtex)
+		info.textures[4] = MapEditor::textureManager().getTexture(midtex2, mixed);
+	if (c2h1 > c1h1 || c2h2 > c1h2)
+		info.textures[5] = MapEditor::textureManager().getTexture(line->s2()->getTexUpper(), mixed);
+}
+
+/* MapRenderer3D::buildLineQuads
+ * Builds the quads for line [index], using [info] gathered by
+ * getLineInfo. Only reads from the map, so can be called from a
+ * worker thread (for different lines at once)
+ *******************************************************************/
+void MapRenderer3D::buildLineQuads(unsigned index, const line_info_t& info)
+{
+	// Clear current line data
+	lines[index].quads.clear();
 
 	// Get relevant line info
-	int map_format = MapEditor::editContext().mapDesc().format;
-	bool upeg = Game::configuration().lineBasicFlagSet("dontpegtop", line, map_format);
-	bool lpeg = Game::configuration().lineBasicFlagSet("dontpegbottom", line, map_format);
+	MapLine* line = map->getLine(index);
+	bool upeg = info.upeg;
+	bool lpeg = info.lpeg;
 	double xoff, yoff, sx, sy, lsx, lsy;
-	bool mixed = Game::configuration().featureSupported(Feature::MixTexFlats);
-	lines[index].line = line;
 	double alpha = 1.0;
-	if (line->hasProp("alpha"))
-		alpha = line->floatProperty("alpha");
+	if (line->hasProp(atom_alpha))
+		alpha = line->floatProp(atom_alpha);
 
 	// Get first side info
 	int floor1 = line->frontSector()->getFloorHeight();
 	int ceiling1 = line->frontSector()->getCeilingHeight();
 	plane_t fp1 = line->frontSector()->getFloorPlane();
 	plane_t cp1 = line->frontSector()->getCeilingPlane();
-	rgba_t colour1 = line->frontSector()->getColour(0, true);
-	rgba_t fogcolour1 = line->frontSector()->getFogColour();
-	int light1 = line->s1()->getLight();
+	rgba_t colour1 = info.colour[0];
+	rgba_t fogcolour1 = info.fogcolour[0];
+	int light1 = info.light[0];
 	int xoff1 = line->s1()->getOffsetX();
 	int yoff1 = line->s1()->getOffsetY();
 
@@ -1276,24 +1651,24 @@ void MapRenderer3D::updateLine(unsigned index)
 		// Determine offsets
 		xoff = xoff1;
 		yoff = yoff1;
-		if (map->currentFormat() == MAP_UDMF && Game::configuration().featureSupported(UDMFFeature::TextureOffsets))
+		if (map->currentFormat() == MAP_UDMF && info.tex_offsets)
 		{
-			if (line->s1()->hasProp("offsetx_mid"))
-				xoff += line->s1()->floatProperty("offsetx_mid");
-			if (line->s1()->hasProp("offsety_mid"))
-				yoff += line->s1()->floatProperty("offsety_mid");
+			if (line->s1()->hasProp(atom_offsetx_mid))
+				xoff += line->s1()->floatProp(atom_offsetx_mid);
+			if (line->s1()->hasProp(atom_offsety_mid))
+				yoff += line->s1()->floatProp(atom_offsety_mid);
 		}
 
 		// Texture scale
-		quad.texture = MapEditor::textureManager().getTexture(line->s1()->getTexMiddle(), mixed);
+		quad.texture = info.textures[1];
 		sx = quad.texture->getScaleX();
 		sy = quad.texture->getScaleY();
-		if (Game::configuration().featureSupported(UDMFFeature::TextureScaling))
+		if (info.tex_scaling)
 		{
-			if (line->s1()->hasProp("scalex_mid"))
-				lsx = 1.0 / line->s1()->floatProperty("scalex_mid");
-			if (line->s1()->hasProp("scaley_mid"))
-				lsy = 1.0 / line->s1()->floatProperty("scaley_mid");
+			if (line->s1()->hasProp(atom_scalex_mid))
+				lsx = 1.0 / line->s1()->floatProp(atom_scalex_mid);
+			if (line->s1()->hasProp(atom_scaley_mid))
+				lsy = 1.0 / line->s1()->floatProp(atom_scaley_mid);
 		}
 		if (!quad.texture->worldPanning()) {
 			xoff *= sx;
@@ -1313,7 +1688,6 @@ void MapRenderer3D::updateLine(unsigned index)
 
 		// Add middle quad and finish
 		lines[index].quads.push_back(quad);
-		lines[index].updated_time = App::runTimer();
 		return;
 	}
 
@@ -1324,16 +1698,16 @@ void MapRenderer3D::updateLine(unsigned index)
 	int ceiling2 = line->backSector()->getCeilingHeight();
 	plane_t fp2 = line->backSector()->getFloorPlane();
 	plane_t cp2 = line->backSector()->getCeilingPlane();
-	rgba_t colour2 = line->backSector()->getColour(0, true);
-	rgba_t fogcolour2 = line->backSector()->getFogColour();
-	int light2 = line->s2()->getLight();
+	rgba_t colour2 = info.colour[1];
+	rgba_t fogcolour2 = info.fogcolour[1];
+	int light2 = info.light[1];
 	int xoff2 = line->s2()->getOffsetX();
 	int yoff2 = line->s2()->getOffsetY();
 	int lowceil = min(ceiling1, ceiling2);
 	int highfloor = max(floor1, floor2);
 	string sky_flat = Game::configuration().skyFlat();
 	string hidden_tex = map->currentFormat() == MAP_DOOM64 ? "?" : "-";
-	bool show_midtex = (map->currentFormat() != MAP_DOOM64) || (line->intProperty("flags") & 512);
+	bool show_midtex = info.show_midtex;
 	// Heights at both endpoints, for both planes, on both sides
 	double f1h1 = fp1.height_at(line->x1(), line->y1());
 	double f1h2 = fp1.height_at(line->x2(), line->y2());
@@ -1375,25 +1749,25 @@ void MapRenderer3D::updateLine(unsigned index)
 		// Determine offsets
 		xoff = xoff1;
 		yoff = yoff1;
-		if (map->currentFormat() == MAP_UDMF && Game::configuration().featureSupported(UDMFFeature::TextureOffsets))
+		if (map->currentFormat() == MAP_UDMF && info.tex_offsets)
 		{
 			// UDMF extra offsets
-			if (line->s1()->hasProp("offsetx_bottom"))
-				xoff += line->s1()->floatProperty("offsetx_bottom");
-			if (line->s1()->hasProp("offsety_bottom"))
-				yoff += line->s1()->floatProperty("offsety_bottom");
+			if (line->s1()->hasProp(atom_offsetx_bottom))
+				xoff += line->s1()->floatProp(atom_offsetx_bottom);
+			if (line->s1()->hasProp(atom_offsety_bottom))
+				yoff += line->s1()->floatProp(atom_offsety_bottom);
 		}
 
 		// Texture scale
-		quad.texture = MapEditor::textureManager().getTexture(line->s1()->getTexLower(), mixed);
+		quad.texture = info.textures[0];
 		sx = quad.texture->getScaleX();
 		sy = quad.texture->getScaleY();
-		if (map->currentFormat() == MAP_UDMF && Game::configuration().featureSupported(UDMFFeature::TextureScaling))
+		if (map->currentFormat() == MAP_UDMF && info.tex_scaling)
 		{
-			if (line->s1()->hasProp("scalex_bottom"))
-				lsx = 1.0 / line->s1()->floatProperty("scalex_bottom");
-			if (line->s1()->hasProp("scaley_bottom"))
-				lsy = 1.0 / line->s1()->floatProperty("scaley_bottom");
+			if (line->s1()->hasProp(atom_scalex_bottom))
+				lsx = 1.0 / line->s1()->floatProp(atom_scalex_bottom);
+			if (line->s1()->hasProp(atom_scaley_bottom))
+				lsy = 1.0 / line->s1()->floatProp(atom_scaley_bottom);
 		}
 		if (!quad.texture->worldPanning()) {
 			xoff *= sx;
@@ -1430,29 +1804,29 @@ void MapRenderer3D::updateLine(unsigned index)
 		quad_3d_t quad;
 
 		// Get texture
-		quad.texture = MapEditor::textureManager().getTexture(midtex1, mixed);
+		quad.texture = info.textures[1];
 
 		// Determine offsets
 		xoff = xoff1;
 		yoff = yoff1;
 		double ytex = 0;
-		if (map->currentFormat() == MAP_UDMF && Game::configuration().featureSupported(UDMFFeature::TextureOffsets))
+		if (map->currentFormat() == MAP_UDMF && info.tex_offsets)
 		{
-			if (line->s1()->hasProp("offsetx_mid"))
-				xoff += line->s1()->floatProperty("offsetx_mid");
-			if (line->s1()->hasProp("offsety_mid"))
-				yoff += line->s1()->floatProperty("offsety_mid");
+			if (line->s1()->hasProp(atom_offsetx_mid))
+				xoff += line->s1()->floatProp(atom_offsetx_mid);
+			if (line->s1()->hasProp(atom_offsety_mid))
+				yoff += line->s1()->floatProp(atom_offsety_mid);
 		}
 
 		// Texture scale
 		sx = quad.texture->getScaleX();
 		sy = quad.texture->getScaleY();
-		if (map->currentFormat() == MAP_UDMF && Game::configuration().featureSupported(UDMFFeature::TextureScaling))
+		if (map->currentFormat() == MAP_UDMF && info.tex_scaling)
 		{
-			if (line->s1()->hasProp("scalex_mid"))
-				lsx = 1.0 / line->s1()->floatProperty("scalex_mid");
-			if (line->s1()->hasProp("scaley_mid"))
-				lsy = 1.0 / line->s1()->floatProperty("scaley_mid");
+			if (line->s1()->hasProp(atom_scalex_mid))
+				lsx = 1.0 / line->s1()->floatProp(atom_scalex_mid);
+			if (line->s1()->hasProp(atom_scaley_mid))
+				lsy = 1.0 / line->s1()->floatProp(atom_scaley_mid);
 		}
 		if (!quad.texture->worldPanning()) {
 			xoff *= sx;
@@ -1465,9 +1839,7 @@ void MapRenderer3D::updateLine(unsigned index)
 
 		// Setup quad coordinates
 		double top, bottom;
-		if ((map->currentFormat() == MAP_DOOM64) || ((map->currentFormat() == MAP_UDMF &&
-			Game::configuration().featureSupported(UDMFFeature::SideMidtexWrapping) &&
-			line->boolProperty("wrapmidtex"))))
+		if (info.wrap_midtex)
 		{
 			top = lowceil;
 			bottom = highfloor;
@@ -1503,7 +1875,7 @@ void MapRenderer3D::updateLine(unsigned index)
 		quad.light = light1;
 		setupQuadTexCoords(&quad, length, xoff, ytex, top, bottom, false, sx, sy);
 		quad.flags |= MIDTEX;
-		if (line->hasProp("renderstyle") && !wxStrcmp(line->stringProperty("renderstyle"), "add"))
+		if (line->hasProp(atom_renderstyle) && !wxStrcmp(line->stringProp(atom_renderstyle), "add"))
 			quad.flags |= TRANSADD;
 
 		// Add quad
@@ -1520,25 +1892,25 @@ void MapRenderer3D::updateLine(unsigned index)
 		// Determine offsets
 		xoff = xoff1;
 		yoff = yoff1;
-		if (map->currentFormat() == MAP_UDMF && Game::configuration().featureSupported(UDMFFeature::TextureOffsets))
+		if (map->currentFormat() == MAP_UDMF && info.tex_offsets)
 		{
 			// UDMF extra offsets
-			if (line->s1()->hasProp("offsetx_top"))
-				xoff += line->s1()->floatProperty("offsetx_top");
-			if (line->s1()->hasProp("offsety_top"))
-				yoff += line->s1()->floatProperty("offsety_top");
+			if (line->s1()->hasProp(atom_offsetx_top))
+				xoff += line->s1()->floatProp(atom_offsetx_top);
+			if (line->s1()->hasProp(atom_offsety_top))
+				yoff += line->s1()->floatProp(atom_offsety_top);
 		}
 
 		// Texture scale
-		quad.texture = MapEditor::textureManager().getTexture(line->s1()->getTexUpper(), mixed);
+		quad.texture = info.textures[2];
 		sx = quad.texture->getScaleX();
 		sy = quad.texture->getScaleY();
-		if (map->currentFormat() == MAP_UDMF && Game::configuration().featureSupported(UDMFFeature::TextureScaling))
+		if (map->currentFormat() == MAP_UDMF && info.tex_scaling)
 		{
-			if (line->s1()->hasProp("scalex_top"))
-				lsx = 1.0 / line->s1()->floatProperty("scalex_top");
-			if (line->s1()->hasProp("scaley_top"))
-				lsy = 1.0 / line->s1()->floatProperty("scaley_top");
+			if (line->s1()->hasProp(atom_scalex_top))
+				lsx = 1.0 / line->s1()->floatProp(atom_scalex_top);
+			if (line->s1()->hasProp(atom_scaley_top))
+				lsy = 1.0 / line->s1()->floatProp(atom_scaley_top);
 		}
 		if (!quad.texture->worldPanning()) {
 			xoff *= sx;
@@ -1573,25 +1945,25 @@ void MapRenderer3D::updateLine(unsigned index)
 		// Determine offsets
 		xoff = xoff2;
 		yoff = yoff2;
-		if (map->currentFormat() == MAP_UDMF && Game::configuration().featureSupported(UDMFFeature::TextureOffsets))
+		if (map->currentFormat() == MAP_UDMF && info.tex_offsets)
 		{
 			// UDMF extra offsets
-			if (line->s2()->hasProp("offsetx_bottom"))
-				xoff += line->s2()->floatProperty("offsetx_bottom");
-			if (line->s2()->hasProp("offsety_bottom"))
-				yoff += line->s2()->floatProperty("offsety_bottom");
+			if (line->s2()->hasProp(atom_offsetx_bottom))
+				xoff += line->s2()->floatProp(atom_offsetx_bottom);
+			if (line->s2()->hasProp(atom_offsety_bottom))
+				yoff += line->s2()->floatProp(atom_offsety_bottom);
 		}
 
 		// Texture scale
-		quad.texture = MapEditor::textureManager().getTexture(line->s2()->getTexLower(), mixed);
+		quad.texture = info.textures[3];
 		sx = quad.texture->getScaleX();
 		sy = quad.texture->getScaleY();
-		if (map->currentFormat() == MAP_UDMF && Game::configuration().featureSupported(UDMFFeature::TextureScaling))
+		if (map->currentFormat() == MAP_UDMF && info.tex_scaling)
 		{
-			if (line->s2()->hasProp("scalex_bottom"))
-				lsx = 1.0 / line->s2()->floatProperty("scalex_bottom");
-			if (line->s2()->hasProp("scaley_bottom"))
-				lsy = 1.0 / line->s2()->floatProperty("scaley_bottom");
+			if (line->s2()->hasProp(atom_scalex_bottom))
+				lsx = 1.0 / line->s2()->floatProp(atom_scalex_bottom);
+			if (line->s2()->hasProp(atom_scaley_bottom))
+				lsy = 1.0 / line->s2()->floatProp(atom_scaley_bottom);
 		}
 		if (!quad.texture->worldPanning()) {
 			xoff *= sx;
@@ -1628,29 +2000,29 @@ void MapRenderer3D::updateLine(unsigned index)
 		quad_3d_t quad;
 
 		// Get texture
-		quad.texture = MapEditor::textureManager().getTexture(midtex2, mixed);
+		quad.texture = info.textures[4];
 
 		// Determine offsets
 		xoff = xoff2;
 		yoff = yoff2;
 		double ytex = 0;
-		if (map->currentFormat() == MAP_UDMF && Game::configuration().featureSupported(UDMFFeature::TextureOffsets))
+		if (map->currentFormat() == MAP_UDMF && info.tex_offsets)
 		{
-			if (line->s2()->hasProp("offsetx_mid"))
-				xoff += line->s2()->floatProperty("offsetx_mid");
-			if (line->s2()->hasProp("offsety_mid"))
-				yoff += line->s2()->floatProperty("offsety_mid");
+			if (line->s2()->hasProp(atom_offsetx_mid))
+				xoff += line->s2()->floatProp(atom_offsetx_mid);
+			if (line->s2()->hasProp(atom_offsety_mid))
+				yoff += line->s2()->floatProp(atom_offsety_mid);
 		}
 
 		// Texture scale
 		sx = quad.texture->getScaleX();
 		sy = quad.texture->getScaleY();
-		if (map->currentFormat() == MAP_UDMF && Game::configuration().featureSupported(UDMFFeature::TextureScaling))
+		if (map->currentFormat() == MAP_UDMF && info.tex_scaling)
 		{
-			if (line->s2()->hasProp("scalex_mid"))
-				lsx = 1.0 / line->s2()->floatProperty("scalex_mid");
-			if (line->s2()->hasProp("scaley_mid"))
-				lsy = 1.0 / line->s2()->floatProperty("scaley_mid");
+			if (line->s2()->hasProp(atom_scalex_mid))
+				lsx = 1.0 / line->s2()->floatProp(atom_scalex_mid);
+			if (line->s2()->hasProp(atom_scaley_mid))
+				lsy = 1.0 / line->s2()->floatProp(atom_scaley_mid);
 		}
 		if (!quad.texture->worldPanning()) {
 			xoff *= sx;
@@ -1663,8 +2035,7 @@ void MapRenderer3D::updateLine(unsigned index)
 
 		// Setup quad coordinates
 		double top, bottom;
-		if ((map->currentFormat() == MAP_DOOM64) || (map->currentFormat() == MAP_UDMF &&
-			Game::configuration().featureSupported(UDMFFeature::SideMidtexWrapping) && line->boolProperty("wrapmidtex")))
+		if (info.wrap_midtex)
 		{
 			top = lowceil;
 			bottom = highfloor;
@@ -1701,7 +2072,7 @@ void MapRenderer3D::updateLine(unsigned index)
 		setupQuadTexCoords(&quad, length, xoff, ytex, top, bottom, false, sx, sy);
 		quad.flags |= BACK;
 		quad.flags |= MIDTEX;
-		if (line->hasProp("renderstyle") && !wxStrcmp(line->stringProperty("renderstyle"), "add"))
+		if (line->hasProp(atom_renderstyle) && !wxStrcmp(line->stringProp(atom_renderstyle), "add"))
 			quad.flags |= TRANSADD;
 
 		// Add quad
@@ -1718,25 +2089,25 @@ void MapRenderer3D::updateLine(unsigned index)
 		// Determine offsets
 		xoff = xoff2;
 		yoff = yoff2;
-		if (map->currentFormat() == MAP_UDMF && Game::configuration().featureSupported(UDMFFeature::TextureOffsets))
+		if (map->currentFormat() == MAP_UDMF && info.tex_offsets)
 		{
 			// UDMF extra offsets
-			if (line->s2()->hasProp("offsetx_top"))
-				xoff += line->s2()->floatProperty("offsetx_top");
-			if (line->s2()->hasProp("offsety_top"))
-				yoff += line->s2()->floatProperty("offsety_top");
+			if (line->s2()->hasProp(atom_offsetx_top))
+				xoff += line->s2()->floatProp(atom_offsetx_top);
+			if (line->s2()->hasProp(atom_offsety_top))
+				yoff += line->s2()->floatProp(atom_offsety_top);
 		}
 
 		// Texture scale
-		quad.texture = MapEditor::textureManager().getTexture(line->s2()->getTexUpper(), mixed);
+		quad.texture = info.textures[5];
 		sx = quad.texture->getScaleX();
 		sy = quad.texture->getScaleY();
-		if (map->currentFormat() == MAP_UDMF && Game::configuration().featureSupported(UDMFFeature::TextureScaling))
+		if (map->currentFormat() == MAP_UDMF && info.tex_scaling)
 		{
-			if (line->s2()->hasProp("scalex_top"))
-				lsx = 1.0 / line->s2()->floatProperty("scalex_top");
-			if (line->s2()->hasProp("scaley_top"))
-				lsy = 1.0 / line->s2()->floatProperty("scaley_top");
+			if (line->s2()->hasProp(atom_scalex_top))
+				lsx = 1.0 / line->s2()->floatProp(atom_scalex_top);
+			if (line->s2()->hasProp(atom_scaley_top))
+				lsy = 1.0 / line->s2()->floatProp(atom_scaley_top);
 		}
 		if (!quad.texture->worldPanning()) {
 			xoff *= sx;
@@ -1760,9 +2131,6 @@ void MapRenderer3D::updateLine(unsigned index)
 		// Add quad
 		lines[index].quads.push_back(quad);
 	}
-
-	// Finished
-	lines[index].updated_time = App::runTimer();
 }
 
 /* MapRenderer3D::renderQuad
@@ -1795,6 +2163,7 @@ void MapRenderer3D::renderQuad(MapRenderer3D::quad_3d_t* quad, float alpha)
 	setFog(quad->fogcolour, quad->light);
 
 	// Draw quad
+	n_draw_calls++;
 	glBegin(GL_QUADS);
 	glTexCoord2f(quad->points[0].tx, quad->points[0].ty);	glVertex3f(quad->points[0].x, quad->points[0].y, quad->points[0].z);
 	glTexCoord2f(quad->points[1].tx, quad->points[1].ty);	glVertex3f(quad->points[1].x, quad->points[1].y, quad->points[1].z);
@@ -1817,11 +2186,59 @@ void MapRenderer3D::renderQuad(MapRenderer3D::quad_3d_t* quad, float alpha)
  *******************************************************************/
 void MapRenderer3D::renderWalls()
 {
+	RenderProfile::ScopedTimer timer(Phase::Lines);
+
 	// Init
 	quads_transparent.clear();
 	glEnable(GL_TEXTURE_2D);
 	glCullFace(GL_BACK);
 
+	// Render batched from the walls VBO if possible
+	if (useBatches(false))
+	{
+		if (walls_vbo_rebuild)
+			updateWallsVBO();
+
+		// Sort quads into batches. Transparent quads are rendered later,
+		// and quads being faded out with distance are rendered separately
+		// (their alpha changes every frame)
+		vector<quad_3d_t*> faded;
+		batch_items.clear();
+		for (unsigned a = 0; a < n_quads; a++)
+		{
+			quad_3d_t* quad = quads[a];
+			if (quad->colour.a < 255)
+				quads_transparent.push_back(quad);
+			else if (quad->alpha < 1.0f)
+				faded.push_back(quad);
+			else
+			{
+				uint8_t flags = quad->flags & (MIDTEX | TRANSADD);
+				if (render_3d_sky)
+					flags |= quad->flags & SKY;
+				batch_items.push_back({ quad->texture, batchState(flags, quad->light, quad->fogcolour), quad->vbo_index, nullptr });
+			}
+		}
+		n_quads = 0;
+		renderBatches(false);
+
+		// Render faded quads
+		tex_last = nullptr;
+		for (auto quad : faded)
+		{
+			if (quad->texture && quad->texture != tex_last)
+			{
+				tex_last = quad->texture;
+				tex_last->bind();
+				n_texture_binds++;
+			}
+			renderQuad(quad, quad->alpha);
+		}
+
+		glDisable(GL_TEXTURE_2D);
+		return;
+	}
+
 	// Render all visible quads, ordered by texture
 	unsigned a = 0;
 	while (n_quads > 0)
@@ -1844,6 +2261,7 @@ void MapRenderer3D::renderWalls()
 			{
 				tex_last = quads[a]->texture;
 				quads[a]->texture->bind();
+				n_texture_binds++;
 			}
 			if (quads[a]->texture != tex_last)
 			{
@@ -1866,6 +2284,8 @@ void MapRenderer3D::renderWalls()
  *******************************************************************/
 void MapRenderer3D::renderTransparentWalls()
 {
+	RenderProfile::ScopedTimer timer(Phase::Lines);
+
 	// Init
 	glEnable(GL_TEXTURE_2D);
 	glDepthMask(GL_FALSE);
@@ -1881,6 +2301,7 @@ void MapRenderer3D::renderTransparentWalls()
 		{
 			tex_last = quads_transparent[a]->texture;
 			quads_transparent[a]->texture->bind();
+			n_texture_binds++;
 		}
 
 		// Render quad
@@ -2030,7 +2451,7 @@ void MapRenderer3D::updateThing(unsigned index, MapThing* thing)
 	{
 		// Get sector floor (or ceiling) height
 		int sheight;
-		float zheight = thing->floatProperty("height");
+		float zheight = thing->floatProp(atom_height);
 		if (things[index].type->hanging())
 		{
 			sheight = things[index].sector->getCeilingPlane().height_at(thing->xPos(), thing->yPos());
@@ -2055,6 +2476,8 @@ void MapRenderer3D::updateThing(unsigned index, MapThing* thing)
 	things[index].z += MapEditor::textureManager().getVerticalOffset(things[index].type->sprite());
 
 	things[index].updated_time = App::runTimer();
+	if (pick_things.nObjects() == things.size())
+		pick_things.refit(index, thingBox(index));
 }
 
 /* MapRenderer3D::renderThings
@@ -2062,6 +2485,8 @@ void MapRenderer3D::updateThing(unsigned index, MapThing* thing)
  *******************************************************************/
 void MapRenderer3D::renderThings()
 {
+	RenderProfile::ScopedTimer timer(Phase::Things);
+
 	// Init
 	glEnable(GL_TEXTURE_2D);
 	glCullFace(GL_BACK);
@@ -2076,8 +2501,12 @@ void MapRenderer3D::renderThings()
 	float x1, y1, x2, y2;
 	unsigned update = 0;
 	fseg2_t strafe(cam_position.get2d(), (cam_position + cam_strafe).get2d());
-	for (unsigned a = 0; a < map->nThings(); a++)
+	const vector<unsigned>& vis_things = vis_portals.visibleThings();
+	unsigned n_things = vis_portals_active ? vis_things.size() : map->nThings();
+	RenderProfile::addObjects(n_things);
+	for (unsigned i = 0; i < n_things; i++)
 	{
+		unsigned a = vis_portals_active ? vis_things[i] : i;
 		MapThing* thing = map->getThing(a);
 		things[a].flags = things[a].flags & ~DRAWN;
 
@@ -2117,6 +2546,7 @@ void MapRenderer3D::renderThings()
 		{
 			tex->bind();
 			tex_last = tex;
+			n_texture_binds++;
 		}
 
 		// Determine coordinates
@@ -2166,6 +2596,7 @@ void MapRenderer3D::renderThings()
 		setFog(fogcol, light);
 
 		// Draw thing
+		n_draw_calls++;
 		glBegin(GL_QUADS);
 		glTexCoord2f(0.0f, 0.0f);	glVertex3f(x1, y1, things[a].z + theight);
 		glTexCoord2f(0.0f, 1.0f);	glVertex3f(x1, y1, things[a].z);
@@ -2185,12 +2616,17 @@ void MapRenderer3D::renderThings()
 		glDisable(GL_CULL_FACE);
 		glLineWidth(3.5f);
 
-		for (unsigned a = 0; a < map->nThings(); a++)
+		for (unsigned i = 0; i < n_things; i++)
 		{
 			// Skip if hidden
+			unsigned a = vis_portals_active ? vis_things[i] : i;
 			if (!(things[a].flags & DRAWN))
 				continue;
 
+			// Fill, outline and direction (plus top outline and corners
+			// for style 2)
+			n_draw_calls += render_3d_things_style == 2 ? 5 : 3;
+
 			MapThing* thing = map->getThing(a);
 			col.set(things[a].type->colour());
 			float radius = things[a].type->radius();
@@ -2385,12 +2821,19 @@ void MapRenderer3D::updateFlatsVBO()
 	if (!flats_use_vbo)
 		return;
 
+	RenderProfile::ScopedTimer timer(Phase::Buffers);
+
 	// Create VBOs if needed
 	if (vbo_floors == 0)
 	{
 		glGenBuffers(1, &vbo_floors);
 		glGenBuffers(1, &vbo_ceilings);
 	}
+	if (vbo_floor_colours == 0)
+	{
+		glGenBuffers(1, &vbo_floor_colours);
+		glGenBuffers(1, &vbo_ceiling_colours);
+	}
 
 	// Get total size needed
 	unsigned totalsize = 0;
@@ -2448,16 +2891,350 @@ void MapRenderer3D::updateFlatsVBO()
 		poly->setZ(0.0f);
 	}
 
+	// --- Colours ---
+
+	// Allocate buffer data
+	unsigned n_vertices = totalsize / 20;
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_floor_colours);
+	glBufferData(GL_ARRAY_BUFFER, n_vertices * 4, nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_ceiling_colours);
+	glBufferData(GL_ARRAY_BUFFER, n_vertices * 4, nullptr, GL_STATIC_DRAW);
+
+	// Write colours for sectors that have been updated already (others
+	// are written when they are first updated)
+	for (unsigned a = 0; a < floors.size() && a < map->nSectors(); a++)
+	{
+		if (floors[a].updated_time > 0)
+			updateFlatColours(a);
+	}
+
 	// Clean up
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
+/* MapRenderer3D::updateFlatColours
+ * Writes the lit floor and ceiling colours of sector [index] to the
+ * flat colour VBOs
+ *******************************************************************/
+void MapRenderer3D::updateFlatColours(unsigned index)
+{
+	if (vbo_floor_colours == 0 || index >= floors.size() || index >= map->nSectors())
+		return;
+
+	Polygon2D* poly = map->getSector(index)->getPolygon();
+	vector<uint8_t> colours(poly->totalVertices() * 4);
+	for (unsigned f = 0; f < 2; f++)
+	{
+		// Get colour
+		flat_3d_t& flat = f == 0 ? floors[index] : ceilings[index];
+		uint8_t col[4];
+		writeLitColour(col, flat.colour, lightMult(flat.light));
+		for (unsigned a = 0; a < colours.size(); a += 4)
+			memcpy(&colours[a], col, 4);
+
+		// Write to VBO
+		glBindBuffer(GL_ARRAY_BUFFER, f == 0 ? vbo_floor_colours : vbo_ceiling_colours);
+		unsigned offset = 0;
+		for (unsigned p = 0; p < poly->nSubPolys(); p++)
+		{
+			gl_polygon_t* sub = poly->getSubPoly(p);
+			glBufferSubData(GL_ARRAY_BUFFER, sub->vbo_index * 4, sub->n_vertices * 4, &colours[offset]);
+			offset += sub->n_vertices * 4;
+		}
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 /* MapRenderer3D::updateWallsVBO
- * (Re)builds the walls Vertex Buffer Object (or would, if it were
- * used for wall rendering)
+ * (Re)builds the walls Vertex Buffer Objects. Each line is given
+ * space for its current quads (plus one spare for two-sided lines),
+ * if a line later needs more the whole buffer is rebuilt
  *******************************************************************/
 void MapRenderer3D::updateWallsVBO()
 {
+	RenderProfile::ScopedTimer timer(Phase::Buffers);
+
+	// Create VBOs if needed
+	if (vbo_walls == 0)
+	{
+		glGenBuffers(1, &vbo_walls);
+		glGenBuffers(1, &vbo_wall_colours);
+	}
+
+	// Build any lines that haven't been yet, so they get enough space
+	walls_vbo_rebuild = true;
+	vector<unsigned> update;
+	for (unsigned a = 0; a < lines.size(); a++)
+	{
+		if (lines[a].updated_time == 0)
+			update.push_back(a);
+	}
+	if (!update.empty())
+		updateLines(update);
+
+	// Allocate space for each line
+	unsigned total = 0;
+	for (unsigned a = 0; a < lines.size(); a++)
+	{
+		lines[a].vbo_index = total;
+		lines[a].vbo_quads = lines[a].quads.size();
+		if (map->getLine(a)->s2())
+			lines[a].vbo_quads++;
+		total += lines[a].vbo_quads * 4;
+	}
+
+	// Write all quads
+	vector<gl_vertex_t> vertices(total);
+	vector<uint8_t> colours(total * 4);
+	for (unsigned a = 0; a < lines.size(); a++)
+	{
+		unsigned index = lines[a].vbo_index;
+		for (auto& quad : lines[a].quads)
+		{
+			quad.vbo_index = index;
+			memcpy(&vertices[index], quad.points, sizeof(quad.points));
+
+			uint8_t col[4];
+			writeLitColour(col, quad.colour, lightMult(quad.light));
+			for (unsigned v = 0; v < 4; v++)
+				memcpy(&colours[(index + v) * 4], col, 4);
+
+			index += 4;
+		}
+	}
+
+	// Upload
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_walls);
+	glBufferData(GL_ARRAY_BUFFER, total * sizeof(gl_vertex_t), vertices.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_wall_colours);
+	glBufferData(GL_ARRAY_BUFFER, total * 4, colours.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	walls_vbo_rebuild = false;
+}
+
+/* MapRenderer3D::updateLineVBO
+ * Writes the quads for line [index] to the walls VBOs, or flags the
+ * VBOs for a rebuild if there isn't enough space for them
+ *******************************************************************/
+void MapRenderer3D::updateLineVBO(unsigned index)
+{
+	if (vbo_walls == 0 || index >= lines.size())
+		return;
+
+	// Check there is enough space
+	line_3d_t& line = lines[index];
+	if (line.quads.size() > line.vbo_quads)
+	{
+		walls_vbo_rebuild = true;
+		return;
+	}
+	if (line.quads.empty())
+		return;
+
+	// Get quad vertices and colours
+	vector<gl_vertex_t> vertices(line.quads.size() * 4);
+	vector<uint8_t> colours(line.quads.size() * 16);
+	for (unsigned q = 0; q < line.quads.size(); q++)
+	{
+		quad_3d_t& quad = line.quads[q];
+		quad.vbo_index = line.vbo_index + q * 4;
+		memcpy(&vertices[q * 4], quad.points, sizeof(quad.points));
+
+		uint8_t col[4];
+		writeLitColour(col, quad.colour, lightMult(quad.light));
+		for (unsigned v = 0; v < 4; v++)
+			memcpy(&colours[(q * 4 + v) * 4], col, 4);
+	}
+
+	// Write to VBOs
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_walls);
+	glBufferSubData(GL_ARRAY_BUFFER, line.vbo_index * sizeof(gl_vertex_t), vertices.size() * sizeof(gl_vertex_t), vertices.data());
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_wall_colours);
+	glBufferSubData(GL_ARRAY_BUFFER, line.vbo_index * 4, colours.size(), colours.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/* MapRenderer3D::useBatches
+ * Returns true if walls (or flats if [flats] is true) can be rendered
+ * in batches from their VBOs. If not, the walls VBO is flagged for a
+ * rebuild, since changed lines aren't written to it in the meantime
+ *******************************************************************/
+bool MapRenderer3D::useBatches(bool flats)
+{
+	if (!render_3d_batch || !OpenGL::vboSupport())
+	{
+		walls_vbo_rebuild = true;
+		return false;
+	}
+
+	if (flats)
+		return flats_use_vbo && vbo_floors != 0 && vbo_floor_colours != 0;
+
+	return true;
+}
+
+/* MapRenderer3D::batchState
+ * Returns a value representing the render state needed for a wall
+ * or flat with [flags], [light] level and [fogcolour]. Walls/flats
+ * can only be rendered in the same batch if their states match
+ *******************************************************************/
+uint64_t MapRenderer3D::batchState(uint8_t flags, uint8_t light, const rgba_t& fogcolour)
+{
+	uint64_t state = flags;
+
+	// Light level and colour only affect the fog, the lit colour is
+	// in the colour VBO
+	if (fog)
+	{
+		state |= (uint64_t)light << 8;
+		state |= (uint64_t)fogcolour.r << 16;
+		state |= (uint64_t)fogcolour.g << 24;
+		state |= (uint64_t)fogcolour.b << 32;
+	}
+
+	return state;
+}
+
+/* MapRenderer3D::renderBatches
+ * Renders all walls (or flats if [flats] is true) in batch_items,
+ * sorted by texture then render state. Each run of items with the
+ * same texture and state is drawn with a single call
+ *******************************************************************/
+void MapRenderer3D::renderBatches(bool flats)
+{
+	if (batch_items.empty())
+		return;
+
+	// Sort by texture, then state
+	std::sort(batch_items.begin(), batch_items.end(), [](const batch_item_t& left, const batch_item_t& right)
+	{
+		if (left.texture != right.texture)
+			return left.texture < right.texture;
+		return left.state < right.state;
+	});
+
+	int buffer_last = -1;
+	tex_last = nullptr;
+	unsigned a = 0;
+	while (a < batch_items.size())
+	{
+		const batch_item_t& item = batch_items[a];
+
+		// Get indices for all items with the same texture and state
+		unsigned end = a;
+		batch_indices.clear();
+		while (end < batch_items.size() &&
+			batch_items[end].texture == item.texture &&
+			batch_items[end].state == item.state)
+		{
+			if (flats)
+			{
+				// Flat polygons are triangle fans or lists, convert to
+				// triangle lists
+				Polygon2D* poly = batch_items[end].flat->sector->getPolygon();
+				for (unsigned p = 0; p < poly->nSubPolys(); p++)
+				{
+					gl_polygon_t* sub = poly->getSubPoly(p);
+					if (poly->isTriangles())
+					{
+						for (unsigned v = 0; v < sub->n_vertices; v++)
+							batch_indices.push_back(sub->vbo_index + v);
+					}
+					else
+					{
+						for (unsigned v = 1; v + 1 < sub->n_vertices; v++)
+						{
+							batch_indices.push_back(sub->vbo_index);
+							batch_indices.push_back(sub->vbo_index + v);
+							batch_indices.push_back(sub->vbo_index + v + 1);
+						}
+					}
+				}
+			}
+			else
+			{
+				for (unsigned v = 0; v < 4; v++)
+					batch_indices.push_back(batch_items[end].index + v);
+			}
+
+			end++;
+		}
+
+		// Bind texture
+		if (item.texture && item.texture != tex_last)
+		{
+			tex_last = item.texture;
+			tex_last->bind();
+			n_texture_binds++;
+		}
+
+		// Setup VBOs (floors and ceilings are in separate VBOs)
+		uint8_t flags = item.state & 0xFF;
+		int buffer = flats ? ((flags & CEIL) ? 2 : 1) : 0;
+		if (buffer != buffer_last)
+		{
+			if (buffer == 0)
+				glBindBuffer(GL_ARRAY_BUFFER, vbo_walls);
+			else
+			{
+				glCullFace(buffer == 2 ? GL_BACK : GL_FRONT);
+				glBindBuffer(GL_ARRAY_BUFFER, buffer == 2 ? vbo_ceilings : vbo_floors);
+			}
+			Polygon2D::setupVBOPointers();
+
+			if (buffer == 0)
+				glBindBuffer(GL_ARRAY_BUFFER, vbo_wall_colours);
+			else
+				glBindBuffer(GL_ARRAY_BUFFER, buffer == 2 ? vbo_ceiling_colours : vbo_floor_colours);
+			glColorPointer(4, GL_UNSIGNED_BYTE, 0, nullptr);
+			buffer_last = buffer;
+		}
+
+		// Setup special rendering options
+		bool sky = (flags & SKY) > 0;
+		if (sky)
+		{
+			glDisable(GL_ALPHA_TEST);
+			glDisableClientState(GL_COLOR_ARRAY);
+			glColor4f(0.0f, 0.0f, 0.0f, 0.0f);
+		}
+		else
+		{
+			glEnableClientState(GL_COLOR_ARRAY);
+			if (!flats && flags & MIDTEX)
+				glAlphaFunc(GL_GREATER, 0.9f);
+		}
+		if (!flats && flags & TRANSADD)
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+		else
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		// Setup fog
+		if (fog)
+		{
+			rgba_t fogcol((item.state >> 16) & 0xFF, (item.state >> 24) & 0xFF, (item.state >> 32) & 0xFF);
+			setFog(fogcol, (item.state >> 8) & 0xFF);
+		}
+
+		// Render
+		glDrawElements(flats ? GL_TRIANGLES : GL_QUADS, batch_indices.size(), GL_UNSIGNED_INT, batch_indices.data());
+		n_draw_calls++;
+
+		// Reset settings
+		if (sky)
+			glEnable(GL_ALPHA_TEST);
+		else if (!flats && flags & MIDTEX)
+			glAlphaFunc(GL_GREATER, 0.0f);
+
+		a = end;
+	}
+
+	// Clean up
+	glDisableClientState(GL_COLOR_ARRAY);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	batch_items.clear();
 }
 
 /* MapRenderer3D::quickVisDiscard
@@ -2526,6 +3303,118 @@ void MapRenderer3D::quickVisDiscard()
 		else
 			lines[map->getSide(a)->getParentLine()->getIndex()].visible = true;
 	}
+
+	vis_portals_active = false;
+}
+
+/* MapRenderer3D::portalVisDiscard
+ * Determines the visible sectors, lines and things by flooding out
+ * from the camera's sector through two-sided lines, and hides
+ * everything else. Returns false if portal visibility is disabled
+ * or the camera isn't in a sector, in which case quickVisDiscard
+ * should be used instead
+ *******************************************************************/
+bool MapRenderer3D::portalVisDiscard()
+{
+	if (!render_3d_portal_vis)
+		return false;
+
+	// Update portal geometry if the map has changed
+	if (vis_geometry_updated != map->geometryUpdated() ||
+		vis_things_updated != map->thingsUpdated() ||
+		vis_portals.nLines() != map->nLines() ||
+		vis_portals.nSectors() != map->nSectors() ||
+		vis_portals.nThings() != map->nThings())
+		updatePortalGeometry();
+
+	// Find the camera sector (usually the same as last time)
+	fpoint2_t cam = cam_position.get2d();
+	vis_cam_sector = vis_portals.sectorAt(cam, vis_cam_sector);
+	if (vis_cam_sector < 0)
+		return false;
+
+	// Hide everything that was visible last time
+	if (!vis_portals_active || dist_sectors.size() != map->nSectors())
+	{
+		dist_sectors.assign(map->nSectors(), -1.0f);
+		for (unsigned a = 0; a < lines.size(); a++)
+			lines[a].visible = false;
+	}
+	else
+	{
+		for (unsigned a : vis_portals.visibleLines())
+			lines[a].visible = false;
+		for (unsigned a : vis_portals.visibleSectors())
+			dist_sectors[a] = -1.0f;
+	}
+
+	// Get the horizontal view angle either side of the camera direction
+	// (looking up or down, the view covers more of the map around the
+	// camera, up to all of it)
+	double pitch = fabs(cam_pitch);
+	double denom = cos(pitch) - sin(pitch) / view_aspect;
+	double half_fov = (denom > 0.01) ? atan(1.0 / denom) + 0.05 : PI;
+
+	// Flood from the camera sector
+	double angle = atan2(cam_direction.y, cam_direction.x);
+	if (!vis_portals.update(cam, vis_cam_sector, angle, half_fov, render_max_dist))
+	{
+		vis_portals_active = false;
+		return false;
+	}
+
+	// Show visible sectors (with their distance from the camera)
+	for (unsigned a : vis_portals.visibleSectors())
+	{
+		bbox_t bbox = map->getSector(a)->boundingBox();
+		double dist = 0;
+		if (render_max_dist > 0 && !bbox.contains(cam))
+		{
+			dist = MathStuff::distanceToLine(cam, bbox.left_side());
+			dist = MIN(dist, MathStuff::distanceToLine(cam, bbox.top_side()));
+			dist = MIN(dist, MathStuff::distanceToLine(cam, bbox.right_side()));
+			dist = MIN(dist, MathStuff::distanceToLine(cam, bbox.bottom_side()));
+		}
+		dist_sectors[a] = dist;
+	}
+
+	// Show visible lines
+	for (unsigned a : vis_portals.visibleLines())
+		lines[a].visible = true;
+
+	vis_portals_active = true;
+	return true;
+}
+
+/* MapRenderer3D::updatePortalGeometry
+ * Updates the lines and thing positions used for portal visibility
+ * from the map
+ *******************************************************************/
+void MapRenderer3D::updatePortalGeometry()
+{
+	// Lines
+	vector<PortalVisibility::line_t> vis_lines(map->nLines());
+	for (unsigned a = 0; a < map->nLines(); a++)
+	{
+		MapLine* line = map->getLine(a);
+		MapSector* front = line->frontSector();
+		MapSector* back = line->backSector();
+		vis_lines[a].v1 = line->point1();
+		vis_lines[a].v2 = line->point2();
+		vis_lines[a].front = front ? front->getIndex() : -1;
+		vis_lines[a].back = back ? back->getIndex() : -1;
+	}
+	vis_portals.setGeometry(vis_lines, map->nSectors());
+
+	// Things
+	vector<fpoint2_t> vis_things(map->nThings());
+	for (unsigned a = 0; a < map->nThings(); a++)
+		vis_things[a] = map->getThing(a)->point();
+	vis_portals.setThings(vis_things);
+
+	vis_geometry_updated = map->geometryUpdated();
+	vis_things_updated = map->thingsUpdated();
+	vis_portals_active = false;
 }
 
 /* MapRenderer3D::calcDistFade
@@ -2557,11 +3446,16 @@ void MapRenderer3D::checkVisibleQuads()
 	MapLine* line;
 	float distfade;
 	n_quads = 0;
-	unsigned updates = 0;
 	bool update = false;
+	vector<std::pair<unsigned, float>> visible;
+	vector<unsigned> update_lines;
 	fseg2_t strafe(cam_position.get2d(), (cam_position + cam_strafe).get2d());
-	for (unsigned a = 0; a < lines.size(); a++)
+	const vector<unsigned>& vis_lines = vis_portals.visibleLines();
+	unsigned n_lines = vis_portals_active ? vis_lines.size() : lines.size();
+	RenderProfile::addObjects(n_lines);
+	for (unsigned i = 0; i < n_lines; i++)
 	{
+		unsigned a = vis_portals_active ? vis_lines[i] : i;
 		line = map->getLine(a);
 
 		// Skip if not visible
@@ -2605,24 +3499,28 @@ void MapRenderer3D::checkVisibleQuads()
 				update = true;
 		}
 		if (update)
-		{
-			updateLine(a);
-			//updates++;
-			//if (updates > 500)
-			//	break;
-		}
+			update_lines.push_back(a);
+
+		visible.push_back(std::make_pair(a, distfade));
+	}
+
+	// Update lines (all at once, so quads can be built in parallel)
+	if (!update_lines.empty())
+		updateLines(update_lines);
 
-		// Determine quads to be drawn
+	// Determine quads to be drawn
+	for (auto& vis : visible)
+	{
 		quad_3d_t* quad;
-		for (unsigned q = 0; q < lines[a].quads.size(); q++)
+		for (unsigned q = 0; q < lines[vis.first].quads.size(); q++)
 		{
 			// Check we're on the right side of the quad
-			quad = &(lines[a].quads[q]);
+			quad = &(lines[vis.first].quads[q]);
 			if (MathStuff::lineSide(cam_position.get2d(), fseg2_t(quad->points[0].x, quad->points[0].y, quad->points[2].x, quad->points[2].y)) < 0)
 				continue;
 
 			quads[n_quads] = quad;
-			quad->alpha = distfade;
+			quad->alpha = vis.second;
 			n_quads++;
 		}
 	}
@@ -2641,9 +3539,14 @@ void MapRenderer3D::checkVisibleFlats()
 	MapSector* sector;
 	n_flats = 0;
 	float alpha;
+	vector<unsigned> update_sectors;
 	fpoint2_t cam = cam_position.get2d();
-	for (unsigned a = 0; a < map->nSectors(); a++)
+	const vector<unsigned>& vis_sectors = vis_portals.visibleSectors();
+	unsigned n_sectors = vis_portals_active ? vis_sectors.size() : map->nSectors();
+	RenderProfile::addObjects(n_sectors);
+	for (unsigned i = 0; i < n_sectors; i++)
 	{
+		unsigned a = vis_portals_active ? vis_sectors[i] : i;
 		sector = map->getSector(a);
 
 		// Skip if invisible
@@ -2667,7 +3570,7 @@ void MapRenderer3D::checkVisibleFlats()
 		// Update sector info if needed
 		if (floors[a].updated_time < sector->modifiedTime() ||
 			floors[a].updated_time < sector->geometryUpdatedTime())
-			updateSector(a);
+			update_sectors.push_back(a);
 
 		// Set distance fade alpha
 		if (render_max_dist > 0)
@@ -2680,8 +3583,10 @@ void MapRenderer3D::checkVisibleFlats()
 		// Add floor flat
 		flats[n_flats++] = &(floors[a]);
 	}
-	for (unsigned a = 0; a < map->nSectors(); a++)
+	for (unsigned i = 0; i < n_sectors; i++)
 	{
+		unsigned a = vis_portals_active ? vis_sectors[i] : i;
+
 		// Skip if invisible
 		if (dist_sectors[a] < 0)
 			continue;
@@ -2689,11 +3594,16 @@ void MapRenderer3D::checkVisibleFlats()
 		// Add ceiling flat
 		flats[n_flats++] = &(ceilings[a]);
 	}
+
+	// Update sectors (all at once, so flats can be built in parallel)
+	if (!update_sectors.empty())
+		updateSectors(update_sectors);
 }
 
 /* MapRenderer3D::determineHilight
  * Finds the closest wall/flat/thing to the camera along the view
- * vector
+ * vector. Only objects whose bounding boxes are hit by the view
+ * ray (found via the picking trees) are checked
  *******************************************************************/
 MapEditor::Item MapRenderer3D::determineHilight()
 {
@@ -2705,17 +3615,26 @@ MapEditor::Item MapRenderer3D::determineHilight()
 	// Check for required map structures
 	if (!map || lines.size() != map->nLines() ||
 	        floors.size() != map->nSectors() ||
-	        things.size() != map->nThings())
+	        things.size() != map->nThings() ||
+	        dist_sectors.size() != map->nSectors())
 		return current;
 
+	// Update picking trees if needed
+	updatePickTrees();
+
+	// Objects are checked in order of distance rather than index, so when
+	// two are the same distance away, the one with the lowest index is
+	// picked (as if they were checked in index order)
+	int best = -1;
+
 	// Check lines
 	double height, dist;
 	quad_3d_t* quad;
-	for (unsigned a = 0; a < map->nLines(); a++)
+	pick_walls.intersectRay(cam_position, cam_dir3d, min_dist, [&](unsigned a)
 	{
 		// Ignore if not visible
 		if (!lines[a].visible)
-			continue;
+			return;
 
 		MapLine* line = map->getLine(a);
 
@@ -2725,8 +3644,8 @@ MapEditor::Item MapRenderer3D::determineHilight()
 			line->point1(), line->point2());
 
 		// Ignore if no intersection or something was closer
-		if (dist < 0 || dist >= min_dist)
-			continue;
+		if (dist < 0 || dist > min_dist || (dist == min_dist && (int)a > best))
+			return;
 
 		// Find quad intersect if any
 		fpoint3_t intersection = cam_position + cam_dir3d * dist;
@@ -2767,51 +3686,42 @@ MapEditor::Item MapRenderer3D::determineHilight()
 					current.type = MapEditor::ItemType::WallMiddle;
 
 				min_dist = dist;
+				best = a;
 			}
 		}
-	}
+	});
 
-	// Check sectors
-	for (unsigned a = 0; a < map->nSectors(); a++)
+	// Check sectors (floor n is flat 2n, ceiling n is flat 2n+1)
+	double walls_dist = min_dist;
+	best = -1;
+	pick_flats.intersectRay(cam_position, cam_dir3d, min_dist, [&](unsigned f)
 	{
 		// Ignore if not visible
+		unsigned a = f / 2;
 		if (dist_sectors[a] < 0)
-			continue;
+			return;
 
-		// Check distance to floor plane
-		dist = MathStuff::distanceRayPlane(cam_position, cam_dir3d, floors[a].plane);
-		if (dist >= 0 && dist < min_dist)
-		{
-			// Check if on the correct side of the plane
-			if (cam_position.z > floors[a].plane.height_at(cam_position.x, cam_position.y))
-			{
-				// Check if intersection is within sector
-				if (map->getSector(a)->isWithin((cam_position + cam_dir3d * dist).get2d()))
-				{
-					current.index = a;
-					current.type = MapEditor::ItemType::Floor;
-					min_dist = dist;
-				}
-			}
-		}
+		// Check distance to plane
+		bool ceiling = (f % 2) == 1;
+		plane_t& plane = ceiling ? ceilings[a].plane : floors[a].plane;
+		dist = MathStuff::distanceRayPlane(cam_position, cam_dir3d, plane);
+		if (dist < 0 || dist >= walls_dist || dist > min_dist || (dist == min_dist && (int)f > best))
+			return;
 
-		// Check distance to ceiling plane
-		dist = MathStuff::distanceRayPlane(cam_position, cam_dir3d, ceilings[a].plane);
-		if (dist >= 0 && dist < min_dist)
+		// Check if on the correct side of the plane
+		double plane_height = plane.height_at(cam_position.x, cam_position.y);
+		if (ceiling ? cam_position.z >= plane_height : cam_position.z <= plane_height)
+			return;
+
+		// Check if intersection is within sector
+		if (map->getSector(a)->isWithin((cam_position + cam_dir3d * dist).get2d()))
 		{
-			// Check if on the correct side of the plane
-			if (cam_position.z < ceilings[a].plane.height_at(cam_position.x, cam_position.y))
-			{
-				// Check if intersection is within sector
-				if (map->getSector(a)->isWithin((cam_position + cam_dir3d * dist).get2d()))
-				{
-					current.index = a;
-					current.type = MapEditor::ItemType::Ceiling;
-					min_dist = dist;
-				}
-			}
+			current.index = a;
+			current.type = ceiling ? MapEditor::ItemType::Ceiling : MapEditor::ItemType::Floor;
+			min_dist = dist;
+			best = f;
 		}
-	}
+	});
 
 	// Update item distance
 	if (min_dist >= 9999999 || min_dist < 0)
@@ -2822,21 +3732,23 @@ MapEditor::Item MapRenderer3D::determineHilight()
 	// Check things (if visible)
 	if (render_3d_things == 0)
 		return current;
+	double flats_dist = min_dist;
 	double halfwidth, theight;
-	for (unsigned a = 0; a < map->nThings(); a++)
+	best = -1;
+	pick_things.intersectRay(cam_position, cam_dir3d, min_dist, [&](unsigned a)
 	{
 		// Ignore if no sprite
 		if (!things[a].sprite)
-			continue;
+			return;
 
 		// Ignore if not visible
 		MapThing* thing = map->getThing(a);
 		if (MathStuff::lineSide(thing->point(), strafe) > 0)
-			continue;
+			return;
 
 		// Ignore if not shown
 		if (!things[a].type->decoration() && render_3d_things == 2)
-			continue;
+			return;
 
 		// Find distance to thing sprite
 		halfwidth = things[a].sprite->getWidth() * 0.5;
@@ -2847,8 +3759,8 @@ MapEditor::Item MapRenderer3D::determineHilight()
 			thing->point() - cam_strafe.get2d() * halfwidth, thing->point() + cam_strafe.get2d() * halfwidth);
 
 		// Ignore if no intersection or something was closer
-		if (dist < 0 || dist >= min_dist)
-			continue;
+		if (dist < 0 || dist >= flats_dist || dist > min_dist || (dist == min_dist && (int)a > best))
+			return;
 
 		// Check intersection height
 		theight = things[a].sprite->getHeight();
@@ -2860,8 +3772,9 @@ MapEditor::Item MapRenderer3D::determineHilight()
 			current.index = a;
 			current.type = MapEditor::ItemType::Thing;
 			min_dist = dist;
+			best = a;
 		}
-	}
+	});
 
 	// Update item distance
 	if (min_dist >= 9999999 || min_dist < 0)
@@ -2872,6 +3785,123 @@ MapEditor::Item MapRenderer3D::determineHilight()
 	return current;
 }
 
+/* MapRenderer3D::wallBox
+ * Returns the picking bounding box for the quads of line [index]
+ *******************************************************************/
+AABBTree::box_t MapRenderer3D::wallBox(unsigned index)
+{
+	AABBTree::box_t box;
+	for (auto& quad : lines[index].quads)
+		for (auto& point : quad.points)
+			box.extend(point.x, point.y, point.z);
+
+	// Allow for rounding in hit tests (boxes of straight lines are flat)
+	if (!box.isEmpty())
+	{
+		MapLine* line = map->getLine(index);
+		box.extend(line->x1(), line->y1(), box.min.z);
+		box.extend(line->x2(), line->y2(), box.min.z);
+		box.min.set(box.min.x - 1, box.min.y - 1, box.min.z - 1);
+		box.max.set(box.max.x + 1, box.max.y + 1, box.max.z + 1);
+	}
+
+	return box;
+}
+
+/* MapRenderer3D::flatBox
+ * Returns the picking bounding box for the floor (or ceiling if
+ * [ceiling] is true) of sector [index]
+ *******************************************************************/
+AABBTree::box_t MapRenderer3D::flatBox(unsigned index, bool ceiling)
+{
+	AABBTree::box_t box;
+	if (index >= map->nSectors())
+		return box;
+
+	// Planes are flat, so the height range over the sector's bounding box
+	// is at its corners
+	bbox_t bbox = map->getSector(index)->boundingBox();
+	plane_t& plane = ceiling ? ceilings[index].plane : floors[index].plane;
+	box.extend(bbox.min.x - 1, bbox.min.y - 1, plane.height_at(bbox.min.x, bbox.min.y) - 1);
+	box.extend(bbox.max.x + 1, bbox.min.y - 1, plane.height_at(bbox.max.x, bbox.min.y) - 1);
+	box.extend(bbox.min.x - 1, bbox.max.y + 1, plane.height_at(bbox.min.x, bbox.max.y) - 1);
+	box.extend(bbox.max.x + 1, bbox.max.y + 1, plane.height_at(bbox.max.x, bbox.max.y) - 1);
+	box.max.z += 2;
+
+	return box;
+}
+
+/* MapRenderer3D::thingBox
+ * Returns the picking bounding box for thing [index]. This contains
+ * the thing's sprite facing any direction
+ *******************************************************************/
+AABBTree::box_t MapRenderer3D::thingBox(unsigned index)
+{
+	AABBTree::box_t box;
+	if (index >= map->nThings() || !things[index].sprite)
+		return box;
+
+	// Get sprite size (same as in determineHilight)
+	double halfwidth = things[index].sprite->getWidth() * 0.5;
+	double theight = things[index].sprite->getHeight();
+	if (things[index].flags & ICON)
+	{
+		halfwidth = render_thing_icon_size*0.5;
+		theight = render_thing_icon_size;
+	}
+
+	MapThing* thing = map->getThing(index);
+	box.extend(thing->xPos() - halfwidth - 1, thing->yPos() - halfwidth - 1, things[index].z - 1);
+	box.extend(thing->xPos() + halfwidth + 1, thing->yPos() + halfwidth + 1, things[index].z + theight + 1);
+
+	return box;
+}
+
+/* MapRenderer3D::updatePickTrees
+ * Rebuilds the picking trees if the map structure has changed since
+ * they were built. Changes to individual lines, sectors and things
+ * are handled by refitting the trees in updateLine etc.
+ *******************************************************************/
+void MapRenderer3D::updatePickTrees()
+{
+	vector<AABBTree::box_t> boxes;
+
+	// Walls and flats
+	if (pick_walls.nObjects() != lines.size() ||
+		pick_flats.nObjects() != floors.size() * 2 ||
+		map->geometryUpdated() != pick_geometry_updated)
+	{
+		boxes.resize(lines.size());
+		for (unsigned a = 0; a < lines.size(); a++)
+			boxes[a] = wallBox(a);
+		pick_walls.build(boxes);
+
+		boxes.resize(floors.size() * 2);
+		for (unsigned a = 0; a < floors.size(); a++)
+		{
+			boxes[a * 2] = flatBox(a, false);
+			boxes[a * 2 + 1] = flatBox(a, true);
+		}
+		pick_flats.build(boxes);
+
+		pick_geometry_updated = map->geometryUpdated();
+	}
+
+	// Things
+	if (pick_things.nObjects() != things.size() ||
+		map->thingsUpdated() != pick_things_updated ||
+		render_thing_icon_size != pick_icon_size)
+	{
+		boxes.resize(things.size());
+		for (unsigned a = 0; a < things.size(); a++)
+			boxes[a] = thingBox(a);
+		pick_things.build(boxes);
+
+		pick_things_updated = map->thingsUpdated();
+		pick_icon_size = render_thing_icon_size;
+	}
+}
+
 /* MapRenderer3D::renderHilight
  * Renders the hilight overlay for the currently hilighted object
  *******************************************************************/
@@ -5,6 +5,8 @@
 #include "MapEditor/SLADEMap/SLADEMap.h"
 #include "General/ListenerAnnouncer.h"
 #include "MapEditor/Edit/Edit3D.h"
+#include "Utility/AABBTree.h"
+#include "PortalVisibility.h"
 
 class ItemSelection;
 class GLTexture;
@@ -52,12 +54,14 @@ public:
 		GLTexture*	texture;
 		uint8_t		flags;
 		float		alpha;
+		unsigned	vbo_index;	// First vertex in the walls VBO
 
 		quad_3d_t()
 		{
 			colour.set(255, 255, 255, 255, 0);
 			texture = nullptr;
 			flags = 0;
+			vbo_index = 0;
 		}
 	};
 	struct line_3d_t
@@ -66,8 +70,10 @@ public:
 		long				updated_time;
 		bool				visible;
 		MapLine*			line;
+		unsigned			vbo_index;	// First vertex in the walls VBO
+		unsigned			vbo_quads;	// Number of quads space is reserved for in the walls VBO
 
-		line_3d_t() { updated_time = 0; visible = true; }
+		line_3d_t() { updated_time = 0; visible = true; line = nullptr; vbo_index = 0; vbo_quads = 0; }
 	};
 	struct thing_3d_t
 	{
@@ -122,6 +128,8 @@ public:
 	int		itemDistance() { return item_dist; }
 	void	enableHilight(bool render) { render_hilight = render; }
 	void	enableSelection(bool render) { render_selection = render; }
+	unsigned	nDrawCalls() { return n_draw_calls; }
+	unsigned	nTextureBinds() { return n_texture_binds; }
 
 	bool	init();
 	void	refresh();
@@ -149,6 +157,7 @@ public:
 
 	// -- Rendering --
 	void	setupView(int width, int height);
+	float	lightMult(uint8_t light);
 	void	setLight(rgba_t& colour, uint8_t light, float alpha = 1.0f);
 	void	setFog(rgba_t &fogcol, uint8_t light);
 	void	renderMap();
@@ -158,6 +167,7 @@ public:
 	// Flats
 	void	updateFlatTexCoords(unsigned index, bool floor);
 	void	updateSector(unsigned index);
+	void	updateSectors(const vector<unsigned>& indices);
 	void	renderFlat(flat_3d_t* flat);
 	void	renderFlats();
 	void	renderFlatSelection(const ItemSelection& selection, float alpha = 1.0f);
@@ -167,6 +177,7 @@ public:
 	void	setupQuad(quad_3d_t* quad, double x1, double y1, double x2, double y2, plane_t top, plane_t bottom);
 	void	setupQuadTexCoords(quad_3d_t* quad, int length, double o_left, double o_top, double h_top, double h_bottom, bool pegbottom = false, double sx = 1, double sy = 1);
 	void	updateLine(unsigned index);
+	void	updateLines(const vector<unsigned>& indices);
 	void	renderQuad(quad_3d_t* quad, float alpha = 1.0f);
 	void	renderWalls();
 	void	renderTransparentWalls();
@@ -179,10 +190,14 @@ public:
 
 	// VBO stuff
 	void	updateFlatsVBO();
+	void	updateFlatColours(unsigned index);
 	void	updateWallsVBO();
+	void	updateLineVBO(unsigned index);
 
 	// Visibility checking
 	void	quickVisDiscard();
+	bool	portalVisDiscard();
+	void	updatePortalGeometry();
 	float	calcDistFade(double distance, double max = -1);
 	void	checkVisibleQuads();
 	void	checkVisibleFlats();
@@ -190,6 +205,10 @@ public:
 	// Hilight
 	MapEditor::Item	determineHilight();
 	void				renderHilight(MapEditor::Item hilight, float alpha = 1.0f);
+	AABBTree::box_t		wallBox(unsigned index);
+	AABBTree::box_t		flatBox(unsigned index, bool ceiling);
+	AABBTree::box_t		thingBox(unsigned index);
+	void				updatePickTrees();
 
 	// Listener stuff
 	void	onAnnouncement(Announcer* announcer, string event_name, MemChunk& event_data);
@@ -206,9 +225,58 @@ private:
 	bool		render_selection;
 	rgba_t		fog_colour_last;
 	float		fog_depth_last;
+	unsigned	n_draw_calls;
+	unsigned	n_texture_binds;
+
+	// Info needed to build a line's quads that has to be looked up on the
+	// main thread (textures may need loading, and configuration/property
+	// lookups can modify the configuration if the property isn't defined)
+	struct line_info_t
+	{
+		GLTexture*	textures[6];	// Front lower/middle/upper, back lower/middle/upper
+		rgba_t		colour[2];
+		rgba_t		fogcolour[2];
+		int			light[2];
+		bool		upeg;
+		bool		lpeg;
+		bool		show_midtex;
+		bool		wrap_midtex;
+		bool		tex_offsets;
+		bool		tex_scaling;
+	};
+
+	void	getLineInfo(unsigned index, line_info_t& info);
+	void	buildLineQuads(unsigned index, const line_info_t& info);
+
+	// Flat texture scaling/offsets/rotation (from UDMF properties)
+	struct flat_coords_t
+	{
+		double	sx;
+		double	sy;
+		double	ox;
+		double	oy;
+		double	rot;
+	};
+
+	void	getFlatCoords(unsigned index, bool floor, flat_coords_t& coords);
+	void	updateFlatInfo(unsigned index);
 
 	// Visibility
-	vector<float>	dist_sectors;
+	vector<float>		dist_sectors;
+	PortalVisibility	vis_portals;
+	bool				vis_portals_active;		// Use vis_portals visible lists (otherwise all objects are checked)
+	long				vis_geometry_updated;
+	long				vis_things_updated;
+	int					vis_cam_sector;
+	float				view_aspect;
+
+	// Picking (flats tree has the floor of sector n at 2n, ceiling at 2n+1)
+	AABBTree	pick_walls;
+	AABBTree	pick_flats;
+	AABBTree	pick_things;
+	long		pick_geometry_updated;
+	long		pick_things_updated;
+	int			pick_icon_size;
 
 	// Camera
 	fpoint3_t	cam_position;
@@ -229,10 +297,34 @@ private:
 	vector<flat_3d_t>	ceilings;
 	flat_3d_t**			flats;
 
-	// VBOs
+	// VBOs (the colour VBOs hold the lit colour of each vertex in the
+	// matching geometry VBO)
 	unsigned	vbo_floors;
 	unsigned	vbo_ceilings;
 	unsigned	vbo_walls;
+	unsigned	vbo_floor_colours;
+	unsigned	vbo_ceiling_colours;
+	unsigned	vbo_wall_colours;
+	bool		walls_vbo_rebuild;
+	bool		vbo_fullbright;
+	float		vbo_brightness;
+
+	// Batched rendering - visible walls/flats are sorted by texture and
+	// render state, and each run with the same texture and state is drawn
+	// with one call from the VBOs
+	struct batch_item_t
+	{
+		GLTexture*	texture;
+		uint64_t	state;		// Render flags, light and fog colour
+		unsigned	index;		// First vertex of a wall quad
+		flat_3d_t*	flat;
+	};
+	vector<batch_item_t>	batch_items;
+	vector<unsigned>		batch_indices;
+
+	bool		useBatches(bool flats);
+	uint64_t	batchState(uint8_t flags, uint8_t light, const rgba_t& fogcolour);
+	void		renderBatches(bool flats);
 
 	// Sky
 	struct gl_vertex_ex_t
@@ -43,6 +43,12 @@
 #include "OpenGL/OpenGL.h"
 
 
+/*******************************************************************
+ * VARIABLES
+ *******************************************************************/
+CVAR(Bool, info_overlay_3d_render_stats, false, CVAR_SAVE)
+
+
 /*******************************************************************
  * EXTERNAL VARIABLES
  *******************************************************************/
@@ -61,7 +67,9 @@ InfoOverlay3D::InfoOverlay3D() :
 	texture(nullptr),
 	thing_icon(false),
 	object(nullptr),
-	last_update(0)
+	last_update(0),
+	n_draw_calls(0),
+	n_texture_binds(0)
 {
 }
 
@@ -496,13 +504,21 @@ void InfoOverlay3D::update(int item_index, MapEditor::ItemType item_type, SLADEM
  *******************************************************************/
 void InfoOverlay3D::draw(int bottom, int right, int middle, float alpha)
 {
-	// Don't bother if invisible
-	if (alpha <= 0.0f)
-		return;
-
-	// Don't bother if no info
-	if (info.size() == 0)
+	// Don't bother if invisible or no info, other than the 3d renderer stats
+	// which are always shown if enabled
+	if (alpha <= 0.0f || info.size() == 0)
+	{
+		if (info_overlay_3d_render_stats)
+		{
+			rgba_t col_fg = ColourConfiguration::getColour("map_3d_overlay_foreground");
+			rgba_t col_bg = ColourConfiguration::getColour("map_3d_overlay_background");
+			int line_height = 16 * (Drawing::fontSize() / 12.0);
+			Drawing::setTextOutline(1.0f, col_bg);
+			drawRenderStats(4, bottom - (line_height * 2) - 4, col_fg);
+			Drawing::setTextOutline(0);
+		}
 		return;
+	}
 
 	// Update if needed
 	if (object &&
@@ -555,6 +571,10 @@ void InfoOverlay3D::draw(int bottom, int right, int middle, float alpha)
 		y -= line_height;
 	}
 
+	// Draw 3d renderer stats (far left)
+	if (info_overlay_3d_render_stats)
+		drawRenderStats(4, bottom - height, col_fg);
+
 	// Draw texture if any
 	drawTexture(alpha, middle - (40 * scale), bottom);
 
@@ -562,6 +582,17 @@ void InfoOverlay3D::draw(int bottom, int right, int middle, float alpha)
 	glEnable(GL_LINE_SMOOTH);
 }
 
+/* InfoOverlay3D::drawRenderStats
+ * Draws the 3d renderer stats (draw calls and texture binds) at
+ * [x],[y] in [colour]
+ *******************************************************************/
+void InfoOverlay3D::drawRenderStats(int x, int y, rgba_t colour)
+{
+	int line_height = 16 * (Drawing::fontSize() / 12.0);
+	Drawing::drawText(S_FMT("Draw Calls: %u", n_draw_calls), x, y, colour, Drawing::FONT_CONDENSED);
+	Drawing::drawText(S_FMT("Texture Binds: %u", n_texture_binds), x, y + line_height, colour, Drawing::FONT_CONDENSED);
+}
+
 /* InfoOverlay3D::drawTexture
  * Draws the item texture/graphic box (if any)
  *******************************************************************/
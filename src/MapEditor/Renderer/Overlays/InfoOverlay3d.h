@@ -16,7 +16,9 @@ public:
 	void	update(int item_index, MapEditor::ItemType item_type, SLADEMap* map);
 	void	draw(int bottom, int right, int middle, float alpha = 1.0f);
 	void	drawTexture(float alpha, int x, int y);
+	void	drawRenderStats(int x, int y, rgba_t colour);
 	void	reset() { texture = nullptr; object = nullptr; }
+	void	setRenderStats(unsigned draw_calls, unsigned texture_binds) { n_draw_calls = draw_calls; n_texture_binds = texture_binds; }
 
 private:
 	vector<string>		info;
@@ -27,6 +29,8 @@ private:
 	bool				thing_icon;
 	MapObject*			object;
 	long				last_update;
+	unsigned			n_draw_calls;
+	unsigned			n_texture_binds;
 };
 
 #endif//__INFO_OVERLAY_3D_H__
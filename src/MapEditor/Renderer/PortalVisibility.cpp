@@ -0,0 +1,453 @@
+// ----------------------------------------------------------------------------
+// SLADE - It's a Doom Editor
+// Copyright(C) 2008 - 2017 Simon Judd
+//
+// Email:       sirjuddington@gmail.com
+// Web:         http://slade.mancubus.net
+// Filename:    PortalVisibility.cpp
+// Description: PortalVisibility class - finds the lines, sectors and things
+//              visible from a point by flooding through two-sided lines
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301, USA.
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+//
+// Includes
+//
+// ----------------------------------------------------------------------------
+#include "Main.h"
+#include "PortalVisibility.h"
+#include "Utility/MathStuff.h"
+
+
+// ----------------------------------------------------------------------------
+//
+// Variables
+//
+// ----------------------------------------------------------------------------
+namespace
+{
+	// Lines closer than this to the view position are treated as covering
+	// the whole view (their angular span isn't reliable)
+	const double	near_dist	= 1.0;
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// PortalVisibility Class Functions
+//
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+// PortalVisibility::clear
+//
+// Clears all geometry, things and results
+// ----------------------------------------------------------------------------
+void PortalVisibility::clear()
+{
+	lines_.clear();
+	sector_start_.clear();
+	sector_lines_.clear();
+	sector_bbox_.clear();
+	grid_things_.clear();
+	n_things_ = 0;
+	spans_.clear();
+	line_stamp_.clear();
+	sector_stamp_.clear();
+	thing_stamp_.clear();
+	sector_windows_.clear();
+	vis_lines_.clear();
+	vis_sectors_.clear();
+	vis_things_.clear();
+	n_portals_ = 0;
+}
+
+// ----------------------------------------------------------------------------
+// PortalVisibility::setGeometry
+//
+// Sets the map geometry to [lines], which reference [n_sectors] sectors
+// (lines referencing sectors outside this range are ignored)
+// ----------------------------------------------------------------------------
+void PortalVisibility::setGeometry(const vector<line_t>& lines, unsigned n_sectors)
+{
+	lines_ = lines;
+	for (auto& line : lines_)
+	{
+		if (line.front >= (int)n_sectors) line.front = -1;
+		if (line.back >= (int)n_sectors) line.back = -1;
+	}
+
+	// Count lines per sector (a line with the same sector on both sides is
+	// only listed once)
+	sector_start_.assign(n_sectors + 1, 0);
+	for (auto& line : lines_)
+	{
+		if (line.front >= 0)
+			sector_start_[line.front + 1]++;
+		if (line.back >= 0 && line.back != line.front)
+			sector_start_[line.back + 1]++;
+	}
+	for (unsigned a = 0; a < n_sectors; a++)
+		sector_start_[a + 1] += sector_start_[a];
+
+	// Fill sector line lists and bounding boxes
+	sector_lines_.resize(sector_start_[n_sectors]);
+	sector_bbox_.assign(n_sectors, bbox_t());
+	vector<unsigned> fill(sector_start_.begin(), sector_start_.end() - 1);
+	for (unsigned a = 0; a < lines_.size(); a++)
+	{
+		const line_t& line = lines_[a];
+		for (int sector : { line.front, line.back })
+		{
+			if (sector < 0 || (sector == line.back && line.back == line.front))
+				continue;
+
+			sector_lines_[fill[sector]++] = a;
+			sector_bbox_[sector].extend(line.v1.x, line.v1.y);
+			sector_bbox_[sector].extend(line.v2.x, line.v2.y);
+		}
+	}
+
+	// Reset per-update data
+	spans_.assign(lines_.size(), span_t());
+	line_stamp_.assign(lines_.size(), 0);
+	sector_stamp_.assign(n_sectors, 0);
+	sector_windows_.assign(n_sectors, vector<window_t>());
+	stamp_ = 0;
+	vis_lines_.clear();
+	vis_sectors_.clear();
+	vis_things_.clear();
+}
+
+// ----------------------------------------------------------------------------
+// PortalVisibility::setThings
+//
+// Sets the positions of all things. Things are identified by their index in
+// [things]
+// ----------------------------------------------------------------------------
+void PortalVisibility::setThings(const vector<fpoint2_t>& things)
+{
+	vector<bbox_t> boxes(things.size());
+	for (unsigned a = 0; a < things.size(); a++)
+		boxes[a].extend(things[a].x, things[a].y);
+
+	grid_things_.build(boxes);
+	n_things_ = things.size();
+	thing_stamp_.assign(n_things_, 0);
+	vis_things_.clear();
+}
+
+// ----------------------------------------------------------------------------
+// PortalVisibility::sectorAt
+//
+// Returns the index of the sector containing [point], or -1 if it isn't
+// within any sector. Sector [hint] (eg. the last result) is checked first
+// ----------------------------------------------------------------------------
+int PortalVisibility::sectorAt(fpoint2_t point, int hint) const
+{
+	if (hint >= 0 && hint < (int)sector_bbox_.size() && pointInSector(point, hint))
+		return hint;
+
+	for (unsigned a = 0; a < sector_bbox_.size(); a++)
+		if ((int)a != hint && pointInSector(point, a))
+			return a;
+
+	return -1;
+}
+
+// ----------------------------------------------------------------------------
+// PortalVisibility::update
+//
+// Determines everything visible from [position] in [sector], looking in
+// direction [angle] (radians) with a horizontal view of [half_fov] either
+// side of it (PI or more for all directions). Lines further away than
+// [max_dist] are ignored, unless it is 0. Returns false if [sector] is
+// invalid
+// ----------------------------------------------------------------------------
+bool PortalVisibility::update(fpoint2_t position, int sector, double angle, double half_fov, double max_dist)
+{
+	vis_lines_.clear();
+	vis_sectors_.clear();
+	vis_things_.clear();
+	n_portals_ = 0;
+	if (sector < 0 || sector >= (int)sector_bbox_.size())
+		return false;
+
+	nextStamp();
+	position_ = position;
+	dir_x_ = cos(angle);
+	dir_y_ = sin(angle);
+	max_dist_ = max_dist;
+
+	// Flood from the view sector (breadth-first, so sectors tend to be
+	// entered through their widest windows before any narrower ones)
+	window_t view = { -PI, PI };
+	if (half_fov < PI)
+		view = { -half_fov, half_fov };
+	queue_.clear();
+	queue_.push_back({ (unsigned)sector, view });
+	for (unsigned e = 0; e < queue_.size(); e++)
+	{
+		entry_t entry = queue_[e];
+
+		// Only the parts of the window not already seen through need
+		// to be checked
+		enterSector(entry.sector, entry.window, unseen_);
+		for (auto& window : unseen_)
+			floodWindow(entry.sector, window);
+	}
+
+	// Things within visible sectors
+	if (n_things_ > 0)
+	{
+		for (unsigned s : vis_sectors_)
+		{
+			grid_things_.query(sector_bbox_[s], query_);
+			for (unsigned thing : query_)
+			{
+				if (thing_stamp_[thing] != stamp_)
+				{
+					thing_stamp_[thing] = stamp_;
+					vis_things_.push_back(thing);
+				}
+			}
+		}
+	}
+
+	std::sort(vis_lines_.begin(), vis_lines_.end());
+	std::sort(vis_sectors_.begin(), vis_sectors_.end());
+	std::sort(vis_things_.begin(), vis_things_.end());
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// PortalVisibility::floodWindow
+//
+// Marks the lines of [sector] within [window] as visible, and adds the
+// sectors beyond any of them that are portals to the queue, with the window
+// clipped to the portal
+// ----------------------------------------------------------------------------
+void PortalVisibility::floodWindow(unsigned sector, const window_t& window)
+{
+	for (unsigned a = sector_start_[sector]; a < sector_start_[sector + 1]; a++)
+	{
+		unsigned index = sector_lines_[a];
+		const span_t& span = lineSpan(index);
+		if (span.culled)
+			continue;
+
+		// Clip the window to the part of it the line covers (the line span
+		// may wrap around behind the view, giving two parts)
+		window_t parts[3];
+		unsigned n_parts = 0;
+		for (int wrap = -1; wrap <= 1; wrap++)
+		{
+			double start = span.start + wrap * 2 * PI;
+			double min = MAX(window.min, start);
+			double max = MIN(window.max, start + span.length);
+			if (min < max)
+				parts[n_parts++] = { min, max };
+		}
+		if (n_parts == 0)
+			continue;
+
+		// Line is visible
+		if (line_stamp_[index] != stamp_)
+		{
+			line_stamp_[index] = stamp_;
+			vis_lines_.push_back(index);
+		}
+
+		// Check the line is a portal into another sector, as seen from this
+		// one
+		const line_t& line = lines_[index];
+		int other = (line.front == (int)sector) ? line.back : line.front;
+		if (other < 0 || other == (int)sector)
+			continue;
+		if (!span.near_line && span.cam_front != (line.front == (int)sector))
+			continue;
+
+		for (unsigned p = 0; p < n_parts; p++)
+			queue_.push_back({ (unsigned)other, parts[p] });
+		n_portals_++;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// PortalVisibility::lineSpan
+//
+// Returns the angular span of [line] from the current view position,
+// calculating it if it hasn't been already for this update
+// ----------------------------------------------------------------------------
+const PortalVisibility::span_t& PortalVisibility::lineSpan(unsigned line)
+{
+	span_t& span = spans_[line];
+	if (span.stamp == stamp_)
+		return span;
+
+	span.stamp = stamp_;
+	span.culled = false;
+	span.near_line = false;
+
+	const line_t& l = lines_[line];
+	fseg2_t seg(l.v1, l.v2);
+	span.cam_front = MathStuff::lineSide(position_, seg) >= 0;
+
+	double dist = MathStuff::distanceToLine(position_, seg);
+	if (max_dist_ > 0 && dist > max_dist_)
+	{
+		span.culled = true;
+		return span;
+	}
+
+	// Too close to tell which way the line goes, so it could cover anything
+	if (dist < near_dist)
+	{
+		span.near_line = true;
+		span.start = -PI;
+		span.length = 2 * PI;
+		return span;
+	}
+
+	// Get the (shorter) arc between the two ends of the line
+	double a1 = viewAngle(l.v1);
+	double a2 = viewAngle(l.v2);
+	double diff = a2 - a1;
+	if (diff > PI) diff -= 2 * PI;
+	if (diff < -PI) diff += 2 * PI;
+	span.start = diff >= 0 ? a1 : a2;
+	span.length = fabs(diff);
+	span.culled = span.length <= 0;
+
+	return span;
+}
+
+// ----------------------------------------------------------------------------
+// PortalVisibility::viewAngle
+//
+// Returns the angle of [point] from the view position, relative to the view
+// direction (within -PI to PI)
+// ----------------------------------------------------------------------------
+double PortalVisibility::viewAngle(fpoint2_t point) const
+{
+	double dx = point.x - position_.x;
+	double dy = point.y - position_.y;
+	return atan2(dir_x_ * dy - dir_y_ * dx, dir_x_ * dx + dir_y_ * dy);
+}
+
+// ----------------------------------------------------------------------------
+// PortalVisibility::enterSector
+//
+// Adds [window] to the windows [sector] has been seen through, and sets
+// [unseen] to the parts of it that weren't already covered by previous ones
+// (so only they need to be checked again). The windows for each sector are
+// kept merged, in order
+// ----------------------------------------------------------------------------
+void PortalVisibility::enterSector(unsigned sector, const window_t& window, vector<window_t>& unseen)
+{
+	auto& windows = sector_windows_[sector];
+	if (sector_stamp_[sector] != stamp_)
+	{
+		sector_stamp_[sector] = stamp_;
+		windows.clear();
+		vis_sectors_.push_back(sector);
+	}
+
+	// Find uncovered parts of the window
+	unseen.clear();
+	double pos = window.min;
+	for (auto& w : windows)
+	{
+		if (w.max <= pos)
+			continue;
+		if (w.min >= window.max)
+			break;
+		if (w.min > pos)
+			unseen.push_back({ pos, w.min });
+		pos = w.max;
+	}
+	if (pos < window.max)
+		unseen.push_back({ pos, window.max });
+
+	if (unseen.empty())
+		return;
+
+	// Merge the window in with any it overlaps
+	window_t merged = window;
+	unsigned first = 0;
+	while (first < windows.size() && windows[first].max < window.min)
+		first++;
+	unsigned last = first;
+	while (last < windows.size() && windows[last].min <= window.max)
+	{
+		merged.min = MIN(merged.min, windows[last].min);
+		merged.max = MAX(merged.max, windows[last].max);
+		last++;
+	}
+	windows.erase(windows.begin() + first, windows.begin() + last);
+	windows.insert(windows.begin() + first, merged);
+}
+
+// ----------------------------------------------------------------------------
+// PortalVisibility::pointInSector
+//
+// Returns true if [point] is within [sector], by counting how many of its
+// lines a ray from the point crosses
+// ----------------------------------------------------------------------------
+bool PortalVisibility::pointInSector(fpoint2_t point, unsigned sector) const
+{
+	const bbox_t& bbox = sector_bbox_[sector];
+	if (point.x < bbox.min.x || point.x > bbox.max.x || point.y < bbox.min.y || point.y > bbox.max.y)
+		return false;
+
+	bool inside = false;
+	for (unsigned a = sector_start_[sector]; a < sector_start_[sector + 1]; a++)
+	{
+		const line_t& line = lines_[sector_lines_[a]];
+		if (line.front == line.back)
+			continue;
+
+		if ((line.v1.y > point.y) != (line.v2.y > point.y))
+		{
+			double x = line.v1.x + (point.y - line.v1.y) * (line.v2.x - line.v1.x) / (line.v2.y - line.v1.y);
+			if (point.x < x)
+				inside = !inside;
+		}
+	}
+
+	return inside;
+}
+
+// ----------------------------------------------------------------------------
+// PortalVisibility::nextStamp
+//
+// Moves on to the next update stamp, resetting the stamps if it wraps around
+// ----------------------------------------------------------------------------
+void PortalVisibility::nextStamp()
+{
+	if (++stamp_ == 0)
+	{
+		for (auto& span : spans_) span.stamp = 0;
+		std::fill(line_stamp_.begin(), line_stamp_.end(), 0);
+		std::fill(sector_stamp_.begin(), sector_stamp_.end(), 0);
+		std::fill(thing_stamp_.begin(), thing_stamp_.end(), 0);
+		stamp_ = 1;
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Utility/SpatialGrid.h"
+
+// Determines which lines, sectors and things can be seen from a point, by
+// flooding out from the sector containing it through two-sided lines
+// (portals). Each sector is entered with a horizontal angular window (the
+// part of the view visible through the portals on the way there), which is
+// clipped by each portal it passes through, so sectors hidden behind walls
+// are never reached.
+//
+// The test is 2d only (floor/ceiling heights are ignored, so closed doors
+// don't block anything) and conservative - anything reached is considered
+// visible, even if it is actually hidden by nearer lines in the same sector.
+// It works on plain map geometry rather than the map itself, so it can be
+// set up with any synthetic arrangement of lines.
+//
+// Lines follow the Doom convention: the front side is on the right when
+// looking from the first vertex to the second
+class PortalVisibility
+{
+public:
+	struct line_t
+	{
+		fpoint2_t	v1;
+		fpoint2_t	v2;
+		int			front;	// Front sector index (or -1 for none)
+		int			back;	// Back sector index (or -1 for none)
+	};
+
+	PortalVisibility() {}
+	~PortalVisibility() {}
+
+	void	clear();
+	void	setGeometry(const vector<line_t>& lines, unsigned n_sectors);
+	void	setThings(const vector<fpoint2_t>& things);
+	int		sectorAt(fpoint2_t point, int hint = -1) const;
+	bool	update(fpoint2_t position, int sector, double angle, double half_fov, double max_dist = 0);
+
+	unsigned	nLines() const { return lines_.size(); }
+	unsigned	nSectors() const { return sector_bbox_.size(); }
+	unsigned	nThings() const { return n_things_; }
+	unsigned	nPortals() const { return n_portals_; }
+
+	// Results of the last update (in ascending index order)
+	const vector<unsigned>&	visibleLines() const { return vis_lines_; }
+	const vector<unsigned>&	visibleSectors() const { return vis_sectors_; }
+	const vector<unsigned>&	visibleThings() const { return vis_things_; }
+
+private:
+	// An angular range, relative to the view direction (within -PI to PI)
+	struct window_t
+	{
+		double	min;
+		double	max;
+	};
+
+	// The angular range covered by a line from the current view position
+	struct span_t
+	{
+		unsigned	stamp;
+		double		start;
+		double		length;
+		bool		culled;		// Too far away or seen edge-on
+		bool		near_line;	// View position is (almost) on the line
+		bool		cam_front;	// View position is on the front side
+	};
+
+	struct entry_t
+	{
+		unsigned	sector;
+		window_t	window;
+	};
+
+	// Geometry
+	vector<line_t>		lines_;
+	vector<unsigned>	sector_start_;	// Index into sector_lines_ for each sector (plus one past the end)
+	vector<unsigned>	sector_lines_;
+	vector<bbox_t>		sector_bbox_;
+	SpatialGrid			grid_things_;
+	unsigned			n_things_	= 0;
+
+	// Current update
+	fpoint2_t					position_;
+	double						dir_x_		= 1;
+	double						dir_y_		= 0;
+	double						max_dist_	= 0;
+	unsigned					stamp_		= 0;
+	vector<span_t>				spans_;
+	vector<unsigned>			line_stamp_;
+	vector<unsigned>			sector_stamp_;
+	vector<unsigned>			thing_stamp_;
+	vector<vector<window_t>>	sector_windows_;
+	vector<entry_t>				queue_;
+	vector<window_t>			unseen_;
+	vector<unsigned>			query_;
+	unsigned					n_portals_	= 0;
+
+	// Results
+	vector<unsigned>	vis_lines_;
+	vector<unsigned>	vis_sectors_;
+	vector<unsigned>	vis_things_;
+
+	const span_t&	lineSpan(unsigned line);
+	double			viewAngle(fpoint2_t point) const;
+	void			floodWindow(unsigned sector, const window_t& window);
+	void			enterSector(unsigned sector, const window_t& window, vector<window_t>& unseen);
+	bool			pointInSector(fpoint2_t point, unsigned sector) const;
+	void			nextStamp();
+};
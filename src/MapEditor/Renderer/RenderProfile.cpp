@@ -0,0 +1,391 @@
+// ----------------------------------------------------------------------------
+// SLADE - It's a Doom Editor
+// Copyright(C) 2008 - 2017 Simon Judd
+//
+// Email:       sirjuddington@gmail.com
+// Web:         http://slade.mancubus.net
+// Filename:    RenderProfile.cpp
+// Description: RenderProfile namespace - per-frame timings and counters for
+//              the map renderer
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301, USA.
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+//
+// Includes
+//
+// ----------------------------------------------------------------------------
+#include "Main.h"
+#include "App.h"
+#include "General/Console/Console.h"
+#include "RenderProfile.h"
+
+
+// ----------------------------------------------------------------------------
+//
+// Variables
+//
+// ----------------------------------------------------------------------------
+namespace RenderProfile
+{
+	// Number of frames kept
+	const unsigned	max_frames		= 1000;
+
+	sf::Clock		frame_clock;
+	bool			in_frame		= false;
+	frame_t			current;
+	sf::Int64		frame_start		= 0;
+	sf::Int64		phase_start		= 0;
+	sf::Int64		phase_us[(int)Phase::Count];
+	Phase			current_phase	= Phase::Other;
+	unsigned		frame_count		= 0;
+
+	// Kept frames (circular, oldest at [first_frame])
+	vector<frame_t>	frames;
+	unsigned		first_frame		= 0;
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// RenderProfile Namespace Functions
+//
+// ----------------------------------------------------------------------------
+namespace RenderProfile
+{
+	// ------------------------------------------------------------------------
+	// switchPhase
+	//
+	// Adds the time since the last phase change to the current phase, and
+	// changes the current phase to [phase]. Returns the previous phase
+	// ------------------------------------------------------------------------
+	Phase switchPhase(Phase phase)
+	{
+		sf::Int64 now = frame_clock.getElapsedTime().asMicroseconds();
+		phase_us[(int)current_phase] += now - phase_start;
+		phase_start = now;
+
+		Phase prev = current_phase;
+		current_phase = phase;
+		return prev;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// RenderProfile::beginFrame
+//
+// Begins timing a new frame. [mode_3d] should be true if the frame is a 3d
+// mode frame
+// ----------------------------------------------------------------------------
+void RenderProfile::beginFrame(bool mode_3d)
+{
+	current = frame_t();
+	current.number = frame_count++;
+	current.time = App::runTimer();
+	current.mode_3d = mode_3d;
+
+	for (unsigned a = 0; a < (unsigned)Phase::Count; a++)
+		phase_us[a] = 0;
+	current_phase = Phase::Other;
+	frame_start = phase_start = frame_clock.getElapsedTime().asMicroseconds();
+	in_frame = true;
+}
+
+// ----------------------------------------------------------------------------
+// RenderProfile::endFrame
+//
+// Finishes timing the current frame and adds it to the kept frames
+// ----------------------------------------------------------------------------
+void RenderProfile::endFrame()
+{
+	if (!in_frame)
+		return;
+
+	switchPhase(Phase::Other);
+	current.total_ms = (phase_start - frame_start) * 0.001;
+	for (unsigned a = 0; a < (unsigned)Phase::Count; a++)
+		current.phase_ms[a] = phase_us[a] * 0.001;
+	in_frame = false;
+
+	if (frames.size() < max_frames)
+		frames.push_back(current);
+	else
+	{
+		frames[first_frame] = current;
+		first_frame = (first_frame + 1) % max_frames;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// RenderProfile::inFrame
+//
+// Returns true if a frame is currently being timed
+// ----------------------------------------------------------------------------
+bool RenderProfile::inFrame()
+{
+	return in_frame;
+}
+
+// ----------------------------------------------------------------------------
+// RenderProfile::addObjects
+//
+// Adds [count] to the number of map objects visited in the current frame
+// ----------------------------------------------------------------------------
+void RenderProfile::addObjects(unsigned count)
+{
+	if (in_frame)
+		current.objects += count;
+}
+
+// ----------------------------------------------------------------------------
+// RenderProfile::addDrawCalls
+//
+// Adds [count] to the number of draw calls in the current frame
+// ----------------------------------------------------------------------------
+void RenderProfile::addDrawCalls(unsigned count)
+{
+	if (in_frame)
+		current.draw_calls += count;
+}
+
+// ----------------------------------------------------------------------------
+// RenderProfile::addTextureBinds
+//
+// Adds [count] to the number of texture binds in the current frame
+// ----------------------------------------------------------------------------
+void RenderProfile::addTextureBinds(unsigned count)
+{
+	if (in_frame)
+		current.texture_binds += count;
+}
+
+// ----------------------------------------------------------------------------
+// RenderProfile::nFrames
+//
+// Returns the number of frames kept
+// ----------------------------------------------------------------------------
+unsigned RenderProfile::nFrames()
+{
+	return frames.size();
+}
+
+// ----------------------------------------------------------------------------
+// RenderProfile::frame
+//
+// Returns the kept frame at [index], where 0 is the oldest
+// ----------------------------------------------------------------------------
+const RenderProfile::frame_t& RenderProfile::frame(unsigned index)
+{
+	return frames[(first_frame + index) % frames.size()];
+}
+
+// ----------------------------------------------------------------------------
+// RenderProfile::average
+//
+// Returns the average of the last [n_frames] kept frames (number and time
+// are taken from the latest frame)
+// ----------------------------------------------------------------------------
+RenderProfile::frame_t RenderProfile::average(unsigned n_frames)
+{
+	frame_t avg = frame_t();
+	n_frames = MIN(n_frames, frames.size());
+	if (n_frames == 0)
+		return avg;
+
+	unsigned objects = 0;
+	unsigned draw_calls = 0;
+	unsigned texture_binds = 0;
+	for (unsigned a = frames.size() - n_frames; a < frames.size(); a++)
+	{
+		const frame_t& f = frame(a);
+		avg.total_ms += f.total_ms;
+		for (unsigned p = 0; p < (unsigned)Phase::Count; p++)
+			avg.phase_ms[p] += f.phase_ms[p];
+		objects += f.objects;
+		draw_calls += f.draw_calls;
+		texture_binds += f.texture_binds;
+	}
+
+	const frame_t& last = frame(frames.size() - 1);
+	avg.number = last.number;
+	avg.time = last.time;
+	avg.mode_3d = last.mode_3d;
+	avg.total_ms /= n_frames;
+	for (unsigned p = 0; p < (unsigned)Phase::Count; p++)
+		avg.phase_ms[p] /= n_frames;
+	avg.objects = objects / n_frames;
+	avg.draw_calls = draw_calls / n_frames;
+	avg.texture_binds = texture_binds / n_frames;
+
+	return avg;
+}
+
+// ----------------------------------------------------------------------------
+// RenderProfile::clear
+//
+// Clears all kept frames
+// ----------------------------------------------------------------------------
+void RenderProfile::clear()
+{
+	frames.clear();
+	first_frame = 0;
+}
+
+// ----------------------------------------------------------------------------
+// RenderProfile::phaseName
+//
+// Returns the name of [phase]
+// ----------------------------------------------------------------------------
+string RenderProfile::phaseName(Phase phase)
+{
+	switch (phase)
+	{
+	case Phase::Other: return "Other";
+	case Phase::Visibility: return "Visibility";
+	case Phase::Buffers: return "Buffers";
+	case Phase::Flats: return "Flats";
+	case Phase::Lines: return "Lines";
+	case Phase::Things: return "Things";
+	case Phase::Overlays: return "Overlays";
+	case Phase::Text: return "Text";
+	default: return "Unknown";
+	}
+}
+
+// ----------------------------------------------------------------------------
+// RenderProfile::writeCSV
+//
+// Writes all kept frames to [filename] in CSV format, one line per frame.
+// Returns false if the file couldn't be written
+// ----------------------------------------------------------------------------
+bool RenderProfile::writeCSV(const string& filename)
+{
+	wxFile file(filename, wxFile::write);
+	if (!file.IsOpened())
+		return false;
+
+	// Header
+	string line = "frame,time,mode,total_ms";
+	for (unsigned p = 0; p < (unsigned)Phase::Count; p++)
+		line += S_FMT(",%s_ms", phaseName((Phase)p).Lower());
+	line += ",objects,draw_calls,texture_binds\n";
+	file.Write(line);
+
+	// Frames
+	for (unsigned a = 0; a < frames.size(); a++)
+	{
+		const frame_t& f = frame(a);
+		line = S_FMT("%u,%ld,%s,%1.3f", f.number, f.time, f.mode_3d ? "3d" : "2d", f.total_ms);
+		for (unsigned p = 0; p < (unsigned)Phase::Count; p++)
+			line += S_FMT(",%1.3f", f.phase_ms[p]);
+		line += S_FMT(",%u,%u,%u\n", f.objects, f.draw_calls, f.texture_binds);
+		file.Write(line);
+	}
+
+	return true;
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// RenderProfile::ScopedTimer Class Functions
+//
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+// RenderProfile::ScopedTimer::ScopedTimer
+//
+// ScopedTimer class constructor, begins timing [phase]
+// ----------------------------------------------------------------------------
+RenderProfile::ScopedTimer::ScopedTimer(Phase phase) :
+	active_{ in_frame },
+	prev_{ Phase::Other }
+{
+	if (active_)
+		prev_ = switchPhase(phase);
+}
+
+// ----------------------------------------------------------------------------
+// RenderProfile::ScopedTimer::~ScopedTimer
+//
+// ScopedTimer class destructor, returns to timing the enclosing phase
+// ----------------------------------------------------------------------------
+RenderProfile::ScopedTimer::~ScopedTimer()
+{
+	if (active_ && in_frame)
+		switchPhase(prev_);
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// Console Commands
+//
+// ----------------------------------------------------------------------------
+
+CONSOLE_COMMAND(m_render_profile, 0, true)
+{
+	string cmd = args.size() > 0 ? args[0].Lower() : "";
+
+	// Clear kept frames
+	if (cmd == "clear")
+	{
+		RenderProfile::clear();
+		Log::console("Render profile cleared");
+		return;
+	}
+
+	// Write kept frames to a CSV file
+	if (cmd == "csv")
+	{
+		string filename = args.size() > 1 ? args[1] : App::path("render_profile.csv", App::Dir::User);
+		if (RenderProfile::writeCSV(filename))
+			Log::console(S_FMT("Wrote %u frames to %s", RenderProfile::nFrames(), filename));
+		else
+			Log::console(S_FMT("Unable to write %s", filename));
+		return;
+	}
+
+	// Print the average of all kept frames
+	unsigned n_frames = RenderProfile::nFrames();
+	if (n_frames == 0)
+	{
+		Log::console("No frames profiled");
+		return;
+	}
+
+	double max_ms = 0;
+	for (unsigned a = 0; a < n_frames; a++)
+		max_ms = MAX(max_ms, RenderProfile::frame(a).total_ms);
+
+	auto avg = RenderProfile::average(n_frames);
+	Log::console(S_FMT("Average of the last %u frames:", n_frames));
+	Log::console(S_FMT("Frame: %1.3fms (max %1.3fms)", avg.total_ms, max_ms));
+	for (unsigned p = 0; p < (unsigned)RenderProfile::Phase::Count; p++)
+		Log::console(S_FMT(
+			"%s: %1.3fms",
+			RenderProfile::phaseName((RenderProfile::Phase)p),
+			avg.phase_ms[p]
+		));
+	Log::console(S_FMT(
+		"Objects: %u, Draw Calls: %u, Texture Binds: %u",
+		avg.objects,
+		avg.draw_calls,
+		avg.texture_binds
+	));
+}
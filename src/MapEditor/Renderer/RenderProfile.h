@@ -0,0 +1,68 @@
+#pragma once
+
+// Lightweight per-frame profiling for the map renderer.
+//
+// Each frame (between beginFrame and endFrame) is split into phases, timed by
+// ScopedTimer objects placed around the relevant drawing code. Timers can be
+// nested - time spent in an inner phase isn't counted towards the outer one,
+// so the phase times of a frame always add up to the frame time (anything not
+// within a timer is counted as 'Other'). Outside of a frame, timers and
+// counters do nothing.
+//
+// The most recent frames are kept, for display and reporting
+namespace RenderProfile
+{
+	enum class Phase
+	{
+		Other,
+		Visibility,	// Determining visible objects
+		Buffers,	// Building geometry and updating vertex buffers
+		Flats,
+		Lines,		// Lines, walls and vertices
+		Things,
+		Overlays,	// Selection, hilight, info and fullscreen overlays
+		Text,		// Editor messages, help text, selection numbers
+
+		Count
+	};
+
+	struct frame_t
+	{
+		unsigned	number;
+		long		time;		// Time the frame began (App::runTimer)
+		bool		mode_3d;
+		double		total_ms;
+		double		phase_ms[(int)Phase::Count];
+		unsigned	objects;	// Map objects visited
+		unsigned	draw_calls;
+		unsigned	texture_binds;
+	};
+
+	// Adds the time from its creation to its destruction to [phase]
+	class ScopedTimer
+	{
+	public:
+		ScopedTimer(Phase phase);
+		~ScopedTimer();
+
+	private:
+		bool	active_;
+		Phase	prev_;
+	};
+
+	void	beginFrame(bool mode_3d);
+	void	endFrame();
+	bool	inFrame();
+
+	void	addObjects(unsigned count);
+	void	addDrawCalls(unsigned count = 1);
+	void	addTextureBinds(unsigned count = 1);
+
+	unsigned		nFrames();
+	const frame_t&	frame(unsigned index);	// 0 is the oldest kept frame
+	frame_t			average(unsigned n_frames);
+	void			clear();
+
+	string	phaseName(Phase phase);
+	bool	writeCSV(const string& filename);
+}
@@ -38,10 +38,12 @@
 #include "OpenGL/Drawing.h"
 #include "OpenGL/OpenGL.h"
 #include "Overlays/MCOverlay.h"
+#include "RenderProfile.h"
 #include "Renderer.h"
 #include "Utility/MathStuff.h"
 
 using namespace MapEditor;
+using RenderProfile::Phase;
 
 
 /*******************************************************************
@@ -64,6 +66,7 @@ CVAR(Int, map_crosshair, 0, CVAR_SAVE)
 CVAR(Bool, map_show_selection_numbers, true, CVAR_SAVE)
 CVAR(Int, map_max_selection_numbers, 1000, CVAR_SAVE)
 CVAR(Int, flat_drawtype, 2, CVAR_SAVE)
+CVAR(Bool, map_show_render_profile, false, CVAR_SAVE)
 
 
 /*******************************************************************
@@ -92,6 +95,7 @@ Renderer::Renderer(MapEditContext& context) :
 	fade_lines_{1},
 	anim_flash_level_{0.5},
 	anim_flash_inc_{true},
+	anim_flash_pulses_{0},
 	anim_info_fade_{0},
 	anim_overlay_fade_{0},
 	anim_help_fade_{0},
@@ -118,6 +122,7 @@ void Renderer::setView(double map_x, double map_y)
 
 	// Update object visibility
 	renderer_2d_.updateVisibility(view_.mapBounds().tl, view_.mapBounds().br);
+	context_.requestRedraw();
 }
 
 /* Renderer::setViewSize
@@ -130,6 +135,7 @@ void Renderer::setViewSize(int width, int height)
 
 	// Update object visibility
 	renderer_2d_.updateVisibility(view_.mapBounds().tl, view_.mapBounds().br);
+	context_.requestRedraw();
 }
 
 /* Renderer::setTopY
@@ -173,6 +179,7 @@ void Renderer::zoom(double amount, bool toward_cursor)
 	// Update object visibility
 	renderer_2d_.setScale(view_.scale(true));
 	renderer_2d_.updateVisibility(view_.mapBounds().tl, view_.mapBounds().br);
+	context_.requestRedraw();
 }
 
 /* Renderer::viewFitToMap
@@ -195,6 +202,7 @@ void Renderer::viewFitToMap(bool snap)
 	renderer_2d_.setScale(view_.scale(true));
 	renderer_2d_.forceUpdate();
 	renderer_2d_.updateVisibility(view_.mapBounds().tl, view_.mapBounds().br);
+	context_.requestRedraw();
 }
 
 /* Renderer::viewFitToObjects
@@ -254,6 +262,7 @@ void Renderer::viewFitToObjects(const vector<MapObject*>& objects)
 	renderer_2d_.setScale(view_.scale(true));
 	renderer_2d_.forceUpdate();
 	renderer_2d_.updateVisibility(view_.mapBounds().tl, view_.mapBounds().br);
+	context_.requestRedraw();
 }
 
 /* Renderer::interpolateView
@@ -511,6 +520,8 @@ void Renderer::drawGrid() const
  *******************************************************************/
 void Renderer::drawEditorMessages() const
 {
+	RenderProfile::ScopedTimer timer(Phase::Text);
+
 	int yoff = 0;
 	if (map_showfps) yoff = 16;
 	auto col_fg = ColourConfiguration::getColour("map_editor_message");
@@ -560,6 +571,8 @@ void Renderer::drawEditorMessages() const
  *******************************************************************/
 void Renderer::drawFeatureHelpText() const
 {
+	RenderProfile::ScopedTimer timer(Phase::Text);
+
 	// Check if any text
 	auto& help_lines = context_.featureHelpLines();
 	if (help_lines.empty() || !map_show_help)
@@ -600,6 +613,46 @@ void Renderer::drawFeatureHelpText() const
 	Drawing::enableTextStateReset(true);
 }
 
+/* Renderer::drawRenderProfile
+ * Draws the render profile (average phase times and counters over
+ * the last few frames)
+ *******************************************************************/
+void Renderer::drawRenderProfile() const
+{
+	RenderProfile::ScopedTimer timer(Phase::Text);
+
+	// Get average of recent frames
+	if (RenderProfile::nFrames() == 0)
+		return;
+	auto frame = RenderProfile::average(30);
+
+	// Build lines
+	vector<string> lines;
+	lines.push_back(S_FMT("Frame: %1.2fms", frame.total_ms));
+	for (unsigned a = 0; a < (unsigned)Phase::Count; a++)
+		lines.push_back(S_FMT("%s: %1.2fms", RenderProfile::phaseName((Phase)a), frame.phase_ms[a]));
+	lines.push_back(S_FMT("Objects: %u", frame.objects));
+	lines.push_back(S_FMT("Draw Calls: %u", frame.draw_calls));
+	lines.push_back(S_FMT("Texture Binds: %u", frame.texture_binds));
+
+	// Draw below editor messages
+	auto col = ColourConfiguration::getColour("map_editor_message");
+	auto col_bg = ColourConfiguration::getColour("map_editor_message_outline");
+	col_bg.a = 255;
+	int yoff = map_showfps ? 88 : 72;
+	Drawing::setTextState(true);
+	Drawing::enableTextStateReset(false);
+	Drawing::setTextOutline(1.0f, col_bg);
+	for (auto& line : lines)
+	{
+		Drawing::drawText(line, 2, yoff, col, Drawing::FONT_SMALL);
+		yoff += 14;
+	}
+	Drawing::setTextOutline(0);
+	Drawing::setTextState(false);
+	Drawing::enableTextStateReset(true);
+}
+
 /* Renderer::drawSelectionNumbers
  * Draws numbers for selected map objects
  *******************************************************************/
@@ -610,6 +663,8 @@ void Renderer::drawSelectionNumbers() const
 	if (selection.size() == 0)
 		return;
 
+	RenderProfile::ScopedTimer timer(Phase::Text);
+
 	// Get editor message text colour
 	auto col = ColourConfiguration::getColour("map_editor_message");
 
@@ -1000,6 +1055,10 @@ void Renderer::drawMap2d()
 	// Draw grid
 	drawGrid();
 
+	// Anything drawn from here on that isn't the map objects themselves
+	// (selection, hilight, editing state, etc.) is overlaid on the map
+	RenderProfile::ScopedTimer overlays_timer(Phase::Overlays);
+
 	// --- Draw map (depending on mode) ---
 	auto mouse_state = context_.input().mouseState();
 	OpenGL::resetBlend();
@@ -1208,8 +1267,11 @@ void Renderer::drawMap3d()
 
 	// Render 3d map
 	renderer_3d_.renderMap();
+	RenderProfile::addDrawCalls(renderer_3d_.nDrawCalls());
+	RenderProfile::addTextureBinds(renderer_3d_.nTextureBinds());
 
 	// Draw selection if any
+	RenderProfile::ScopedTimer timer(Phase::Overlays);
 	auto selection = context_.selection();
 	renderer_3d_.renderFlatSelection(selection);
 	renderer_3d_.renderWallSelection(selection);
@@ -1228,6 +1290,8 @@ void Renderer::drawMap3d()
  *******************************************************************/
 void Renderer::draw()
 {
+	RenderProfile::beginFrame(context_.editMode() == Mode::Visual);
+
 	// Setup the viewport
 	glViewport(0, 0, view_.size().x, view_.size().y);
 
@@ -1247,6 +1311,7 @@ void Renderer::draw()
 		drawMap2d();
 
 	// Draw info overlay
+	RenderProfile::ScopedTimer overlays_timer(Phase::Overlays);
 	glDisable(GL_CULL_FACE);
 	glDisable(GL_DEPTH_TEST);
 	glMatrixMode(GL_PROJECTION);
@@ -1312,6 +1377,7 @@ void Renderer::draw()
 		// Draw item distance (if any)
 		if (context_.renderer().renderer3D().itemDistance() >= 0 && camera_3d_show_distance)
 		{
+			RenderProfile::ScopedTimer timer(Phase::Text);
 			glEnable(GL_TEXTURE_2D);
 			OpenGL::setColour(col);
 			Drawing::drawText(
@@ -1349,6 +1415,12 @@ void Renderer::draw()
 
 	// Help text
 	drawFeatureHelpText();
+
+	// Render profile
+	if (map_show_render_profile)
+		drawRenderProfile();
+
+	RenderProfile::endFrame();
 }
 
 namespace
@@ -1409,27 +1481,33 @@ void Renderer::updateAnimations(double mult)
 		renderer_2d_.setScale(view_.scale(true));
 	}
 
-	// Flashing animation for hilight
-	// Pulsates between 0.5-1.0f (multiplied with hilight alpha)
-	if (anim_flash_inc_)
+	// Flashing animation for hilight/selection/tagged objects
+	// Pulsates between 0.5-1.0f (multiplied with hilight alpha) a few
+	// times, then settles at 1.0f
+	if (anim_flash_pulses_ > 0)
 	{
-		if (anim_flash_level_ < 0.5f)
-			anim_flash_level_ += 0.053*mult;	// Initial fade in
-		else
-			anim_flash_level_ += 0.015f*mult;
-		if (anim_flash_level_ >= 1.0f)
+		animations_active_ = true;
+		if (anim_flash_inc_)
 		{
-			anim_flash_inc_ = false;
-			anim_flash_level_ = 1.0f;
+			if (anim_flash_level_ < 0.5f)
+				anim_flash_level_ += 0.053*mult;	// Initial fade in
+			else
+				anim_flash_level_ += 0.015f*mult;
+			if (anim_flash_level_ >= 1.0f)
+			{
+				anim_flash_inc_ = false;
+				anim_flash_level_ = 1.0f;
+				anim_flash_pulses_--;
+			}
 		}
-	}
-	else
-	{
-		anim_flash_level_ -= 0.015f*mult;
-		if (anim_flash_level_ <= 0.5f)
+		else
 		{
-			anim_flash_inc_ = true;
-			anim_flash_level_ = 0.6f;
+			anim_flash_level_ -= 0.015f*mult;
+			if (anim_flash_level_ <= 0.5f)
+			{
+				anim_flash_inc_ = true;
+				anim_flash_level_ = 0.6f;
+			}
 		}
 	}
 
@@ -1657,6 +1735,9 @@ void Renderer::animateSelectionChange(const ItemSelection &selection)
 {
 	for (auto& change : selection.lastChange())
 		animateSelectionChange(change.first, change.second);
+
+	if (!selection.empty())
+		startFlash();
 }
 
 /* Renderer::animateHilightChange
@@ -1692,6 +1773,16 @@ void Renderer::animateHilightChange(const MapEditor::Item& old_item, MapObject*
 	// Reset hilight flash
 	anim_flash_inc_ = true;
 	anim_flash_level_ = 0.f;
+	startFlash();
+}
+
+/* Renderer::startFlash
+ * (Re)starts the hilight/selection/tagged object flashing animation,
+ * continuing from the current flash level
+ *******************************************************************/
+void Renderer::startFlash()
+{
+	anim_flash_pulses_ = 3;
 }
 
 /* Renderer::addAnimation
@@ -46,6 +46,7 @@ namespace MapEditor
 		void	animateSelectionChange(const MapEditor::Item& item, bool selected = true);
 		void	animateSelectionChange(const ItemSelection &selection);
 		void	animateHilightChange(const MapEditor::Item& old_item, MapObject* old_object = nullptr);
+		void	startFlash();
 		void	addAnimation(std::unique_ptr<MCAnimation> animation);
 
 	private:
@@ -66,6 +67,7 @@ namespace MapEditor
 		float	fade_lines_;
 		float	anim_flash_level_;
 		bool	anim_flash_inc_;
+		int		anim_flash_pulses_;	// Pulses left before the flash settles
 		float	anim_info_fade_;
 		float	anim_overlay_fade_;
 		float	anim_help_fade_;
@@ -76,6 +78,7 @@ namespace MapEditor
 		void	drawGrid() const;
 		void	drawEditorMessages() const;
 		void	drawFeatureHelpText() const;
+		void	drawRenderProfile() const;
 		void	drawSelectionNumbers() const;
 		void	drawThingQuickAngleLines() const;
 		void	drawLineLength(fpoint2_t p1, fpoint2_t p2, rgba_t col) const;
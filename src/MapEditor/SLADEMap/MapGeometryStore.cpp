@@ -0,0 +1,218 @@
+// ----------------------------------------------------------------------------
+// SLADE - It's a Doom Editor
+// Copyright(C) 2008 - 2017 Simon Judd
+//
+// Email:       sirjuddington@gmail.com
+// Web:         http://slade.mancubus.net
+// Filename:    MapGeometryStore.cpp
+// Description: MapGeometryStore class - keeps vertex positions, line vertex
+//              indices and line bounding boxes for a map in flat arrays, so
+//              that full-map scans don't have to chase object pointers.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301, USA.
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+//
+// Includes
+//
+// ----------------------------------------------------------------------------
+#include "Main.h"
+#include "MapGeometryStore.h"
+#include "MapLine.h"
+#include "MapVertex.h"
+
+
+// ----------------------------------------------------------------------------
+//
+// MapGeometryStore Class Functions
+//
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+// MapGeometryStore::clear
+//
+// Clears all geometry (the store will need to be rebuilt before use)
+// ----------------------------------------------------------------------------
+void MapGeometryStore::clear()
+{
+	vertex_x_.clear();
+	vertex_y_.clear();
+	line_v1_.clear();
+	line_v2_.clear();
+	line_min_x_.clear();
+	line_min_y_.clear();
+	line_max_x_.clear();
+	line_max_y_.clear();
+	valid_ = false;
+}
+
+// ----------------------------------------------------------------------------
+// MapGeometryStore::rebuild
+//
+// Rebuilds all geometry arrays from [vertices] and [lines]
+// ----------------------------------------------------------------------------
+void MapGeometryStore::rebuild(const vector<MapVertex*>& vertices, const vector<MapLine*>& lines)
+{
+	// Vertices
+	vertex_x_.resize(vertices.size());
+	vertex_y_.resize(vertices.size());
+	for (unsigned a = 0; a < vertices.size(); a++)
+	{
+		vertex_x_[a] = vertices[a]->xPos();
+		vertex_y_[a] = vertices[a]->yPos();
+	}
+
+	// Lines
+	line_v1_.resize(lines.size());
+	line_v2_.resize(lines.size());
+	line_min_x_.resize(lines.size());
+	line_min_y_.resize(lines.size());
+	line_max_x_.resize(lines.size());
+	line_max_y_.resize(lines.size());
+	for (unsigned a = 0; a < lines.size(); a++)
+	{
+		line_v1_[a] = lines[a]->v1() ? lines[a]->v1()->getIndex() : 0;
+		line_v2_[a] = lines[a]->v2() ? lines[a]->v2()->getIndex() : 0;
+		updateLineBBox(a);
+	}
+
+	valid_ = true;
+}
+
+// ----------------------------------------------------------------------------
+// MapGeometryStore::setVertex
+//
+// Sets the position of vertex [index]. Bounding boxes of lines connected to
+// the vertex must be updated separately (via setLine)
+// ----------------------------------------------------------------------------
+void MapGeometryStore::setVertex(unsigned index, double x, double y)
+{
+	if (index >= vertex_x_.size())
+		return;
+
+	vertex_x_[index] = x;
+	vertex_y_[index] = y;
+}
+
+// ----------------------------------------------------------------------------
+// MapGeometryStore::addVertex
+//
+// Adds a vertex at [x,y] to the end of the vertex arrays
+// ----------------------------------------------------------------------------
+void MapGeometryStore::addVertex(double x, double y)
+{
+	vertex_x_.push_back(x);
+	vertex_y_.push_back(y);
+}
+
+// ----------------------------------------------------------------------------
+// MapGeometryStore::removeVertex
+//
+// Removes vertex [index], replacing it with the last vertex (the same way
+// SLADEMap removes vertices). Lines connected to the moved vertex must be
+// updated separately (via setLine)
+// ----------------------------------------------------------------------------
+void MapGeometryStore::removeVertex(unsigned index)
+{
+	if (index >= vertex_x_.size())
+		return;
+
+	vertex_x_[index] = vertex_x_.back();
+	vertex_y_[index] = vertex_y_.back();
+	vertex_x_.pop_back();
+	vertex_y_.pop_back();
+}
+
+// ----------------------------------------------------------------------------
+// MapGeometryStore::setLine
+//
+// Sets the vertices of line [index] to [v1] and [v2], and updates its
+// bounding box
+// ----------------------------------------------------------------------------
+void MapGeometryStore::setLine(unsigned index, unsigned v1, unsigned v2)
+{
+	if (index >= line_v1_.size())
+		return;
+
+	line_v1_[index] = v1;
+	line_v2_[index] = v2;
+	updateLineBBox(index);
+}
+
+// ----------------------------------------------------------------------------
+// MapGeometryStore::addLine
+//
+// Adds a line between vertices [v1] and [v2] to the end of the line arrays
+// ----------------------------------------------------------------------------
+void MapGeometryStore::addLine(unsigned v1, unsigned v2)
+{
+	line_v1_.push_back(v1);
+	line_v2_.push_back(v2);
+	line_min_x_.push_back(0);
+	line_min_y_.push_back(0);
+	line_max_x_.push_back(0);
+	line_max_y_.push_back(0);
+	updateLineBBox(line_v1_.size() - 1);
+}
+
+// ----------------------------------------------------------------------------
+// MapGeometryStore::removeLine
+//
+// Removes line [index], replacing it with the last line (the same way
+// SLADEMap removes lines)
+// ----------------------------------------------------------------------------
+void MapGeometryStore::removeLine(unsigned index)
+{
+	if (index >= line_v1_.size())
+		return;
+
+	line_v1_[index] = line_v1_.back();
+	line_v2_[index] = line_v2_.back();
+	line_min_x_[index] = line_min_x_.back();
+	line_min_y_[index] = line_min_y_.back();
+	line_max_x_[index] = line_max_x_.back();
+	line_max_y_[index] = line_max_y_.back();
+	line_v1_.pop_back();
+	line_v2_.pop_back();
+	line_min_x_.pop_back();
+	line_min_y_.pop_back();
+	line_max_x_.pop_back();
+	line_max_y_.pop_back();
+}
+
+// ----------------------------------------------------------------------------
+// MapGeometryStore::updateLineBBox
+//
+// Recalculates the bounding box of line [index] from its vertex positions
+// ----------------------------------------------------------------------------
+void MapGeometryStore::updateLineBBox(unsigned index)
+{
+	unsigned v1 = line_v1_[index];
+	unsigned v2 = line_v2_[index];
+	if (v1 >= vertex_x_.size() || v2 >= vertex_x_.size())
+	{
+		line_min_x_[index] = line_max_x_[index] = 0;
+		line_min_y_[index] = line_max_y_[index] = 0;
+		return;
+	}
+
+	line_min_x_[index] = MIN(vertex_x_[v1], vertex_x_[v2]);
+	line_min_y_[index] = MIN(vertex_y_[v1], vertex_y_[v2]);
+	line_max_x_[index] = MAX(vertex_x_[v1], vertex_x_[v2]);
+	line_max_y_[index] = MAX(vertex_y_[v1], vertex_y_[v2]);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+class MapVertex;
+class MapLine;
+
+// A structure-of-arrays copy of a map's vertex positions and line geometry.
+// Loops that scan every vertex or line (hit testing, VBO building, map checks)
+// can use these contiguous arrays instead of going through each MapVertex or
+// MapLine. SLADEMap keeps it in sync with the actual map objects
+class MapGeometryStore
+{
+public:
+	MapGeometryStore() : valid_{ false } {}
+
+	bool	isValid() const { return valid_; }
+	void	invalidate() { valid_ = false; }
+	void	clear();
+	void	rebuild(const vector<MapVertex*>& vertices, const vector<MapLine*>& lines);
+
+	// Incremental updates (indices are map object indices)
+	void	setVertex(unsigned index, double x, double y);
+	void	addVertex(double x, double y);
+	void	removeVertex(unsigned index);
+	void	setLine(unsigned index, unsigned v1, unsigned v2);
+	void	addLine(unsigned v1, unsigned v2);
+	void	removeLine(unsigned index);
+
+	// Vertices
+	size_t					nVertices() const { return vertex_x_.size(); }
+	const vector<double>&	vertexX() const { return vertex_x_; }
+	const vector<double>&	vertexY() const { return vertex_y_; }
+
+	// Lines
+	size_t					nLines() const { return line_v1_.size(); }
+	const vector<unsigned>&	lineV1() const { return line_v1_; }
+	const vector<unsigned>&	lineV2() const { return line_v2_; }
+	const vector<double>&	lineMinX() const { return line_min_x_; }
+	const vector<double>&	lineMinY() const { return line_min_y_; }
+	const vector<double>&	lineMaxX() const { return line_max_x_; }
+	const vector<double>&	lineMaxY() const { return line_max_y_; }
+
+	// Returns true if the bounding box of line [index] overlaps [min,max]
+	bool lineBBoxIntersects(unsigned index, double min_x, double min_y, double max_x, double max_y) const
+	{
+		return !(line_max_x_[index] < min_x ||
+				 line_min_x_[index] > max_x ||
+				 line_max_y_[index] < min_y ||
+				 line_min_y_[index] > max_y);
+	}
+
+private:
+	bool	valid_;
+
+	vector<double>		vertex_x_;
+	vector<double>		vertex_y_;
+
+	vector<unsigned>	line_v1_;
+	vector<unsigned>	line_v2_;
+	vector<double>		line_min_x_;
+	vector<double>		line_min_y_;
+	vector<double>		line_max_x_;
+	vector<double>		line_max_y_;
+
+	void	updateLineBBox(unsigned index);
+};
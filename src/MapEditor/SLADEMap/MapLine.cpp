@@ -316,6 +316,7 @@ void MapLine::setIntProperty(const string& key, int value)
 			vertex1 = vertex;
 			vertex1->connectLine(this);
 			resetInternals();
+			parent_map->lineGeometryChanged(this);
 		}
 	}
 	else if (key == "v2")
@@ -327,6 +328,7 @@ void MapLine::setIntProperty(const string& key, int value)
 			vertex2 = vertex;
 			vertex2->connectLine(this);
 			resetInternals();
+			parent_map->lineGeometryChanged(this);
 		}
 	}
 
@@ -350,7 +352,11 @@ void MapLine::setIntProperty(const string& key, int value)
 
 	// Id
 	else if (key == "id")
+	{
 		line_id = value;
+		if (parent_map)
+			parent_map->objectTagsChanged(this);
+	}
 
 	// Line property
 	else
@@ -712,7 +718,10 @@ void MapLine::flip(bool sides)
 
 	resetInternals();
 	if (parent_map)
+	{
 		parent_map->setGeometryUpdated();
+		parent_map->lineGeometryChanged(this);
+	}
 }
 
 /* MapLine::writeBackup
@@ -761,6 +770,8 @@ void MapLine::readBackup(mobj_backup_t* backup)
 		vertex2->connectLine(this);
 		resetInternals();
 	}
+	if (v1 || v2)
+		parent_map->lineGeometryChanged(this);
 
 	// Sides
 	MapObject* s1 = parent_map->getObjectById(backup->props_internal["s1"]);
@@ -796,4 +807,6 @@ void MapLine::copy(MapObject* c)
 	//setIntProperty("special", l->intProperty("special"));
 	special = l->special;
 	line_id = l->line_id;
+	if (parent_map)
+		parent_map->objectTagsChanged(this);
 }
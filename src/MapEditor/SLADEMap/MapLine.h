@@ -83,6 +83,7 @@ public:
 	MapSide*		s1() const { return side1; }
 	MapSide*		s2() const { return side2; }
 	int				getSpecial() const { return special; }
+	int				getLineId() const { return line_id; }
 
 	MapSector*	frontSector();
 	MapSector*	backSector();
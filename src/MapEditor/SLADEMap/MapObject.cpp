@@ -143,6 +143,8 @@ void MapObject::copy(MapObject* c)
 		this->parent_map = c->parent_map;
 		this->filtered = c->filtered;
 	}
+	if (parent_map)
+		parent_map->objectTagsChanged(this);
 }
 
 /* MapObject::boolProperty
@@ -151,8 +153,9 @@ void MapObject::copy(MapObject* c)
 bool MapObject::boolProperty(const string& key)
 {
 	// If the property exists already, return it
-	if (properties[key].hasValue())
-		return properties[key].getBoolValue();
+	const Property* value = properties.get(key);
+	if (value && value->hasValue())
+		return value->getBoolValue();
 
 	// Otherwise check the game configuration for a default value
 	else
@@ -171,8 +174,9 @@ bool MapObject::boolProperty(const string& key)
 int MapObject::intProperty(const string& key)
 {
 	// If the property exists already, return it
-	if (properties[key].hasValue())
-		return properties[key].getIntValue();
+	const Property* value = properties.get(key);
+	if (value && value->hasValue())
+		return value->getIntValue();
 
 	// Otherwise check the game configuration for a default value
 	else
@@ -191,8 +195,9 @@ int MapObject::intProperty(const string& key)
 double MapObject::floatProperty(const string& key)
 {
 	// If the property exists already, return it
-	if (properties[key].hasValue())
-		return properties[key].getFloatValue();
+	const Property* value = properties.get(key);
+	if (value && value->hasValue())
+		return value->getFloatValue();
 
 	// Otherwise check the game configuration for a default value
 	else
@@ -211,8 +216,9 @@ double MapObject::floatProperty(const string& key)
 string MapObject::stringProperty(const string& key)
 {
 	// If the property exists already, return it
-	if (properties[key].hasValue())
-		return properties[key].getStringValue();
+	const Property* value = properties.get(key);
+	if (value && value->hasValue())
+		return value->getStringValue();
 
 	// Otherwise check the game configuration for a default value
 	else
@@ -225,6 +231,74 @@ string MapObject::stringProperty(const string& key)
 	}
 }
 
+/* MapObject::boolProp
+ * Returns the value of the boolean property [key] from the property
+ * list, or the game configuration default if it isn't set
+ *******************************************************************/
+bool MapObject::boolProp(MobjPropertyList::Atom key)
+{
+	const Property* value = properties.get(key);
+	if (value && value->hasValue())
+		return value->getBoolValue();
+
+	UDMFProperty* prop = Game::configuration().getUDMFProperty(MobjPropertyList::atomName(key), type);
+	if (prop)
+		return prop->defaultValue().getBoolValue();
+	else
+		return false;
+}
+
+/* MapObject::intProp
+ * Returns the value of the integer property [key] from the property
+ * list, or the game configuration default if it isn't set
+ *******************************************************************/
+int MapObject::intProp(MobjPropertyList::Atom key)
+{
+	const Property* value = properties.get(key);
+	if (value && value->hasValue())
+		return value->getIntValue();
+
+	UDMFProperty* prop = Game::configuration().getUDMFProperty(MobjPropertyList::atomName(key), type);
+	if (prop)
+		return prop->defaultValue().getIntValue();
+	else
+		return 0;
+}
+
+/* MapObject::floatProp
+ * Returns the value of the float property [key] from the property
+ * list, or the game configuration default if it isn't set
+ *******************************************************************/
+double MapObject::floatProp(MobjPropertyList::Atom key)
+{
+	const Property* value = properties.get(key);
+	if (value && value->hasValue())
+		return value->getFloatValue();
+
+	UDMFProperty* prop = Game::configuration().getUDMFProperty(MobjPropertyList::atomName(key), type);
+	if (prop)
+		return prop->defaultValue().getFloatValue();
+	else
+		return 0;
+}
+
+/* MapObject::stringProp
+ * Returns the value of the string property [key] from the property
+ * list, or the game configuration default if it isn't set
+ *******************************************************************/
+string MapObject::stringProp(MobjPropertyList::Atom key)
+{
+	const Property* value = properties.get(key);
+	if (value && value->hasValue())
+		return value->getStringValue();
+
+	UDMFProperty* prop = Game::configuration().getUDMFProperty(MobjPropertyList::atomName(key), type);
+	if (prop)
+		return prop->defaultValue().getStringValue();
+	else
+		return "";
+}
+
 /* MapObject::setBoolProperty
  * Sets the boolean value of the property [key] to [value]
  *******************************************************************/
@@ -235,6 +309,8 @@ void MapObject::setBoolProperty(const string& key, bool value)
 
 	// Set property
 	properties[key] = value;
+	if (parent_map)
+		parent_map->objectTagsChanged(this);
 }
 
 /* MapObject::setIntProperty
@@ -247,6 +323,8 @@ void MapObject::setIntProperty(const string& key, int value)
 
 	// Set property
 	properties[key] = value;
+	if (parent_map)
+		parent_map->objectTagsChanged(this);
 }
 
 /* MapObject::setFloatProperty
@@ -259,6 +337,8 @@ void MapObject::setFloatProperty(const string& key, double value)
 
 	// Set property
 	properties[key] = value;
+	if (parent_map)
+		parent_map->objectTagsChanged(this);
 }
 
 /* MapObject::setStringProperty
@@ -271,6 +351,8 @@ void MapObject::setStringProperty(const string& key, const string& value)
 
 	// Set property
 	properties[key] = value;
+	if (parent_map)
+		parent_map->objectTagsChanged(this);
 }
 
 /* MapObject::backup
@@ -316,6 +398,8 @@ void MapObject::loadFromBackup(mobj_backup_t* backup)
 
 	// Object-specific properties
 	readBackup(backup);
+	if (parent_map)
+		parent_map->objectTagsChanged(this);
 }
 
 /* MapObject::getBackup
@@ -65,7 +65,24 @@ public:
 	void		setModified();
 
 	MobjPropertyList&	props()						{ return properties; }
-	bool				hasProp(const string& key)	{ return properties[key].hasValue(); }
+	bool				hasProp(const string& key) const
+	{
+		const Property* value = properties.get(key);
+		return value && value->hasValue();
+	}
+	bool				hasProp(MobjPropertyList::Atom key) const
+	{
+		const Property* value = properties.get(key);
+		return value && value->hasValue();
+	}
+
+	// Property list access by atom, for frequently read properties. These
+	// only look at the property list (and config defaults), so they can't
+	// be used for basic properties handled by the functions below
+	bool	boolProp(MobjPropertyList::Atom key);
+	int		intProp(MobjPropertyList::Atom key);
+	double	floatProp(MobjPropertyList::Atom key);
+	string	stringProp(MobjPropertyList::Atom key);
 
 	// Generic property modification
 	virtual bool	boolProperty(const string& key);
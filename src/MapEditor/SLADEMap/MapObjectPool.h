@@ -0,0 +1,123 @@
+#pragma once
+
+#include <memory>
+#include <type_traits>
+
+// A typed pool allocator for map objects. Objects are constructed in slots
+// within fixed-size blocks, so creating many objects (eg. when loading a map)
+// only needs one heap allocation per block. Released objects go on a free
+// list to be reused, and clear() releases everything at once when the map is
+// closed
+template<class T, unsigned BlockSize = 1024>
+class MapObjectPool
+{
+public:
+	// Allocation statistics
+	struct Stats
+	{
+		unsigned long	created;	// Total objects created
+		unsigned long	reused;		// Objects created in a slot from the free list
+		unsigned long	released;	// Objects released individually
+		unsigned long	blocks;		// Blocks allocated (ie. actual heap allocations)
+		unsigned long	live;		// Objects currently alive
+
+		Stats() : created{ 0 }, reused{ 0 }, released{ 0 }, blocks{ 0 }, live{ 0 } {}
+	};
+
+	MapObjectPool() : free_list_{ nullptr }, last_block_used_{ BlockSize } {}
+	MapObjectPool(const MapObjectPool&) = delete;
+	MapObjectPool& operator=(const MapObjectPool&) = delete;
+	~MapObjectPool() { clear(); }
+
+	const Stats&	stats() const { return stats_; }
+	size_t			nBlocks() const { return blocks_.size(); }
+	size_t			memoryUsage() const { return blocks_.size() * BlockSize * sizeof(Slot); }
+
+	// Constructs a new object in the pool with [args]
+	template<class... Args> T* create(Args&&... args)
+	{
+		Slot* slot = acquireSlot();
+		T* object = new (&slot->storage) T(std::forward<Args>(args)...);
+		slot->live = true;
+		stats_.created++;
+		stats_.live++;
+		return object;
+	}
+
+	// Destroys [object] and adds its slot to the free list
+	void release(T* object)
+	{
+		if (!object)
+			return;
+
+		Slot* slot = reinterpret_cast<Slot*>(object);
+		object->~T();
+		slot->live = false;
+		slot->next_free = free_list_;
+		free_list_ = slot;
+		stats_.released++;
+		stats_.live--;
+	}
+
+	// Destroys all objects in the pool and frees all blocks
+	void clear()
+	{
+		for (unsigned b = 0; b < blocks_.size(); b++)
+		{
+			unsigned used = (b == blocks_.size() - 1) ? last_block_used_ : BlockSize;
+			Slot* block = blocks_[b].get();
+			for (unsigned a = 0; a < used; a++)
+				if (block[a].live)
+					reinterpret_cast<T*>(&block[a].storage)->~T();
+		}
+
+		blocks_.clear();
+		free_list_ = nullptr;
+		last_block_used_ = BlockSize;
+		stats_.live = 0;
+	}
+
+	// Clears the pool and resets statistics
+	void reset()
+	{
+		clear();
+		stats_ = Stats();
+	}
+
+private:
+	// Storage must be first, so a T* can be converted back to its Slot*
+	struct Slot
+	{
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type	storage;
+		Slot*	next_free;
+		bool	live;
+	};
+
+	vector<std::unique_ptr<Slot[]>>	blocks_;
+	Slot*							free_list_;
+	unsigned						last_block_used_;
+	Stats							stats_;
+
+	Slot* acquireSlot()
+	{
+		// Reuse a released slot if possible
+		if (free_list_)
+		{
+			Slot* slot = free_list_;
+			free_list_ = slot->next_free;
+			stats_.reused++;
+			return slot;
+		}
+
+		// Otherwise take the next slot in the last block, allocating a new
+		// block if it is full
+		if (last_block_used_ >= BlockSize)
+		{
+			blocks_.emplace_back(new Slot[BlockSize]);
+			last_block_used_ = 0;
+			stats_.blocks++;
+		}
+
+		return &blocks_.back()[last_block_used_++];
+	}
+};
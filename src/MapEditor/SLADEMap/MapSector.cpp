@@ -40,6 +40,17 @@
 // Number of radians in the unit circle
 const double TAU = M_PI * 2;
 
+// Atoms for properties read when getting sector lighting
+namespace
+{
+	const MobjPropertyList::Atom atom_lightfloor = MobjPropertyList::atom("lightfloor");
+	const MobjPropertyList::Atom atom_lightfloorabsolute = MobjPropertyList::atom("lightfloorabsolute");
+	const MobjPropertyList::Atom atom_lightceiling = MobjPropertyList::atom("lightceiling");
+	const MobjPropertyList::Atom atom_lightceilingabsolute = MobjPropertyList::atom("lightceilingabsolute");
+	const MobjPropertyList::Atom atom_lightcolor = MobjPropertyList::atom("lightcolor");
+	const MobjPropertyList::Atom atom_fadecolor = MobjPropertyList::atom("fadecolor");
+}
+
 
 /*******************************************************************
  * MAPSECTOR CLASS FUNCTIONS
@@ -56,6 +67,8 @@ MapSector::MapSector(SLADEMap* parent) : MapObject(MOBJ_SECTOR, parent)
 	plane_floor.set(0, 0, 1, 0);
 	plane_ceiling.set(0, 0, 1, 0);
 	poly_needsupdate = true;
+	text_point_valid = false;
+	edges_hash = 0;
 	setGeometryUpdated();
 }
 
@@ -72,6 +85,8 @@ MapSector::MapSector(string f_tex, string c_tex, SLADEMap* parent) : MapObject(M
 	plane_floor.set(0, 0, 1, 0);
 	plane_ceiling.set(0, 0, 1, 0);
 	poly_needsupdate = true;
+	text_point_valid = false;
+	edges_hash = 0;
 	setGeometryUpdated();
 }
 
@@ -227,7 +242,11 @@ void MapSector::setIntProperty(const string& key, int value)
 	else if (key == "special")
 		special = value;
 	else if (key == "id")
+	{
 		tag = value;
+		if (parent_map)
+			parent_map->objectTagsChanged(this);
+	}
 	else
 		MapObject::setIntProperty(key, value);
 }
@@ -261,7 +280,10 @@ fpoint2_t MapSector::getPoint(uint8_t point)
 	}
 	else
 	{
-		if (text_point.x == 0 && text_point.y == 0 && parent_map)
+		// Make sure the bbox is up to date first (this detects any changes
+		// that invalidate the text point)
+		boundingBox();
+		if (!text_point_valid && parent_map)
 			parent_map->findSectorTextPoint(this);
 		return text_point;
 	}
@@ -275,15 +297,41 @@ void MapSector::updateBBox()
 	// Reset bounding box
 	bbox.reset();
 
+	uint32_t hash = 2166136261u;
 	for (unsigned a = 0; a < connected_sides.size(); a++)
 	{
 		MapLine* line = connected_sides[a]->getParentLine();
 		if (!line) continue;
 		bbox.extend(line->v1()->xPos(), line->v1()->yPos());
 		bbox.extend(line->v2()->xPos(), line->v2()->yPos());
+
+		// Add edge (in the direction with the sector on the right) to hash
+		double coords[4];
+		if (line->s1() == connected_sides[a])
+		{
+			coords[0] = line->v1()->xPos();
+			coords[1] = line->v1()->yPos();
+			coords[2] = line->v2()->xPos();
+			coords[3] = line->v2()->yPos();
+		}
+		else
+		{
+			coords[0] = line->v2()->xPos();
+			coords[1] = line->v2()->yPos();
+			coords[2] = line->v1()->xPos();
+			coords[3] = line->v1()->yPos();
+		}
+		const uint8_t* bytes = (const uint8_t*)coords;
+		for (unsigned b = 0; b < sizeof(coords); b++)
+			hash = (hash ^ bytes[b]) * 16777619u;
 	}
 
-	text_point.set(0, 0);
+	// The text point only needs recalculating if the edges actually changed
+	if (hash != edges_hash)
+	{
+		text_point_valid = false;
+		edges_hash = hash;
+	}
 	setGeometryUpdated();
 }
 
@@ -292,8 +340,9 @@ void MapSector::updateBBox()
  *******************************************************************/
 bbox_t MapSector::boundingBox()
 {
-	// Update bbox if needed
-	if (!bbox.is_valid())
+	// Update bbox if needed (using the bbox precomputed on map load if
+	// possible)
+	if (!bbox.is_valid() && (!parent_map || !parent_map->sectorGeometry().getBBox(this, bbox)))
 		updateBBox();
 
 	return bbox;
@@ -306,7 +355,9 @@ Polygon2D* MapSector::getPolygon()
 {
 	if (poly_needsupdate)
 	{
-		polygon.openSector(this);
+		// Use the polygon precomputed on map load if possible
+		if (!parent_map || !parent_map->sectorGeometry().takePolygon(this, polygon))
+			polygon.openSector(this);
 		poly_needsupdate = false;
 	}
 
@@ -477,8 +528,8 @@ uint8_t MapSector::getLight(int where)
 		if (where == 1)
 		{
 			// Floor
-			int fl = intProperty("lightfloor");
-			if (boolProperty("lightfloorabsolute"))
+			int fl = intProp(atom_lightfloor);
+			if (boolProp(atom_lightfloorabsolute))
 				l = fl;
 			else
 				l += fl;
@@ -486,8 +537,8 @@ uint8_t MapSector::getLight(int where)
 		else if (where == 2)
 		{
 			// Ceiling
-			int cl = intProperty("lightceiling");
-			if (boolProperty("lightceilingabsolute"))
+			int cl = intProp(atom_lightceiling);
+			if (boolProp(atom_lightceilingabsolute))
 				l = cl;
 			else
 				l += cl;
@@ -535,12 +586,12 @@ void MapSector::changeLight(int amount, int where)
 	// Change light level by amount
 	if (where == 1 && separate)
 	{
-		int cur = intProperty("lightfloor");
+		int cur = intProp(atom_lightfloor);
 		setIntProperty("lightfloor", cur + amount);
 	}
 	else if (where == 2 && separate)
 	{
-		int cur = intProperty("lightceiling");
+		int cur = intProp(atom_lightceiling);
 		setIntProperty("lightceiling", cur + amount);
 	}
 	else
@@ -592,7 +643,7 @@ rgba_t MapSector::getColour(int where, bool fullbright)
 		wxColour wxcol;
 		if(Game::configuration().featureSupported(UDMFFeature::SectorColor))
 		{
-			int intcol = MapObject::intProperty("lightcolor");
+			int intcol = intProp(atom_lightcolor);
 			wxcol = wxColour(intcol);
 		}
 		else
@@ -612,8 +663,8 @@ rgba_t MapSector::getColour(int where, bool fullbright)
 			if(where == 1)
 			{
 				// Floor
-				int fl = MapObject::intProperty("lightfloor");
-				if(boolProperty("lightfloorabsolute"))
+				int fl = intProp(atom_lightfloor);
+				if(boolProp(atom_lightfloorabsolute))
 					ll = fl;
 				else
 					ll += fl;
@@ -621,8 +672,8 @@ rgba_t MapSector::getColour(int where, bool fullbright)
 			else if(where == 2)
 			{
 				// Ceiling
-				int cl = MapObject::intProperty("lightceiling");
-				if(boolProperty("lightceilingabsolute"))
+				int cl = intProp(atom_lightceiling);
+				if(boolProp(atom_lightceilingabsolute))
 					ll = cl;
 				else
 					ll += cl;
@@ -675,7 +726,7 @@ rgba_t MapSector::getFogColour()
 	if (parent_map->currentFormat() == MAP_UDMF &&
 		Game::configuration().featureSupported(Game::UDMFFeature::SectorFog))
 	{
-		int intcol = MapObject::intProperty("fadecolor");
+		int intcol = intProp(atom_fadecolor);
 
 		wxColour wxcol(intcol);
 		color = rgba_t(wxcol.Blue(), wxcol.Green(), wxcol.Red(), 0);
@@ -59,6 +59,8 @@ private:
 	bool				poly_needsupdate;
 	long				geometry_updated;
 	fpoint2_t			text_point;
+	bool				text_point_valid;
+	uint32_t			edges_hash;		// Hash of the sector's edges, to detect actual geometry changes
 	plane_t				plane_floor;
 	plane_t				plane_ceiling;
 
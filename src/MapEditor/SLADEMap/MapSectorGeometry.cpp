@@ -0,0 +1,423 @@
+// ----------------------------------------------------------------------------
+// SLADE - It's a Doom Editor
+// Copyright(C) 2008 - 2017 Simon Judd
+//
+// Email:       sirjuddington@gmail.com
+// Web:         http://slade.mancubus.net
+// Filename:    MapSectorGeometry.cpp
+// Description: MapSectorGeometry class - precomputes sector polygons,
+//              bounding boxes and text points on worker threads
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301, USA.
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+//
+// Includes
+//
+// ----------------------------------------------------------------------------
+#include "Main.h"
+#include "MapSectorGeometry.h"
+#include "MapLine.h"
+#include "MapSector.h"
+#include "MapSide.h"
+#include "MapVertex.h"
+#include "Utility/MathStuff.h"
+#include "Utility/PolygonTriangulator.h"
+#include "Utility/ThreadPool.h"
+#include <queue>
+
+
+// ----------------------------------------------------------------------------
+//
+// Variables
+//
+// ----------------------------------------------------------------------------
+CVAR(Bool, map_precompute_sectors, true, CVAR_SAVE)
+namespace
+{
+	// Limit on cells checked when finding a text point (only reached with
+	// huge or badly formed sectors)
+	const unsigned text_point_max_cells = 5000;
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// MapSectorGeometry Class Functions
+//
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+// MapSectorGeometry::start
+//
+// Takes a snapshot of the edges of all [sectors] and starts computing their
+// geometry on the thread pool. Any previous results are discarded. Returns
+// false if precomputing is disabled
+// ----------------------------------------------------------------------------
+bool MapSectorGeometry::start(const vector<MapSector*>& sectors)
+{
+	clear();
+	if (!map_precompute_sectors)
+		return false;
+	if (sectors.empty())
+		return true;
+
+	// Snapshot sector edges
+	auto batch = std::make_shared<batch_t>();
+	batch->results.reset(new result_t[sectors.size()]);
+	for (unsigned a = 0; a < sectors.size(); a++)
+	{
+		getEdges(sectors[a], batch->results[a].edges);
+
+		unsigned id = sectors[a]->getId();
+		if (id >= sector_results_.size())
+			sector_results_.resize(id + 1, -1);
+		sector_results_[id] = a;
+	}
+
+	// Split into a few tasks per thread, so sectors finish (and can be picked
+	// up) progressively
+	unsigned n_sectors = sectors.size();
+	unsigned n_tasks = MIN(n_sectors, ThreadPool::nThreads() * 4);
+	batch->pending = n_sectors;
+	batch_ = batch;
+	for (unsigned t = 0; t < n_tasks; t++)
+	{
+		unsigned first = (unsigned)((uint64_t)n_sectors * t / n_tasks);
+		unsigned last = (unsigned)((uint64_t)n_sectors * (t + 1) / n_tasks);
+		ThreadPool::run([batch, first, last]()
+		{
+			for (unsigned a = first; a < last; a++)
+			{
+				if (!batch->cancelled)
+					compute(batch->results[a]);
+
+				batch->results[a].done.store(true, std::memory_order_release);
+				batch->pending--;
+			}
+		});
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// MapSectorGeometry::clear
+//
+// Discards all results (any tasks still running are cancelled)
+// ----------------------------------------------------------------------------
+void MapSectorGeometry::clear()
+{
+	if (batch_)
+		batch_->cancelled = true;
+	batch_.reset();
+	sector_results_.clear();
+}
+
+// ----------------------------------------------------------------------------
+// MapSectorGeometry::nPending
+//
+// Returns the number of sectors still being computed
+// ----------------------------------------------------------------------------
+unsigned MapSectorGeometry::nPending() const
+{
+	return batch_ ? batch_->pending.load() : 0;
+}
+
+// ----------------------------------------------------------------------------
+// MapSectorGeometry::takePolygon
+//
+// Sets [polygon] to the precomputed triangles for [sector]. Returns false if
+// they aren't available (the polygon should be built directly instead). The
+// triangles can only be taken once
+// ----------------------------------------------------------------------------
+bool MapSectorGeometry::takePolygon(MapSector* sector, Polygon2D& polygon)
+{
+	result_t* res = result(sector);
+	if (!res || res->polygon_taken || res->triangles.empty())
+		return false;
+
+	polygon.setTriangles(res->triangles);
+	res->polygon_taken = true;
+	vector<fpoint2_t>().swap(res->triangles);
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// MapSectorGeometry::getBBox
+//
+// Sets [bbox] to the precomputed bounding box for [sector]. Returns false if
+// it isn't available
+// ----------------------------------------------------------------------------
+bool MapSectorGeometry::getBBox(MapSector* sector, bbox_t& bbox)
+{
+	result_t* res = result(sector);
+	if (!res)
+		return false;
+
+	bbox = res->bbox;
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// MapSectorGeometry::getTextPoint
+//
+// Sets [point] to the precomputed text point for [sector]. Returns false if
+// it isn't available
+// ----------------------------------------------------------------------------
+bool MapSectorGeometry::getTextPoint(MapSector* sector, fpoint2_t& point)
+{
+	result_t* res = result(sector);
+	if (!res)
+		return false;
+
+	point = res->text_point;
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// MapSectorGeometry::result
+//
+// Returns the finished result for [sector], or nullptr if it isn't done or
+// the sector's edges no longer match the snapshot
+// ----------------------------------------------------------------------------
+MapSectorGeometry::result_t* MapSectorGeometry::result(MapSector* sector)
+{
+	if (!batch_ || !sector || sector->getId() >= sector_results_.size())
+		return nullptr;
+
+	int index = sector_results_[sector->getId()];
+	if (index < 0)
+		return nullptr;
+
+	result_t& res = batch_->results[index];
+	if (res.stale || !res.done.load(std::memory_order_acquire))
+		return nullptr;
+
+	// Check the sector hasn't changed since the snapshot
+	vector<edge_t> edges;
+	getEdges(sector, edges);
+	if (edges != res.edges)
+	{
+		res.stale = true;
+		vector<fpoint2_t>().swap(res.triangles);
+		return nullptr;
+	}
+
+	return &res;
+}
+
+// ----------------------------------------------------------------------------
+// MapSectorGeometry::compute
+//
+// Computes the geometry for [result] from its edges (runs on a worker
+// thread)
+// ----------------------------------------------------------------------------
+void MapSectorGeometry::compute(result_t& result)
+{
+	// Polygon
+	PolygonTriangulator triangulator;
+	for (auto& edge : result.edges)
+		triangulator.addEdge(edge.p1.x, edge.p1.y, edge.p2.x, edge.p2.y);
+	if (triangulator.triangulate())
+	{
+		auto& vertices = triangulator.vertices();
+		auto& indices = triangulator.triangles();
+		result.triangles.resize(indices.size());
+		for (unsigned a = 0; a < indices.size(); a++)
+			result.triangles[a] = vertices[indices[a]];
+	}
+
+	// Bounding box and text point
+	result.bbox = edgesBBox(result.edges);
+	result.text_point = findTextPoint(result.edges, result.bbox);
+}
+
+// ----------------------------------------------------------------------------
+// MapSectorGeometry::getEdges
+//
+// Adds an edge to [edges] for each side of [sector], directed so the sector
+// is on the right
+// ----------------------------------------------------------------------------
+void MapSectorGeometry::getEdges(MapSector* sector, vector<edge_t>& edges)
+{
+	edges.clear();
+	for (auto side : sector->connectedSides())
+	{
+		MapLine* line = side->getParentLine();
+		if (!line)
+			continue;
+
+		if (line->s1() == side)
+			edges.push_back({ line->v1()->point(), line->v2()->point() });
+		else
+			edges.push_back({ line->v2()->point(), line->v1()->point() });
+	}
+}
+
+// ----------------------------------------------------------------------------
+// MapSectorGeometry::edgesBBox
+//
+// Returns the bounding box of [edges]
+// ----------------------------------------------------------------------------
+bbox_t MapSectorGeometry::edgesBBox(const vector<edge_t>& edges)
+{
+	bbox_t bbox;
+	for (auto& edge : edges)
+	{
+		bbox.extend(edge.p1.x, edge.p1.y);
+		bbox.extend(edge.p2.x, edge.p2.y);
+	}
+	return bbox;
+}
+
+// ----------------------------------------------------------------------------
+// MapSectorGeometry::pointWithin
+//
+// Returns true if [point] is within the area enclosed by [edges]. Sector
+// edges run clockwise, so the winding number inside is negative, but any
+// nonzero winding counts
+// ----------------------------------------------------------------------------
+bool MapSectorGeometry::pointWithin(const vector<edge_t>& edges, fpoint2_t point)
+{
+	int winding = 0;
+	for (auto& edge : edges)
+	{
+		double side = (edge.p2.x - edge.p1.x) * (point.y - edge.p1.y) - (point.x - edge.p1.x) * (edge.p2.y - edge.p1.y);
+		if (edge.p1.y <= point.y)
+		{
+			if (edge.p2.y > point.y && side > 0)
+				winding++;
+		}
+		else if (edge.p2.y <= point.y && side < 0)
+			winding--;
+	}
+
+	return winding != 0;
+}
+
+// ----------------------------------------------------------------------------
+// MapSectorGeometry::signedDistance
+//
+// Returns the distance from [point] to the nearest of [edges], negative if
+// [point] is outside the area they enclose
+// ----------------------------------------------------------------------------
+double MapSectorGeometry::signedDistance(const vector<edge_t>& edges, fpoint2_t point)
+{
+	double min_dist = -1;
+	for (auto& edge : edges)
+	{
+		double dist = MathStuff::distanceToLineFast(point, fseg2_t(edge.p1, edge.p2));
+		if (min_dist < 0 || dist < min_dist)
+			min_dist = dist;
+	}
+
+	min_dist = sqrt(MAX(0.0, min_dist));
+	return pointWithin(edges, point) ? min_dist : -min_dist;
+}
+
+// ----------------------------------------------------------------------------
+// MapSectorGeometry::findTextPoint
+//
+// Finds the point within the area enclosed by [edges] (with bounding box
+// [bbox]) that is furthest from any edge (the 'pole of inaccessibility'),
+// which is where a label fits best. The bbox is covered with square cells
+// that are recursively split, in order of the best distance each cell could
+// possibly contain - cells that can't beat the best point found so far by
+// more than the required precision are dropped
+// ----------------------------------------------------------------------------
+fpoint2_t MapSectorGeometry::findTextPoint(const vector<edge_t>& edges, bbox_t bbox)
+{
+	fpoint2_t mid = bbox.mid();
+	double width = bbox.width();
+	double height = bbox.height();
+	double cell_size = MIN(width, height);
+	if (edges.empty() || cell_size <= 0)
+		return mid;
+
+	struct cell_t
+	{
+		fpoint2_t	centre;
+		double		half;	// Half the cell size
+		double		dist;	// Distance from the centre to the nearest edge
+		double		max;	// Max distance possible within the cell
+
+		cell_t(const vector<edge_t>& edges, fpoint2_t centre, double half) :
+			centre{ centre },
+			half{ half },
+			dist{ signedDistance(edges, centre) },
+			max{ dist + half * 1.4142135623730951 } {}
+
+		bool operator<(const cell_t& other) const { return max < other.max; }
+	};
+
+	// Start with the bbox centre, and the area centroid if it is inside
+	cell_t best(edges, mid, 0);
+	double area = 0;
+	double cx = 0;
+	double cy = 0;
+	for (auto& edge : edges)
+	{
+		double f = edge.p1.x * edge.p2.y - edge.p2.x * edge.p1.y;
+		cx += (edge.p1.x + edge.p2.x) * f;
+		cy += (edge.p1.y + edge.p2.y) * f;
+		area += f * 3;
+	}
+	if (area != 0)
+	{
+		cell_t centroid(edges, fpoint2_t(cx / area, cy / area), 0);
+		if (centroid.dist > best.dist)
+			best = centroid;
+	}
+
+	// Cover the bbox with cells. For long thin areas, the cells are made
+	// larger to keep the initial grid at most 64 cells along its long side
+	// (the cells are split later anyway)
+	double precision = MAX(1.0, cell_size * 0.01);
+	cell_size = MAX(cell_size, MAX(width, height) / 64);
+	std::priority_queue<cell_t> cells;
+	double half = cell_size * 0.5;
+	for (double x = bbox.min.x; x < bbox.max.x; x += cell_size)
+		for (double y = bbox.min.y; y < bbox.max.y; y += cell_size)
+			cells.push(cell_t(edges, fpoint2_t(x + half, y + half), half));
+
+	// Split cells until no better point can be found (to within [precision]
+	// map units)
+	unsigned n_cells = 0;
+	while (!cells.empty() && n_cells < text_point_max_cells)
+	{
+		cell_t cell = cells.top();
+		cells.pop();
+		n_cells++;
+
+		if (cell.dist > best.dist)
+			best = cell;
+
+		if (cell.max - best.dist <= precision)
+			continue;
+
+		half = cell.half * 0.5;
+		cells.push(cell_t(edges, fpoint2_t(cell.centre.x - half, cell.centre.y - half), half));
+		cells.push(cell_t(edges, fpoint2_t(cell.centre.x + half, cell.centre.y - half), half));
+		cells.push(cell_t(edges, fpoint2_t(cell.centre.x - half, cell.centre.y + half), half));
+		cells.push(cell_t(edges, fpoint2_t(cell.centre.x + half, cell.centre.y + half), half));
+	}
+
+	return best.centre;
+}
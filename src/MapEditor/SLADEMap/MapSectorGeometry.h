@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+
+class MapSector;
+class Polygon2D;
+
+// Computes sector polygons, bounding boxes and text points for a whole map on
+// worker threads. start() takes a snapshot of each sector's edges (so the
+// workers never touch the map itself) and returns immediately. Sectors pick
+// up their results as they need them via the take/get functions, which
+// return false if the result isn't ready yet or the sector has changed since
+// the snapshot - the caller then falls back to computing it directly
+class MapSectorGeometry
+{
+public:
+	// A sector edge, with the sector on the right
+	struct edge_t
+	{
+		fpoint2_t	p1;
+		fpoint2_t	p2;
+
+		bool operator==(const edge_t& other) const
+		{
+			return p1.x == other.p1.x && p1.y == other.p1.y && p2.x == other.p2.x && p2.y == other.p2.y;
+		}
+	};
+
+	MapSectorGeometry() {}
+	~MapSectorGeometry() { clear(); }
+
+	bool		start(const vector<MapSector*>& sectors);
+	void		clear();
+	unsigned	nPending() const;
+
+	bool	takePolygon(MapSector* sector, Polygon2D& polygon);
+	bool	getBBox(MapSector* sector, bbox_t& bbox);
+	bool	getTextPoint(MapSector* sector, fpoint2_t& point);
+
+	// Geometry calculations (shared with the non-precomputed path)
+	static void			getEdges(MapSector* sector, vector<edge_t>& edges);
+	static bbox_t		edgesBBox(const vector<edge_t>& edges);
+	static bool			pointWithin(const vector<edge_t>& edges, fpoint2_t point);
+	static double		signedDistance(const vector<edge_t>& edges, fpoint2_t point);
+	static fpoint2_t	findTextPoint(const vector<edge_t>& edges, bbox_t bbox);
+
+private:
+	struct result_t
+	{
+		std::atomic<bool>	done;
+		bool				stale;		// Sector changed since the snapshot (main thread only)
+		bool				polygon_taken;
+		vector<edge_t>		edges;
+		vector<fpoint2_t>	triangles;	// 3 vertices per triangle
+		bbox_t				bbox;
+		fpoint2_t			text_point;
+
+		result_t() : done{ false }, stale{ false }, polygon_taken{ false } {}
+	};
+
+	// Shared with the worker tasks, so it stays valid if the map is closed
+	// before they finish
+	struct batch_t
+	{
+		std::atomic<bool>			cancelled;
+		std::atomic<unsigned>		pending;
+		std::unique_ptr<result_t[]>	results;
+
+		batch_t() : cancelled{ false }, pending{ 0 } {}
+	};
+
+	std::shared_ptr<batch_t>	batch_;
+	vector<int>					sector_results_;	// Indexed by sector object id
+
+	result_t*	result(MapSector* sector);
+	static void	compute(result_t& result);
+};
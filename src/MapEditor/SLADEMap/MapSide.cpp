@@ -34,6 +34,17 @@
 #include "SLADEMap.h"
 
 
+/*******************************************************************
+ * VARIABLES
+ *******************************************************************/
+namespace
+{
+	// Atoms for properties read when getting side lighting
+	const MobjPropertyList::Atom atom_light = MobjPropertyList::atom("light");
+	const MobjPropertyList::Atom atom_lightabsolute = MobjPropertyList::atom("lightabsolute");
+}
+
+
 /*******************************************************************
  * MAPSIDE CLASS FUNCTIONS
  *******************************************************************/
@@ -118,8 +129,8 @@ uint8_t MapSide::getLight()
 	if (parent_map->currentFormat() == MAP_UDMF &&
 		Game::configuration().featureSupported(Game::UDMFFeature::SideLighting))
 	{
-		light += intProperty("light");
-		if (boolProperty("lightabsolute"))
+		light += intProp(atom_light);
+		if (boolProp(atom_lightabsolute))
 			include_sector = false;
 	}
 
@@ -141,7 +152,7 @@ void MapSide::changeLight(int amount)
 {
 	if (parent_map->currentFormat() == MAP_UDMF &&
 		Game::configuration().featureSupported(Game::UDMFFeature::SideLighting))
-		setIntProperty("light", intProperty("light") + amount);
+		setIntProperty("light", intProp(atom_light) + amount);
 }
 
 /* MapSide::setSector
@@ -0,0 +1,274 @@
+// ----------------------------------------------------------------------------
+// SLADE - It's a Doom Editor
+// Copyright(C) 2008 - 2017 Simon Judd
+//
+// Email:       sirjuddington@gmail.com
+// Web:         http://slade.mancubus.net
+// Filename:    MapTagIndex.cpp
+// Description: MapTagIndex class - reverse indexes from sector tags, line
+//              ids, thing ids and special args to the objects using them.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301, USA.
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+//
+// Includes
+//
+// ----------------------------------------------------------------------------
+#include "Main.h"
+#include "MapTagIndex.h"
+#include "MapLine.h"
+#include "MapSector.h"
+#include "MapThing.h"
+
+
+// ----------------------------------------------------------------------------
+//
+// Variables
+//
+// ----------------------------------------------------------------------------
+namespace
+{
+	const vector<unsigned> no_objects;
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// MapTagIndex Class Functions
+//
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+// MapTagIndex::clear
+//
+// Clears all indexes (the index will need to be rebuilt before use)
+// ----------------------------------------------------------------------------
+void MapTagIndex::clear()
+{
+	for (unsigned a = 0; a < NumIndexes; a++)
+		indexes_[a].clear();
+	entries_.clear();
+	valid_ = false;
+}
+
+// ----------------------------------------------------------------------------
+// MapTagIndex::rebuild
+//
+// Rebuilds all indexes from [sectors], [lines] and [things]
+// ----------------------------------------------------------------------------
+void MapTagIndex::rebuild(
+	const vector<MapSector*>& sectors,
+	const vector<MapLine*>& lines,
+	const vector<MapThing*>& things)
+{
+	for (unsigned a = 0; a < NumIndexes; a++)
+		indexes_[a].clear();
+	entries_.clear();
+
+	for (auto sector : sectors)
+		addEntry(sector);
+	for (auto line : lines)
+		addEntry(line);
+	for (auto thing : things)
+		addEntry(thing);
+
+	valid_ = true;
+}
+
+// ----------------------------------------------------------------------------
+// MapTagIndex::update
+//
+// Updates the indexed values for [object], if any of them have changed
+// ----------------------------------------------------------------------------
+void MapTagIndex::update(MapObject* object)
+{
+	if (!valid_)
+		return;
+
+	uint8_t type = object->getObjType();
+	if (type != MOBJ_SECTOR && type != MOBJ_LINE && type != MOBJ_THING)
+		return;
+
+	// Check if anything changed
+	unsigned id = object->getId();
+	if (id >= entries_.size())
+		entries_.resize(id + 1);
+	Entry& old = entries_[id];
+	Entry current;
+	readValues(object, current);
+	if (old.indexed &&
+		old.id == current.id &&
+		old.n_args == current.n_args &&
+		std::equal(old.args, old.args + old.n_args, current.args))
+		return;
+
+	// Remove old values
+	Index index_id = (type == MOBJ_SECTOR) ? SectorTags : (type == MOBJ_LINE) ? LineIds : ThingIds;
+	Index index_args = (type == MOBJ_LINE) ? LineArgs : ThingArgs;
+	if (old.indexed)
+	{
+		remove(index_id, old.id, id);
+		for (unsigned a = 0; a < old.n_args; a++)
+			remove(index_args, old.args[a], id);
+	}
+
+	// Add current values
+	add(index_id, current.id, id);
+	for (unsigned a = 0; a < current.n_args; a++)
+		add(index_args, current.args[a], id);
+	entries_[id] = current;
+}
+
+// ----------------------------------------------------------------------------
+// MapTagIndex::objects
+//
+// Returns the ids of all objects indexed under [value] in [index]. This can
+// include objects that have since been removed from the map
+// ----------------------------------------------------------------------------
+const vector<unsigned>& MapTagIndex::objects(Index index, int value) const
+{
+	auto i = indexes_[index].find(value);
+	if (i == indexes_[index].end())
+		return no_objects;
+
+	return i->second;
+}
+
+// ----------------------------------------------------------------------------
+// MapTagIndex::add
+//
+// Adds [object] to [index] under [value] (0 values aren't indexed)
+// ----------------------------------------------------------------------------
+void MapTagIndex::add(Index index, int value, unsigned object)
+{
+	if (value != 0)
+		indexes_[index][value].push_back(object);
+}
+
+// ----------------------------------------------------------------------------
+// MapTagIndex::remove
+//
+// Removes [object] from [index] under [value]
+// ----------------------------------------------------------------------------
+void MapTagIndex::remove(Index index, int value, unsigned object)
+{
+	if (value == 0)
+		return;
+
+	auto i = indexes_[index].find(value);
+	if (i == indexes_[index].end())
+		return;
+
+	auto& list = i->second;
+	for (unsigned a = 0; a < list.size(); a++)
+	{
+		if (list[a] == object)
+		{
+			list[a] = list.back();
+			list.pop_back();
+			break;
+		}
+	}
+
+	if (list.empty())
+		indexes_[index].erase(i);
+}
+
+// ----------------------------------------------------------------------------
+// MapTagIndex::readValues
+//
+// Reads the values [object] should be indexed under into [entry]
+// ----------------------------------------------------------------------------
+void MapTagIndex::readValues(MapObject* object, Entry& entry)
+{
+	static const MobjPropertyList::Atom atom_id = MobjPropertyList::atom("id");
+	static const MobjPropertyList::Atom atom_args[5] =
+	{
+		MobjPropertyList::atom("arg0"),
+		MobjPropertyList::atom("arg1"),
+		MobjPropertyList::atom("arg2"),
+		MobjPropertyList::atom("arg3"),
+		MobjPropertyList::atom("arg4")
+	};
+
+	entry.indexed = true;
+	entry.n_args = 0;
+
+	// Sector tag
+	uint8_t type = object->getObjType();
+	if (type == MOBJ_SECTOR)
+	{
+		entry.id = ((MapSector*)object)->getTag();
+		return;
+	}
+
+	// Line/thing id
+	auto& props = object->props();
+	if (type == MOBJ_LINE)
+		entry.id = ((MapLine*)object)->getLineId();
+	else
+	{
+		const Property* id = props.get(atom_id);
+		entry.id = (id && id->hasValue()) ? id->getIntValue() : 0;
+	}
+
+	// Args (negative arg0 is also indexed as positive, for
+	// TagType::LineNegative)
+	int args[6];
+	unsigned n_args = 0;
+	for (unsigned a = 0; a < 5; a++)
+	{
+		const Property* arg = props.get(atom_args[a]);
+		if (arg && arg->hasValue())
+			args[n_args++] = arg->getIntValue();
+	}
+	const Property* arg0 = props.get(atom_args[0]);
+	if (arg0 && arg0->hasValue() && arg0->getIntValue() < 0)
+		args[n_args++] = -arg0->getIntValue();
+
+	// Add unique non-zero values
+	for (unsigned a = 0; a < n_args; a++)
+	{
+		if (args[a] == 0 || std::find(entry.args, entry.args + entry.n_args, args[a]) != entry.args + entry.n_args)
+			continue;
+		entry.args[entry.n_args++] = args[a];
+	}
+}
+
+// ----------------------------------------------------------------------------
+// MapTagIndex::addEntry
+//
+// Reads and indexes the values for [object] (used when rebuilding)
+// ----------------------------------------------------------------------------
+void MapTagIndex::addEntry(MapObject* object)
+{
+	unsigned id = object->getId();
+	if (id >= entries_.size())
+		entries_.resize(id + 1);
+
+	Entry& entry = entries_[id];
+	readValues(object, entry);
+
+	uint8_t type = object->getObjType();
+	Index index_id = (type == MOBJ_SECTOR) ? SectorTags : (type == MOBJ_LINE) ? LineIds : ThingIds;
+	Index index_args = (type == MOBJ_LINE) ? LineArgs : ThingArgs;
+	add(index_id, entry.id, id);
+	for (unsigned a = 0; a < entry.n_args; a++)
+		add(index_args, entry.args[a], id);
+}
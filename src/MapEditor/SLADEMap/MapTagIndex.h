@@ -0,0 +1,65 @@
+#pragma once
+
+#include <unordered_map>
+
+class MapObject;
+class MapSector;
+class MapLine;
+class MapThing;
+
+// Reverse indexes from tag/id/arg values to the map objects that use them,
+// so tag lookups don't need to scan every sector, line or thing. Objects are
+// referenced by their map object id (MapObject::getId), and stay in the index
+// when removed from the map (they may come back via undo), so results must
+// be checked against the map. SLADEMap keeps it in sync via update()
+class MapTagIndex
+{
+public:
+	enum Index
+	{
+		SectorTags,	// Sector tag
+		LineIds,	// Line id
+		LineArgs,	// Line args (and abs(arg0))
+		ThingIds,	// Thing TID
+		ThingArgs,	// Thing args (and abs(arg0))
+
+		NumIndexes
+	};
+
+	MapTagIndex() : valid_{ false } {}
+
+	bool	isValid() const { return valid_; }
+	void	invalidate() { valid_ = false; }
+	void	clear();
+	void	rebuild(
+				const vector<MapSector*>& sectors,
+				const vector<MapLine*>& lines,
+				const vector<MapThing*>& things
+			);
+	void	update(MapObject* object);
+
+	const vector<unsigned>&	objects(Index index, int value) const;
+
+private:
+	typedef std::unordered_map<int, vector<unsigned>> ValueMap;
+
+	// The values an object is currently indexed under
+	struct Entry
+	{
+		bool	indexed;
+		int		id;
+		int		args[6];
+		uint8_t	n_args;
+
+		Entry() : indexed{ false }, id{ 0 }, n_args{ 0 } {}
+	};
+
+	bool			valid_;
+	ValueMap		indexes_[NumIndexes];
+	vector<Entry>	entries_;	// Indexed by map object id
+
+	void	add(Index index, int value, unsigned object);
+	void	remove(Index index, int value, unsigned object);
+	void	readValues(MapObject* object, Entry& entry);
+	void	addEntry(MapObject* object);
+};
@@ -31,6 +31,7 @@
 #include "MapVertex.h"
 #include "MapLine.h"
 #include "App.h"
+#include "SLADEMap.h"
 
 
 /*******************************************************************
@@ -130,6 +131,9 @@ void MapVertex::setIntProperty(const string& key, int value)
 	}
 	else
 		return MapObject::setIntProperty(key, value);
+
+	if (parent_map)
+		parent_map->vertexGeometryChanged(this);
 }
 
 /* MapVertex::setFloatProperty
@@ -146,6 +150,9 @@ void MapVertex::setFloatProperty(const string& key, double value)
 		y = value;
 	else
 		return MapObject::setFloatProperty(key, value);
+
+	if (parent_map)
+		parent_map->vertexGeometryChanged(this);
 }
 
 /* MapVertex::scriptCanModifyProp
@@ -211,4 +218,7 @@ void MapVertex::readBackup(mobj_backup_t* backup)
 	// Position
 	x = backup->props_internal["x"].getFloatValue();
 	y = backup->props_internal["y"].getFloatValue();
+
+	if (parent_map)
+		parent_map->vertexGeometryChanged(this);
 }
@@ -6,7 +6,8 @@
  * Web:         http://slade.mancubus.net
  * Filename:    MobjPropertyList.cpp
  * Description: A special version of the PropertyList class that
- *              uses a vector rather than a map to store properties
+ *              uses a vector rather than a map to store properties,
+ *              keyed by interned property name 'atoms'
  *
  * This program is free software; you can redistribute it and/or
  * modify it under the terms of the GNU General Public License
@@ -30,6 +31,41 @@
 #include "Main.h"
 #include "MobjPropertyList.h"
 #include "Utility/StringUtils.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
+
+/*******************************************************************
+ * VARIABLES
+ *******************************************************************/
+namespace
+{
+	WX_DECLARE_STRING_HASH_MAP(MobjPropertyList::Atom, AtomMap);
+
+	const unsigned ATOM_BLOCK_SIZE = 1024;
+	const unsigned ATOM_MAX_BLOCKS = 1024;
+
+	// The atom table. Names are only ever appended, into fixed-size blocks
+	// that never move, and a name is complete before [count] is increased
+	// to include it. So atomName can read names without locking, and
+	// looking up existing names only needs a shared lock
+	struct AtomTable
+	{
+		AtomMap						atoms;
+		std::unique_ptr<string[]>	blocks[ATOM_MAX_BLOCKS];
+		std::atomic<unsigned>		count{ 0 };
+		std::shared_timed_mutex		mutex;
+	};
+
+	AtomTable& atomTable()
+	{
+		static AtomTable table;
+		return table;
+	}
+}
+const MobjPropertyList::Atom MobjPropertyList::NO_ATOM;
 
 
 /*******************************************************************
@@ -50,31 +86,19 @@ MobjPropertyList::~MobjPropertyList()
 {
 }
 
-/* MobjPropertyList::propertyExists
- * Returns true if a property with the given name exists, false
- * otherwise
- *******************************************************************/
-bool MobjPropertyList::propertyExists(string key)
-{
-	for (unsigned a = 0; a < properties.size(); ++a)
-	{
-		if (properties[a].name == key)
-			return true;
-	}
-
-	return false;
-}
-
 /* MobjPropertyList::removeProperty
  * Removes a property value, returns true if [key] was removed
  * or false if key didn't exist
  *******************************************************************/
-bool MobjPropertyList::removeProperty(string key)
+bool MobjPropertyList::removeProperty(const string& key)
 {
-	//return properties.erase(key) > 0;
+	Atom key_atom = findAtom(key);
+	if (key_atom == NO_ATOM)
+		return false;
+
 	for (unsigned a = 0; a < properties.size(); ++a)
 	{
-		if (properties[a].name == key)
+		if (properties[a].key == key_atom)
 		{
 			properties[a] = properties.back();
 			properties.pop_back();
@@ -90,20 +114,15 @@ bool MobjPropertyList::removeProperty(string key)
  *******************************************************************/
 void MobjPropertyList::copyTo(MobjPropertyList& list)
 {
-	// Clear given list
-	list.clear();
-
-	for (unsigned a = 0; a < properties.size(); ++a)
-		list.properties.push_back(prop_t(properties[a].name, properties[a].value));
+	list.properties = properties;
 }
 
 /* MobjPropertyList::addFlag
  * Adds a 'flag' property [key]
  *******************************************************************/
-void MobjPropertyList::addFlag(string key)
+void MobjPropertyList::addFlag(const string& key)
 {
-	Property flag;
-	properties.push_back(prop_t(key, flag));
+	properties.push_back(prop_t(atom(key)));
 }
 
 /* MobjPropertyList::toString
@@ -121,7 +140,7 @@ string MobjPropertyList::toString(bool condensed)
 			continue;
 
 		// Add "key = value;\n" to the return string
-		string key = properties[a].name;
+		const string& key = properties[a].name();
 		string val = properties[a].value.getStringValue();
 
 		if (properties[a].value.getType() == PROP_STRING)
@@ -138,3 +157,75 @@ string MobjPropertyList::toString(bool condensed)
 
 	return ret;
 }
+
+/* MobjPropertyList::atom (static)
+ * Returns the atom for property name [name], adding it to the atom
+ * table if it doesn't exist yet (returns NO_ATOM if the table is
+ * full, which shouldn't ever happen)
+ *******************************************************************/
+MobjPropertyList::Atom MobjPropertyList::atom(const string& name)
+{
+	// Check for an existing atom first
+	Atom atom = findAtom(name);
+	if (atom != NO_ATOM)
+		return atom;
+
+	AtomTable& table = atomTable();
+	std::unique_lock<std::shared_timed_mutex> lock(table.mutex);
+
+	// Check again, it may have been added since
+	AtomMap::iterator i = table.atoms.find(name);
+	if (i != table.atoms.end())
+		return i->second;
+
+	// Add name
+	atom = table.count.load(std::memory_order_relaxed);
+	unsigned block = atom / ATOM_BLOCK_SIZE;
+	if (block >= ATOM_MAX_BLOCKS)
+		return NO_ATOM;
+	if (!table.blocks[block])
+		table.blocks[block].reset(new string[ATOM_BLOCK_SIZE]);
+	table.blocks[block][atom % ATOM_BLOCK_SIZE] = name;
+	table.atoms[name] = atom;
+	table.count.store(atom + 1, std::memory_order_release);
+
+	return atom;
+}
+
+/* MobjPropertyList::findAtom (static)
+ * Returns the atom for property name [name], or NO_ATOM if it isn't
+ * in the atom table. Unlike atom(), never adds anything to the table
+ *******************************************************************/
+MobjPropertyList::Atom MobjPropertyList::findAtom(const string& name)
+{
+	AtomTable& table = atomTable();
+	std::shared_lock<std::shared_timed_mutex> lock(table.mutex);
+
+	AtomMap::iterator i = table.atoms.find(name);
+	if (i != table.atoms.end())
+		return i->second;
+
+	return NO_ATOM;
+}
+
+/* MobjPropertyList::atomName (static)
+ * Returns the property name for [atom]. Doesn't lock the atom table
+ *******************************************************************/
+const string& MobjPropertyList::atomName(Atom atom)
+{
+	AtomTable& table = atomTable();
+
+	static const string no_name;
+	if (atom >= table.count.load(std::memory_order_acquire))
+		return no_name;
+
+	return table.blocks[atom / ATOM_BLOCK_SIZE][atom % ATOM_BLOCK_SIZE];
+}
+
+/* MobjPropertyList::nAtoms (static)
+ * Returns the number of atoms in the atom table
+ *******************************************************************/
+unsigned MobjPropertyList::nAtoms()
+{
+	return atomTable().count.load(std::memory_order_acquire);
+}
@@ -1,4 +1,3 @@
-
 #ifndef __MOBJ_PROPERTY_LIST_H__
 #define __MOBJ_PROPERTY_LIST_H__
 
@@ -7,46 +6,68 @@
 class MobjPropertyList
 {
 public:
+	// Property names are interned into a global atom table, so each property
+	// only stores an integer key and lookups compare integers
+	typedef unsigned Atom;
+	static const Atom NO_ATOM = 0xFFFFFFFF;
+
 	struct prop_t
 	{
-		string		name;
+		Atom		key;
 		Property	value;
 
-		prop_t(string name) { this->name = name; }
-		prop_t(string name, Property value)
-		{
-			this->name = name;
-			this->value = value;
-		}
+		prop_t(Atom key) : key{ key } {}
+		prop_t(Atom key, const Property& value) : key{ key }, value{ value } {}
+
+		const string&	name() const { return atomName(key); }
 	};
 
 	MobjPropertyList();
 	~MobjPropertyList();
 
-	// Operator for direct access to hash map
-	Property& operator[](string key)
+	// Operators for direct access (adds an empty property if [key] doesn't
+	// exist)
+	Property& operator[](const string& key) { return (*this)[atom(key)]; }
+	Property& operator[](Atom key)
 	{
-		for (unsigned a = 0; a < properties.size(); ++a)
-		{
-			if (properties[a].name == key)
-				return properties[a].value;
-		}
+		for (auto& prop : properties)
+			if (prop.key == key)
+				return prop.value;
 
 		properties.push_back(prop_t(key));
 		return properties.back().value;
 	}
 
+	// Lookup without adding (returns nullptr if [key] doesn't exist)
+	Property*	get(Atom key)
+	{
+		for (auto& prop : properties)
+			if (prop.key == key)
+				return &prop.value;
+
+		return nullptr;
+	}
+	const Property*	get(Atom key) const { return const_cast<MobjPropertyList*>(this)->get(key); }
+	Property*		get(const string& key) { return get(findAtom(key)); }
+	const Property*	get(const string& key) const { return get(findAtom(key)); }
+
 	vector<prop_t>&	allProperties() { return properties; }
 
 	void	clear() { properties.clear(); }
-	bool	propertyExists(string key);
-	bool	removeProperty(string key);
+	bool	propertyExists(const string& key) const { return get(key) != nullptr; }
+	bool	removeProperty(const string& key);
 	void	copyTo(MobjPropertyList& list);
-	void	addFlag(string key);
-	bool	isEmpty() { return properties.empty(); }
+	void	addFlag(const string& key);
+	bool	isEmpty() const { return properties.empty(); }
 
 	string	toString(bool condensed = false);
 
+	// Atom table
+	static Atom				atom(const string& name);
+	static Atom				findAtom(const string& name);
+	static const string&	atomName(Atom atom);
+	static unsigned			nAtoms();
+
 private:
 	vector<prop_t>	properties;
 };
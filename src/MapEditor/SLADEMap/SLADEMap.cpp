@@ -37,7 +37,8 @@
 #include "MapEditor/SectorBuilder.h"
 #include "SLADEMap.h"
 #include "Utility/MathStuff.h"
-#include "Utility/Parser.h"
+#include "Utility/ThreadPool.h"
+#include <cmath>
 
 #define IDEQ(x) (((x) != 0) && ((x) == id))
 
@@ -48,6 +49,404 @@
 CVAR(Bool, map_split_auto_offset, true, CVAR_SAVE)
 
 
+/*******************************************************************
+ * UDMF WRITING HELPER FUNCTIONS
+ *******************************************************************/
+namespace
+{
+	/* appendInt
+	 * Appends [value] to [out] as a decimal integer
+	 *******************************************************************/
+	void appendInt(std::string& out, long long value)
+	{
+		char buf[24];
+		char* pos = buf + sizeof(buf);
+		unsigned long long v = value < 0 ? 0ull - (unsigned long long)value : (unsigned long long)value;
+		do
+		{
+			*--pos = '0' + (v % 10);
+			v /= 10;
+		}
+		while (v);
+		if (value < 0)
+			*--pos = '-';
+
+		out.append(pos, buf + sizeof(buf) - pos);
+	}
+
+	/* appendFloat
+	 * Appends [value] to [out] with [decimals] (max 6) digits after the
+	 * decimal point. Gives the same output as printf's %.Nf, but is
+	 * independent of the current locale
+	 *******************************************************************/
+	void appendFloat(std::string& out, double value, int decimals)
+	{
+		static const double scales[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+		static const long long iscales[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+		// Fall back to printf for values too large to scale exactly (or that
+		// aren't numbers), and for values close enough to halfway between two
+		// outputs that the exact binary value is needed to round the same way
+		double scaled = value * scales[decimals];
+		if (!(fabs(scaled) < 1.0e9) || fabs(fabs(scaled - trunc(scaled)) - 0.5) < 1e-6)
+		{
+			char buf[512];
+			snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+			for (char* c = buf; *c; ++c)
+				if (*c == ',')
+					*c = '.';
+			out += buf;
+			return;
+		}
+
+		long long rounded = llround(scaled);
+		if (std::signbit(value))
+			out += '-';
+		if (rounded < 0)
+			rounded = -rounded;
+
+		appendInt(out, rounded / iscales[decimals]);
+		if (decimals > 0)
+		{
+			char frac[8];
+			long long f = rounded % iscales[decimals];
+			for (int a = decimals - 1; a >= 0; a--)
+			{
+				frac[a] = '0' + (f % 10);
+				f /= 10;
+			}
+			out += '.';
+			out.append(frac, decimals);
+		}
+	}
+
+	/* appendString
+	 * Appends [value] to [out] as UTF-8, escaping backslashes and double
+	 * quotes if [escape] is true
+	 *******************************************************************/
+	void appendString(std::string& out, const string& value, bool escape = false)
+	{
+		auto utf8 = value.utf8_str();
+		const char* str = utf8.data();
+		if (!escape)
+		{
+			out.append(str, utf8.length());
+			return;
+		}
+
+		for (size_t a = 0; a < utf8.length(); a++)
+		{
+			if (str[a] == '\\' || str[a] == '"')
+				out += '\\';
+			out += str[a];
+		}
+	}
+
+	/* appendKeyInt
+	 * Appends "[key]=[value];" to [out]
+	 *******************************************************************/
+	void appendKeyInt(std::string& out, const char* key, long long value)
+	{
+		out += key;
+		out += '=';
+		appendInt(out, value);
+		out += ";\n";
+	}
+
+	/* appendKeyString
+	 * Appends [key]="[value]"; to [out]
+	 *******************************************************************/
+	void appendKeyString(std::string& out, const char* key, const string& value)
+	{
+		out += key;
+		out += "=\"";
+		appendString(out, value);
+		out += "\";\n";
+	}
+
+	/* appendProperties
+	 * Appends all properties in [props] to [out], in the same format as
+	 * MobjPropertyList::toString(true)
+	 *******************************************************************/
+	void appendProperties(std::string& out, MobjPropertyList& props)
+	{
+		for (auto& prop : props.allProperties())
+		{
+			// Skip if no value
+			if (!prop.value.hasValue())
+				continue;
+
+			appendString(out, prop.name());
+			out += '=';
+			switch (prop.value.getType())
+			{
+			case PROP_BOOL:
+				out += prop.value.getBoolValue() ? "true" : "false"; break;
+			case PROP_INT:
+				appendInt(out, prop.value.getIntValue()); break;
+			case PROP_UINT:
+				appendInt(out, prop.value.getUnsignedValue()); break;
+			case PROP_FLOAT:
+				appendFloat(out, prop.value.getFloatValue(), 6); break;
+			case PROP_STRING:
+				out += '"';
+				appendString(out, prop.value.getStringValue(), true);
+				out += '"';
+				break;
+			case PROP_FLAG:
+				out += '1'; break;
+			default:
+				break;
+			}
+			out += ";\n";
+		}
+	}
+
+	/* appendBlockStart
+	 * Appends the start of a UDMF block of [type] for object [index]
+	 *******************************************************************/
+	void appendBlockStart(std::string& out, const char* type, unsigned index)
+	{
+		out += type;
+		out += "//#";
+		appendInt(out, index);
+		out += "\n{\n";
+	}
+}
+
+/*******************************************************************
+ * TAG HELPER FUNCTIONS
+ *******************************************************************/
+namespace
+{
+	/* thingTagsId
+	 * Returns true if [thing]'s special (or type) affects objects of
+	 * [type] with [id]. [ttype] is the path thing type for patrol and
+	 * interpolation specials
+	 *******************************************************************/
+	bool thingTagsId(MapThing* thing, int id, int type, int ttype)
+	{
+		using Game::TagType;
+
+		auto& tt = Game::configuration().thingType(thing->getType());
+		auto needs_tag = tt.needsTag();
+		if (needs_tag == TagType::None &&
+			(!thing->intProperty("special") || (tt.flags() & Game::ThingType::FLAG_SCRIPT)))
+			return false;
+
+		if (needs_tag == TagType::None)
+			needs_tag = Game::configuration().actionSpecial(thing->intProperty("special")).needsTag();
+		int tag, arg2, arg3, arg4, arg5, tid;
+		tag = thing->intProperty("arg0");
+		bool fits = false;
+		int path_type;
+		switch (needs_tag)
+		{
+		case TagType::Sector:
+		case TagType::SectorOrBack:
+		case TagType::SectorAndBack:
+			fits = (IDEQ(tag) && type == SLADEMap::SECTORS);
+			break;
+		case TagType::LineNegative:
+			tag = abs(tag);
+		case TagType::Line:
+			fits = (IDEQ(tag) && type == SLADEMap::LINEDEFS);
+			break;
+		case TagType::Thing:
+			fits = (IDEQ(tag) && type == SLADEMap::THINGS);
+			break;
+		case TagType::Thing1Sector2:
+			arg2 = thing->intProperty("arg1");
+			fits = (type == SLADEMap::THINGS ? IDEQ(tag) : (IDEQ(arg2) && type == SLADEMap::SECTORS));
+			break;
+		case TagType::Thing1Sector3:
+			arg3 = thing->intProperty("arg2");
+			fits = (type == SLADEMap::THINGS ? IDEQ(tag) : (IDEQ(arg3) && type == SLADEMap::SECTORS));
+			break;
+		case TagType::Thing1Thing2:
+			arg2 = thing->intProperty("arg1");
+			fits = (type == SLADEMap::THINGS && (IDEQ(tag) || IDEQ(arg2)));
+			break;
+		case TagType::Thing1Thing4:
+			arg4 = thing->intProperty("arg3");
+			fits = (type == SLADEMap::THINGS && (IDEQ(tag) || IDEQ(arg4)));
+			break;
+		case TagType::Thing1Thing2Thing3:
+			arg2 = thing->intProperty("arg1");
+			arg3 = thing->intProperty("arg2");
+			fits = (type == SLADEMap::THINGS && (IDEQ(tag) || IDEQ(arg2) || IDEQ(arg3)));
+			break;
+		case TagType::Sector1Thing2Thing3Thing5:
+			arg2 = thing->intProperty("arg1");
+			arg3 = thing->intProperty("arg2");
+			arg5 = thing->intProperty("arg4");
+			fits = (type == SLADEMap::SECTORS ? (IDEQ(tag)) : (type == SLADEMap::THINGS &&
+					(IDEQ(arg2) || IDEQ(arg3) || IDEQ(arg5))));
+			break;
+		case TagType::LineId1Line2:
+			arg2 = thing->intProperty("arg1");
+			fits = (type == SLADEMap::LINEDEFS && IDEQ(arg2));
+			break;
+		case TagType::Thing4:
+			arg4 = thing->intProperty("arg3");
+			fits = (type == SLADEMap::THINGS && IDEQ(arg4));
+			break;
+		case TagType::Thing5:
+			arg5 = thing->intProperty("arg4");
+			fits = (type == SLADEMap::THINGS && IDEQ(arg5));
+			break;
+		case TagType::Line1Sector2:
+			arg2 = thing->intProperty("arg1");
+			fits = (type == SLADEMap::LINEDEFS ? (IDEQ(tag)) : (IDEQ(arg2) && type == SLADEMap::SECTORS));
+			break;
+		case TagType::Sector1Sector2:
+			arg2 = thing->intProperty("arg1");
+			fits = (type == SLADEMap::SECTORS && (IDEQ(tag) || IDEQ(arg2)));
+			break;
+		case TagType::Sector1Sector2Sector3Sector4:
+			arg2 = thing->intProperty("arg1");
+			arg3 = thing->intProperty("arg2");
+			arg4 = thing->intProperty("arg3");
+			fits = (type == SLADEMap::SECTORS && (IDEQ(tag) || IDEQ(arg2) || IDEQ(arg3) || IDEQ(arg4)));
+			break;
+		case TagType::Sector2Is3Line:
+			arg2 = thing->intProperty("arg1");
+			fits = (IDEQ(tag) && (arg2 == 3 ? type == SLADEMap::LINEDEFS : type == SLADEMap::SECTORS));
+			break;
+		case TagType::Sector1Thing2:
+			arg2 = thing->intProperty("arg1");
+			fits = (type == SLADEMap::SECTORS ? (IDEQ(tag)) : (IDEQ(arg2) && type == SLADEMap::THINGS));
+			break;
+		case TagType::Patrol:
+			path_type = 9047;
+		case TagType::Interpolation:
+		{
+			path_type = 9075;
+
+			tid = thing->intProperty("id");
+			auto& tt = Game::configuration().thingType(thing->getType());
+			fits = ((path_type == ttype) && (IDEQ(tid)) && (tt.needsTag() == needs_tag));
+		}
+			break;
+		default:
+			break;
+		}
+
+		return fits;
+	}
+
+	/* lineTagsId
+	 * Returns true if [line]'s special affects objects of [type] with
+	 * [id]
+	 *******************************************************************/
+	bool lineTagsId(MapLine* line, int id, int type)
+	{
+		using Game::TagType;
+
+		if (!line->getSpecial())
+			return false;
+
+		int tag, arg2, arg3, arg4, arg5;
+		tag = line->intProperty("arg0");
+		bool fits = false;
+		switch (Game::configuration().actionSpecial(line->getSpecial()).needsTag())
+		{
+		case TagType::Sector:
+		case TagType::SectorOrBack:
+		case TagType::SectorAndBack:
+			fits = (IDEQ(tag) && type == SLADEMap::SECTORS);
+			break;
+		case TagType::LineNegative:
+			tag = abs(tag);
+		case TagType::Line:
+			fits = (IDEQ(tag) && type == SLADEMap::LINEDEFS);
+			break;
+		case TagType::Thing:
+			fits = (IDEQ(tag) && type == SLADEMap::THINGS);
+			break;
+		case TagType::Thing1Sector2:
+			arg2 = line->intProperty("arg1");
+			fits = (type == SLADEMap::THINGS ? IDEQ(tag) : (IDEQ(arg2) && type == SLADEMap::SECTORS));
+			break;
+		case TagType::Thing1Sector3:
+			arg3 = line->intProperty("arg2");
+			fits = (type == SLADEMap::THINGS ? IDEQ(tag) : (IDEQ(arg3) && type == SLADEMap::SECTORS));
+			break;
+		case TagType::Thing1Thing2:
+			arg2 = line->intProperty("arg1");
+			fits = (type == SLADEMap::THINGS && (IDEQ(tag) || IDEQ(arg2)));
+			break;
+		case TagType::Thing1Thing4:
+			arg4 = line->intProperty("arg3");
+			fits = (type == SLADEMap::THINGS && (IDEQ(tag) || IDEQ(arg4)));
+			break;
+		case TagType::Thing1Thing2Thing3:
+			arg2 = line->intProperty("arg1");
+			arg3 = line->intProperty("arg2");
+			fits = (type == SLADEMap::THINGS && (IDEQ(tag) || IDEQ(arg2) || IDEQ(arg3)));
+			break;
+		case TagType::Sector1Thing2Thing3Thing5:
+			arg2 = line->intProperty("arg1");
+			arg3 = line->intProperty("arg2");
+			arg5 = line->intProperty("arg4");
+			fits = (type == SLADEMap::SECTORS ? (IDEQ(tag)) : (type == SLADEMap::THINGS &&
+					(IDEQ(arg2) || IDEQ(arg3) || IDEQ(arg5))));
+			break;
+		case TagType::LineId1Line2:
+			arg2 = line->intProperty("arg1");
+			fits = (type == SLADEMap::LINEDEFS && IDEQ(arg2));
+			break;
+		case TagType::Thing4:
+			arg4 = line->intProperty("arg3");
+			fits = (type == SLADEMap::THINGS && IDEQ(arg4));
+			break;
+		case TagType::Thing5:
+			arg5 = line->intProperty("arg4");
+			fits = (type == SLADEMap::THINGS && IDEQ(arg5));
+			break;
+		case TagType::Line1Sector2:
+			arg2 = line->intProperty("arg1");
+			fits = (type == SLADEMap::LINEDEFS ? (IDEQ(tag)) : (IDEQ(arg2) && type == SLADEMap::SECTORS));
+			break;
+		case TagType::Sector1Sector2:
+			arg2 = line->intProperty("arg1");
+			fits = (type == SLADEMap::SECTORS && (IDEQ(tag) || IDEQ(arg2)));
+			break;
+		case TagType::Sector1Sector2Sector3Sector4:
+			arg2 = line->intProperty("arg1");
+			arg3 = line->intProperty("arg2");
+			arg4 = line->intProperty("arg3");
+			fits = (type == SLADEMap::SECTORS && (IDEQ(tag) || IDEQ(arg2) || IDEQ(arg3) || IDEQ(arg4)));
+			break;
+		case TagType::Sector2Is3Line:
+			arg2 = line->intProperty("arg1");
+			fits = (IDEQ(tag) && (arg2 == 3 ? type == SLADEMap::LINEDEFS : type == SLADEMap::SECTORS));
+			break;
+		case TagType::Sector1Thing2:
+			arg2 = line->intProperty("arg1");
+			fits = (type == SLADEMap::SECTORS ? (IDEQ(tag)) : (IDEQ(arg2) && type == SLADEMap::THINGS));
+			break;
+		default:
+			break;
+		}
+
+		return fits;
+	}
+
+	/* sortByIndex
+	 * Sorts map objects in [list] by index, so results from the tag
+	 * index are in the same order as a scan through the map would give
+	 *******************************************************************/
+	void sortByIndex(vector<MapObject*>& list)
+	{
+		std::sort(list.begin(), list.end(), [](MapObject* left, MapObject* right)
+		{
+			return left->getIndex() < right->getIndex();
+		});
+	}
+}
+
+
 /*******************************************************************
  * SLADEMAP CLASS FUNCTIONS
  *******************************************************************/
@@ -193,6 +592,9 @@ void SLADEMap::refreshIndices()
 	// Thing indices
 	for (unsigned a = 0; a < things_.size(); a++)
 		things_[a]->index = a;
+
+	// Geometry store uses indices, rebuild it
+	geometry_store_.invalidate();
 }
 
 /* SLADEMap::addMapObject
@@ -267,6 +669,8 @@ void SLADEMap::restoreObjectIdList(uint8_t type, vector<unsigned>& list)
 			vertices_.push_back((MapVertex*)all_objects_[list[a]].mobj);
 			vertices_.back()->index = vertices_.size() - 1;
 		}
+
+		geometry_store_.invalidate();
 	}
 	else if (type == MOBJ_LINE)
 	{
@@ -282,6 +686,8 @@ void SLADEMap::restoreObjectIdList(uint8_t type, vector<unsigned>& list)
 			lines_.push_back((MapLine*)all_objects_[list[a]].mobj);
 			lines_.back()->index = lines_.size() - 1;
 		}
+
+		geometry_store_.invalidate();
 	}
 	else if (type == MOBJ_SIDE)
 	{
@@ -383,7 +789,10 @@ bool SLADEMap::readMap(Archive::MapDesc map)
 			udmf_namespace_ = Game::configuration().udmfNamespace();
 	}
 
-	initSectorPolygons();
+	geometry_store_.rebuild(vertices_, lines_);
+	tag_index_.rebuild(sectors_, lines_, things_);
+	if (!sector_geometry_.start(sectors_))
+		initSectorPolygons();
 	recomputeSpecials();
 
 	opened_time_ = App::runTimer() + 10;
@@ -396,7 +805,7 @@ bool SLADEMap::readMap(Archive::MapDesc map)
  *******************************************************************/
 bool SLADEMap::addVertex(doomvertex_t& v)
 {
-	MapVertex* nv = new MapVertex(v.x, v.y, this);
+	MapVertex* nv = vertex_pool_.create(v.x, v.y, this);
 	vertices_.push_back(nv);
 	return true;
 }
@@ -406,7 +815,7 @@ bool SLADEMap::addVertex(doomvertex_t& v)
  *******************************************************************/
 bool SLADEMap::addVertex(doom64vertex_t& v)
 {
-	MapVertex* nv = new MapVertex((double)v.x/65536, (double)v.y/65536, this);
+	MapVertex* nv = vertex_pool_.create((double)v.x/65536, (double)v.y/65536, this);
 	vertices_.push_back(nv);
 	return true;
 }
@@ -417,7 +826,7 @@ bool SLADEMap::addVertex(doom64vertex_t& v)
 bool SLADEMap::addSide(doomside_t& s)
 {
 	// Create side
-	MapSide* ns = new MapSide(getSector(s.sector), this);
+	MapSide* ns = side_pool_.create(getSector(s.sector), this);
 
 	// Setup side properties
 	ns->tex_upper = wxString::FromAscii(s.tex_upper, 8);
@@ -442,7 +851,7 @@ bool SLADEMap::addSide(doomside_t& s)
 bool SLADEMap::addSide(doom64side_t& s)
 {
 	// Create side
-	MapSide* ns = new MapSide(getSector(s.sector), this);
+	MapSide* ns = side_pool_.create(getSector(s.sector), this);
 
 	// Setup side properties
 	ns->tex_upper = theResourceManager->getTextureName(s.tex_upper);
@@ -493,7 +902,7 @@ bool SLADEMap::addLine(doomline_t& l)
 	if (s1 && s1->parent)
 	{
 		// Duplicate side
-		MapSide* ns = new MapSide(s1->sector, this);
+		MapSide* ns = side_pool_.create(s1->sector, this);
 		ns->copy(s1);
 		s1 = ns;
 		sides_.push_back(s1);
@@ -503,14 +912,14 @@ bool SLADEMap::addLine(doomline_t& l)
 	if (s2 && s2->parent)
 	{
 		// Duplicate side
-		MapSide* ns = new MapSide(s2->sector, this);
+		MapSide* ns = side_pool_.create(s2->sector, this);
 		ns->copy(s2);
 		s2 = ns;
 		sides_.push_back(s2);
 	}
 
 	// Create line
-	MapLine* nl = new MapLine(v1, v2, s1, s2, this);
+	MapLine* nl = line_pool_.create(v1, v2, s1, s2, this);
 
 	// Setup line properties
 	nl->properties["arg0"] = l.sector_tag;
@@ -555,7 +964,7 @@ bool SLADEMap::addLine(doom64line_t& l)
 	if (s1 && s1->parent)
 	{
 		// Duplicate side
-		MapSide* ns = new MapSide(s1->sector, this);
+		MapSide* ns = side_pool_.create(s1->sector, this);
 		ns->copy(s1);
 		s1 = ns;
 		sides_.push_back(s1);
@@ -565,14 +974,14 @@ bool SLADEMap::addLine(doom64line_t& l)
 	if (s2 && s2->parent)
 	{
 		// Duplicate side
-		MapSide* ns = new MapSide(s2->sector, this);
+		MapSide* ns = side_pool_.create(s2->sector, this);
 		ns->copy(s2);
 		s2 = ns;
 		sides_.push_back(s2);
 	}
 
 	// Create line
-	MapLine* nl = new MapLine(v1, v2, s1, s2, this);
+	MapLine* nl = line_pool_.create(v1, v2, s1, s2, this);
 
 	// Setup line properties
 	nl->properties["arg0"] = l.sector_tag;
@@ -594,7 +1003,7 @@ bool SLADEMap::addLine(doom64line_t& l)
 bool SLADEMap::addSector(doomsector_t& s)
 {
 	// Create sector
-	MapSector* ns = new MapSector(wxString::FromAscii(s.f_tex, 8), wxString::FromAscii(s.c_tex, 8), this);
+	MapSector* ns = sector_pool_.create(wxString::FromAscii(s.f_tex, 8), wxString::FromAscii(s.c_tex, 8), this);
 
 	// Setup sector properties
 	ns->setFloorHeight(s.f_height);
@@ -619,7 +1028,7 @@ bool SLADEMap::addSector(doom64sector_t& s)
 {
 	// Create sector
 	// We need to retrieve the texture name from the hash value
-	MapSector* ns = new MapSector(theResourceManager->getTextureName(s.f_tex),
+	MapSector* ns = sector_pool_.create(theResourceManager->getTextureName(s.f_tex),
 								  theResourceManager->getTextureName(s.c_tex), this);
 
 	// Setup sector properties
@@ -650,7 +1059,7 @@ bool SLADEMap::addSector(doom64sector_t& s)
 bool SLADEMap::addThing(doomthing_t& t)
 {
 	// Create thing
-	MapThing* nt = new MapThing(t.x, t.y, t.type, this);
+	MapThing* nt = thing_pool_.create(t.x, t.y, t.type, this);
 
 	// Setup thing properties
 	nt->angle = t.angle;
@@ -667,7 +1076,7 @@ bool SLADEMap::addThing(doomthing_t& t)
 bool SLADEMap::addThing(doom64thing_t& t)
 {
 	// Create thing
-	MapThing* nt = new MapThing(t.x, t.y, t.type, this);
+	MapThing* nt = thing_pool_.create(t.x, t.y, t.type, this);
 
 	// Setup thing properties
 	nt->angle = t.angle;
@@ -958,7 +1367,7 @@ bool SLADEMap::addLine(hexenline_t& l)
 	if (s1 && s1->parent)
 	{
 		// Duplicate side
-		MapSide* ns = new MapSide(s1->sector, this);
+		MapSide* ns = side_pool_.create(s1->sector, this);
 		ns->copy(s1);
 		s1 = ns;
 		sides_.push_back(s1);
@@ -968,14 +1377,14 @@ bool SLADEMap::addLine(hexenline_t& l)
 	if (s2 && s2->parent)
 	{
 		// Duplicate side
-		MapSide* ns = new MapSide(s2->sector, this);
+		MapSide* ns = side_pool_.create(s2->sector, this);
 		ns->copy(s2);
 		s2 = ns;
 		sides_.push_back(s2);
 	}
 
 	// Create line
-	MapLine* nl = new MapLine(v1, v2, s1, s2, this);
+	MapLine* nl = line_pool_.create(v1, v2, s1, s2, this);
 
 	// Setup line properties
 	nl->properties["arg0"] = l.args[0];
@@ -1012,7 +1421,7 @@ bool SLADEMap::addLine(hexenline_t& l)
 bool SLADEMap::addThing(hexenthing_t& t)
 {
 	// Create thing
-	MapThing* nt = new MapThing(t.x, t.y, t.type, this);
+	MapThing* nt = thing_pool_.create(t.x, t.y, t.type, this);
 
 	// Setup thing properties
 	nt->angle = t.angle;
@@ -1412,28 +1821,36 @@ bool SLADEMap::readDoom64Map(Archive::MapDesc map)
 /* SLADEMap::addVertex
  * Adds a vertex to the map from parsed UDMF vertex definition [def]
  *******************************************************************/
-bool SLADEMap::addVertex(ParseTreeNode* def)
+bool SLADEMap::addVertex(const UDMFParser::Block& def)
 {
+	typedef UDMFParser::Key Key;
+
 	// Check for required properties
-	auto prop_x = def->getChildPTN("x");
-	auto prop_y = def->getChildPTN("y");
+	const UDMFParser::Field* prop_x = nullptr;
+	const UDMFParser::Field* prop_y = nullptr;
+	for (unsigned a = 0; a < def.n_fields; a++)
+	{
+		if (def.fields[a].known == Key::X)
+			prop_x = &def.fields[a];
+		else if (def.fields[a].known == Key::Y)
+			prop_y = &def.fields[a];
+	}
 	if (!prop_x || !prop_y)
 		return false;
 
 	// Create new vertex
-	MapVertex* nv = new MapVertex(prop_x->floatValue(), prop_y->floatValue(), this);
+	MapVertex* nv = vertex_pool_.create(prop_x->floatValue(), prop_y->floatValue(), this);
 
 	// Add extra vertex info
-	ParseTreeNode* prop = nullptr;
-	for (unsigned a = 0; a < def->nChildren(); a++)
+	for (unsigned a = 0; a < def.n_fields; a++)
 	{
-		prop = def->getChildPTN(a);
+		auto& prop = def.fields[a];
 
 		// Skip required properties
-		if (prop == prop_x || prop == prop_y)
+		if (prop.known == Key::X || prop.known == Key::Y)
 			continue;
 
-		nv->properties[prop->getName()] = prop->value();
+		nv->properties[prop.name()] = prop.value();
 	}
 
 	// Add vertex to map
@@ -1445,10 +1862,15 @@ bool SLADEMap::addVertex(ParseTreeNode* def)
 /* SLADEMap::addSide
  * Adds a side to the map from parsed UDMF side definition [def]
  *******************************************************************/
-bool SLADEMap::addSide(ParseTreeNode* def)
+bool SLADEMap::addSide(const UDMFParser::Block& def)
 {
+	typedef UDMFParser::Key Key;
+
 	// Check for required properties
-	auto prop_sector = def->getChildPTN("sector");
+	const UDMFParser::Field* prop_sector = nullptr;
+	for (unsigned a = 0; a < def.n_fields; a++)
+		if (def.fields[a].known == Key::Sector)
+			prop_sector = &def.fields[a];
 	if (!prop_sector)
 		return false;
 
@@ -1458,7 +1880,7 @@ bool SLADEMap::addSide(ParseTreeNode* def)
 		return false;
 
 	// Create new side
-	MapSide* ns = new MapSide(sectors_[sector], this);
+	MapSide* ns = side_pool_.create(sectors_[sector], this);
 
 	// Set defaults
 	ns->offset_x = 0;
@@ -1468,28 +1890,19 @@ bool SLADEMap::addSide(ParseTreeNode* def)
 	ns->tex_lower = "-";
 
 	// Add extra side info
-	ParseTreeNode* prop = nullptr;
-	for (unsigned a = 0; a < def->nChildren(); a++)
+	for (unsigned a = 0; a < def.n_fields; a++)
 	{
-		prop = def->getChildPTN(a);
-
-		// Skip required properties
-		if (prop == prop_sector)
-			continue;
-
-		if (S_CMPNOCASE(prop->getName(), "texturetop"))
-			ns->tex_upper = prop->stringValue();
-		else if (S_CMPNOCASE(prop->getName(), "texturemiddle"))
-			ns->tex_middle = prop->stringValue();
-		else if (S_CMPNOCASE(prop->getName(), "texturebottom"))
-			ns->tex_lower = prop->stringValue();
-		else if (S_CMPNOCASE(prop->getName(), "offsetx"))
-			ns->offset_x = prop->intValue();
-		else if (S_CMPNOCASE(prop->getName(), "offsety"))
-			ns->offset_y = prop->intValue();
-		else
-			ns->properties[prop->getName()] = prop->value();
-		//LOG_MESSAGE(1, "Property %s type %s (%s)", prop->getName(), prop->getValue().typeString(), prop->getValue().getStringValue());
+		auto& prop = def.fields[a];
+		switch (prop.known)
+		{
+		case Key::Sector:			break;	// Required property
+		case Key::TextureTop:		ns->tex_upper = prop.stringValue(); break;
+		case Key::TextureMiddle:	ns->tex_middle = prop.stringValue(); break;
+		case Key::TextureBottom:	ns->tex_lower = prop.stringValue(); break;
+		case Key::OffsetX:			ns->offset_x = prop.intValue(); break;
+		case Key::OffsetY:			ns->offset_y = prop.intValue(); break;
+		default:					ns->properties[prop.name()] = prop.value(); break;
+		}
 	}
 
 	// Update texture counts
@@ -1506,12 +1919,26 @@ bool SLADEMap::addSide(ParseTreeNode* def)
 /* SLADEMap::addLine
  * Adds a line to the map from parsed UDMF line definition [def]
  *******************************************************************/
-bool SLADEMap::addLine(ParseTreeNode* def)
+bool SLADEMap::addLine(const UDMFParser::Block& def)
 {
+	typedef UDMFParser::Key Key;
+
 	// Check for required properties
-	auto prop_v1 = def->getChildPTN("v1");
-	auto prop_v2 = def->getChildPTN("v2");
-	auto prop_s1 = def->getChildPTN("sidefront");
+	const UDMFParser::Field* prop_v1 = nullptr;
+	const UDMFParser::Field* prop_v2 = nullptr;
+	const UDMFParser::Field* prop_s1 = nullptr;
+	const UDMFParser::Field* prop_s2 = nullptr;
+	for (unsigned a = 0; a < def.n_fields; a++)
+	{
+		switch (def.fields[a].known)
+		{
+		case Key::V1:			prop_v1 = &def.fields[a]; break;
+		case Key::V2:			prop_v2 = &def.fields[a]; break;
+		case Key::SideFront:	prop_s1 = &def.fields[a]; break;
+		case Key::SideBack:		prop_s2 = &def.fields[a]; break;
+		default: break;
+		}
+	}
 	if (!prop_v1 || !prop_v2 || !prop_s1)
 		return false;
 
@@ -1528,32 +1955,29 @@ bool SLADEMap::addLine(ParseTreeNode* def)
 
 	// Get second side if any
 	MapSide* side2 = nullptr;
-	auto prop_s2 = def->getChildPTN("sideback");
 	if (prop_s2) side2 = getSide(prop_s2->intValue());
 
 	// Create new line
-	MapLine* nl = new MapLine(vertices_[v1], vertices_[v2], sides_[s1], side2, this);
+	MapLine* nl = line_pool_.create(vertices_[v1], vertices_[v2], sides_[s1], side2, this);
 
 	// Set defaults
 	nl->special = 0;
 	nl->line_id = 0;
 
 	// Add extra line info
-	ParseTreeNode* prop = nullptr;
-	for (unsigned a = 0; a < def->nChildren(); a++)
+	for (unsigned a = 0; a < def.n_fields; a++)
 	{
-		prop = def->getChildPTN(a);
-
-		// Skip required properties
-		if (prop == prop_v1 || prop == prop_v2 || prop == prop_s1 || prop == prop_s2)
-			continue;
-
-		if (prop->getName() == "special")
-			nl->special = prop->intValue();
-		else if (prop->getName() == "id")
-			nl->line_id = prop->intValue();
-		else
-			nl->properties[prop->getName()] = prop->value();
+		auto& prop = def.fields[a];
+		switch (prop.known)
+		{
+		case Key::V1:
+		case Key::V2:
+		case Key::SideFront:
+		case Key::SideBack:	break;	// Required properties
+		case Key::Special:	nl->special = prop.intValue(); break;
+		case Key::Id:		nl->line_id = prop.intValue(); break;
+		default:			nl->properties[prop.name()] = prop.value(); break;
+		}
 	}
 
 	// Add line to map
@@ -1565,16 +1989,25 @@ bool SLADEMap::addLine(ParseTreeNode* def)
 /* SLADEMap::addSector
  * Adds a sector to the map from parsed UDMF sector definition [def]
  *******************************************************************/
-bool SLADEMap::addSector(ParseTreeNode* def)
+bool SLADEMap::addSector(const UDMFParser::Block& def)
 {
+	typedef UDMFParser::Key Key;
+
 	// Check for required properties
-	auto prop_ftex = def->getChildPTN("texturefloor");
-	auto prop_ctex = def->getChildPTN("textureceiling");
+	const UDMFParser::Field* prop_ftex = nullptr;
+	const UDMFParser::Field* prop_ctex = nullptr;
+	for (unsigned a = 0; a < def.n_fields; a++)
+	{
+		if (def.fields[a].known == Key::TextureFloor)
+			prop_ftex = &def.fields[a];
+		else if (def.fields[a].known == Key::TextureCeiling)
+			prop_ctex = &def.fields[a];
+	}
 	if (!prop_ftex || !prop_ctex)
 		return false;
 
 	// Create new sector
-	MapSector* ns = new MapSector(prop_ftex->stringValue(), prop_ctex->stringValue(), this);
+	MapSector* ns = sector_pool_.create(prop_ftex->stringValue(), prop_ctex->stringValue(), this);
 	usage_flat_[ns->f_tex.Upper()] += 1;
 	usage_flat_[ns->c_tex.Upper()] += 1;
 
@@ -1586,27 +2019,20 @@ bool SLADEMap::addSector(ParseTreeNode* def)
 	ns->tag = 0;
 
 	// Add extra sector info
-	ParseTreeNode* prop = nullptr;
-	for (unsigned a = 0; a < def->nChildren(); a++)
+	for (unsigned a = 0; a < def.n_fields; a++)
 	{
-		prop = def->getChildPTN(a);
-
-		// Skip required properties
-		if (prop == prop_ftex || prop == prop_ctex)
-			continue;
-
-		if (S_CMPNOCASE(prop->getName(), "heightfloor"))
-			ns->setFloorHeight(prop->intValue());
-		else if (S_CMPNOCASE(prop->getName(), "heightceiling"))
-			ns->setCeilingHeight(prop->intValue());
-		else if (S_CMPNOCASE(prop->getName(), "lightlevel"))
-			ns->light = prop->intValue();
-		else if (S_CMPNOCASE(prop->getName(), "special"))
-			ns->special = prop->intValue();
-		else if (S_CMPNOCASE(prop->getName(), "id"))
-			ns->tag = prop->intValue();
-		else
-			ns->properties[prop->getName()] = prop->value();
+		auto& prop = def.fields[a];
+		switch (prop.known)
+		{
+		case Key::TextureFloor:
+		case Key::TextureCeiling:	break;	// Required properties
+		case Key::HeightFloor:		ns->setFloorHeight(prop.intValue()); break;
+		case Key::HeightCeiling:	ns->setCeilingHeight(prop.intValue()); break;
+		case Key::LightLevel:		ns->light = prop.intValue(); break;
+		case Key::Special:			ns->special = prop.intValue(); break;
+		case Key::Id:				ns->tag = prop.intValue(); break;
+		default:					ns->properties[prop.name()] = prop.value(); break;
+		}
 	}
 
 	// Add sector to map
@@ -1618,33 +2044,42 @@ bool SLADEMap::addSector(ParseTreeNode* def)
 /* SLADEMap::addThing
  * Adds a thing to the map from parsed UDMF thing definition [def]
  *******************************************************************/
-bool SLADEMap::addThing(ParseTreeNode* def)
+bool SLADEMap::addThing(const UDMFParser::Block& def)
 {
+	typedef UDMFParser::Key Key;
+
 	// Check for required properties
-	auto prop_x = def->getChildPTN("x");
-	auto prop_y = def->getChildPTN("y");
-	auto prop_type = def->getChildPTN("type");
+	const UDMFParser::Field* prop_x = nullptr;
+	const UDMFParser::Field* prop_y = nullptr;
+	const UDMFParser::Field* prop_type = nullptr;
+	for (unsigned a = 0; a < def.n_fields; a++)
+	{
+		switch (def.fields[a].known)
+		{
+		case Key::X:	prop_x = &def.fields[a]; break;
+		case Key::Y:	prop_y = &def.fields[a]; break;
+		case Key::Type:	prop_type = &def.fields[a]; break;
+		default: break;
+		}
+	}
 	if (!prop_x || !prop_y || !prop_type)
 		return false;
 
 	// Create new thing
-	MapThing* nt = new MapThing(prop_x->floatValue(), prop_y->floatValue(), prop_type->intValue(), this);
+	MapThing* nt = thing_pool_.create(prop_x->floatValue(), prop_y->floatValue(), prop_type->intValue(), this);
 
 	// Add extra thing info
-	ParseTreeNode* prop = nullptr;
-	for (unsigned a = 0; a < def->nChildren(); a++)
+	for (unsigned a = 0; a < def.n_fields; a++)
 	{
-		prop = def->getChildPTN(a);
-
-		// Skip required properties
-		if (prop == prop_x || prop == prop_y || prop == prop_type)
-			continue;
-
-		// Builtin properties
-		if (S_CMPNOCASE(prop->getName(), "angle"))
-			nt->angle = prop->intValue();
-		else
-			nt->properties[prop->getName()] = prop->value();
+		auto& prop = def.fields[a];
+		switch (prop.known)
+		{
+		case Key::X:
+		case Key::Y:
+		case Key::Type:		break;	// Required properties
+		case Key::Angle:	nt->angle = prop.intValue(); break;
+		default:			nt->properties[prop.name()] = prop.value(); break;
+		}
 	}
 
 	// Add thing to map
@@ -1653,120 +2088,94 @@ bool SLADEMap::addThing(ParseTreeNode* def)
 	return true;
 }
 
-/* SLADEMap::readDoomMap
+/* SLADEMap::readUDMFMap
  * Reads a UDMF format map using info in [map]
  *******************************************************************/
 bool SLADEMap::readUDMFMap(Archive::MapDesc map)
 {
+	typedef UDMFParser::Key Key;
+
 	// Get TEXTMAP entry (will always be after the 'head' entry)
 	ArchiveEntry* textmap = map.head->nextEntry();
 
 	// --- Parse UDMF text ---
+	// The parser scans the TEXTMAP data in place and sorts the definition
+	// blocks by type, so they can be created in the correct order
+	// (verts->sides->lines->sectors->things), even if they aren't defined in
+	// that order
 	UI::setSplashProgressMessage("Parsing TEXTMAP");
 	UI::setSplashProgress(-100.0f);
-	Parser parser;
-	if (!parser.parseText(textmap->getMCData()))
+	UDMFParser parser;
+	if (!parser.parse(textmap->getMCData()))
 		return false;
 
-	// --- Process parsed data ---
-
-	// First we have to sort the definition blocks by type so they can
-	// be created in the correct order (verts->sides->lines->sectors->things),
-	// even if they aren't defined in that order.
-	// Unknown definitions are also kept, just in case
-	UI::setSplashProgressMessage("Sorting definitions");
-	ParseTreeNode* root = parser.parseTreeRoot();
-	vector<ParseTreeNode*> defs_vertices;
-	vector<ParseTreeNode*> defs_lines;
-	vector<ParseTreeNode*> defs_sides;
-	vector<ParseTreeNode*> defs_sectors;
-	vector<ParseTreeNode*> defs_things;
-	vector<ParseTreeNode*> defs_other;
-	for (unsigned a = 0; a < root->nChildren(); a++)
+	// Namespace and map-scope values
+	for (auto global : parser.globals())
 	{
-		UI::setSplashProgress((float)a / root->nChildren());
-
-		auto node = root->getChildPTN(a);
-
-		// Vertex definition
-		if (S_CMPNOCASE(node->getName(), "vertex"))
-			defs_vertices.push_back(node);
-
-		// Line definition
-		else if (S_CMPNOCASE(node->getName(), "linedef"))
-			defs_lines.push_back(node);
-
-		// Side definition
-		else if (S_CMPNOCASE(node->getName(), "sidedef"))
-			defs_sides.push_back(node);
-
-		// Sector definition
-		else if (S_CMPNOCASE(node->getName(), "sector"))
-			defs_sectors.push_back(node);
-
-		// Thing definition
-		else if (S_CMPNOCASE(node->getName(), "thing"))
-			defs_things.push_back(node);
-
-		// Namespace
-		else if (S_CMPNOCASE(node->getName(), "namespace"))
-			udmf_namespace_ = node->stringValue();
-
-		// Unknown
+		if (global->known == Key::Namespace)
+			udmf_namespace_ = global->stringValue();
 		else
-			defs_other.push_back(node);
+			udmf_props_[global->name()] = global->value();
 	}
 
 	// Now create map structures from parsed data, in the right order
 
 	// Create vertices from parsed data
 	UI::setSplashProgressMessage("Reading Vertices");
+	auto& defs_vertices = parser.blocks(Key::Vertex);
+	vertices_.reserve(defs_vertices.size());
 	for (unsigned a = 0; a < defs_vertices.size(); a++)
 	{
-		UI::setSplashProgress(((float)a / defs_vertices.size()) * 0.2f);
+		if (a % 1024 == 0)
+			UI::setSplashProgress(((float)a / defs_vertices.size()) * 0.2f);
 		addVertex(defs_vertices[a]);
 	}
 
 	// Create sectors from parsed data
 	UI::setSplashProgressMessage("Reading Sectors");
+	auto& defs_sectors = parser.blocks(Key::Sector);
+	sectors_.reserve(defs_sectors.size());
 	for (unsigned a = 0; a < defs_sectors.size(); a++)
 	{
-		UI::setSplashProgress(0.2f + ((float)a / defs_sectors.size()) * 0.2f);
+		if (a % 1024 == 0)
+			UI::setSplashProgress(0.2f + ((float)a / defs_sectors.size()) * 0.2f);
 		addSector(defs_sectors[a]);
 	}
 
 	// Create sides from parsed data
 	UI::setSplashProgressMessage("Reading Sides");
+	auto& defs_sides = parser.blocks(Key::Sidedef);
+	sides_.reserve(defs_sides.size());
 	for (unsigned a = 0; a < defs_sides.size(); a++)
 	{
-		UI::setSplashProgress(0.4f + ((float)a / defs_sides.size()) * 0.2f);
+		if (a % 1024 == 0)
+			UI::setSplashProgress(0.4f + ((float)a / defs_sides.size()) * 0.2f);
 		addSide(defs_sides[a]);
 	}
 
 	// Create lines from parsed data
 	UI::setSplashProgressMessage("Reading Lines");
+	auto& defs_lines = parser.blocks(Key::Linedef);
+	lines_.reserve(defs_lines.size());
 	for (unsigned a = 0; a < defs_lines.size(); a++)
 	{
-		UI::setSplashProgress(0.6f + ((float)a / defs_lines.size()) * 0.2f);
+		if (a % 1024 == 0)
+			UI::setSplashProgress(0.6f + ((float)a / defs_lines.size()) * 0.2f);
 		addLine(defs_lines[a]);
 	}
 
 	// Create things from parsed data
 	UI::setSplashProgressMessage("Reading Things");
+	auto& defs_things = parser.blocks(Key::Thing);
+	things_.reserve(defs_things.size());
 	for (unsigned a = 0; a < defs_things.size(); a++)
 	{
-		UI::setSplashProgress(0.8f + ((float)a / defs_things.size()) * 0.2f);
+		if (a % 1024 == 0)
+			UI::setSplashProgress(0.8f + ((float)a / defs_things.size()) * 0.2f);
 		addThing(defs_things[a]);
 	}
 
-	// Keep map-scope values
-	for (auto node : defs_other)
-	{
-		if (node->nValues() > 0)
-			udmf_props_[node->getName()] = node->value();
-
-		// TODO: Unknown blocks
-	}
+	// TODO: Unknown blocks
 
 	UI::setSplashProgressMessage("Init map data");
 
@@ -2346,169 +2755,202 @@ bool SLADEMap::writeDoom64Map(vector<ArchiveEntry*>& map_entries)
 	return true;
 }
 
-/* SLADEMap::writeUDMFMap
- * Writes map as UDMF format text to [textmap]
+/* SLADEMap::writeUDMFThing
+ * Appends the UDMF definition of [thing] to [out]
  *******************************************************************/
-bool SLADEMap::writeUDMFMap(ArchiveEntry* textmap)
+void SLADEMap::writeUDMFThing(MapThing* thing, unsigned index, std::string& out)
 {
-	// Check entry was given
-	if (!textmap)
-		return false;
-
-	// Open temp text file
-	wxFile tempfile(App::path("sladetemp.txt", App::Dir::Temp), wxFile::write);
+	appendBlockStart(out, "thing", index);
 
-	// Write map namespace
-	tempfile.Write("// Written by SLADE3\n");
-	tempfile.Write(S_FMT("namespace=\"%s\";\n", udmf_namespace_));
+	// Basic properties
+	out += "x=";
+	appendFloat(out, thing->x, 3);
+	out += ";\ny=";
+	appendFloat(out, thing->y, 3);
+	out += ";\n";
+	appendKeyInt(out, "type", thing->type);
+	if (thing->angle != 0) appendKeyInt(out, "angle", thing->angle);
 
-	// Write map-scope props
-	tempfile.Write(udmf_props_.toString(true));
-	tempfile.Write("\n");
+	// Other properties
+	if (!thing->properties.isEmpty())
+		appendProperties(out, thing->properties);
 
-	//sf::Clock clock;
-
-	// Locale for float number format
-	setlocale(LC_NUMERIC, "C");
-
-	// Write things
-	string object_def;
-	for (unsigned a = 0; a < things_.size(); a++)
-	{
-		object_def = S_FMT("thing//#%u\n{\n", a);
-
-		// Basic properties
-		object_def += S_FMT("x=%1.3f;\ny=%1.3f;\ntype=%d;\n", things_[a]->x, things_[a]->y, things_[a]->type);
-		if (things_[a]->angle != 0) object_def += S_FMT("angle=%d;\n", things_[a]->angle);
-
-		// Remove internal 'flags' property if it exists
-		things_[a]->props().removeProperty("flags");
-
-		// Other properties
-		if (!things_[a]->properties.isEmpty())
-		{
-			Game::configuration().cleanObjectUDMFProps(things_[a]);
-			object_def += things_[a]->properties.toString(true);
-		}
+	out += "}\n\n";
+}
 
-		object_def += "}\n\n";
-		tempfile.Write(object_def);
-	}
-	//LOG_MESSAGE(1, "Writing things took %dms", clock.getElapsedTime().asMilliseconds());
+/* SLADEMap::writeUDMFLine
+ * Appends the UDMF definition of [line] to [out]
+ *******************************************************************/
+void SLADEMap::writeUDMFLine(MapLine* line, unsigned index, std::string& out)
+{
+	appendBlockStart(out, "linedef", index);
 
-	// Write lines
-	//clock.restart();
-	for (unsigned a = 0; a < lines_.size(); a++)
-	{
-		object_def = S_FMT("linedef//#%u\n{\n", a);
+	// Basic properties
+	appendKeyInt(out, "v1", line->v1Index());
+	appendKeyInt(out, "v2", line->v2Index());
+	appendKeyInt(out, "sidefront", line->s1Index());
+	if (line->s2()) appendKeyInt(out, "sideback", line->s2Index());
+	if (line->special != 0) appendKeyInt(out, "special", line->special);
+	if (line->line_id != 0) appendKeyInt(out, "id", line->line_id);
 
-		// Basic properties
-		object_def += S_FMT("v1=%d;\nv2=%d;\nsidefront=%d;\n", lines_[a]->v1Index(), lines_[a]->v2Index(), lines_[a]->s1Index());
-		if (lines_[a]->s2())
-			object_def += S_FMT("sideback=%d;\n", lines_[a]->s2Index());
-		if (lines_[a]->special != 0)
-			object_def += S_FMT("special=%d;\n", lines_[a]->special);
-		if (lines_[a]->line_id != 0)
-			object_def += S_FMT("id=%d;\n", lines_[a]->line_id);
+	// Other properties
+	if (!line->properties.isEmpty())
+		appendProperties(out, line->properties);
 
-		// Remove internal 'flags' property if it exists
-		lines_[a]->props().removeProperty("flags");
+	out += "}\n\n";
+}
 
-		// Other properties
-		if (!lines_[a]->properties.isEmpty())
-		{
-			Game::configuration().cleanObjectUDMFProps(lines_[a]);
-			object_def += lines_[a]->properties.toString(true);
-		}
+/* SLADEMap::writeUDMFSide
+ * Appends the UDMF definition of [side] to [out]
+ *******************************************************************/
+void SLADEMap::writeUDMFSide(MapSide* side, unsigned index, std::string& out)
+{
+	appendBlockStart(out, "sidedef", index);
 
-		object_def += "}\n\n";
-		tempfile.Write(object_def);
-	}
-	//LOG_MESSAGE(1, "Writing lines took %dms", clock.getElapsedTime().asMilliseconds());
+	// Basic properties
+	appendKeyInt(out, "sector", side->sector->getIndex());
+	if (side->tex_upper != "-") appendKeyString(out, "texturetop", side->tex_upper);
+	if (side->tex_middle != "-") appendKeyString(out, "texturemiddle", side->tex_middle);
+	if (side->tex_lower != "-") appendKeyString(out, "texturebottom", side->tex_lower);
+	if (side->offset_x != 0) appendKeyInt(out, "offsetx", side->offset_x);
+	if (side->offset_y != 0) appendKeyInt(out, "offsety", side->offset_y);
 
-	// Write sides
-	//clock.restart();
-	for (unsigned a = 0; a < sides_.size(); a++)
-	{
-		object_def = S_FMT("sidedef//#%u\n{\n", a);
-
-		// Basic properties
-		object_def += S_FMT("sector=%u;\n", sides_[a]->sector->getIndex());
-		if (sides_[a]->tex_upper != "-")
-			object_def += S_FMT("texturetop=\"%s\";\n", sides_[a]->tex_upper);
-		if (sides_[a]->tex_middle != "-")
-			object_def += S_FMT("texturemiddle=\"%s\";\n", sides_[a]->tex_middle);
-		if (sides_[a]->tex_lower != "-")
-			object_def += S_FMT("texturebottom=\"%s\";\n", sides_[a]->tex_lower);
-		if (sides_[a]->offset_x != 0)
-			object_def += S_FMT("offsetx=%d;\n", sides_[a]->offset_x);
-		if (sides_[a]->offset_y != 0)
-			object_def += S_FMT("offsety=%d;\n", sides_[a]->offset_y);
-
-		// Other properties
-		if (!sides_[a]->properties.isEmpty())
-		{
-			Game::configuration().cleanObjectUDMFProps(sides_[a]);
-			object_def += sides_[a]->properties.toString(true);
-		}
+	// Other properties
+	if (!side->properties.isEmpty())
+		appendProperties(out, side->properties);
 
-		object_def += "}\n\n";
-		tempfile.Write(object_def);
-	}
-	//LOG_MESSAGE(1, "Writing sides took %dms", clock.getElapsedTime().asMilliseconds());
+	out += "}\n\n";
+}
 
-	// Write vertices
-	//clock.restart();
-	for (unsigned a = 0; a < vertices_.size(); a++)
-	{
-		object_def = S_FMT("vertex//#%u\n{\n", a);
+/* SLADEMap::writeUDMFVertex
+ * Appends the UDMF definition of [vertex] to [out]
+ *******************************************************************/
+void SLADEMap::writeUDMFVertex(MapVertex* vertex, unsigned index, std::string& out)
+{
+	appendBlockStart(out, "vertex", index);
 
-		// Basic properties
-		object_def += S_FMT("x=%1.3f;\ny=%1.3f;\n", vertices_[a]->x, vertices_[a]->y);
+	// Basic properties
+	out += "x=";
+	appendFloat(out, vertex->x, 3);
+	out += ";\ny=";
+	appendFloat(out, vertex->y, 3);
+	out += ";\n";
 
-		// Other properties
-		if (!vertices_[a]->properties.isEmpty())
-		{
-			Game::configuration().cleanObjectUDMFProps(vertices_[a]);
-			object_def += vertices_[a]->properties.toString(true);
-		}
+	// Other properties
+	if (!vertex->properties.isEmpty())
+		appendProperties(out, vertex->properties);
 
-		object_def += "}\n\n";
-		tempfile.Write(object_def);
-	}
-	//LOG_MESSAGE(1, "Writing vertices took %dms", clock.getElapsedTime().asMilliseconds());
+	out += "}\n\n";
+}
 
-	// Write sectors
-	//clock.restart();
-	for (unsigned a = 0; a < sectors_.size(); a++)
-	{
-		object_def = S_FMT("sector//#%u\n{\n", a);
+/* SLADEMap::writeUDMFSector
+ * Appends the UDMF definition of [sector] to [out]
+ *******************************************************************/
+void SLADEMap::writeUDMFSector(MapSector* sector, unsigned index, std::string& out)
+{
+	appendBlockStart(out, "sector", index);
 
-		// Basic properties
-		object_def += S_FMT("texturefloor=\"%s\";\ntextureceiling=\"%s\";\n", sectors_[a]->f_tex, sectors_[a]->c_tex);
-		if (sectors_[a]->f_height != 0) object_def += S_FMT("heightfloor=%d;\n", sectors_[a]->f_height);
-		if (sectors_[a]->c_height != 0) object_def += S_FMT("heightceiling=%d;\n", sectors_[a]->c_height);
-		if (sectors_[a]->light != 160) object_def += S_FMT("lightlevel=%d;\n", sectors_[a]->light);
-		if (sectors_[a]->special != 0) object_def += S_FMT("special=%d;\n", sectors_[a]->special);
-		if (sectors_[a]->tag != 0) object_def += S_FMT("id=%d;\n", sectors_[a]->tag);
+	// Basic properties
+	appendKeyString(out, "texturefloor", sector->f_tex);
+	appendKeyString(out, "textureceiling", sector->c_tex);
+	if (sector->f_height != 0) appendKeyInt(out, "heightfloor", sector->f_height);
+	if (sector->c_height != 0) appendKeyInt(out, "heightceiling", sector->c_height);
+	if (sector->light != 160) appendKeyInt(out, "lightlevel", sector->light);
+	if (sector->special != 0) appendKeyInt(out, "special", sector->special);
+	if (sector->tag != 0) appendKeyInt(out, "id", sector->tag);
 
-		// Other properties
-		if (!sectors_[a]->properties.isEmpty())
-		{
-			Game::configuration().cleanObjectUDMFProps(sectors_[a]);
-			object_def += sectors_[a]->properties.toString(true);
-		}
+	// Other properties
+	if (!sector->properties.isEmpty())
+		appendProperties(out, sector->properties);
 
-		object_def += "}\n\n";
-		tempfile.Write(object_def);
-	}
-	//LOG_MESSAGE(1, "Writing sectors took %dms", clock.getElapsedTime().asMilliseconds());
+	out += "}\n\n";
+}
 
-	// Close file
-	tempfile.Close();
+/* SLADEMap::writeUDMFMap
+ * Writes map as UDMF format text to [textmap]. Each object type is
+ * split into ranges which are written to separate buffers in
+ * parallel (only reading the objects), then the buffers are joined
+ * into the entry data
+ *******************************************************************/
+bool SLADEMap::writeUDMFMap(ArchiveEntry* textmap)
+{
+	// Check entry was given
+	if (!textmap)
+		return false;
 
-	// Load file to entry
-	textmap->importFile(App::path("sladetemp.txt", App::Dir::Temp));
+	// Remove internal 'flags' properties and any properties set to their
+	// defaults first, so the parallel writing below doesn't modify anything
+	auto& config = Game::configuration();
+	auto clean_props = [&config](MapObject* object)
+	{
+		if (!object->props().isEmpty())
+			config.cleanObjectUDMFProps(object);
+	};
+	for (auto thing : things_)
+	{
+		thing->props().removeProperty("flags");
+		clean_props(thing);
+	}
+	for (auto line : lines_)
+	{
+		line->props().removeProperty("flags");
+		clean_props(line);
+	}
+	for (auto side : sides_)
+		clean_props(side);
+	for (auto vertex : vertices_)
+		clean_props(vertex);
+	for (auto sector : sectors_)
+		clean_props(sector);
+
+	// Buffers for each written range, in order
+	vector<std::string> buffers;
+
+	// Write map namespace and map-scope props
+	std::string header = "// Written by SLADE3\nnamespace=\"";
+	appendString(header, udmf_namespace_);
+	header += "\";\n";
+	appendString(header, udmf_props_.toString(true));
+	header += "\n";
+	buffers.push_back(std::move(header));
+
+	// Writes [count] objects to new buffers via [write_func], reserving
+	// [estimate] bytes per object
+	auto write_objects = [&buffers](size_t count, size_t estimate, const std::function<void(unsigned, std::string&)>& write_func)
+	{
+		vector<std::string> range_buffers(ThreadPool::nThreads());
+		unsigned n_ranges = ThreadPool::parallelForRanges(
+			count,
+			[&](size_t begin, size_t end, unsigned range)
+			{
+				std::string& out = range_buffers[range];
+				out.reserve((end - begin) * estimate);
+				for (size_t a = begin; a < end; a++)
+					write_func(a, out);
+			},
+			1024
+		);
+
+		for (unsigned a = 0; a < n_ranges; a++)
+			buffers.push_back(std::move(range_buffers[a]));
+	};
+
+	write_objects(things_.size(), 96, [this](unsigned a, std::string& out) { writeUDMFThing(things_[a], a, out); });
+	write_objects(lines_.size(), 96, [this](unsigned a, std::string& out) { writeUDMFLine(lines_[a], a, out); });
+	write_objects(sides_.size(), 80, [this](unsigned a, std::string& out) { writeUDMFSide(sides_[a], a, out); });
+	write_objects(vertices_.size(), 48, [this](unsigned a, std::string& out) { writeUDMFVertex(vertices_[a], a, out); });
+	write_objects(sectors_.size(), 144, [this](unsigned a, std::string& out) { writeUDMFSector(sectors_[a], a, out); });
+
+	// Join buffers
+	size_t total_size = 0;
+	for (auto& buffer : buffers)
+		total_size += buffer.size();
+	MemChunk mc(total_size);
+	for (auto& buffer : buffers)
+		mc.write(buffer.data(), buffer.size());
+
+	// Load to entry
+	textmap->importMemChunk(mc);
 
 	return true;
 }
@@ -2526,14 +2968,20 @@ void SLADEMap::clearMap()
 	vertices_.clear();
 	sectors_.clear();
 	things_.clear();
+	geometry_store_.clear();
+	tag_index_.clear();
+	sector_geometry_.clear();
+	dirty_vertices_.clear();
+	dirty_lines_.clear();
+	geometry_dirty_.clear();
 
 	// Clear map objects
-	for (unsigned a = 0; a < all_objects_.size(); a++)
-	{
-		if (all_objects_[a].mobj)
-			delete all_objects_[a].mobj;
-	}
 	all_objects_.clear();
+	vertex_pool_.clear();
+	line_pool_.clear();
+	side_pool_.clear();
+	sector_pool_.clear();
+	thing_pool_.clear();
 
 	// Object id 0 is always null
 	all_objects_.push_back(mobj_holder_t(nullptr, false));
@@ -2597,6 +3045,7 @@ bool SLADEMap::removeVertex(unsigned index, bool merge_lines)
 		vertices_[index]->disconnectLine(l_first);
 		v_end->connectLine(l_first);
 		l_first->resetInternals();
+		lineGeometryChanged(l_first);
 
 		// Check if we ended up with overlapping lines (ie. there was a triangle)
 		for (unsigned a = 0; a < v_end->nConnectedLines(); a++)
@@ -2629,6 +3078,7 @@ bool SLADEMap::removeVertex(unsigned index, bool merge_lines)
 	vertices_[index] = vertices_.back();
 	vertices_[index]->index = index;
 	vertices_.pop_back();
+	geometryVertexRemoved(index);
 
 	geometry_updated_ = App::runTimer();
 
@@ -2679,6 +3129,8 @@ bool SLADEMap::removeLine(unsigned index)
 	lines_[index]->index = index;
 	//lines[index]->modified_time = App::runTimer();
 	lines_.pop_back();
+	if (geometry_store_.isValid())
+		geometry_store_.removeLine(index);
 
 	geometry_updated_ = App::runTimer();
 
@@ -2833,16 +3285,16 @@ bool SLADEMap::removeThing(unsigned index)
 int SLADEMap::nearestVertex(fpoint2_t point, double min)
 {
 	// Go through vertices
+	const MapGeometryStore& geometry = geometryStore();
+	const vector<double>& vx = geometry.vertexX();
+	const vector<double>& vy = geometry.vertexY();
 	double min_dist = 999999999;
-	MapVertex* v = nullptr;
 	double dist = 0;
 	int index = -1;
-	for (unsigned a = 0; a < vertices_.size(); a++)
+	for (unsigned a = 0; a < vx.size(); a++)
 	{
-		v = vertices_[a];
-
 		// Get 'quick' distance (no need to get real distance)
-		dist = point.taxicab_distance_to(v->point());
+		dist = fabs(point.x - vx[a]) + fabs(point.y - vy[a]);
 
 		// Check if it's nearer than the previous nearest
 		if (dist < min_dist)
@@ -2856,8 +3308,7 @@ int SLADEMap::nearestVertex(fpoint2_t point, double min)
 	// to check for minimum hilight distance
 	if (index >= 0)
 	{
-		v = vertices_[index];
-		double rdist = MathStuff::distance(v->point(), point);
+		double rdist = MathStuff::distance(fpoint2_t(vx[index], vy[index]), point);
 		if (rdist > min)
 			return -1;
 	}
@@ -2872,22 +3323,18 @@ int SLADEMap::nearestVertex(fpoint2_t point, double min)
 int SLADEMap::nearestLine(fpoint2_t point, double mindist)
 {
 	// Go through lines
+	const MapGeometryStore& geometry = geometryStore();
 	double min_dist = mindist;
 	double dist = 0;
 	int index = -1;
-	MapLine* l;
-	for (unsigned a = 0; a < lines_.size(); a++)
+	for (unsigned a = 0; a < geometry.nLines(); a++)
 	{
-		l = lines_[a];
-
 		// Check with line bounding box first (since we have a minimum distance)
-		fseg2_t bbox = l->seg();
-		bbox.expand(mindist, mindist);
-		if (! bbox.contains(point))
+		if (!geometry.lineBBoxIntersects(a, point.x - mindist, point.y - mindist, point.x + mindist, point.y + mindist))
 			continue;
 
 		// Calculate distance to line
-		dist = l->distanceTo(point);
+		dist = lines_[a]->distanceTo(point);
 
 		// Check if it's nearer than the previous nearest
 		if (dist < min_dist && dist < mindist)
@@ -3026,9 +3473,12 @@ bbox_t SLADEMap::getMapBBox()
 MapVertex* SLADEMap::vertexAt(double x, double y)
 {
 	// Go through all vertices
-	for (unsigned a = 0; a < vertices_.size(); a++)
+	const MapGeometryStore& geometry = geometryStore();
+	const vector<double>& vx = geometry.vertexX();
+	const vector<double>& vy = geometry.vertexY();
+	for (unsigned a = 0; a < vx.size(); a++)
 	{
-		if (vertices_[a]->x == x && vertices_[a]->y == y)
+		if (vx[a] == x && vy[a] == y)
 			return vertices_[a];
 	}
 
@@ -3153,37 +3603,86 @@ MapVertex* SLADEMap::lineCrossVertex(double x1, double y1, double x2, double y2)
 
 /* SLADEMap::updateGeometryInfo
  * Updates geometry info (polygons/bbox/etc) for anything modified
- * since [modified_time]
+ * since [modified_time]. Only vertices and lines that were changed
+ * (via vertexGeometryChanged/lineGeometryChanged) are processed, and
+ * each affected sector is only updated once. If [modified_time] is 0,
+ * all vertices are checked
  *******************************************************************/
 void SLADEMap::updateGeometryInfo(long modified_time)
 {
-	for (unsigned a = 0; a < vertices_.size(); a++)
+	geometry_update_stats_ = geometry_update_stats_t();
+
+	// Check all vertices if requested
+	if (modified_time <= 0)
 	{
-		if (vertices_[a]->modifiedTime() > modified_time)
-		{
-			for (unsigned l = 0; l < vertices_[a]->connected_lines.size(); l++)
-			{
-				MapLine* line = vertices_[a]->connected_lines[l];
+		for (unsigned a = 0; a < vertices_.size(); a++)
+			if (vertices_[a]->modifiedTime() > modified_time && markGeometryDirty(vertices_[a]))
+				dirty_vertices_.push_back(vertices_[a]);
+	}
 
-				// Update line geometry
-				line->resetInternals();
+	// Lines connected to changed vertices
+	for (auto vertex : dirty_vertices_)
+	{
+		for (auto line : vertex->connected_lines)
+			if (markGeometryDirty(line))
+				dirty_lines_.push_back(line);
 
-				// Update front sector
-				if (line->frontSector())
-				{
-					line->frontSector()->resetPolygon();
-					line->frontSector()->updateBBox();
-				}
+		geometry_dirty_[vertex->id] = 0;
+	}
+	geometry_update_stats_.vertices = dirty_vertices_.size();
+	dirty_vertices_.clear();
 
-				// Update back sector
-				if (line->backSector())
-				{
-					line->backSector()->resetPolygon();
-					line->backSector()->updateBBox();
-				}
-			}
+	// Update line geometry, and get affected sectors
+	vector<MapSector*> sectors;
+	for (auto line : dirty_lines_)
+	{
+		line->resetInternals();
+		geometry_dirty_[line->id] = 0;
+
+		MapSector* front = line->frontSector();
+		MapSector* back = line->backSector();
+		if (front)
+		{
+			if (markGeometryDirty(front))
+				sectors.push_back(front);
+			else
+				geometry_update_stats_.sector_resets_saved++;
+		}
+		if (back)
+		{
+			if (markGeometryDirty(back))
+				sectors.push_back(back);
+			else
+				geometry_update_stats_.sector_resets_saved++;
 		}
 	}
+	geometry_update_stats_.lines = dirty_lines_.size();
+	dirty_lines_.clear();
+
+	// Update each affected sector once
+	for (auto sector : sectors)
+	{
+		sector->resetPolygon();
+		sector->updateBBox();
+		geometry_dirty_[sector->id] = 0;
+	}
+	geometry_update_stats_.sectors = sectors.size();
+}
+
+/* SLADEMap::markGeometryDirty
+ * Flags [object] as having geometry changes to process. Returns false
+ * if it was already flagged
+ *******************************************************************/
+bool SLADEMap::markGeometryDirty(MapObject* object)
+{
+	if (object->id >= geometry_dirty_.size())
+		geometry_dirty_.resize(all_objects_.size());
+
+	if (geometry_dirty_[object->id])
+		return false;
+
+	geometry_dirty_[object->id] = 1;
+	return true;
 }
 
 /* SLADEMap::linesIntersect
@@ -3200,9 +3699,10 @@ bool SLADEMap::linesIntersect(MapLine* line1, MapLine* line2, double& x, double&
 }
 
 /* SLADEMap::findSectorTextPoint
- * Finds the 'text point' for [sector]. This is a point within the
- * sector that is reasonably close to the middle of the sector bbox
- * while still being within the sector itself
+ * Finds the 'text point' for [sector]. This is the point within the
+ * sector furthest from any of its lines (see
+ * MapSectorGeometry::findTextPoint). The result is kept by the sector
+ * until its lines change
  *******************************************************************/
 void SLADEMap::findSectorTextPoint(MapSector* sector)
 {
@@ -3210,51 +3710,14 @@ void SLADEMap::findSectorTextPoint(MapSector* sector)
 	if (!sector)
 		return;
 
-	// Check if actual sector midpoint can be used
-	sector->text_point = sector->getPoint(MOBJ_POINT_MID);
-	if (sector->isWithin(sector->text_point))
+	// Use the text point precomputed on map load if possible
+	sector->text_point_valid = true;
+	if (sector_geometry_.getTextPoint(sector, sector->text_point))
 		return;
 
-	if (sector->connected_sides.size() == 0)
-		return;
-
-	// Find nearest line to sector midpoint (that is also part of the sector)
-	double min_dist = 9999999999.0;
-	MapSide* mid_side = sector->connected_sides[0];
-	for (unsigned a = 0; a < sector->connected_sides.size(); a++)
-	{
-		MapLine* l = sector->connected_sides[a]->parent;
-		double dist = MathStuff::distanceToLineFast(sector->text_point, l->seg());
-
-		if (dist < min_dist)
-		{
-			min_dist = dist;
-			mid_side = sector->connected_sides[a];
-		}
-	}
-
-	// Calculate ray
-	fpoint2_t r_o = mid_side->parent->getPoint(MOBJ_POINT_MID);
-	fpoint2_t r_d = mid_side->parent->frontVector();
-	if (mid_side == mid_side->parent->side1)
-		r_d.set(-r_d.x, -r_d.y);
-
-	// Find nearest intersecting line
-	min_dist = 9999999999.0;
-	for (unsigned a = 0; a < sector->connected_sides.size(); a++)
-	{
-		if (sector->connected_sides[a] == mid_side)
-			continue;
-
-		MapLine* line = sector->connected_sides[a]->parent;
-		double dist = MathStuff::distanceRayLine(r_o, r_o + r_d, line->point1(), line->point2());
-
-		if (dist > 0 && dist < min_dist)
-			min_dist = dist;
-	}
-
-	// Set text point to halfway between the two lines
-	sector->text_point.set(r_o.x + (r_d.x * min_dist * 0.5), r_o.y + (r_d.y * min_dist * 0.5));
+	vector<MapSectorGeometry::edge_t> edges;
+	MapSectorGeometry::getEdges(sector, edges);
+	sector->text_point = MapSectorGeometry::findTextPoint(edges, sector->boundingBox());
 }
 
 /* SLADEMap::initSectorPolygons
@@ -3317,6 +3780,134 @@ MapLine* SLADEMap::lineVectorIntersect(MapLine* line, bool front, double& hit_x,
 	return nearest;
 }
 
+/* SLADEMap::geometryStore
+ * Returns the structure-of-arrays geometry store for the map,
+ * rebuilding it first if it is out of date
+ *******************************************************************/
+const MapGeometryStore& SLADEMap::geometryStore()
+{
+	if (!geometry_store_.isValid() ||
+		geometry_store_.nVertices() != vertices_.size() ||
+		geometry_store_.nLines() != lines_.size())
+		geometry_store_.rebuild(vertices_, lines_);
+
+	return geometry_store_;
+}
+
+/* SLADEMap::vertexGeometryChanged
+ * Updates the geometry store for [vertex], which was either just
+ * added to the map or moved, and flags the map geometry as updated
+ *******************************************************************/
+void SLADEMap::vertexGeometryChanged(MapVertex* vertex)
+{
+	geometry_updated_ = App::runTimer();
+
+	// Flag for updateGeometryInfo
+	if (markGeometryDirty(vertex))
+		dirty_vertices_.push_back(vertex);
+
+	// Nothing to do if the store will be rebuilt anyway, or if the
+	// vertex isn't (yet) part of the map
+	unsigned index = vertex->index;
+	if (!geometry_store_.isValid() || index >= vertices_.size() || vertices_[index] != vertex)
+		return;
+
+	if (index == geometry_store_.nVertices())
+		geometry_store_.addVertex(vertex->x, vertex->y);
+	else if (index < geometry_store_.nVertices())
+	{
+		geometry_store_.setVertex(index, vertex->x, vertex->y);
+
+		// Update connected lines' bounding boxes
+		for (auto line : vertex->connected_lines)
+			lineGeometryChanged(line);
+	}
+	else
+		geometry_store_.invalidate();
+}
+
+/* SLADEMap::lineGeometryChanged
+ * Updates the geometry store for [line], which was either just added
+ * to the map or had its vertices changed, and flags the map geometry
+ * as updated
+ *******************************************************************/
+void SLADEMap::lineGeometryChanged(MapLine* line)
+{
+	geometry_updated_ = App::runTimer();
+
+	// Flag for updateGeometryInfo
+	if (markGeometryDirty(line))
+		dirty_lines_.push_back(line);
+
+	// Nothing to do if the store will be rebuilt anyway, or if the line
+	// isn't (yet) part of the map
+	unsigned index = line->index;
+	if (!geometry_store_.isValid() || index >= lines_.size() || lines_[index] != line)
+		return;
+
+	unsigned v1 = line->vertex1 ? line->vertex1->index : 0;
+	unsigned v2 = line->vertex2 ? line->vertex2->index : 0;
+	if (index == geometry_store_.nLines())
+		geometry_store_.addLine(v1, v2);
+	else if (index < geometry_store_.nLines())
+		geometry_store_.setLine(index, v1, v2);
+	else
+		geometry_store_.invalidate();
+}
+
+/* SLADEMap::geometryVertexRemoved
+ * Updates the geometry store after the vertex at [index] was removed
+ * (and replaced with the last vertex)
+ *******************************************************************/
+void SLADEMap::geometryVertexRemoved(unsigned index)
+{
+	if (!geometry_store_.isValid())
+		return;
+
+	geometry_store_.removeVertex(index);
+
+	// Lines connected to the vertex that was moved to [index] need
+	// their vertex indices updated
+	if (index < vertices_.size())
+	{
+		for (auto line : vertices_[index]->connected_lines)
+			lineGeometryChanged(line);
+	}
+}
+
+/* SLADEMap::objectTagsChanged
+ * Called when the tag, id, special or args of [object] may have
+ * changed, updates the tag index
+ *******************************************************************/
+void SLADEMap::objectTagsChanged(MapObject* object)
+{
+	tag_index_.update(object);
+}
+
+/* SLADEMap::getIndexedObjects
+ * Adds all objects currently in the map that are indexed under
+ * [value] in tag index [index] to [list], sorted by index
+ *******************************************************************/
+void SLADEMap::getIndexedObjects(MapTagIndex::Index index, int value, vector<MapObject*>& list)
+{
+	if (!tag_index_.isValid())
+		tag_index_.rebuild(sectors_, lines_, things_);
+
+	size_t start = list.size();
+	for (auto id : tag_index_.objects(index, value))
+	{
+		if (id < all_objects_.size() && all_objects_[id].in_map)
+			list.push_back(all_objects_[id].mobj);
+	}
+
+	if (list.size() - start > 1)
+	{
+		vector<MapObject*> found(list.begin() + start, list.end());
+		sortByIndex(found);
+		std::copy(found.begin(), found.end(), list.begin() + start);
+	}
+}
+
 /* SLADEMap::getSectorsByTag
  * Adds all sectors with tag [tag] to [list]
  *******************************************************************/
@@ -3326,10 +3917,13 @@ void SLADEMap::getSectorsByTag(int tag, vector<MapSector*>& list)
 		return;
 
 	// Find sectors with matching tag
-	for (unsigned a = 0; a < sectors_.size(); a++)
+	vector<MapObject*> found;
+	getIndexedObjects(MapTagIndex::SectorTags, tag, found);
+	for (auto object : found)
 	{
-		if (sectors_[a]->tag == tag)
-			list.push_back(sectors_[a]);
+		MapSector* sector = (MapSector*)object;
+		if (sector->tag == tag)
+			list.push_back(sector);
 	}
 }
 
@@ -3343,10 +3937,13 @@ void SLADEMap::getThingsById(int id, vector<MapThing*>& list, unsigned start, in
 		return;
 
 	// Find things with matching id
-	for (unsigned a = start; a < things_.size(); a++)
+	vector<MapObject*> found;
+	getIndexedObjects(MapTagIndex::ThingIds, id, found);
+	for (auto object : found)
 	{
-		if (things_[a]->intProperty("id") == id && (type == 0 || things_[a]->type == type))
-			list.push_back(things_[a]);
+		MapThing* thing = (MapThing*)object;
+		if (thing->index >= start && thing->intProperty("id") == id && (type == 0 || thing->type == type))
+			list.push_back(thing);
 	}
 }
 
@@ -3359,11 +3956,14 @@ MapThing* SLADEMap::getFirstThingWithId(int id)
 		return nullptr;
 
 	// Find things with matching id, but ignore dragons, we don't want them!
-	for (unsigned a = 0; a < things_.size(); a++)
+	vector<MapObject*> found;
+	getIndexedObjects(MapTagIndex::ThingIds, id, found);
+	for (auto object : found)
 	{
-		auto& tt = Game::configuration().thingType(things_[a]->getType());
-		if (things_[a]->intProperty("id") == id && !(tt.flags() & Game::ThingType::FLAG_DRAGON))
-			return things_[a];
+		MapThing* thing = (MapThing*)object;
+		auto& tt = Game::configuration().thingType(thing->getType());
+		if (thing->intProperty("id") == id && !(tt.flags() & Game::ThingType::FLAG_DRAGON))
+			return thing;
 	}
 	return nullptr;
 }
@@ -3377,15 +3977,23 @@ void SLADEMap::getThingsByIdInSectorTag(int id, int tag, vector<MapThing*>& list
 	if (id==0 && tag==0)
 		return;
 
+	// Things with id 0 aren't indexed, check them all
+	vector<MapObject*> found;
+	if (id == 0)
+		found.assign(things_.begin(), things_.end());
+	else
+		getIndexedObjects(MapTagIndex::ThingIds, id, found);
+
 	// Find things with matching id contained in sector with matching tag
-	for (unsigned a = 0; a < things_.size(); a++)
+	for (auto object : found)
 	{
-		if (things_[a]->intProperty("id") == id)
+		MapThing* thing = (MapThing*)object;
+		if (thing->intProperty("id") == id)
 		{
-			int si = sectorAt(things_[a]->point());
+			int si = sectorAt(thing->point());
 			if (si > -1 && (unsigned)si < sectors_.size() && sectors_[si]->tag == tag)
 			{
-				list.push_back(things_[a]);
+				list.push_back(thing);
 			}
 		}
 	}
@@ -3440,10 +4048,13 @@ void SLADEMap::getLinesById(int id, vector<MapLine*>& list)
 		return;
 
 	// Find lines with matching id
-	for (unsigned a = 0; a < lines_.size(); a++)
+	vector<MapObject*> found;
+	getIndexedObjects(MapTagIndex::LineIds, id, found);
+	for (auto object : found)
 	{
-		if (lines_[a]->line_id == id)
-			list.push_back(lines_[a]);
+		MapLine* line = (MapLine*)object;
+		if (line->line_id == id)
+			list.push_back(line);
 	}
 }
 
@@ -3452,115 +4063,22 @@ void SLADEMap::getLinesById(int id, vector<MapLine*>& list)
  *******************************************************************/
 void SLADEMap::getTaggingThingsById(int id, int type, vector<MapThing*>& list, int ttype)
 {
-	using Game::TagType;
+	if (id == 0)
+		return;
+
+	// Only things with an arg (or TID, for path specials) matching id can
+	// affect it
+	vector<MapObject*> found;
+	getIndexedObjects(MapTagIndex::ThingArgs, id, found);
+	getIndexedObjects(MapTagIndex::ThingIds, id, found);
+	sortByIndex(found);
+	found.erase(std::unique(found.begin(), found.end()), found.end());
 
 	// Find things with special affecting matching id
-	int tag, arg2, arg3, arg4, arg5, tid;
-	for (unsigned a = 0; a < things_.size(); a++)
+	for (auto object : found)
 	{
-		auto& tt = Game::configuration().thingType(things_[a]->getType());
-		auto needs_tag = tt.needsTag();
-		if (needs_tag != TagType::None ||
-			(things_[a]->intProperty("special") && !(tt.flags() & Game::ThingType::FLAG_SCRIPT)))
-		{
-			if (needs_tag == TagType::None)
-				needs_tag = Game::configuration().actionSpecial(things_[a]->intProperty("special")).needsTag();
-			tag = things_[a]->intProperty("arg0");
-			bool fits = false;
-			int path_type;
-			switch (needs_tag)
-			{
-			case TagType::Sector:
-			case TagType::SectorOrBack:
-			case TagType::SectorAndBack:
-				fits = (IDEQ(tag) && type == SECTORS);
-				break;
-			case TagType::LineNegative:
-				tag = abs(tag);
-			case TagType::Line:
-				fits = (IDEQ(tag) && type == LINEDEFS);
-				break;
-			case TagType::Thing:
-				fits = (IDEQ(tag) && type == THINGS);
-				break;
-			case TagType::Thing1Sector2:
-				arg2 = things_[a]->intProperty("arg1");
-				fits = (type == THINGS ? IDEQ(tag) : (IDEQ(arg2) && type == SECTORS));
-				break;
-			case TagType::Thing1Sector3:
-				arg3 = things_[a]->intProperty("arg2");
-				fits = (type == THINGS ? IDEQ(tag) : (IDEQ(arg3) && type == SECTORS));
-				break;
-			case TagType::Thing1Thing2:
-				arg2 = things_[a]->intProperty("arg1");
-				fits = (type == THINGS && (IDEQ(tag) || IDEQ(arg2)));
-				break;
-			case TagType::Thing1Thing4:
-				arg4 = things_[a]->intProperty("arg3");
-				fits = (type == THINGS && (IDEQ(tag) || IDEQ(arg4)));
-				break;
-			case TagType::Thing1Thing2Thing3:
-				arg2 = things_[a]->intProperty("arg1");
-				arg3 = things_[a]->intProperty("arg2");
-				fits = (type == THINGS && (IDEQ(tag) || IDEQ(arg2) || IDEQ(arg3)));
-				break;
-			case TagType::Sector1Thing2Thing3Thing5:
-				arg2 = things_[a]->intProperty("arg1");
-				arg3 = things_[a]->intProperty("arg2");
-				arg5 = things_[a]->intProperty("arg4");
-				fits = (type == SECTORS ? (IDEQ(tag)) : (type == THINGS &&
-						(IDEQ(arg2) || IDEQ(arg3) || IDEQ(arg5))));
-				break;
-			case TagType::LineId1Line2:
-				arg2 = things_[a]->intProperty("arg1");
-				fits = (type == LINEDEFS && IDEQ(arg2));
-				break;
-			case TagType::Thing4:
-				arg4 = things_[a]->intProperty("arg3");
-				fits = (type == THINGS && IDEQ(arg4));
-				break;
-			case TagType::Thing5:
-				arg5 = things_[a]->intProperty("arg4");
-				fits = (type == THINGS && IDEQ(arg5));
-				break;
-			case TagType::Line1Sector2:
-				arg2 = things_[a]->intProperty("arg1");
-				fits = (type == LINEDEFS ? (IDEQ(tag)) : (IDEQ(arg2) && type == SECTORS));
-				break;
-			case TagType::Sector1Sector2:
-				arg2 = things_[a]->intProperty("arg1");
-				fits = (type == SECTORS && (IDEQ(tag) || IDEQ(arg2)));
-				break;
-			case TagType::Sector1Sector2Sector3Sector4:
-				arg2 = things_[a]->intProperty("arg1");
-				arg3 = things_[a]->intProperty("arg2");
-				arg4 = things_[a]->intProperty("arg3");
-				fits = (type == SECTORS && (IDEQ(tag) || IDEQ(arg2) || IDEQ(arg3) || IDEQ(arg4)));
-				break;
-			case TagType::Sector2Is3Line:
-				arg2 = things_[a]->intProperty("arg1");
-				fits = (IDEQ(tag) && (arg2 == 3 ? type == LINEDEFS : type == SECTORS));
-				break;
-			case TagType::Sector1Thing2:
-				arg2 = things_[a]->intProperty("arg1");
-				fits = (type == SECTORS ? (IDEQ(tag)) : (IDEQ(arg2) && type == THINGS));
-				break;
-			case TagType::Patrol:
-				path_type = 9047;
-			case TagType::Interpolation:
-			{
-				path_type = 9075;
-
-				tid = things_[a]->intProperty("id");
-				auto& tt = Game::configuration().thingType(things_[a]->getType());
-				fits = ((path_type == ttype) && (IDEQ(tid)) && (tt.needsTag() == needs_tag));
-			}
-				break;
-			default:
-				break;
-			}
-			if (fits) list.push_back(things_[a]);
-		}
+		if (thingTagsId((MapThing*)object, id, type, ttype))
+			list.push_back((MapThing*)object);
 	}
 }
 
@@ -3569,99 +4087,17 @@ void SLADEMap::getTaggingThingsById(int id, int type, vector<MapThing*>& list, i
  *******************************************************************/
 void SLADEMap::getTaggingLinesById(int id, int type, vector<MapLine*>& list)
 {
-	using Game::TagType;
+	if (id == 0)
+		return;
 
-	// Find lines with special affecting matching id
-	int tag, arg2, arg3, arg4, arg5;
-	for (unsigned a = 0; a < lines_.size(); a++)
+	// Find lines with special affecting matching id (only lines with an
+	// arg matching id can affect it)
+	vector<MapObject*> found;
+	getIndexedObjects(MapTagIndex::LineArgs, id, found);
+	for (auto object : found)
 	{
-		int special = lines_[a]->special;
-		if (special)
-		{
-			tag = lines_[a]->intProperty("arg0");
-			bool fits = false;
-			switch (Game::configuration().actionSpecial(lines_[a]->special).needsTag())
-			{
-			case TagType::Sector:
-			case TagType::SectorOrBack:
-			case TagType::SectorAndBack:
-				fits = (IDEQ(tag) && type == SECTORS);
-				break;
-			case TagType::LineNegative:
-				tag = abs(tag);
-			case TagType::Line:
-				fits = (IDEQ(tag) && type == LINEDEFS);
-				break;
-			case TagType::Thing:
-				fits = (IDEQ(tag) && type == THINGS);
-				break;
-			case TagType::Thing1Sector2:
-				arg2 = lines_[a]->intProperty("arg1");
-				fits = (type == THINGS ? IDEQ(tag) : (IDEQ(arg2) && type == SECTORS));
-				break;
-			case TagType::Thing1Sector3:
-				arg3 = lines_[a]->intProperty("arg2");
-				fits = (type == THINGS ? IDEQ(tag) : (IDEQ(arg3) && type == SECTORS));
-				break;
-			case TagType::Thing1Thing2:
-				arg2 = lines_[a]->intProperty("arg1");
-				fits = (type == THINGS && (IDEQ(tag) || IDEQ(arg2)));
-				break;
-			case TagType::Thing1Thing4:
-				arg4 = lines_[a]->intProperty("arg3");
-				fits = (type == THINGS && (IDEQ(tag) || IDEQ(arg4)));
-				break;
-			case TagType::Thing1Thing2Thing3:
-				arg2 = lines_[a]->intProperty("arg1");
-				arg3 = lines_[a]->intProperty("arg2");
-				fits = (type == THINGS && (IDEQ(tag) || IDEQ(arg2) || IDEQ(arg3)));
-				break;
-			case TagType::Sector1Thing2Thing3Thing5:
-				arg2 = lines_[a]->intProperty("arg1");
-				arg3 = lines_[a]->intProperty("arg2");
-				arg5 = lines_[a]->intProperty("arg4");
-				fits = (type == SECTORS ? (IDEQ(tag)) : (type == THINGS &&
-						(IDEQ(arg2) || IDEQ(arg3) || IDEQ(arg5))));
-				break;
-			case TagType::LineId1Line2:
-				arg2 = lines_[a]->intProperty("arg1");
-				fits = (type == LINEDEFS && IDEQ(arg2));
-				break;
-			case TagType::Thing4:
-				arg4 = lines_[a]->intProperty("arg3");
-				fits = (type == THINGS && IDEQ(arg4));
-				break;
-			case TagType::Thing5:
-				arg5 = lines_[a]->intProperty("arg4");
-				fits = (type == THINGS && IDEQ(arg5));
-				break;
-			case TagType::Line1Sector2:
-				arg2 = lines_[a]->intProperty("arg1");
-				fits = (type == LINEDEFS ? (IDEQ(tag)) : (IDEQ(arg2) && type == SECTORS));
-				break;
-			case TagType::Sector1Sector2:
-				arg2 = lines_[a]->intProperty("arg1");
-				fits = (type == SECTORS && (IDEQ(tag) || IDEQ(arg2)));
-				break;
-			case TagType::Sector1Sector2Sector3Sector4:
-				arg2 = lines_[a]->intProperty("arg1");
-				arg3 = lines_[a]->intProperty("arg2");
-				arg4 = lines_[a]->intProperty("arg3");
-				fits = (type == SECTORS && (IDEQ(tag) || IDEQ(arg2) || IDEQ(arg3) || IDEQ(arg4)));
-				break;
-			case TagType::Sector2Is3Line:
-				arg2 = lines_[a]->intProperty("arg1");
-				fits = (IDEQ(tag) && (arg2 == 3 ? type == LINEDEFS : type == SECTORS));
-				break;
-			case TagType::Sector1Thing2:
-				arg2 = lines_[a]->intProperty("arg1");
-				fits = (type == SECTORS ? (IDEQ(tag)) : (IDEQ(arg2) && type == THINGS));
-				break;
-			default:
-				break;
-			}
-			if (fits) list.push_back(lines_[a]);
-		}
+		if (lineTagsId((MapLine*)object, id, type))
+			list.push_back((MapLine*)object);
 	}
 }
 
@@ -3671,16 +4107,16 @@ void SLADEMap::getTaggingLinesById(int id, int type, vector<MapLine*>& list)
 int SLADEMap::findUnusedSectorTag()
 {
 	int tag = 1;
-	for (unsigned a = 0; a < sectors_.size(); a++)
+	vector<MapSector*> found;
+	while (true)
 	{
-		if (sectors_[a]->tag == tag)
-		{
-			tag++;
-			a = 0;
-		}
-	}
+		getSectorsByTag(tag, found);
+		if (found.empty())
+			return tag;
 
-	return tag;
+		found.clear();
+		tag++;
+	}
 }
 
 /* SLADEMap::findUnusedThingId
@@ -3689,16 +4125,16 @@ int SLADEMap::findUnusedSectorTag()
 int SLADEMap::findUnusedThingId()
 {
 	int tag = 1;
-	for (unsigned a = 0; a < things_.size(); a++)
+	vector<MapThing*> found;
+	while (true)
 	{
-		if (things_[a]->intProperty("id") == tag)
-		{
-			tag++;
-			a = 0;
-		}
-	}
+		getThingsById(tag, found);
+		if (found.empty())
+			return tag;
 
-	return tag;
+		found.clear();
+		tag++;
+	}
 }
 
 /* SLADEMap::findUnusedLineId
@@ -3706,48 +4142,53 @@ int SLADEMap::findUnusedThingId()
  *******************************************************************/
 int SLADEMap::findUnusedLineId()
 {
-	int tag = 1;
-
 	// UDMF (id property)
 	if (current_format_ == MAP_UDMF)
 	{
-		for (unsigned a = 0; a < lines_.size(); a++)
+		int tag = 1;
+		vector<MapLine*> found;
+		while (true)
 		{
-			if (lines_[a]->line_id == tag)
-			{
-				tag++;
-				a = 0;
-			}
+			getLinesById(tag, found);
+			if (found.empty())
+				return tag;
+
+			found.clear();
+			tag++;
 		}
 	}
 
 	// Hexen (special 121 arg0)
-	else if (current_format_ == MAP_HEXEN)
-	{
-		for (unsigned a = 0; a < lines_.size(); a++)
-		{
-			if (lines_[a]->special == 121 && lines_[a]->intProperty("arg0") == tag)
-			{
-				tag++;
-				a = 0;
-			}
-		}
-	}
+	bool hexen = (current_format_ == MAP_HEXEN);
 
 	// Boom (sector tag (arg0))
-	else if (current_format_ == MAP_DOOM && Game::configuration().featureSupported(Game::Feature::Boom))
+	bool boom = (current_format_ == MAP_DOOM && Game::configuration().featureSupported(Game::Feature::Boom));
+
+	if (!hexen && !boom)
+		return 1;
+
+	int tag = 1;
+	vector<MapObject*> found;
+	while (true)
 	{
-		for (unsigned a = 0; a < lines_.size(); a++)
+		getIndexedObjects(MapTagIndex::LineArgs, tag, found);
+		bool used = false;
+		for (auto object : found)
 		{
-			if (lines_[a]->intProperty("arg0") == tag)
+			MapLine* line = (MapLine*)object;
+			if ((!hexen || line->special == 121) && line->intProperty("arg0") == tag)
 			{
-				tag++;
-				a = 0;
+				used = true;
+				break;
 			}
 		}
-	}
 
-	return tag;
+		if (!used)
+			return tag;
+
+		found.clear();
+		tag++;
+	}
 }
 
 /* SLADEMap::getAdjecentLineTexture
@@ -4095,16 +4536,15 @@ MapVertex* SLADEMap::createVertex(double x, double y, double split_dist)
 	fpoint2_t point(x, y);
 
 	// First check that it won't overlap any other vertex
-	for (unsigned a = 0; a < vertices_.size(); a++)
-	{
-		if (vertices_[a]->x == x && vertices_[a]->y == y)
-			return vertices_[a];
-	}
+	MapVertex* existing = vertexAt(x, y);
+	if (existing)
+		return existing;
 
 	// Create the vertex
-	MapVertex* nv = new MapVertex(x, y, this);
+	MapVertex* nv = vertex_pool_.create(x, y, this);
 	nv->index = vertices_.size();
 	vertices_.push_back(nv);
+	vertexGeometryChanged(nv);
 
 	// Check if this vertex splits any lines (if needed)
 	if (split_dist >= 0)
@@ -4184,9 +4624,10 @@ MapLine* SLADEMap::createLine(MapVertex* vertex1, MapVertex* vertex2, bool force
 	}
 
 	// Create new line between vertices
-	MapLine* nl = new MapLine(vertex1, vertex2, nullptr, nullptr, this);
+	MapLine* nl = line_pool_.create(vertex1, vertex2, nullptr, nullptr, this);
 	nl->index = lines_.size();
 	lines_.push_back(nl);
+	lineGeometryChanged(nl);
 
 	// Connect line to vertices
 	vertex1->connectLine(nl);
@@ -4204,7 +4645,7 @@ MapLine* SLADEMap::createLine(MapVertex* vertex1, MapVertex* vertex2, bool force
 MapThing* SLADEMap::createThing(double x, double y)
 {
 	// Create the thing
-	MapThing* nt = new MapThing(this);
+	MapThing* nt = thing_pool_.create(this);
 
 	// Setup initial values
 	nt->x = x;
@@ -4225,7 +4666,7 @@ MapThing* SLADEMap::createThing(double x, double y)
 MapSector* SLADEMap::createSector()
 {
 	// Create the sector
-	MapSector* ns = new MapSector(this);
+	MapSector* ns = sector_pool_.create(this);
 
 	// Setup initial values
 	ns->index = sectors_.size();
@@ -4246,7 +4687,7 @@ MapSide* SLADEMap::createSide(MapSector* sector)
 		return nullptr;
 
 	// Create side
-	MapSide* side = new MapSide(sector, this);
+	MapSide* side = side_pool_.create(sector, this);
 
 	// Setup initial values
 	side->index = sides_.size();
@@ -4275,6 +4716,7 @@ void SLADEMap::moveVertex(unsigned vertex, double nx, double ny)
 	v->setModified();
 	v->x = nx;
 	v->y = ny;
+	vertexGeometryChanged(v);
 
 	// Reset all attached lines' geometry info
 	for (unsigned a = 0; a < v->connected_lines.size(); a++)
@@ -4319,6 +4761,8 @@ void SLADEMap::mergeVertices(unsigned vertex1, unsigned vertex2)
 			v1->connectLine(line);
 		}
 
+		lineGeometryChanged(line);
+
 		if (line->vertex1 == v1 && line->vertex2 == v1)
 			zlines.push_back(line);
 	}
@@ -4329,6 +4773,7 @@ void SLADEMap::mergeVertices(unsigned vertex1, unsigned vertex2)
 	vertices_[vertex2] = vertices_.back();
 	vertices_[vertex2]->index = vertex2;
 	vertices_.pop_back();
+	geometryVertexRemoved(vertex2);
 
 	// Delete any resulting zero-length lines
 	for (unsigned a = 0; a < zlines.size(); a++)
@@ -4387,6 +4832,7 @@ MapLine* SLADEMap::splitLine(MapLine* l, MapVertex* v)
 	l->vertex2 = v;
 	v->connectLine(l);
 	l->length = -1;
+	lineGeometryChanged(l);
 
 	// Create and add new sides
 	MapSide* s1 = nullptr;
@@ -4394,7 +4840,7 @@ MapLine* SLADEMap::splitLine(MapLine* l, MapVertex* v)
 	if (l->side1)
 	{
 		// Create side 1
-		s1 = new MapSide(this);
+		s1 = side_pool_.create(this);
 		s1->copy(l->side1);
 		s1->setSector(l->side1->sector);
 		if (s1->sector)
@@ -4415,7 +4861,7 @@ MapLine* SLADEMap::splitLine(MapLine* l, MapVertex* v)
 	if (l->side2)
 	{
 		// Create side 2
-		s2 = new MapSide(this);
+		s2 = side_pool_.create(this);
 		s2->copy(l->side2);
 		s2->setSector(l->side2->sector);
 		if (s2->sector)
@@ -4435,11 +4881,12 @@ MapLine* SLADEMap::splitLine(MapLine* l, MapVertex* v)
 	}
 
 	// Create and add new line
-	MapLine* nl = new MapLine(v, v2, s1, s2, this);
+	MapLine* nl = line_pool_.create(v, v2, s1, s2, this);
 	nl->copy(l);
 	nl->index = lines_.size();
 	nl->setModified();
 	lines_.push_back(nl);
+	lineGeometryChanged(nl);
 
 	// Update x-offsets
 	if (map_split_auto_offset)
@@ -5467,3 +5914,34 @@ int SLADEMap::thingTypeUsageCount(int type)
 {
 	return usage_thing_type_[type];
 }
+
+/* SLADEMap::objectPoolStats
+ * Returns a string describing allocation statistics for each of the
+ * map object pools
+ *******************************************************************/
+string SLADEMap::objectPoolStats() const
+{
+	string info;
+	auto add_stats = [&info](const char* type, const auto& pool)
+	{
+		auto& stats = pool.stats();
+		info += S_FMT(
+			"%s: %lu live, %lu created (%lu reused), %lu released, %lu block allocations (%luKB)\n",
+			type,
+			stats.live,
+			stats.created,
+			stats.reused,
+			stats.released,
+			stats.blocks,
+			(unsigned long)pool.memoryUsage() / 1024
+		);
+	};
+
+	add_stats("Vertices", vertex_pool_);
+	add_stats("Lines", line_pool_);
+	add_stats("Sides", side_pool_);
+	add_stats("Sectors", sector_pool_);
+	add_stats("Things", thing_pool_);
+
+	return info;
+}
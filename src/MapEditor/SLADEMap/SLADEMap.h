@@ -10,6 +10,11 @@
 #include "Archive/Archive.h"
 #include "Utility/PropertyList/PropertyList.h"
 #include "MapEditor/MapSpecials.h"
+#include "UDMFParser.h"
+#include "MapGeometryStore.h"
+#include "MapObjectPool.h"
+#include "MapSectorGeometry.h"
+#include "MapTagIndex.h"
 
 struct mobj_holder_t
 {
@@ -38,7 +43,17 @@ struct mobj_cd_t
 	}
 };
 
-class ParseTreeNode;
+// Counts of objects processed by the last SLADEMap::updateGeometryInfo
+struct geometry_update_stats_t
+{
+	unsigned	vertices;
+	unsigned	lines;
+	unsigned	sectors;
+	unsigned	sector_resets_saved;	// Duplicate sector updates skipped
+
+	geometry_update_stats_t() : vertices{ 0 }, lines{ 0 }, sectors{ 0 }, sector_resets_saved{ 0 } {}
+};
+
 namespace Game { enum class TagType; }
 
 class SLADEMap
@@ -91,6 +106,7 @@ public:
 	void		addMapObject(MapObject* object);
 	void		removeMapObject(MapObject* object);
 	MapObject*	getObjectById(unsigned id) { return all_objects_[id].mobj; }
+	bool		objectInMap(unsigned id) const { return id < all_objects_.size() && all_objects_[id].in_map; }
 	void		getObjectIdList(uint8_t type, vector<unsigned>& list);
 	void		restoreObjectIdList(uint8_t type, vector<unsigned>& list);
 
@@ -136,12 +152,20 @@ public:
 	vector<fpoint2_t>	cutLines(double x1, double y1, double x2, double y2);
 	MapVertex*			lineCrossVertex(double x1, double y1, double x2, double y2);
 	void				updateGeometryInfo(long modified_time);
+	const geometry_update_stats_t&	lastGeometryUpdate() const { return geometry_update_stats_; }
 	bool				linesIntersect(MapLine* line1, MapLine* line2, double& x, double& y);
 	void				findSectorTextPoint(MapSector* sector);
 	void				initSectorPolygons();
+	MapSectorGeometry&	sectorGeometry() { return sector_geometry_; }
 	MapLine*			lineVectorIntersect(MapLine* line, bool front, double& hit_x, double& hit_y);
 
+	// Geometry store
+	const MapGeometryStore&	geometryStore();
+	void					vertexGeometryChanged(MapVertex* vertex);
+	void					lineGeometryChanged(MapLine* line);
+
 	// Tags/Ids
+	void	objectTagsChanged(MapObject* object);
 	MapThing* getFirstThingWithId(int id);
 	void	getSectorsByTag(int tag, vector<MapSector*>& list);
 	void	getThingsById(int id, vector<MapThing*>& list, unsigned start = 0, int type = 0);
@@ -218,6 +242,9 @@ public:
 	int		flatUsageCount(string tex);
 	int		thingTypeUsageCount(int type);
 
+	// Object pool info
+	string	objectPoolStats() const;
+
 private:
 	vector<MapLine*>	lines_;
 	vector<MapSide*>	sides_;
@@ -236,6 +263,23 @@ private:
 
 	vector<ArchiveEntry*>	udmf_extra_entries_;	// UDMF Extras
 
+	MapGeometryStore	geometry_store_;
+	MapTagIndex			tag_index_;
+	MapSectorGeometry	sector_geometry_;
+
+	// Objects with geometry changes not yet processed by updateGeometryInfo
+	vector<MapVertex*>		dirty_vertices_;
+	vector<MapLine*>		dirty_lines_;
+	vector<uint8_t>			geometry_dirty_;	// Indexed by object id
+	geometry_update_stats_t	geometry_update_stats_;
+
+	// Object pools (all map objects are allocated from these)
+	MapObjectPool<MapVertex>	vertex_pool_;
+	MapObjectPool<MapLine>		line_pool_;
+	MapObjectPool<MapSide>		side_pool_;
+	MapObjectPool<MapSector>	sector_pool_;
+	MapObjectPool<MapThing>		thing_pool_;
+
 	// For undo/redo
 	vector<mobj_holder_t>	all_objects_;
 	vector<unsigned>		deleted_objects_;
@@ -299,11 +343,21 @@ private:
 	bool	writeDoom64Things(ArchiveEntry* entry);
 
 	// UDMF
-	bool	addVertex(ParseTreeNode* def);
-	bool	addSide(ParseTreeNode* def);
-	bool	addLine(ParseTreeNode* def);
-	bool	addSector(ParseTreeNode* def);
-	bool	addThing(ParseTreeNode* def);
+	bool	addVertex(const UDMFParser::Block& def);
+	bool	addSide(const UDMFParser::Block& def);
+	bool	addLine(const UDMFParser::Block& def);
+	bool	addSector(const UDMFParser::Block& def);
+	bool	addThing(const UDMFParser::Block& def);
+
+	void	geometryVertexRemoved(unsigned index);
+	bool	markGeometryDirty(MapObject* object);
+	void	getIndexedObjects(MapTagIndex::Index index, int value, vector<MapObject*>& list);
+
+	void	writeUDMFThing(MapThing* thing, unsigned index, std::string& out);
+	void	writeUDMFLine(MapLine* line, unsigned index, std::string& out);
+	void	writeUDMFSide(MapSide* side, unsigned index, std::string& out);
+	void	writeUDMFVertex(MapVertex* vertex, unsigned index, std::string& out);
+	void	writeUDMFSector(MapSector* sector, unsigned index, std::string& out);
 };
 
 #endif //__SLADEMAP_H__
@@ -0,0 +1,937 @@
+// ----------------------------------------------------------------------------
+// SLADE - It's a Doom Editor
+// Copyright(C) 2008 - 2017 Simon Judd
+//
+// Email:       sirjuddington@gmail.com
+// Web:         http://slade.mancubus.net
+// Filename:    UDMFParser.cpp
+// Description: UDMFParser class - a purpose-built scanner for UDMF TEXTMAP
+//              data. Unlike the generic Parser it doesn't build a tree of
+//              nodes or copy any keys/values into strings, it just records
+//              where each field is in the source data (with numeric values
+//              already converted), grouped into blocks by type.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301, USA.
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+//
+// Includes
+//
+// ----------------------------------------------------------------------------
+#include "Main.h"
+#include "UDMFParser.h"
+#include "Utility/ThreadPool.h"
+#include <climits>
+#include <locale>
+#include <sstream>
+
+
+// ----------------------------------------------------------------------------
+//
+// Variables
+//
+// ----------------------------------------------------------------------------
+CVAR(Int, udmf_parse_chunk_size, 4 * 1024 * 1024, CVAR_SAVE)
+
+namespace
+{
+	typedef UDMFParser::Key Key;
+
+	struct KeyDef
+	{
+		const char*	name;
+		Key			key;
+	};
+
+	const KeyDef KEY_DEFS[] =
+	{
+		{ "vertex", Key::Vertex },
+		{ "linedef", Key::Linedef },
+		{ "sidedef", Key::Sidedef },
+		{ "sector", Key::Sector },
+		{ "thing", Key::Thing },
+		{ "namespace", Key::Namespace },
+		{ "x", Key::X },
+		{ "y", Key::Y },
+		{ "type", Key::Type },
+		{ "angle", Key::Angle },
+		{ "v1", Key::V1 },
+		{ "v2", Key::V2 },
+		{ "sidefront", Key::SideFront },
+		{ "sideback", Key::SideBack },
+		{ "special", Key::Special },
+		{ "id", Key::Id },
+		{ "texturetop", Key::TextureTop },
+		{ "texturemiddle", Key::TextureMiddle },
+		{ "texturebottom", Key::TextureBottom },
+		{ "offsetx", Key::OffsetX },
+		{ "offsety", Key::OffsetY },
+		{ "texturefloor", Key::TextureFloor },
+		{ "textureceiling", Key::TextureCeiling },
+		{ "heightfloor", Key::HeightFloor },
+		{ "heightceiling", Key::HeightCeiling },
+		{ "lightlevel", Key::LightLevel },
+	};
+
+	const unsigned KEY_MAX_LENGTH = 14;
+	const unsigned KEY_TABLE_SIZE = 64;
+
+	const double POW10[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// Local Functions
+//
+// ----------------------------------------------------------------------------
+namespace
+{
+	// ------------------------------------------------------------------------
+	// toLower
+	//
+	// ASCII-only lowercase conversion (UDMF identifiers are ASCII)
+	// ------------------------------------------------------------------------
+	inline char toLower(char c)
+	{
+		return (c >= 'A' && c <= 'Z') ? c + 32 : c;
+	}
+
+	// ------------------------------------------------------------------------
+	// keyHash
+	//
+	// Hash function for known keys. The multipliers were chosen so that every
+	// entry in KEY_DEFS maps to a unique slot (ie. a perfect hash)
+	// ------------------------------------------------------------------------
+	inline unsigned keyHash(const char* lower, unsigned len)
+	{
+		return ((unsigned char)lower[0] + 15 * (unsigned char)lower[len - 1] + 4 * (unsigned char)lower[len / 2])
+			& (KEY_TABLE_SIZE - 1);
+	}
+
+	// ------------------------------------------------------------------------
+	// keyTable
+	//
+	// Returns the known key hash table, building it on first use
+	// ------------------------------------------------------------------------
+	const KeyDef* const* keyTable()
+	{
+		static const KeyDef* table[KEY_TABLE_SIZE] = {};
+		static bool init = [&]()
+		{
+			for (auto& def : KEY_DEFS)
+			{
+				unsigned slot = keyHash(def.name, strlen(def.name));
+				if (table[slot])
+					Log::error(S_FMT("UDMFParser: Key hash collision (%s/%s)", def.name, table[slot]->name));
+				table[slot] = &def;
+			}
+			return true;
+		}();
+
+		(void)init;
+		return table;
+	}
+
+	// ------------------------------------------------------------------------
+	// isIdentChar
+	//
+	// Returns true if [c] can be part of an identifier
+	// ------------------------------------------------------------------------
+	inline bool isIdentChar(char c)
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+	}
+
+	// ------------------------------------------------------------------------
+	// isValueEnd
+	//
+	// Returns true if [c] ends an unquoted value
+	// ------------------------------------------------------------------------
+	inline bool isValueEnd(char c)
+	{
+		return (unsigned char)c <= ' ' || c == ';' || c == '=' || c == '{' || c == '}' || c == '"' || c == '/';
+	}
+
+	// ------------------------------------------------------------------------
+	// skipWhitespace
+	//
+	// Advances [p] past any whitespace and comments. Returns false if an
+	// unterminated block comment was found
+	// ------------------------------------------------------------------------
+	inline bool skipWhitespace(const char*& p, const char* end)
+	{
+		while (p < end)
+		{
+			char c = *p;
+			if ((unsigned char)c <= ' ')
+				++p;
+			else if (c == '/' && p + 1 < end && p[1] == '/')
+			{
+				p += 2;
+				while (p < end && *p != '\n')
+					++p;
+			}
+			else if (c == '/' && p + 1 < end && p[1] == '*')
+			{
+				p += 2;
+				while (p + 1 < end && !(p[0] == '*' && p[1] == '/'))
+					++p;
+				if (p + 1 >= end)
+				{
+					p = end;
+					return false;
+				}
+				p += 2;
+			}
+			else
+				break;
+		}
+
+		return true;
+	}
+
+	// ------------------------------------------------------------------------
+	// parseInt
+	//
+	// Parses a decimal or hex (0x) integer from [start] to [end]. Returns
+	// false if the text isn't a valid integer, or is out of range (decimal
+	// beyond int, hex beyond 32 bits), so it can be read as a float or
+	// string instead
+	// ------------------------------------------------------------------------
+	bool parseInt(const char* start, const char* end, int& out)
+	{
+		const char* p = start;
+		bool negative = false;
+		int64_t val = 0;
+
+		// Hex (no sign allowed, as per the generic Parser)
+		if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+		{
+			for (p += 2; p < end; ++p)
+			{
+				char c = *p;
+				int digit;
+				if (c >= '0' && c <= '9') digit = c - '0';
+				else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+				else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+				else return false;
+				val = (val << 4) | digit;
+				if (val > 0xFFFFFFFFll)
+					return false;
+			}
+
+			out = (int)val;
+			return true;
+		}
+
+		// Decimal
+		if (p < end && (*p == '-' || *p == '+'))
+			negative = (*p++ == '-');
+		if (p == end)
+			return false;
+		for (; p < end; ++p)
+		{
+			if (*p < '0' || *p > '9')
+				return false;
+			val = val * 10 + (*p - '0');
+			if (val > (negative ? -(int64_t)INT_MIN : (int64_t)INT_MAX))
+				return false;
+		}
+
+		out = (int)(negative ? -val : val);
+		return true;
+	}
+
+	// ------------------------------------------------------------------------
+	// parseFloat
+	//
+	// Parses a floating point number from [start] to [end], independent of
+	// the current locale. Returns false if the text isn't a valid number
+	// ------------------------------------------------------------------------
+	bool parseFloat(const char* start, const char* end, double& out)
+	{
+		const char* p = start;
+		bool negative = false;
+		uint64_t mantissa = 0;
+		int exp10 = 0;
+		int sig_digits = 0;
+		bool any_digits = false;
+
+		if (p < end && (*p == '-' || *p == '+'))
+			negative = (*p++ == '-');
+
+		// Integer part
+		for (; p < end && *p >= '0' && *p <= '9'; ++p)
+		{
+			any_digits = true;
+			if (sig_digits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa) ++sig_digits;
+			}
+			else
+				++exp10;
+		}
+
+		// Fractional part
+		if (p < end && *p == '.')
+		{
+			for (++p; p < end && *p >= '0' && *p <= '9'; ++p)
+			{
+				any_digits = true;
+				if (sig_digits < 19)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					if (mantissa) ++sig_digits;
+					--exp10;
+				}
+			}
+		}
+
+		if (!any_digits)
+			return false;
+
+		// Exponent
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			++p;
+			bool exp_negative = false;
+			if (p < end && (*p == '-' || *p == '+'))
+				exp_negative = (*p++ == '-');
+			if (p == end)
+				return false;
+
+			int exp = 0;
+			for (; p < end && *p >= '0' && *p <= '9'; ++p)
+				if (exp < 10000) exp = exp * 10 + (*p - '0');
+			exp10 += exp_negative ? -exp : exp;
+		}
+
+		if (p != end)
+			return false;
+
+		// Fast path: exact conversion when the mantissa and power of 10 are
+		// both exactly representable
+		if (mantissa < (1ull << 53) && exp10 >= -22 && exp10 <= 22)
+		{
+			double val = (double)mantissa;
+			val = exp10 < 0 ? val / POW10[-exp10] : val * POW10[exp10];
+			out = negative ? -val : val;
+			return true;
+		}
+
+		// Slow path for anything else
+		std::istringstream stream(std::string(start, end));
+		stream.imbue(std::locale::classic());
+		stream >> out;
+		return !stream.fail();
+	}
+
+	// ------------------------------------------------------------------------
+	// lineNumber
+	//
+	// Returns the line number of [pos] within the data beginning at [start]
+	// ------------------------------------------------------------------------
+	unsigned lineNumber(const char* start, const char* pos)
+	{
+		unsigned line = 1;
+		for (const char* p = start; p < pos; ++p)
+			if (*p == '\n')
+				++line;
+
+		return line;
+	}
+
+	// ------------------------------------------------------------------------
+	// findSplit
+	//
+	// Returns the position just after the first '}' from [from] (up to
+	// [limit]) that looks like the end of a top-level block: it isn't after a
+	// line comment on the same line, and is followed by an identifier then
+	// '{' or '='. [start] and [end] are the bounds of the whole data. Returns
+	// nullptr if no such position was found
+	// ------------------------------------------------------------------------
+	const char* findSplit(const char* from, const char* limit, const char* start, const char* end)
+	{
+		for (const char* p = from; p < limit; ++p)
+		{
+			if (*p != '}')
+				continue;
+
+			// Check for a line comment before it (giving up on long lines)
+			const char* ls = p;
+			unsigned n = 0;
+			bool comment = false;
+			while (ls > start && ls[-1] != '\n')
+			{
+				--ls;
+				if ((ls[0] == '/' && ls[1] == '/') || ++n > 1024)
+				{
+					comment = true;
+					break;
+				}
+			}
+			if (comment)
+				continue;
+
+			// Check what follows
+			const char* next = p + 1;
+			if (!skipWhitespace(next, end))
+				return nullptr;
+			if (next >= end || !isIdentChar(*next))
+				continue;
+			while (next < end && isIdentChar(*next))
+				++next;
+			if (!skipWhitespace(next, end))
+				return nullptr;
+			if (next < end && (*next == '{' || *next == '='))
+				return p + 1;
+		}
+
+		return nullptr;
+	}
+
+	// ------------------------------------------------------------------------
+	// toWxString
+	//
+	// Converts [len] bytes of text at [str] to a wxString
+	// ------------------------------------------------------------------------
+	string toWxString(const char* str, size_t len)
+	{
+		string ret = wxString::FromUTF8(str, len);
+		if (ret.empty() && len > 0)
+			ret = wxString::From8BitData(str, len);
+
+		return ret;
+	}
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// UDMFParser::Field Struct Functions
+//
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+// UDMFParser::Field::name
+//
+// Returns the (lowercase) field name
+// ----------------------------------------------------------------------------
+string UDMFParser::Field::name() const
+{
+	char buf[256];
+	unsigned len = MIN((unsigned)key_len, 255u);
+	for (unsigned a = 0; a < len; ++a)
+		buf[a] = toLower(key[a]);
+
+	return wxString::FromAscii(buf, len);
+}
+
+// ----------------------------------------------------------------------------
+// UDMFParser::Field::value
+//
+// Returns the field value as a Property
+// ----------------------------------------------------------------------------
+Property UDMFParser::Field::value() const
+{
+	switch (type)
+	{
+	case ValueType::Bool:	return Property(v_bool);
+	case ValueType::Int:	return Property(v_int);
+	case ValueType::Float:	return Property(v_float);
+	default:				return Property(stringValue());
+	}
+}
+
+// ----------------------------------------------------------------------------
+// UDMFParser::Field::boolValue
+//
+// Returns the field value as a bool
+// ----------------------------------------------------------------------------
+bool UDMFParser::Field::boolValue() const
+{
+	switch (type)
+	{
+	case ValueType::Bool:	return v_bool;
+	case ValueType::Int:	return !!v_int;
+	case ValueType::Float:	return !!((int)v_float);
+	default:				return value().getBoolValue();
+	}
+}
+
+// ----------------------------------------------------------------------------
+// UDMFParser::Field::intValue
+//
+// Returns the field value as an int
+// ----------------------------------------------------------------------------
+int UDMFParser::Field::intValue() const
+{
+	switch (type)
+	{
+	case ValueType::Bool:	return (int)v_bool;
+	case ValueType::Int:	return v_int;
+	case ValueType::Float:	return (int)v_float;
+	default:				return value().getIntValue();
+	}
+}
+
+// ----------------------------------------------------------------------------
+// UDMFParser::Field::floatValue
+//
+// Returns the field value as a double
+// ----------------------------------------------------------------------------
+double UDMFParser::Field::floatValue() const
+{
+	switch (type)
+	{
+	case ValueType::Bool:	return (double)v_bool;
+	case ValueType::Int:	return (double)v_int;
+	case ValueType::Float:	return v_float;
+	default:				return value().getFloatValue();
+	}
+}
+
+// ----------------------------------------------------------------------------
+// UDMFParser::Field::stringValue
+//
+// Returns the field value as a string. Unquoted identifier values are
+// lowercase (as with the generic Parser)
+// ----------------------------------------------------------------------------
+string UDMFParser::Field::stringValue() const
+{
+	if (type != ValueType::String)
+		return value().getStringValue();
+
+	// Unquoted, convert to lowercase
+	if (!quoted)
+		return toWxString(v_str, str_len).Lower();
+
+	// No escape sequences, convert directly
+	if (!escaped)
+		return toWxString(v_str, str_len);
+
+	// Remove escape backslashes
+	std::string unescaped;
+	unescaped.reserve(str_len);
+	for (unsigned a = 0; a < str_len; ++a)
+	{
+		if (v_str[a] == '\\' && a + 1 < str_len)
+			++a;
+		unescaped += v_str[a];
+	}
+
+	return toWxString(unescaped.data(), unescaped.size());
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// UDMFParser Class Functions
+//
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+// UDMFParser::UDMFParser
+//
+// UDMFParser class constructor
+// ----------------------------------------------------------------------------
+UDMFParser::UDMFParser() : data_start_{ nullptr }
+{
+}
+
+// ----------------------------------------------------------------------------
+// UDMFParser::~UDMFParser
+//
+// UDMFParser class destructor
+// ----------------------------------------------------------------------------
+UDMFParser::~UDMFParser()
+{
+}
+
+// ----------------------------------------------------------------------------
+// UDMFParser::blocks
+//
+// Returns all parsed blocks of [type], in the order they were defined
+// ----------------------------------------------------------------------------
+const vector<UDMFParser::Block>& UDMFParser::blocks(Key type) const
+{
+	switch (type)
+	{
+	case Key::Vertex:	return blocks_vertices_;
+	case Key::Linedef:	return blocks_lines_;
+	case Key::Sidedef:	return blocks_sides_;
+	case Key::Sector:	return blocks_sectors_;
+	case Key::Thing:	return blocks_things_;
+	default:			return blocks_other_;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// UDMFParser::parse
+//
+// Parses UDMF text data in [mc]. Returns false if any errors were found
+// ----------------------------------------------------------------------------
+bool UDMFParser::parse(const MemChunk& mc)
+{
+	const char* start = (const char*)mc.getData();
+	const char* end = start + mc.getSize();
+	data_start_ = start;
+
+	// Split data into chunks on block boundaries, so each can be parsed
+	// independently
+	unsigned n_chunks = 1;
+	if (udmf_parse_chunk_size > 0)
+		n_chunks = MIN(ThreadPool::nThreads() * 4, 1 + mc.getSize() / (unsigned)udmf_parse_chunk_size);
+	splitChunks(start, end, MAX(1u, n_chunks));
+
+	// Parse chunks
+	ThreadPool::parallelFor(chunks_.size(), [&](size_t first, size_t last)
+	{
+		for (size_t a = first; a < last; ++a)
+			parseChunk(chunks_[a]);
+	});
+
+	// If anything failed with multiple chunks, it may just be a bad split
+	// (or the error position may be off), so parse it again in one piece
+	if (chunks_.size() > 1)
+	{
+		for (auto& chunk : chunks_)
+		{
+			if (!chunk.error.empty())
+			{
+				splitChunks(start, end, 1);
+				parseChunk(chunks_[0]);
+				break;
+			}
+		}
+	}
+
+	// Check for errors (report the first one only)
+	for (auto& chunk : chunks_)
+	{
+		if (!chunk.error.empty())
+		{
+			Log::error(S_FMT("TEXTMAP:%d: %s", lineNumber(start, chunk.error_pos), chunk.error));
+			return false;
+		}
+	}
+
+	// Sort blocks by type
+	for (auto& chunk : chunks_)
+	{
+		for (auto& def : chunk.blocks)
+		{
+			Block block{ def.type, chunk.fields.data() + def.first_field, def.n_fields };
+			switch (def.type)
+			{
+			case Key::Vertex:	blocks_vertices_.push_back(block); break;
+			case Key::Linedef:	blocks_lines_.push_back(block); break;
+			case Key::Sidedef:	blocks_sides_.push_back(block); break;
+			case Key::Sector:	blocks_sectors_.push_back(block); break;
+			case Key::Thing:	blocks_things_.push_back(block); break;
+			default:			blocks_other_.push_back(block); break;
+			}
+		}
+
+		for (auto& field : chunk.globals)
+			globals_.push_back(&field);
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// UDMFParser::splitChunks
+//
+// Splits the data from [start] to [end] into (up to) [n_chunks] chunks of
+// roughly equal size. Each split is made at an approximate offset and moved
+// forward to the next (likely) top-level block end, so no serial pass over
+// the whole data is needed. A split can still land inside a string or block
+// comment, but then the chunk before it fails to parse and parse() falls
+// back to a single chunk
+// ----------------------------------------------------------------------------
+void UDMFParser::splitChunks(const char* start, const char* end, unsigned n_chunks)
+{
+	chunks_.clear();
+	if (n_chunks <= 1)
+	{
+		Chunk chunk;
+		chunk.start = start;
+		chunk.end = end;
+		chunks_.push_back(std::move(chunk));
+		return;
+	}
+
+	// Find split points in parallel, each searching from its approximate
+	// offset up to the next one
+	size_t target_size = (end - start) / n_chunks;
+	vector<const char*> splits(n_chunks - 1);
+	ThreadPool::parallelFor(splits.size(), [&](size_t first, size_t last)
+	{
+		for (size_t a = first; a < last; ++a)
+		{
+			const char* from = start + (a + 1) * target_size;
+			const char* limit = a + 1 < splits.size() ? from + target_size : end;
+			splits[a] = findSplit(from, limit, start, end);
+		}
+	});
+
+	// Build chunks (splits that weren't found are skipped)
+	const char* chunk_start = start;
+	for (auto split : splits)
+	{
+		if (!split)
+			continue;
+
+		Chunk chunk;
+		chunk.start = chunk_start;
+		chunk.end = split;
+		chunks_.push_back(std::move(chunk));
+		chunk_start = split;
+	}
+
+	// Last chunk
+	Chunk chunk;
+	chunk.start = chunk_start;
+	chunk.end = end;
+	chunks_.push_back(std::move(chunk));
+}
+
+// ----------------------------------------------------------------------------
+// UDMFParser::parseChunk
+//
+// Parses all statements in [chunk]. Returns false on error, in which case
+// the chunk's error message and position are set
+// ----------------------------------------------------------------------------
+bool UDMFParser::parseChunk(Chunk& chunk)
+{
+	const char* p = chunk.start;
+	const char* end = chunk.end;
+
+	// Rough reservation to avoid lots of reallocation (an average field
+	// definition is around 12 characters)
+	chunk.fields.reserve((end - p) / 12);
+	chunk.blocks.reserve((end - p) / 128);
+
+	auto fail = [&chunk](const char* pos, const char* error)
+	{
+		chunk.error = error;
+		chunk.error_pos = pos;
+		return false;
+	};
+
+	// Reads an identifier at [p] into [field]
+	auto readIdent = [&](Field& field)
+	{
+		const char* ident = p;
+		while (p < end && isIdentChar(*p))
+			++p;
+		if (p == ident)
+			return false;
+
+		field.key = ident;
+		field.key_len = (uint16_t)MIN(p - ident, 65535);
+		field.known = lookupKey(ident, p - ident);
+		return true;
+	};
+
+	// Reads a value (and the terminating ;) at [p] into [field]
+	auto readValue = [&](Field& field)
+	{
+		if (!skipWhitespace(p, end))
+			return fail(p, "Unterminated comment");
+		if (p >= end)
+			return fail(p, "Unexpected end of data, expected a value");
+
+		if (*p == '"')
+		{
+			// Quoted string
+			const char* str = ++p;
+			field.quoted = true;
+			field.escaped = false;
+			while (p < end && *p != '"')
+			{
+				if (*p == '\\')
+				{
+					field.escaped = true;
+					++p;
+				}
+				++p;
+			}
+			if (p >= end)
+				return fail(str, "Unterminated string");
+
+			field.type = ValueType::String;
+			field.v_str = str;
+			field.str_len = p - str;
+			++p;
+		}
+		else
+		{
+			// Keyword or number
+			const char* val = p;
+			while (p < end && !isValueEnd(*p))
+				++p;
+			if (p == val)
+				return fail(p, "Expected a value");
+
+			size_t len = p - val;
+			field.quoted = false;
+			field.escaped = false;
+			if (len == 4 && toLower(val[0]) == 't' && toLower(val[1]) == 'r' && toLower(val[2]) == 'u' && toLower(val[3]) == 'e')
+			{
+				field.type = ValueType::Bool;
+				field.v_bool = true;
+			}
+			else if (len == 5 && toLower(val[0]) == 'f' && toLower(val[1]) == 'a' && toLower(val[2]) == 'l' && toLower(val[3]) == 's' && toLower(val[4]) == 'e')
+			{
+				field.type = ValueType::Bool;
+				field.v_bool = false;
+			}
+			else if (parseInt(val, p, field.v_int))
+				field.type = ValueType::Int;
+			else if (parseFloat(val, p, field.v_float))
+				field.type = ValueType::Float;
+			else
+			{
+				// Unknown, treat as a string
+				field.type = ValueType::String;
+				field.v_str = val;
+				field.str_len = len;
+			}
+		}
+
+		// Terminating ;
+		if (!skipWhitespace(p, end))
+			return fail(p, "Unterminated comment");
+		if (p >= end || *p != ';')
+			return fail(p, "Expected \";\"");
+		++p;
+
+		return true;
+	};
+
+	while (true)
+	{
+		if (!skipWhitespace(p, end))
+			return fail(p, "Unterminated comment");
+		if (p >= end)
+			break;
+
+		// Read identifier (block type or global field name)
+		Field field;
+		if (!readIdent(field))
+			return fail(p, "Expected an identifier");
+
+		if (!skipWhitespace(p, end))
+			return fail(p, "Unterminated comment");
+		if (p >= end)
+			return fail(p, "Unexpected end of data");
+
+		// Global assignment
+		if (*p == '=')
+		{
+			++p;
+			if (!readValue(field))
+				return false;
+			chunk.globals.push_back(field);
+			continue;
+		}
+
+		// Block
+		if (*p != '{')
+			return fail(p, "Expected \"=\" or \"{\"");
+		++p;
+
+		BlockDef block;
+		block.type = field.known;
+		block.first_field = chunk.fields.size();
+		if (block.type > Key::Thing)
+			block.type = Key::Unknown;
+
+		while (true)
+		{
+			if (!skipWhitespace(p, end))
+				return fail(p, "Unterminated comment");
+			if (p >= end)
+				return fail(p, "Unexpected end of data, expected \"}\"");
+
+			// End of block
+			if (*p == '}')
+			{
+				++p;
+				break;
+			}
+
+			// Field
+			Field bfield;
+			if (!readIdent(bfield))
+				return fail(p, "Expected an identifier");
+			if (!skipWhitespace(p, end))
+				return fail(p, "Unterminated comment");
+			if (p >= end || *p != '=')
+				return fail(p, "Expected \"=\"");
+			++p;
+			if (!readValue(bfield))
+				return false;
+
+			chunk.fields.push_back(bfield);
+		}
+
+		block.n_fields = chunk.fields.size() - block.first_field;
+		chunk.blocks.push_back(block);
+	}
+
+	return true;
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// UDMFParser Class Static Functions
+//
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+// UDMFParser::lookupKey
+//
+// Returns the known key matching [key] (case-insensitive), or Key::Unknown
+// ----------------------------------------------------------------------------
+UDMFParser::Key UDMFParser::lookupKey(const char* key, unsigned len)
+{
+	if (len == 0 || len > KEY_MAX_LENGTH)
+		return Key::Unknown;
+
+	char lower[KEY_MAX_LENGTH];
+	for (unsigned a = 0; a < len; ++a)
+		lower[a] = toLower(key[a]);
+
+	const KeyDef* def = keyTable()[keyHash(lower, len)];
+	if (def && strncmp(def->name, lower, len) == 0 && def->name[len] == 0)
+		return def->key;
+
+	return Key::Unknown;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "Utility/PropertyList/Property.h"
+
+// A dedicated parser for UDMF TEXTMAP data. Scans the source data in place
+// (keys and string values point directly into it), so the source MemChunk
+// must outlive the parser. Large inputs are split on block boundaries and the
+// pieces are parsed in parallel
+class UDMFParser
+{
+public:
+	// Known keys and block names, looked up via a perfect hash
+	enum class Key : uint8_t
+	{
+		Unknown = 0,
+
+		// Block types
+		Vertex,
+		Linedef,
+		Sidedef,
+		Sector,
+		Thing,
+
+		// Fields
+		Namespace,
+		X,
+		Y,
+		Type,
+		Angle,
+		V1,
+		V2,
+		SideFront,
+		SideBack,
+		Special,
+		Id,
+		TextureTop,
+		TextureMiddle,
+		TextureBottom,
+		OffsetX,
+		OffsetY,
+		TextureFloor,
+		TextureCeiling,
+		HeightFloor,
+		HeightCeiling,
+		LightLevel
+	};
+
+	enum class ValueType : uint8_t
+	{
+		Bool,
+		Int,
+		Float,
+		String
+	};
+
+	struct Field
+	{
+		const char*	key;
+		uint16_t	key_len;
+		Key			known;
+		ValueType	type;
+		bool		quoted;		// String value was quoted
+		bool		escaped;	// String value contains escape sequences
+		uint32_t	str_len;
+		union
+		{
+			bool		v_bool;
+			int			v_int;
+			double		v_float;
+			const char*	v_str;
+		};
+
+		string		name() const;
+		Property	value() const;
+		bool		boolValue() const;
+		int			intValue() const;
+		double		floatValue() const;
+		string		stringValue() const;
+	};
+
+	struct Block
+	{
+		Key				type;
+		const Field*	fields;
+		unsigned		n_fields;
+	};
+
+	UDMFParser();
+	~UDMFParser();
+
+	bool	parse(const MemChunk& mc);
+
+	const vector<Block>&		blocks(Key type) const;
+	const vector<const Field*>&	globals() const { return globals_; }
+
+	static Key	lookupKey(const char* key, unsigned len);
+
+private:
+	struct BlockDef
+	{
+		Key			type;
+		unsigned	first_field;
+		unsigned	n_fields;
+	};
+
+	struct Chunk
+	{
+		const char*			start;
+		const char*			end;
+		vector<BlockDef>	blocks;
+		vector<Field>		fields;
+		vector<Field>		globals;
+		string				error;
+		const char*			error_pos;
+	};
+
+	const char*				data_start_;
+	vector<Chunk>			chunks_;
+	vector<Block>			blocks_vertices_;
+	vector<Block>			blocks_lines_;
+	vector<Block>			blocks_sides_;
+	vector<Block>			blocks_sectors_;
+	vector<Block>			blocks_things_;
+	vector<Block>			blocks_other_;
+	vector<const Field*>	globals_;
+
+	void	splitChunks(const char* start, const char* end, unsigned n_chunks);
+	bool	parseChunk(Chunk& chunk);
+};
@@ -34,6 +34,8 @@
 #include "MapBackupPanel.h"
 #include "Archive/Formats/WadArchive.h"
 #include "Archive/Formats/ZipArchive.h"
+#include "MapEditor/MapBackupManager.h"
+#include "MapEditor/MapEditor.h"
 #include "UI/Canvas/MapPreviewCanvas.h"
 #include "UI/Lists/ListView.h"
 #include "UI/WxUtils.h"
@@ -74,21 +76,74 @@ MapBackupPanel::MapBackupPanel(wxWindow* parent) :
 // ----------------------------------------------------------------------------
 // MapBackupPanel::loadBackups
 //
-// Opens the map backup file for [map_name] in [archive_name] and populates the
-// list
+// Loads the list of backups for [map_name] in [archive_name] from the backup
+// manager and populates the list
 // ----------------------------------------------------------------------------
 bool MapBackupPanel::loadBackups(string archive_name, string map_name)
+{
+	archive_name_ = archive_name;
+	map_name_ = map_name;
+	dir_current_ = nullptr;
+	timestamps_.clear();
+	MapEditor::backupManager().getBackupList(archive_name, map_name, timestamps_);
+
+	// Fall back to backups made by older versions, if any
+	if (timestamps_.empty())
+		return loadLegacyBackups(archive_name, map_name);
+
+	// Populate backups list
+	list_backups_->ClearAll();
+	list_backups_->AppendColumn("Backup Date");
+	list_backups_->AppendColumn("Time");
+
+	int index = 0;
+	for (int a = timestamps_.size() - 1; a >= 0; a--)
+	{
+		string timestamp = timestamps_[a];
+		wxArrayString cols;
+
+		// Date
+		cols.Add(timestamp.Before('_'));
+
+		// Time (with sequence number if there were multiple backups that second)
+		string seq;
+		string time = timestamp.After('_').BeforeFirst('.', &seq);
+		time = time.Left(2) + ":" + time.Mid(2, 2) + ":" + time.Right(2);
+		if (!seq.empty())
+			time += S_FMT(" (%s)", seq);
+		cols.Add(time);
+
+		// Add to list
+		list_backups_->addItem(index++, cols);
+	}
+
+	if (list_backups_->GetItemCount() > 0)
+		list_backups_->selectItem(0);
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// MapBackupPanel::loadLegacyBackups
+//
+// Opens the (old-style) map backup zip for [map_name] in [archive_name] and
+// populates the list
+// ----------------------------------------------------------------------------
+bool MapBackupPanel::loadLegacyBackups(string archive_name, string map_name)
 {
 	// Open backup file
 	archive_name.Replace(".", "_");
 	string backup_file = App::path("backups", App::Dir::User) + "/" + archive_name + "_backup.zip";
-	if (!archive_backups_->open(backup_file))
+	if (!wxFileExists(backup_file) || !archive_backups_->open(backup_file))
 		return false;
 
 	// Get backup dir for map
 	dir_current_ = archive_backups_->getDir(map_name);
 	if (dir_current_ == archive_backups_->rootDir() || !dir_current_)
+	{
+		dir_current_ = nullptr;
 		return false;
+	}
 
 	// Populate backups list
 	list_backups_->ClearAll();
@@ -136,12 +191,19 @@ void MapBackupPanel::updateMapPreview()
 	// Load map data to temporary wad
 	if (archive_mapdata_)
 		delete archive_mapdata_;
-	archive_mapdata_ = new WadArchive();
-	ArchiveTreeNode* dir = (ArchiveTreeNode*)dir_current_->getChild(selection);
-	for (unsigned a = 0; a < dir->numEntries(); a++)
-		archive_mapdata_->addEntry(dir->entryAt(a), "", true);
+	if (dir_current_)
+	{
+		archive_mapdata_ = new WadArchive();
+		ArchiveTreeNode* dir = (ArchiveTreeNode*)dir_current_->getChild(selection);
+		for (unsigned a = 0; a < dir->numEntries(); a++)
+			archive_mapdata_->addEntry(dir->entryAt(a), "", true);
+	}
+	else
+		archive_mapdata_ = MapEditor::backupManager().readBackup(archive_name_, map_name_, timestamps_[selection]);
 
 	// Open map preview
+	if (!archive_mapdata_)
+		return;
 	vector<Archive::MapDesc> maps = archive_mapdata_->detectMaps();
 	if (!maps.empty())
 		canvas_map_->openMap(maps[0]);
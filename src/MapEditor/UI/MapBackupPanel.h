@@ -23,4 +23,9 @@ private:
 	std::unique_ptr<ZipArchive>	archive_backups_;
 	Archive*					archive_mapdata_	= nullptr;
 	ArchiveTreeNode*			dir_current_		= nullptr;
+	string						archive_name_;
+	string						map_name_;
+	vector<string>				timestamps_;
+
+	bool	loadLegacyBackups(string archive_name, string map_name);
 };
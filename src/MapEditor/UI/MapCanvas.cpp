@@ -30,10 +30,16 @@
  *******************************************************************/
 #include "Main.h"
 #include "App.h"
+#include "General/Console/Console.h"
+#include "General/ResourceManager.h"
+#include "MainEditor/MainEditor.h"
+#include "MainEditor/UI/MainWindow.h"
 #include "MapCanvas.h"
+#include "MapEditor/MapEditor.h"
 #include "MapEditor/Renderer/Overlays/MCOverlay.h"
 #include "MapEditor/SectorBuilder.h"
 #include "OpenGL/Drawing.h"
+#include "UI/Controls/PaletteChooser.h"
 #include "Utility/MathStuff.h"
 
 using MapEditor::Mode;
@@ -85,6 +91,14 @@ MapCanvas::MapCanvas(wxWindow* parent, int id, MapEditContext* context) :
 	Bind(wxEVT_IDLE, &MapCanvas::onIdle, this);
 #endif
 
+	// Redraw when resources or the palette change, or the map is changed
+	// from outside the canvas (eg. via the undo history panel)
+	listenTo(theResourceManager);
+	listenTo(theMainWindow->getPaletteChooser());
+	listenTo(context->undoManager());
+	listenTo(context->edit3D().undoManager());
+
+	resetFrameStats();
 	timer.Start(map_bg_ms, true);
 }
 
@@ -103,11 +117,30 @@ void MapCanvas::draw()
 	if (!IsEnabled())
 		return;
 
+	sf::Int64 start = sf_clock_.getElapsedTime().asMicroseconds();
+
 	context_->renderer().draw();
 
 	SwapBuffers();
 
 	glFinish();
+
+	// Update frame pacing stats
+	sf::Int64 end = sf_clock_.getElapsedTime().asMicroseconds();
+	frame_stats_.frames++;
+	frame_stats_.draw_total += end - start;
+	frame_stats_.draw_max = MAX(frame_stats_.draw_max, end - start);
+	if (last_frame_ >= 0)
+	{
+		frame_stats_.intervals++;
+		frame_stats_.interval_total += start - last_frame_;
+		frame_stats_.interval_max = MAX(frame_stats_.interval_max, start - last_frame_);
+	}
+	last_frame_ = start;
+
+	// Anything started outside of the update timer (eg. an animation from a
+	// menu action) needs the timer running to continue
+	wake();
 }
 
 /* MapCanvas::mouseToCenter
@@ -180,12 +213,65 @@ void MapCanvas::mouseLook3d()
 			if (fabs(xrel) > threshold || fabs(yrel) > threshold)
 			{
 				context_->renderer().renderer3D().cameraLook(xrel, yrel);
+				context_->requestRedraw();
 				mouseToCenter();
 			}
 		}
 	}
 }
 
+/* MapCanvas::wake
+ * Starts the update timer if it isn't already running. The timer
+ * stops (sleeps) when there is nothing to redraw, so this must be
+ * called when something happens that may need a redraw
+ *******************************************************************/
+void MapCanvas::wake()
+{
+	if (timer.IsRunning())
+		return;
+
+	if (sleeping_)
+	{
+		sleeping_ = false;
+		long now = sf_clock_.getElapsedTime().asMilliseconds();
+		frame_stats_.wakeups++;
+		frame_stats_.sleep_total += now - sleep_start_;
+
+		// Don't count time spent sleeping as frame time (animations and
+		// camera movement would jump ahead)
+		last_time = now - map_bg_ms;
+		last_frame_ = -1;
+	}
+
+	timer.Start(map_bg_ms, true);
+}
+
+/* MapCanvas::frameStats
+ * Returns the current frame pacing statistics (including any time
+ * spent sleeping up to now)
+ *******************************************************************/
+MapCanvas::frame_stats_t MapCanvas::frameStats() const
+{
+	long now = sf_clock_.getElapsedTime().asMilliseconds();
+	frame_stats_t stats = frame_stats_;
+	stats.elapsed = now - stats.start_time;
+	if (sleeping_)
+		stats.sleep_total += now - sleep_start_;
+
+	return stats;
+}
+
+/* MapCanvas::resetFrameStats
+ * Resets the frame pacing statistics
+ *******************************************************************/
+void MapCanvas::resetFrameStats()
+{
+	frame_stats_ = frame_stats_t();
+	frame_stats_.start_time = sf_clock_.getElapsedTime().asMilliseconds();
+	if (sleeping_)
+		sleep_start_ = frame_stats_.start_time;
+}
+
 /* MapCanvas::onKeyBindPress
  * Called when the key bind [name] is pressed
  *******************************************************************/
@@ -231,6 +317,21 @@ void MapCanvas::onKeyBindPress(string name)
 }
 
 
+/* MapCanvas::onAnnouncement
+ * Handles any announcements from the palette, resource manager or
+ * map undo managers
+ *******************************************************************/
+void MapCanvas::onAnnouncement(Announcer* announcer, string event_name, MemChunk& event_data)
+{
+	if (event_name == "resources_updated" || event_name == "main_palette_changed")
+		context_->requestRedraw();
+
+	// Map changed
+	if (event_name == "level_recorded" || event_name == "undo" || event_name == "redo")
+		context_->requestRedraw();
+}
+
+
 /*******************************************************************
  * MAPCANVAS CLASS EVENTS
  *******************************************************************/
@@ -242,6 +343,7 @@ void MapCanvas::onSize(wxSizeEvent& e)
 {
 	// Update screen limits
 	context_->renderer().setViewSize(GetSize().x, GetSize().y);
+	context_->requestRedraw();
 
 	e.Skip();
 }
@@ -252,6 +354,7 @@ void MapCanvas::onSize(wxSizeEvent& e)
 void MapCanvas::onKeyDown(wxKeyEvent& e)
 {
 	// Send to editor
+	context_->requestRedraw();
 	context_->input().updateKeyModifiersWx(e.GetModifiers());
 	context_->input().keyDown(KeyBind::keyName(e.GetKeyCode()));
 
@@ -339,6 +442,7 @@ void MapCanvas::onKeyDown(wxKeyEvent& e)
 void MapCanvas::onKeyUp(wxKeyEvent& e)
 {
 	// Send to editor
+	context_->requestRedraw();
 	context_->input().updateKeyModifiersWx(e.GetModifiers());
 	context_->input().keyUp(KeyBind::keyName(e.GetKeyCode()));
 
@@ -354,6 +458,7 @@ void MapCanvas::onMouseDown(wxMouseEvent& e)
 
 	// Send to editor context
 	bool skip = true;
+	context_->requestRedraw();
 	context_->input().updateKeyModifiersWx(e.GetModifiers());
 	if (e.LeftDown())
 		skip = context_->input().mouseDown(Input::MouseButton::Left);
@@ -394,6 +499,7 @@ void MapCanvas::onMouseUp(wxMouseEvent& e)
 
 	// Send to editor context
 	bool skip = true;
+	context_->requestRedraw();
 	context_->input().updateKeyModifiersWx(e.GetModifiers());
 	if (e.LeftUp())
 		skip = context_->input().mouseUp(Input::MouseButton::Left);
@@ -424,6 +530,7 @@ void MapCanvas::onMouseMotion(wxMouseEvent& e)
 	}
 
 	// Update mouse variables
+	context_->requestRedraw();
 	if (!context_->input().mouseMove(e.GetX(), e.GetY()))
 		return;
 
@@ -446,6 +553,7 @@ void MapCanvas::onMouseWheel(wxMouseEvent& e)
 	if (mwheel_rotation < 0.001)
 		return;
 
+	context_->requestRedraw();
 	context_->input().mouseWheel(e.GetWheelRotation() > 0, mwheel_rotation);
 }
 
@@ -455,6 +563,7 @@ void MapCanvas::onMouseWheel(wxMouseEvent& e)
 void MapCanvas::onMouseLeave(wxMouseEvent& e)
 {
 	context_->input().mouseLeave();
+	context_->requestRedraw();
 
 	e.Skip();
 }
@@ -481,6 +590,7 @@ void MapCanvas::onIdle(wxIdleEvent& e)
 	// Get time since last redraw
 	long frametime = (sf_clock_.getElapsedTime().asMilliseconds()) - last_time;
 
+	frame_stats_.idle_updates++;
 	if (context_->update(frametime))
 	{
 		last_time = (sf_clock_.getElapsedTime().asMilliseconds());
@@ -499,13 +609,22 @@ void MapCanvas::onRTimer(wxTimerEvent& e)
 	// Get time since last redraw
 	long frametime = (sf_clock_.getElapsedTime().asMilliseconds()) - last_time;
 
+	frame_stats_.updates++;
 	if (context_->update(frametime))
 	{
 		last_time = (sf_clock_.getElapsedTime().asMilliseconds());
 		Refresh();
+		timer.Start(map_bg_ms, true);
 	}
+	else if (context_->redrawPending())
+		timer.Start(map_bg_ms, true);
 
-	timer.Start(map_bg_ms, true);
+	// Nothing changed, sleep until woken by input or an announcement
+	else if (!timer.IsRunning())
+	{
+		sleeping_ = true;
+		sleep_start_ = sf_clock_.getElapsedTime().asMilliseconds();
+	}
 }
 
 /* MapCanvas::onFocus
@@ -513,6 +632,7 @@ void MapCanvas::onRTimer(wxTimerEvent& e)
  *******************************************************************/
 void MapCanvas::onFocus(wxFocusEvent& e)
 {
+	context_->requestRedraw();
 	if (e.GetEventType() == wxEVT_SET_FOCUS)
 	{
 		if (context_->editMode() == Mode::Visual)
@@ -521,3 +641,54 @@ void MapCanvas::onFocus(wxFocusEvent& e)
 	else if (e.GetEventType() == wxEVT_KILL_FOCUS)
 		lockMouse(false);
 }
+
+
+/*******************************************************************
+ * CONSOLE COMMANDS
+ *******************************************************************/
+
+CONSOLE_COMMAND(m_frame_stats, 0, false)
+{
+	MapCanvas* canvas = MapEditor::editContext().canvas();
+	if (!canvas)
+	{
+		Log::console("Map editor not open");
+		return;
+	}
+
+	if (args.size() > 0 && args[0].CmpNoCase("reset") == 0)
+	{
+		canvas->resetFrameStats();
+		Log::console("Frame stats reset");
+		return;
+	}
+
+	auto stats = canvas->frameStats();
+	double elapsed = MAX(stats.elapsed, 1) * 0.001;
+	Log::console(S_FMT("Frame stats over %1.1fs:", elapsed));
+	Log::console(S_FMT(
+		"%u frames drawn (%1.1f per second), %u timer updates, %u idle updates",
+		stats.frames,
+		(double)stats.frames / elapsed,
+		stats.updates,
+		stats.idle_updates
+	));
+	if (stats.frames > 0)
+		Log::console(S_FMT(
+			"Draw time: %1.2fms average, %1.2fms max",
+			(double)stats.draw_total / stats.frames * 0.001,
+			(double)stats.draw_max * 0.001
+		));
+	if (stats.intervals > 0)
+		Log::console(S_FMT(
+			"Frame interval (while awake): %1.2fms average, %1.2fms max",
+			(double)stats.interval_total / stats.intervals * 0.001,
+			(double)stats.interval_max * 0.001
+		));
+	Log::console(S_FMT(
+		"Asleep %1.1f%% of the time, woken %u times%s",
+		(double)stats.sleep_total / MAX(stats.elapsed, 1) * 100.0,
+		stats.wakeups,
+		canvas->isSleeping() ? " (currently asleep)" : ""
+	));
+}
@@ -4,12 +4,31 @@
 
 #include "common.h"
 #include "General/KeyBind.h"
+#include "General/ListenerAnnouncer.h"
 #include "UI/Canvas/OGLCanvas.h"
 #include "MapEditor/MapEditContext.h"
 
-class MapCanvas : public OGLCanvas, public KeyBindHandler
+class MapCanvas : public OGLCanvas, public KeyBindHandler, public Listener
 {
 public:
+	// Frame pacing statistics, since the canvas was created (or last reset)
+	struct frame_stats_t
+	{
+		long		start_time		= 0;
+		long		elapsed			= 0;	// Time covered by the stats (ms)
+		unsigned	frames			= 0;
+		unsigned	updates			= 0;	// Timer updates
+		unsigned	idle_updates	= 0;	// Idle event updates
+		unsigned	wakeups			= 0;	// Times the update timer was restarted after sleeping
+		sf::Int64	draw_total		= 0;	// Time spent drawing (us)
+		sf::Int64	draw_max		= 0;
+		unsigned	intervals		= 0;	// Number of frame intervals measured (excludes sleeps)
+		sf::Int64	interval_total	= 0;	// Time between consecutive frames (us)
+		sf::Int64	interval_max	= 0;
+		long		sleep_total		= 0;	// Time spent sleeping (ms)
+	};
+
+
 	MapCanvas(wxWindow* parent, int id, MapEditContext* context);
 	~MapCanvas();
 
@@ -21,14 +40,27 @@ public:
 	void	lockMouse(bool lock);
 	void	mouseLook3d();
 
+	// Updating
+	void					wake();
+	bool					isSleeping() const { return sleeping_; }
+	frame_stats_t			frameStats() const;
+	void					resetFrameStats();
+
 	// Keybind handling
 	void	onKeyBindPress(string name) override;
 
+	// Listener
+	void	onAnnouncement(Announcer* announcer, string event_name, MemChunk& event_data) override;
+
 private:
 	MapEditContext*	context_	= nullptr;
 	bool			mouse_warp_ = false;
 	vector<int>		fps_avg_;
 	sf::Clock		sf_clock_;
+	bool			sleeping_		= false;
+	long			sleep_start_	= 0;
+	sf::Int64		last_frame_		= -1;
+	frame_stats_t	frame_stats_;
 
 	// Events
 	void	onSize(wxSizeEvent& e);
@@ -41,11 +41,14 @@
 #include "General/Misc.h"
 #include "General/UI.h"
 #include "MainEditor/MainEditor.h"
+#include "MapEditor/BlockmapBuilder.h"
+#include "MapEditor/BSPBuilder.h"
 #include "MapEditor/MapBackupManager.h"
 #include "MapEditor/MapEditContext.h"
 #include "MapEditor/MapEditor.h"
 #include "MapEditor/MapTextureManager.h"
 #include "MapEditor/NodeBuilders.h"
+#include "MapEditor/RejectBuilder.h"
 #include "MapEditor/UI/MapCanvas.h"
 #include "MapEditor/UI/MapChecksPanel.h"
 #include "MapEditor/UI/ObjectEditPanel.h"
@@ -59,8 +62,11 @@
 #include "UI/SToolBar/SToolBar.h"
 #include "UI/Controls/UndoManagerHistoryPanel.h"
 #include "Utility/SFileDialog.h"
+#include "Utility/ThreadPool.h"
 #include "Utility/Tokenizer.h"
 #include "UI/WxUtils.h"
+#include <condition_variable>
+#include <mutex>
 
 
 // ----------------------------------------------------------------------------
@@ -72,6 +78,9 @@ CVAR(Bool, mew_maximized, true, CVAR_SAVE);
 CVAR(String, nodebuilder_id, "zdbsp", CVAR_SAVE);
 CVAR(String, nodebuilder_options, "", CVAR_SAVE);
 CVAR(Bool, save_archive_with_map, true, CVAR_SAVE);
+CVAR(Bool, map_build_blockmap, true, CVAR_SAVE);
+CVAR(Bool, map_build_blockmap_compress, true, CVAR_SAVE);
+CVAR(Bool, map_build_reject, false, CVAR_SAVE);
 
 
 // ----------------------------------------------------------------------------
@@ -82,6 +91,138 @@ CVAR(Bool, save_archive_with_map, true, CVAR_SAVE);
 EXTERN_CVAR(Int, flat_drawtype);
 
 
+// ----------------------------------------------------------------------------
+//
+// Local Functions
+//
+// ----------------------------------------------------------------------------
+namespace
+{
+	// REJECT/BLOCKMAP being built on a worker thread while a map is saved
+	struct lump_build_t
+	{
+		bool					reject;
+		bool					blockmap;
+		RejectBuilder			reject_builder;
+		BlockmapBuilder			blockmap_builder;
+		MemChunk				reject_data;
+		MemChunk				blockmap_data;
+		bool					blockmap_ok		= false;
+		int						reject_time		= 0;
+		int						blockmap_time	= 0;
+		unsigned				n_sectors		= 0;
+		bool					done			= false;
+		std::mutex				mutex;
+		std::condition_variable	cv;
+	};
+
+	// ------------------------------------------------------------------------
+	// startLumpBuild
+	//
+	// Reads [map] into the REJECT and/or BLOCKMAP builders (whichever are
+	// enabled) and starts building them on a worker thread. Returns nullptr
+	// if neither is enabled
+	// ------------------------------------------------------------------------
+	std::shared_ptr<lump_build_t> startLumpBuild(SLADEMap& map)
+	{
+		if (!map_build_reject && !map_build_blockmap)
+			return nullptr;
+
+		// The map is read here, so it can be edited while the lumps build
+		auto build = std::make_shared<lump_build_t>();
+		build->reject = map_build_reject;
+		build->blockmap = map_build_blockmap;
+		build->n_sectors = map.nSectors();
+		if (build->reject)
+			build->reject_builder.loadMap(map);
+		if (build->blockmap)
+			build->blockmap_builder.loadMap(map);
+
+		bool compress = map_build_blockmap_compress;
+		ThreadPool::run([build, compress]()
+		{
+			sf::Clock clock;
+			if (build->reject)
+			{
+				build->reject_builder.build(build->reject_data);
+				build->reject_time = clock.getElapsedTime().asMilliseconds();
+			}
+
+			clock.restart();
+			if (build->blockmap)
+			{
+				build->blockmap_ok = build->blockmap_builder.build(build->blockmap_data, compress);
+				build->blockmap_time = clock.getElapsedTime().asMilliseconds();
+			}
+
+			std::lock_guard<std::mutex> lock(build->mutex);
+			build->done = true;
+			build->cv.notify_all();
+		});
+
+		return build;
+	}
+
+	// ------------------------------------------------------------------------
+	// finishLumpBuild
+	//
+	// Waits for [build] to finish and adds the built lumps to the map in
+	// [wad]. Both REJECT and BLOCKMAP are added after SECTORS (empty if not
+	// built) so they are in the correct position
+	// ------------------------------------------------------------------------
+	void finishLumpBuild(lump_build_t& build, Archive* wad)
+	{
+		{
+			std::unique_lock<std::mutex> lock(build.mutex);
+			build.cv.wait(lock, [&build]() { return build.done; });
+		}
+
+		ArchiveEntry* sectors = wad->getEntry("SECTORS");
+		if (!sectors)
+			return;
+
+		// (The built-in node builder may have added empty lumps already)
+		unsigned index = wad->entryIndex(sectors);
+		ArchiveEntry* reject = wad->getEntry("REJECT");
+		if (!reject)
+			reject = wad->addNewEntry("REJECT", index + 1);
+		ArchiveEntry* blockmap = wad->getEntry("BLOCKMAP");
+		if (!blockmap)
+			blockmap = wad->addNewEntry("BLOCKMAP", wad->entryIndex(reject) + 1);
+
+		if (build.reject)
+		{
+			reject->importMemChunk(build.reject_data);
+			LOG_MESSAGE(
+				2,
+				"Built REJECT in %dms: %u of %u sector pairs can't see each other%s",
+				build.reject_time,
+				build.reject_builder.nHiddenPairs(),
+				build.n_sectors * build.n_sectors,
+				build.reject_builder.nOverflows() > 0 ?
+					S_FMT(" (%u sectors too complex to check)", build.reject_builder.nOverflows()) : ""
+			);
+		}
+
+		if (build.blockmap && build.blockmap_ok)
+		{
+			blockmap->importMemChunk(build.blockmap_data);
+			LOG_MESSAGE(
+				2,
+				"Built BLOCKMAP in %dms: %ux%u blocks, %u blocklists, %u bytes",
+				build.blockmap_time,
+				build.blockmap_builder.nColumns(),
+				build.blockmap_builder.nRows(),
+				build.blockmap_builder.nBlocklists(),
+				build.blockmap_data.getSize()
+			);
+		}
+		else if (build.blockmap)
+			Log::warning(1, "Map is too large for a BLOCKMAP, it was left empty");
+	}
+}
+
+
 // ----------------------------------------------------------------------------
 //
 // MapEditorWindow Class Functions
@@ -667,7 +808,7 @@ bool MapEditorWindow::openMap(Archive::MapDesc map)
 				map_data_,
 				map.head->getTopParent()->filename(false),
 				map.head->getName(true)))
-			LOG_MESSAGE(1, "Warning: Failed to backup map data");
+			LOG_MESSAGE(1, "Warning: Failed to write the previous map backup");
 	}
 
 	return ok;
@@ -750,10 +891,6 @@ void MapEditorWindow::buildNodes(Archive* wad)
 	string command;
 	string options;
 
-	// Save wad to disk
-	string filename = App::path("sladetemp.wad", App::Dir::Temp);
-	wad->save(filename);
-
 	// Get current nodebuilder
 	builder = NodeBuilders::getBuilder(nodebuilder_id);
 	command = builder.command;
@@ -763,6 +900,17 @@ void MapEditorWindow::buildNodes(Archive* wad)
 	if (builder.id == "none")
 		return;
 
+	// Built-in node builder works on the map directly
+	if (builder.id == "slade")
+	{
+		buildNodesInternal(wad);
+		return;
+	}
+
+	// Save wad to disk
+	string filename = App::path("sladetemp.wad", App::Dir::Temp);
+	wad->save(filename);
+
 	// Switch to ZDBSP if UDMF
 	if (MapEditor::editContext().mapDesc().format == MAP_UDMF && nodebuilder_id != "zdbsp")
 	{
@@ -819,18 +967,112 @@ void MapEditorWindow::buildNodes(Archive* wad)
 		LOG_MESSAGE(1, "Nodebuilder path not set up, no nodes were built");
 }
 
+// ----------------------------------------------------------------------------
+// MapEditorWindow::buildNodesInternal
+//
+// Builds nodes for the current map with the built-in node builder, and adds
+// them to the map entries in [wad]
+// ----------------------------------------------------------------------------
+void MapEditorWindow::buildNodesInternal(Archive* wad)
+{
+	sf::Clock clock;
+	int format = MapEditor::editContext().mapDesc().format;
+	string options = nodebuilder_options;
+	bool gl = options.Contains(" gl ") || format == MAP_UDMF;
+	bool extended = options.Contains(" extended ");
+
+	// Build
+	BSPBuilder bsp;
+	bsp.loadMap(MapEditor::editContext().map());
+	if (!bsp.build(gl))
+	{
+		LOG_MESSAGE(1, "Built-in node builder: Map has no lines, no nodes were built");
+		return;
+	}
+
+	// UDMF: GL nodes go in ZNODES, before ENDMAP
+	if (format == MAP_UDMF)
+	{
+		MemChunk nodes;
+		bsp.writeGL(nodes);
+		ArchiveEntry* endmap = wad->getEntry("ENDMAP");
+		ArchiveEntry* entry = wad->addNewEntry("ZNODES", endmap ? wad->entryIndex(endmap) : 0xFFFFFFFF);
+		entry->importMemChunk(nodes);
+	}
+
+	// Binary formats: SEGS, SSECTORS and NODES go between VERTEXES and
+	// SECTORS (ZDoom nodes go in NODES and leave SEGS/SSECTORS empty)
+	else
+	{
+		MemChunk vertexes, segs, ssectors, nodes;
+		if (gl)
+			bsp.writeGL(nodes);
+		else if (extended || !bsp.writeVanilla(vertexes, segs, ssectors, nodes))
+		{
+			if (!extended)
+				Log::warning(1, "Built-in node builder: Map is too large for vanilla nodes, extended nodes were built instead");
+			vertexes.clear();
+			segs.clear();
+			ssectors.clear();
+			bsp.writeExtended(nodes);
+		}
+
+		ArchiveEntry* entry = wad->getEntry("VERTEXES");
+		if (!entry)
+			return;
+		if (vertexes.hasData())
+			entry->importMemChunk(vertexes);
+		unsigned index = wad->entryIndex(entry);
+		wad->addNewEntry("SEGS", index + 1)->importMemChunk(segs);
+		wad->addNewEntry("SSECTORS", index + 2)->importMemChunk(ssectors);
+		wad->addNewEntry("NODES", index + 3)->importMemChunk(nodes);
+
+		// Lumps are found by position in binary maps, so REJECT and BLOCKMAP
+		// need to be present (empty, which most source ports will rebuild)
+		entry = wad->getEntry("SECTORS");
+		if (entry && !wad->getEntry("REJECT") && !wad->getEntry("BLOCKMAP"))
+		{
+			index = wad->entryIndex(entry);
+			wad->addNewEntry("REJECT", index + 1);
+			wad->addNewEntry("BLOCKMAP", index + 2);
+		}
+	}
+
+	LOG_MESSAGE(
+		1,
+		"Built-in node builder: %d nodes, %d subsectors, %d segs, %d splits (%s) in %dms",
+		bsp.nNodes(),
+		bsp.nSubsectors(),
+		gl ? bsp.nGLSegs() : bsp.nSegs(),
+		bsp.nSplits(),
+		gl ? "GL" : (extended ? "extended" : "vanilla"),
+		clock.getElapsedTime().asMilliseconds()
+	);
+}
+
 // ----------------------------------------------------------------------------
 // MapEditorWindow::writeMap
 //
-// Writes the current map as [name] to a wad archive and returns it
+// Writes the current map as [name] to a wad archive and returns it. If
+// [build_lumps] is true, REJECT and BLOCKMAP are built for binary format maps
+// (as enabled in the node builder preferences), unless an external node
+// builder is going to build them
 // ----------------------------------------------------------------------------
-WadArchive* MapEditorWindow::writeMap(string name, bool nodes)
+WadArchive* MapEditorWindow::writeMap(string name, bool nodes, bool build_lumps)
 {
 	auto& mdesc_current = MapEditor::editContext().mapDesc();
+	SLADEMap& map = MapEditor::editContext().map();
+
+	// Start building REJECT/BLOCKMAP in the background if needed, they are
+	// added to the wad once the map data and nodes have been written
+	std::shared_ptr<lump_build_t> lumps;
+	if (build_lumps &&
+		(mdesc_current.format == MAP_DOOM || mdesc_current.format == MAP_HEXEN) &&
+		(!nodes || nodebuilder_id == "none" || nodebuilder_id == "slade"))
+		lumps = startLumpBuild(map);
 
 	// Get map data entries
 	vector<ArchiveEntry*> new_map_data;
-	SLADEMap& map = MapEditor::editContext().map();
 	if (mdesc_current.format == MAP_DOOM)
 		map.writeDoomMap(new_map_data);
 	else if (mdesc_current.format == MAP_HEXEN)
@@ -884,6 +1126,10 @@ WadArchive* MapEditorWindow::writeMap(string name, bool nodes)
 	if (nodes)
 		buildNodes(wad);
 
+	// Add REJECT/BLOCKMAP
+	if (lumps)
+		finishLumpBuild(*lumps, wad);
+
 	// Clear current map data
 	for (unsigned a = 0; a < map_data_.size(); a++)
 		delete map_data_[a];
@@ -911,7 +1157,7 @@ bool MapEditorWindow::saveMap()
 		return saveMapAs();
 
 	// Write map to temp wad
-	WadArchive* wad = writeMap();
+	WadArchive* wad = writeMap("MAP01", true, true);
 	if (!wad)
 		return false;
 
@@ -951,7 +1197,7 @@ bool MapEditorWindow::saveMap()
 			map.head->getTopParent()->filename(false),
 			map.head->getName(true)
 		))
-		Log::warning(1, "Warning: Failed to backup map data");
+		Log::warning(1, "Warning: Failed to write the previous map backup");
 
 	// Add new map entries
 	for (unsigned a = 1; a < wad->numEntries(); a++)
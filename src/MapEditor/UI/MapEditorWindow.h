@@ -31,7 +31,7 @@ public:
 	bool		chooseMap(Archive* archive = nullptr);
 	bool		openMap(Archive::MapDesc map);
 	void		loadMapScripts(Archive::MapDesc map);
-	WadArchive*	writeMap(string name="MAP01", bool nodes = true);
+	WadArchive*	writeMap(string name = "MAP01", bool nodes = true, bool build_lumps = false);
 	bool		saveMap();
 	bool		saveMapAs();
 	void		closeMap();
@@ -62,6 +62,7 @@ private:
 	wxMenu*						menu_scripts_			= nullptr;
 
 	void	buildNodes(Archive* wad);
+	void	buildNodesInternal(Archive* wad);
 	void	lockMapEntries(bool lock = true);
 
 	// Events
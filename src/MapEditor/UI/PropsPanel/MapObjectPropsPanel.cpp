@@ -975,7 +975,7 @@ void MapObjectPropsPanel::openObjects(vector<MapObject*>& objects)
 		for (unsigned a = 0; a < objects.size(); a++)
 		{
 			// Go through object properties
-			vector<MobjPropertyList::prop_t> objprops = objects[a]->props().allProperties();
+			auto& objprops = objects[a]->props().allProperties();
 			for (unsigned b = 0; b < objprops.size(); b++)
 			{
 				// Ignore unset properties
@@ -983,18 +983,18 @@ void MapObjectPropsPanel::openObjects(vector<MapObject*>& objects)
 					continue;
 
 				// Ignore side property
-				if (objprops[b].name.StartsWith("side1.") || objprops[b].name.StartsWith("side2."))
+				if (objprops[b].name().StartsWith("side1.") || objprops[b].name().StartsWith("side2."))
 					continue;
 
 				// Check if hidden
-				if (VECTOR_EXISTS(hide_props_, objprops[b].name))
+				if (VECTOR_EXISTS(hide_props_, objprops[b].name()))
 					continue;
 
 				// Check if property is already on the list
 				bool exists = false;
 				for (unsigned c = 0; c < properties_.size(); c++)
 				{
-					if (properties_[c]->getPropName() == objprops[b].name)
+					if (properties_[c]->getPropName() == objprops[b].name())
 					{
 						exists = true;
 						break;
@@ -1007,19 +1007,19 @@ void MapObjectPropsPanel::openObjects(vector<MapObject*>& objects)
 					if (!group_custom_)
 						group_custom_ = pg_properties_->Append(new wxPropertyCategory("Custom"));
 
-					//LOG_MESSAGE(2, "Add custom property \"%s\"", objprops[b].name);
+					//LOG_MESSAGE(2, "Add custom property \"%s\"", objprops[b].name());
 
 					// Add property
 					switch (objprops[b].value.getType())
 					{
 					case PROP_BOOL:
-						addBoolProperty(group_custom_, objprops[b].name, objprops[b].name); break;
+						addBoolProperty(group_custom_, objprops[b].name(), objprops[b].name()); break;
 					case PROP_INT:
-						addIntProperty(group_custom_, objprops[b].name, objprops[b].name); break;
+						addIntProperty(group_custom_, objprops[b].name(), objprops[b].name()); break;
 					case PROP_FLOAT:
-						addFloatProperty(group_custom_, objprops[b].name, objprops[b].name); break;
+						addFloatProperty(group_custom_, objprops[b].name(), objprops[b].name()); break;
 					default:
-						addStringProperty(group_custom_, objprops[b].name, objprops[b].name); break;
+						addStringProperty(group_custom_, objprops[b].name(), objprops[b].name()); break;
 					}
 				}
 			}
@@ -1,286 +1,584 @@
-
 #include "Main.h"
 #include "SLADEMap/SLADEMap.h"
 #include "UndoSteps.h"
+#include "Utility/Compression.h"
 
 using namespace MapEditor;
 
+
+// ----------------------------------------------------------------------------
+//
+// Binary Encoding Functions
+//
+// Undo data is kept in a compact binary form rather than as full
+// mobj_backup_t structs. Integers are written as varints (zigzag-encoded if
+// signed), properties as a type byte (0xFF if the property doesn't exist)
+// followed by the value
+//
+// ----------------------------------------------------------------------------
+namespace
+{
+	const uint8_t PROP_NONE = 0xFF;
+	const uint8_t PROP_HAS_VALUE = 0x80;
+
+	void writeVarint(vector<uint8_t>& out, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back((uint8_t)(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back((uint8_t)value);
+	}
+
+	uint64_t readVarint(const vector<uint8_t>& in, unsigned& pos)
+	{
+		uint64_t value = 0;
+		unsigned shift = 0;
+		while (pos < in.size() && shift < 64)
+		{
+			uint8_t b = in[pos++];
+			value |= (uint64_t)(b & 0x7F) << shift;
+			if (!(b & 0x80))
+				break;
+			shift += 7;
+		}
+		return value;
+	}
+
+	void writeSigned(vector<uint8_t>& out, int64_t value)
+	{
+		writeVarint(out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+	}
+
+	int64_t readSigned(const vector<uint8_t>& in, unsigned& pos)
+	{
+		uint64_t value = readVarint(in, pos);
+		return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+	}
+
+	void writeProperty(vector<uint8_t>& out, const Property* prop)
+	{
+		if (!prop)
+		{
+			out.push_back(PROP_NONE);
+			return;
+		}
+
+		uint8_t type = prop->getType();
+		out.push_back(type | (prop->hasValue() ? PROP_HAS_VALUE : 0));
+		switch (type)
+		{
+		case PROP_BOOL:
+			out.push_back(prop->getBoolValue() ? 1 : 0); break;
+		case PROP_INT:
+			writeSigned(out, prop->getIntValue()); break;
+		case PROP_UINT:
+			writeVarint(out, prop->getUnsignedValue()); break;
+		case PROP_FLOAT:
+		{
+			double value = prop->getFloatValue();
+			const uint8_t* bytes = (const uint8_t*)&value;
+			out.insert(out.end(), bytes, bytes + sizeof(double));
+			break;
+		}
+		case PROP_STRING:
+		{
+			wxCharBuffer utf8 = prop->getStringValue().ToUTF8();
+			unsigned len = utf8.length();
+			writeVarint(out, len);
+			out.insert(out.end(), (const uint8_t*)utf8.data(), (const uint8_t*)utf8.data() + len);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	// Reads a property from [in] at [pos]. Returns false if the property
+	// doesn't exist
+	bool readProperty(const vector<uint8_t>& in, unsigned& pos, Property& prop)
+	{
+		uint8_t type = in[pos++];
+		if (type == PROP_NONE)
+			return false;
+
+		bool has_value = (type & PROP_HAS_VALUE) != 0;
+		type &= ~PROP_HAS_VALUE;
+		prop = Property(type);
+		switch (type)
+		{
+		case PROP_BOOL:
+			prop.setValue(in[pos++] != 0); break;
+		case PROP_INT:
+			prop.setValue((int)readSigned(in, pos)); break;
+		case PROP_UINT:
+			prop.setValue((unsigned)readVarint(in, pos)); break;
+		case PROP_FLOAT:
+		{
+			double value;
+			memcpy(&value, &in[pos], sizeof(double));
+			pos += sizeof(double);
+			prop.setValue(value);
+			break;
+		}
+		case PROP_STRING:
+		{
+			unsigned len = (unsigned)readVarint(in, pos);
+			prop.setValue(wxString::FromUTF8((const char*)&in[pos], len));
+			pos += len;
+			break;
+		}
+		default:
+			break;
+		}
+		prop.setHasValue(has_value);
+
+		return true;
+	}
+
+	// Returns the property list [list] (0 = properties, 1 = internal) of
+	// [backup]
+	MobjPropertyList& backupList(mobj_backup_t& backup, uint8_t list)
+	{
+		return list == 0 ? backup.properties : backup.props_internal;
+	}
+
+	// Writes all properties of [backup] to [out]
+	void encodeBackup(vector<uint8_t>& out, mobj_backup_t& backup)
+	{
+		writeVarint(out, backup.id);
+		out.push_back(backup.type);
+		for (uint8_t list = 0; list < 2; list++)
+		{
+			auto& props = backupList(backup, list).allProperties();
+			writeVarint(out, props.size());
+			for (auto& prop : props)
+			{
+				writeVarint(out, prop.key);
+				writeProperty(out, &prop.value);
+			}
+		}
+	}
+
+	// Reads a backup previously written with encodeBackup
+	void decodeBackup(const vector<uint8_t>& in, mobj_backup_t& backup)
+	{
+		unsigned pos = 0;
+		backup.id = (unsigned)readVarint(in, pos);
+		backup.type = in[pos++];
+		for (uint8_t list = 0; list < 2; list++)
+		{
+			auto& props = backupList(backup, list);
+			props.clear();
+			unsigned count = (unsigned)readVarint(in, pos);
+			for (unsigned a = 0; a < count; a++)
+			{
+				auto key = (MobjPropertyList::Atom)readVarint(in, pos);
+				Property value;
+				if (readProperty(in, pos, value))
+					props[key] = value;
+			}
+		}
+	}
+
+	// Returns true if [p1] and [p2] are identical (including type and
+	// existence)
+	bool propertiesEqual(const Property* p1, const Property* p2)
+	{
+		if (!p1 || !p2)
+			return p1 == p2;
+
+		vector<uint8_t> e1, e2;
+		writeProperty(e1, p1);
+		writeProperty(e2, p2);
+		return e1 == e2;
+	}
+
+	// Writes only the properties that differ between [before] and [after] to
+	// [out], as [list][atom][before][after] records. Returns the number of
+	// records written
+	unsigned encodeDelta(vector<uint8_t>& out, mobj_backup_t& before, mobj_backup_t& after)
+	{
+		unsigned count = 0;
+		vector<uint8_t> records;
+		for (uint8_t list = 0; list < 2; list++)
+		{
+			MobjPropertyList& l_before = backupList(before, list);
+			MobjPropertyList& l_after = backupList(after, list);
+
+			// Changed or removed properties
+			for (auto& prop : l_before.allProperties())
+			{
+				const Property* p_after = l_after.get(prop.key);
+				if (propertiesEqual(&prop.value, p_after))
+					continue;
+
+				records.push_back(list);
+				writeVarint(records, prop.key);
+				writeProperty(records, &prop.value);
+				writeProperty(records, p_after);
+				count++;
+			}
+
+			// Added properties
+			for (auto& prop : l_after.allProperties())
+			{
+				if (l_before.get(prop.key))
+					continue;
+
+				records.push_back(list);
+				writeVarint(records, prop.key);
+				writeProperty(records, nullptr);
+				writeProperty(records, &prop.value);
+				count++;
+			}
+		}
+
+		if (count > 0)
+		{
+			writeVarint(out, after.id);
+			writeVarint(out, count);
+			out.insert(out.end(), records.begin(), records.end());
+		}
+
+		return count;
+	}
+
+	// Applies the delta for one object at [pos] in [in] to its object in
+	// [map]: the 'before' values if [undo] is true, otherwise the 'after'
+	// values
+	void applyDelta(const vector<uint8_t>& in, unsigned& pos, SLADEMap* map, bool undo)
+	{
+		unsigned id = (unsigned)readVarint(in, pos);
+		unsigned count = (unsigned)readVarint(in, pos);
+		MapObject* obj = map->getObjectById(id);
+
+		mobj_backup_t backup;
+		if (obj)
+			obj->backup(&backup);
+
+		for (unsigned a = 0; a < count; a++)
+		{
+			uint8_t list = in[pos++];
+			auto key = (MobjPropertyList::Atom)readVarint(in, pos);
+
+			Property p_before, p_after;
+			bool before_exists = readProperty(in, pos, p_before);
+			bool after_exists = readProperty(in, pos, p_after);
+
+			MobjPropertyList& props = backupList(backup, list);
+			if (undo ? before_exists : after_exists)
+				props[key] = undo ? p_before : p_after;
+			else
+				props.removeProperty(MobjPropertyList::atomName(key));
+		}
+
+		if (obj)
+			obj->loadFromBackup(&backup);
+	}
+
+	void encodeIdList(vector<uint8_t>& out, const vector<unsigned>& list)
+	{
+		// Ids are mostly ascending, so store each as a difference from the
+		// previous one
+		writeVarint(out, list.size());
+		int64_t prev = 0;
+		for (unsigned id : list)
+		{
+			writeSigned(out, (int64_t)id - prev);
+			prev = id;
+		}
+	}
+
+	void decodeIdList(const vector<uint8_t>& in, vector<unsigned>& list)
+	{
+		unsigned pos = 0;
+		unsigned count = (unsigned)readVarint(in, pos);
+		list.resize(count);
+		int64_t prev = 0;
+		for (unsigned a = 0; a < count; a++)
+		{
+			prev += readSigned(in, pos);
+			list[a] = (unsigned)prev;
+		}
+	}
+
+	const uint8_t list_types[] = { MOBJ_VERTEX, MOBJ_LINE, MOBJ_SIDE, MOBJ_SECTOR, MOBJ_THING };
+	const char* list_names[] = { "vertices", "lines", "sides", "sectors", "things" };
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// UndoData Class Functions
+//
+// ----------------------------------------------------------------------------
+
+void UndoData::set(const vector<uint8_t>& bytes)
+{
+	data.clear();
+	if (!bytes.empty())
+		data.importMem(bytes.data(), bytes.size());
+	raw_size = bytes.size();
+	compressed = false;
+}
+
+bool UndoData::get(vector<uint8_t>& bytes)
+{
+	if (!compressed)
+	{
+		bytes.assign(data.getData(), data.getData() + data.getSize());
+		return true;
+	}
+
+	MemChunk raw;
+	if (!Compression::ZlibInflate(data, raw, raw_size) || raw.getSize() != raw_size)
+	{
+		LOG_MESSAGE(1, "Error: Unable to decompress undo data (%u bytes)", raw_size);
+		bytes.clear();
+		return false;
+	}
+	bytes.assign(raw.getData(), raw.getData() + raw.getSize());
+	return true;
+}
+
+void UndoData::compress()
+{
+	// Not worth compressing very small data
+	if (compressed || raw_size < 64)
+		return;
+
+	MemChunk packed;
+	if (Compression::ZlibDeflate(data, packed) && packed.getSize() < data.getSize())
+	{
+		data.importMem(packed.getData(), packed.getSize());
+		compressed = true;
+	}
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// PropertyChangeUS Class Functions
+//
+// ----------------------------------------------------------------------------
+
 PropertyChangeUS::PropertyChangeUS(MapObject* object)
 {
-	backup = new mobj_backup_t();
-	object->backup(backup);
+	mobj_backup_t bak;
+	object->backup(&bak);
+	id = bak.id;
+
+	vector<uint8_t> bytes;
+	encodeBackup(bytes, bak);
+	backup.set(bytes);
 }
 
 PropertyChangeUS::~PropertyChangeUS()
 {
-	delete backup;
 }
 
-void PropertyChangeUS::doSwap(MapObject* obj)
+bool PropertyChangeUS::doSwap(MapObject* obj)
 {
-	mobj_backup_t* temp = new mobj_backup_t();
-	obj->backup(temp);
-	obj->loadFromBackup(backup);
-	delete backup;
-	backup = temp;
+	vector<uint8_t> bytes;
+	if (!backup.get(bytes))
+		return false;
+	if (bytes.empty())
+		return true;
+
+	mobj_backup_t restore;
+	decodeBackup(bytes, restore);
+
+	// Keep the current state for redo/undo
+	mobj_backup_t current;
+	obj->backup(&current);
+	bytes.clear();
+	encodeBackup(bytes, current);
+	backup.set(bytes);
+
+	obj->loadFromBackup(&restore);
+	return true;
 }
 
 bool PropertyChangeUS::doUndo()
 {
-	MapObject* obj = UndoRedo::currentMap()->getObjectById(backup->id);
-	if (obj) doSwap(obj);
+	MapObject* obj = UndoRedo::currentMap()->getObjectById(id);
+	if (obj) return doSwap(obj);
 
 	return true;
 }
 
 bool PropertyChangeUS::doRedo()
 {
-	MapObject* obj = UndoRedo::currentMap()->getObjectById(backup->id);
-	if (obj) doSwap(obj);
+	MapObject* obj = UndoRedo::currentMap()->getObjectById(id);
+	if (obj) return doSwap(obj);
 
 	return true;
 }
 
 
+// ----------------------------------------------------------------------------
+//
+// MapObjectCreateDeleteUS Class Functions
+//
+// ----------------------------------------------------------------------------
+
 MapObjectCreateDeleteUS::MapObjectCreateDeleteUS()
 {
 	SLADEMap* map = UndoRedo::currentMap();
-	map->getObjectIdList(MOBJ_VERTEX, vertices);
-	map->getObjectIdList(MOBJ_LINE, lines);
-	map->getObjectIdList(MOBJ_SIDE, sides);
-	map->getObjectIdList(MOBJ_SECTOR, sectors);
-	map->getObjectIdList(MOBJ_THING, things);
+	for (unsigned a = 0; a < 5; a++)
+	{
+		map->getObjectIdList(list_types[a], initial[a]);
+		changed[a] = true;
+	}
 }
 
-void MapObjectCreateDeleteUS::swapLists()
+bool MapObjectCreateDeleteUS::swapLists()
 {
-	// Backup
-	vector<unsigned> vertices;
-	vector<unsigned> lines;
-	vector<unsigned> sides;
-	vector<unsigned> sectors;
-	vector<unsigned> things;
+	// Get all lists to restore first, so nothing is changed if any of them
+	// can't be read
+	vector<uint8_t> bytes[5];
+	for (unsigned a = 0; a < 5; a++)
+		if (changed[a] && !lists[a].get(bytes[a]))
+			return false;
+
 	SLADEMap* map = UndoRedo::currentMap();
-	if (isValid(this->vertices))	map->getObjectIdList(MOBJ_VERTEX, vertices);
-	if (isValid(this->lines))		map->getObjectIdList(MOBJ_LINE, lines);
-	if (isValid(this->sides))		map->getObjectIdList(MOBJ_SIDE, sides);
-	if (isValid(this->sectors))		map->getObjectIdList(MOBJ_SECTOR, sectors);
-	if (isValid(this->things))		map->getObjectIdList(MOBJ_THING, things);
-
-	// Restore
-	if (isValid(this->vertices))
-	{
-		map->restoreObjectIdList(MOBJ_VERTEX, this->vertices);
-		this->vertices = vertices;
-		map->updateGeometryInfo(0);
-	}
-	if (isValid(this->lines))
+	vector<unsigned> restore, current;
+	for (unsigned a = 0; a < 5; a++)
 	{
-		map->restoreObjectIdList(MOBJ_LINE, this->lines);
-		this->lines = lines;
-		map->updateGeometryInfo(0);
-	}
-	if (isValid(this->sides))
-	{
-		map->restoreObjectIdList(MOBJ_SIDE, this->sides);
-		this->sides = sides;
-	}
-	if (isValid(this->sectors))
-	{
-		map->restoreObjectIdList(MOBJ_SECTOR, this->sectors);
-		this->sectors = sectors;
-	}
-	if (isValid(this->things))
-	{
-		map->restoreObjectIdList(MOBJ_THING, this->things);
-		this->things = things;
+		if (!changed[a])
+			continue;
+
+		// Backup
+		current.clear();
+		map->getObjectIdList(list_types[a], current);
+
+		// Restore
+		decodeIdList(bytes[a], restore);
+		map->restoreObjectIdList(list_types[a], restore);
+		bytes[a].clear();
+		encodeIdList(bytes[a], current);
+		lists[a].set(bytes[a]);
+
+		if (list_types[a] == MOBJ_VERTEX || list_types[a] == MOBJ_LINE)
+			map->updateGeometryInfo(0);
 	}
+
+	return true;
 }
 
 bool MapObjectCreateDeleteUS::doUndo()
 {
-	swapLists();
-	return true;
+	return swapLists();
 }
 
 bool MapObjectCreateDeleteUS::doRedo()
 {
-	swapLists();
-	return true;
+	return swapLists();
 }
 
 void MapObjectCreateDeleteUS::checkChanges()
 {
 	SLADEMap* map = UndoRedo::currentMap();
-
-	// Check vertices changed
-	bool vertices_changed = false;
-	if (map->nVertices() != vertices.size())
-		vertices_changed = true;
-	else
-		for (unsigned a = 0; a < map->nVertices(); a++)
-			if (map->getVertex(a)->getId() != vertices[a])
-			{
-				vertices_changed = true;
-				break;
-			}
-	if (!vertices_changed)
+	vector<unsigned> current;
+	vector<uint8_t> bytes;
+	for (unsigned a = 0; a < 5; a++)
 	{
-		// No change, clear
-		vertices.clear();
-		vertices.push_back(0);
-		LOG_MESSAGE(3, "MapObjectCreateDeleteUS: No vertices added/deleted");
-	}
+		current.clear();
+		map->getObjectIdList(list_types[a], current);
+		changed[a] = (current != initial[a]);
 
-	// Check lines changed
-	bool lines_changed = false;
-	if (map->nLines() != lines.size())
-		lines_changed = true;
-	else
-		for (unsigned a = 0; a < map->nLines(); a++)
-			if (map->getLine(a)->getId() != lines[a])
-			{
-				lines_changed = true;
-				break;
-			}
-	if (!lines_changed)
-	{
-		// No change, clear
-		lines.clear();
-		lines.push_back(0);
-		LOG_MESSAGE(3, "MapObjectCreateDeleteUS: No lines added/deleted");
-	}
-
-	// Check sides changed
-	bool sides_changed = false;
-	if (map->nSides() != sides.size())
-		sides_changed = true;
-	else
-		for (unsigned a = 0; a < map->nSides(); a++)
-			if (map->getSide(a)->getId() != sides[a])
-			{
-				sides_changed = true;
-				break;
-			}
-	if (!sides_changed)
-	{
-		// No change, clear
-		sides.clear();
-		sides.push_back(0);
-		LOG_MESSAGE(3, "MapObjectCreateDeleteUS: No sides added/deleted");
-	}
-
-	// Check sectors changed
-	bool sectors_changed = false;
-	if (map->nSectors() != sectors.size())
-		sectors_changed = true;
-	else
-		for (unsigned a = 0; a < map->nSectors(); a++)
-			if (map->getSector(a)->getId() != sectors[a])
-			{
-				sectors_changed = true;
-				break;
-			}
-	if (!sectors_changed)
-	{
-		// No change, clear
-		sectors.clear();
-		sectors.push_back(0);
-		LOG_MESSAGE(3, "MapObjectCreateDeleteUS: No sectors added/deleted");
-	}
+		if (changed[a])
+		{
+			bytes.clear();
+			encodeIdList(bytes, initial[a]);
+			lists[a].set(bytes);
+		}
+		else
+			LOG_MESSAGE(3, "MapObjectCreateDeleteUS: No %s added/deleted", list_names[a]);
 
-	// Check things changed
-	bool things_changed = false;
-	if (map->nThings() != things.size())
-		things_changed = true;
-	else
-		for (unsigned a = 0; a < map->nThings(); a++)
-			if (map->getThing(a)->getId() != things[a])
-			{
-				things_changed = true;
-				break;
-			}
-	if (!things_changed)
-	{
-		// No change, clear
-		things.clear();
-		things.push_back(0);
-		LOG_MESSAGE(3, "MapObjectCreateDeleteUS: No things added/deleted");
+		// Initial lists are no longer needed
+		vector<unsigned>().swap(initial[a]);
 	}
 }
 
 bool MapObjectCreateDeleteUS::isOk()
 {
 	// Check for any changes at all
-	if (vertices.size() == 1 && vertices[0] == 0 &&
-		lines.size() == 1 && lines[0] == 0 &&
-		sides.size() == 1 && sides[0] == 0 &&
-		sectors.size() == 1 && sectors[0] == 0 &&
-		things.size() == 1 && things[0] == 0)
-		return false;
+	for (unsigned a = 0; a < 5; a++)
+		if (changed[a])
+			return true;
 
-	return true;
+	return false;
 }
 
+size_t MapObjectCreateDeleteUS::memoryUsage()
+{
+	size_t total = 0;
+	for (unsigned a = 0; a < 5; a++)
+		total += lists[a].memoryUsage();
+
+	return total;
+}
+
+void MapObjectCreateDeleteUS::compress()
+{
+	for (unsigned a = 0; a < 5; a++)
+		lists[a].compress();
+}
 
 
-MultiMapObjectPropertyChangeUS::MultiMapObjectPropertyChangeUS()
+// ----------------------------------------------------------------------------
+//
+// MultiMapObjectPropertyChangeUS Class Functions
+//
+// ----------------------------------------------------------------------------
+
+MultiMapObjectPropertyChangeUS::MultiMapObjectPropertyChangeUS() : n_objects{ 0 }
 {
-	// Get backups of recently modified map objects
+	// Get deltas of recently modified map objects (between their backup and
+	// their current state)
 	vector<MapObject*> objects = UndoRedo::currentMap()->getAllModifiedObjects(MapObject::propBackupTime());
+	vector<uint8_t> bytes;
+	string msg = "Modified ids: ";
 	for (unsigned a = 0; a < objects.size(); a++)
 	{
 		mobj_backup_t* bak = objects[a]->getBackup(true);
-		if (bak)
+		if (!bak)
+			continue;
+
+		mobj_backup_t current;
+		objects[a]->backup(&current);
+		if (encodeDelta(bytes, *bak, current) > 0)
 		{
-			backups.push_back(bak);
-			//LOG_MESSAGE(1, "%s #%d modified", objects[a]->getTypeName(), objects[a]->getIndex());
+			n_objects++;
+			if (Log::verbosity() >= 2)
+				msg += S_FMT("%d, ", bak->id);
 		}
+		delete bak;
 	}
 
+	deltas.set(bytes);
+
 	if (Log::verbosity() >= 2)
-	{
-		string msg = "Modified ids: ";
-		for (unsigned a = 0; a < backups.size(); a++)
-			msg += S_FMT("%d, ", backups[a]->id);
 		Log::info(msg);
-	}
 }
 
 MultiMapObjectPropertyChangeUS::~MultiMapObjectPropertyChangeUS()
 {
-	for (unsigned a = 0; a < backups.size(); a++)
-		delete backups[a];
-}
-
-void MultiMapObjectPropertyChangeUS::doSwap(MapObject* obj, unsigned index)
-{
-	mobj_backup_t* temp = new mobj_backup_t();
-	obj->backup(temp);
-	obj->loadFromBackup(backups[index]);
-	delete backups[index];
-	backups[index] = temp;
 }
 
-bool MultiMapObjectPropertyChangeUS::doUndo()
+bool MultiMapObjectPropertyChangeUS::apply(bool undo)
 {
-	for (unsigned a = 0; a < backups.size(); a++)
-	{
-		MapObject* obj = UndoRedo::currentMap()->getObjectById(backups[a]->id);
-		if (obj) doSwap(obj, a);
-	}
-
-	return true;
-}
+	vector<uint8_t> bytes;
+	if (!deltas.get(bytes))
+		return false;
 
-bool MultiMapObjectPropertyChangeUS::doRedo()
-{
-	//LOG_MESSAGE(2, "Restore %lu objects", backups.size());
-	for (unsigned a = 0; a < backups.size(); a++)
-	{
-		MapObject* obj = UndoRedo::currentMap()->getObjectById(backups[a]->id);
-		if (obj) doSwap(obj, a);
-	}
+	SLADEMap* map = UndoRedo::currentMap();
+	unsigned pos = 0;
+	for (unsigned a = 0; a < n_objects && pos < bytes.size(); a++)
+		applyDelta(bytes, pos, map, undo);
 
 	return true;
 }
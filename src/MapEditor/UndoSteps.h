@@ -7,6 +7,24 @@ struct mobj_backup_t;
 
 namespace MapEditor
 {
+	// Binary undo data, which can be kept zlib-compressed while it isn't
+	// being used (ie. for older undo levels)
+	class UndoData
+	{
+	public:
+		UndoData() : raw_size{ 0 }, compressed{ false } {}
+
+		void		set(const vector<uint8_t>& bytes);
+		bool		get(vector<uint8_t>& bytes);
+		void		compress();
+		size_t		memoryUsage() const { return data.getSize(); }
+
+	private:
+		MemChunk	data;
+		unsigned	raw_size;
+		bool		compressed;
+	};
+
  	// UndoStep for when a MapObject has properties changed
 	class PropertyChangeUS : public UndoStep
 	{
@@ -14,12 +32,16 @@ namespace MapEditor
 		PropertyChangeUS(MapObject* object);
 		~PropertyChangeUS();
 
-		void doSwap(MapObject* obj);
+		bool doSwap(MapObject* obj);
 		bool doUndo();
 		bool doRedo();
 
+		size_t		memoryUsage() { return backup.memoryUsage(); }
+		void		compress() { backup.compress(); }
+
 	private:
-		mobj_backup_t*	backup;
+		unsigned	id;
+		UndoData	backup;
 	};
 
  	// UndoStep for when a MapObject is either created or deleted
@@ -29,19 +51,23 @@ namespace MapEditor
 		MapObjectCreateDeleteUS();
 		~MapObjectCreateDeleteUS() {}
 
-		bool isValid(vector<unsigned>& list) { return !(list.size() == 1 && list[0] == 0); }
-		void swapLists();
+		bool swapLists();
 		bool doUndo();
 		bool doRedo();
 		void checkChanges();
 		bool isOk();
 
+		size_t		memoryUsage();
+		void		compress();
+
 	private:
-		vector<unsigned>	vertices;
-		vector<unsigned>	lines;
-		vector<unsigned>	sides;
-		vector<unsigned>	sectors;
-		vector<unsigned>	things;
+		// Object id lists for each object type, encoded once checkChanges
+		// has been called. Lists that didn't change aren't kept
+		UndoData	lists[5];
+		bool		changed[5];
+
+		// Id lists at the start of recording, until checkChanges is called
+		vector<unsigned>	initial[5];
 	};
 
 	// UndoStep for when multiple MapObjects have properties changed
@@ -51,12 +77,17 @@ namespace MapEditor
 		MultiMapObjectPropertyChangeUS();
 		~MultiMapObjectPropertyChangeUS();
 
-		void doSwap(MapObject* obj, unsigned index);
-		bool doUndo();
-		bool doRedo();
-		bool isOk() { return !backups.empty(); }
+		bool apply(bool undo);
+		bool doUndo() { return apply(true); }
+		bool doRedo() { return apply(false); }
+		bool isOk() { return n_objects > 0; }
+
+		size_t		memoryUsage() { return deltas.memoryUsage(); }
+		void		compress() { deltas.compress(); }
 
 	private:
-		vector<mobj_backup_t*>	backups;
+		// Property changes (before and after) for each modified object
+		UndoData	deltas;
+		unsigned	n_objects;
 	};
 }
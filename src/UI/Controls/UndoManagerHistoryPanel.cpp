@@ -33,6 +33,7 @@
 // ----------------------------------------------------------------------------
 #include "Main.h"
 #include "UndoManagerHistoryPanel.h"
+#include "General/Misc.h"
 #include "General/UndoRedo.h"
 #include "UI/WxUtils.h"
 
@@ -78,10 +79,14 @@ string UndoListView::getItemText(long item, long column, long index) const
 			string name = manager_->undoLevel((unsigned) item)->getName();
 			return S_FMT("%lu. %s", item + 1, name);
 		}
-		else
+		else if (column == 1)
 		{
 			return manager_->undoLevel((unsigned) item)->getTimeStamp(false, true);
 		}
+		else
+		{
+			return Misc::sizeAsString(manager_->undoLevel((unsigned) item)->memoryUsage());
+		}
 	}
 	else
 		return "Invalid Index";
@@ -186,6 +191,7 @@ UndoManagerHistoryPanel::UndoManagerHistoryPanel(wxWindow* parent, UndoManager*
 
 	list_levels_->AppendColumn("Action", wxLIST_FORMAT_LEFT, UI::scalePx(160));
 	list_levels_->AppendColumn("Time", wxLIST_FORMAT_RIGHT);
+	list_levels_->AppendColumn("Memory", wxLIST_FORMAT_RIGHT);
 	list_levels_->Bind(wxEVT_LIST_ITEM_RIGHT_CLICK, &UndoManagerHistoryPanel::onItemRightClick, this);
 	Bind(wxEVT_MENU, &UndoManagerHistoryPanel::onMenu, this);
 }
@@ -0,0 +1,359 @@
+// ----------------------------------------------------------------------------
+// SLADE - It's a Doom Editor
+// Copyright(C) 2008 - 2017 Simon Judd
+//
+// Email:       sirjuddington@gmail.com
+// Web:         http://slade.mancubus.net
+// Filename:    AABBTree.cpp
+// Description: AABBTree class - a bounding volume hierarchy of 3d boxes for
+//              ray picking, which can be refit when boxes change
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301, USA.
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+//
+// Includes
+//
+// ----------------------------------------------------------------------------
+#include "Main.h"
+#include "AABBTree.h"
+
+
+// ----------------------------------------------------------------------------
+//
+// Variables
+//
+// ----------------------------------------------------------------------------
+namespace
+{
+	// Maximum number of objects in a leaf node
+	const unsigned	max_leaf_objects	= 4;
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// AABBTree::box_t Struct Functions
+//
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+// AABBTree::box_t::extend
+//
+// Extends the box to contain [box] (empty boxes are ignored)
+// ----------------------------------------------------------------------------
+void AABBTree::box_t::extend(const box_t& box)
+{
+	if (box.isEmpty())
+		return;
+
+	extend(box.min.x, box.min.y, box.min.z);
+	extend(box.max.x, box.max.y, box.max.z);
+}
+
+// ----------------------------------------------------------------------------
+// AABBTree::box_t::extend
+//
+// Extends the box to contain the point [x,y,z]
+// ----------------------------------------------------------------------------
+void AABBTree::box_t::extend(double x, double y, double z)
+{
+	if (isEmpty())
+	{
+		min.set(x, y, z);
+		max.set(x, y, z);
+		return;
+	}
+
+	min.x = MIN(min.x, x);
+	min.y = MIN(min.y, y);
+	min.z = MIN(min.z, z);
+	max.x = MAX(max.x, x);
+	max.y = MAX(max.y, y);
+	max.z = MAX(max.z, z);
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// AABBTree Class Functions
+//
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+// AABBTree::clear
+//
+// Clears all boxes and nodes
+// ----------------------------------------------------------------------------
+void AABBTree::clear()
+{
+	boxes_.clear();
+	nodes_.clear();
+	objects_.clear();
+	leaves_.clear();
+}
+
+// ----------------------------------------------------------------------------
+// AABBTree::build
+//
+// Builds the tree from [boxes]. Objects are identified by their index in
+// [boxes]
+// ----------------------------------------------------------------------------
+void AABBTree::build(const vector<box_t>& boxes)
+{
+	clear();
+	if (boxes.empty())
+		return;
+
+	boxes_ = boxes;
+	objects_.resize(boxes_.size());
+	leaves_.resize(boxes_.size());
+	vector<fpoint3_t> centres(boxes_.size());
+	for (unsigned a = 0; a < boxes_.size(); a++)
+	{
+		objects_[a] = a;
+		if (!boxes_[a].isEmpty())
+			centres[a].set(
+				(boxes_[a].min.x + boxes_[a].max.x) * 0.5,
+				(boxes_[a].min.y + boxes_[a].max.y) * 0.5,
+				(boxes_[a].min.z + boxes_[a].max.z) * 0.5
+			);
+	}
+
+	nodes_.reserve(boxes_.size() / 2 + 1);
+	buildNode(0, boxes_.size(), -1, centres);
+}
+
+// ----------------------------------------------------------------------------
+// AABBTree::refit
+//
+// Changes the box of object [index] to [box], and updates the boxes of the
+// nodes containing it
+// ----------------------------------------------------------------------------
+void AABBTree::refit(unsigned index, const box_t& box)
+{
+	if (index >= boxes_.size())
+		return;
+
+	boxes_[index] = box;
+
+	// Update node boxes up to the root (or until one doesn't change)
+	int node = leaves_[index];
+	while (node >= 0)
+	{
+		box_t old = nodes_[node].box;
+		updateNodeBox(node);
+
+		const box_t& nb = nodes_[node].box;
+		if (old.min.x == nb.min.x && old.min.y == nb.min.y && old.min.z == nb.min.z &&
+			old.max.x == nb.max.x && old.max.y == nb.max.y && old.max.z == nb.max.z)
+			break;
+
+		node = nodes_[node].parent;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// AABBTree::intersectRay
+//
+// Calls [func] with the index of each object whose box is hit by the ray
+// from [origin] along [dir], within [max_dist] (in multiples of [dir]).
+// Nearer nodes are visited first, and [func] can reduce [max_dist] (eg. once
+// an object is actually hit) so that anything further away is skipped
+// ----------------------------------------------------------------------------
+void AABBTree::intersectRay(fpoint3_t origin, fpoint3_t dir, const double& max_dist, const std::function<void(unsigned)>& func) const
+{
+	if (nodes_.empty())
+		return;
+
+	// Zero direction components give infinite inverses, which the slab test
+	// handles correctly
+	fpoint3_t inv_dir(1.0 / dir.x, 1.0 / dir.y, 1.0 / dir.z);
+
+	double entry_dist;
+	if (!rayHitsBox(nodes_[0].box, origin, inv_dir, max_dist, entry_dist))
+		return;
+
+	vector<std::pair<double, unsigned>> stack;
+	stack.push_back({ entry_dist, 0 });
+	while (!stack.empty())
+	{
+		auto entry = stack.back();
+		stack.pop_back();
+
+		// Something closer may have been hit since this node was added
+		if (entry.first > max_dist)
+			continue;
+
+		const node_t& node = nodes_[entry.second];
+		if (node.leaf)
+		{
+			for (unsigned a = node.left; a < node.left + node.right; a++)
+				if (rayHitsBox(boxes_[objects_[a]], origin, inv_dir, max_dist, entry_dist))
+					func(objects_[a]);
+			continue;
+		}
+
+		// Add children, nearest last so it is visited first
+		double near_l, near_r;
+		bool hit_l = rayHitsBox(nodes_[node.left].box, origin, inv_dir, max_dist, near_l);
+		bool hit_r = rayHitsBox(nodes_[node.right].box, origin, inv_dir, max_dist, near_r);
+		if (hit_l && hit_r)
+		{
+			if (near_l < near_r)
+			{
+				stack.push_back({ near_r, node.right });
+				stack.push_back({ near_l, node.left });
+			}
+			else
+			{
+				stack.push_back({ near_l, node.left });
+				stack.push_back({ near_r, node.right });
+			}
+		}
+		else if (hit_l)
+			stack.push_back({ near_l, node.left });
+		else if (hit_r)
+			stack.push_back({ near_r, node.right });
+	}
+}
+
+// ----------------------------------------------------------------------------
+// AABBTree::buildNode
+//
+// Builds a node for objects [first] to [last] (in objects_), splitting them
+// at the median of their centres along the longest axis. Returns the index
+// of the new node
+// ----------------------------------------------------------------------------
+unsigned AABBTree::buildNode(unsigned first, unsigned last, int parent, const vector<fpoint3_t>& centres)
+{
+	unsigned index = nodes_.size();
+	nodes_.emplace_back();
+	nodes_[index].parent = parent;
+
+	// Leaf
+	if (last - first <= max_leaf_objects)
+	{
+		nodes_[index].leaf = true;
+		nodes_[index].left = first;
+		nodes_[index].right = last - first;
+		for (unsigned a = first; a < last; a++)
+			leaves_[objects_[a]] = index;
+		updateNodeBox(index);
+		return index;
+	}
+
+	// Find longest axis of centres
+	box_t bounds;
+	for (unsigned a = first; a < last; a++)
+		bounds.extend(centres[objects_[a]].x, centres[objects_[a]].y, centres[objects_[a]].z);
+	double size_x = bounds.max.x - bounds.min.x;
+	double size_y = bounds.max.y - bounds.min.y;
+	double size_z = bounds.max.z - bounds.min.z;
+	int axis = 0;
+	if (size_y > size_x && size_y >= size_z)
+		axis = 1;
+	else if (size_z > size_x && size_z > size_y)
+		axis = 2;
+
+	// Split at median
+	unsigned mid = (first + last) / 2;
+	std::nth_element(
+		objects_.begin() + first,
+		objects_.begin() + mid,
+		objects_.begin() + last,
+		[&centres, axis](unsigned a, unsigned b)
+		{
+			if (axis == 0)
+				return centres[a].x < centres[b].x;
+			else if (axis == 1)
+				return centres[a].y < centres[b].y;
+			else
+				return centres[a].z < centres[b].z;
+		}
+	);
+
+	// Build children (nodes_ may be reallocated, so don't hold references)
+	nodes_[index].leaf = false;
+	unsigned left = buildNode(first, mid, index, centres);
+	unsigned right = buildNode(mid, last, index, centres);
+	nodes_[index].left = left;
+	nodes_[index].right = right;
+	updateNodeBox(index);
+
+	return index;
+}
+
+// ----------------------------------------------------------------------------
+// AABBTree::updateNodeBox
+//
+// Sets the box of [node] to contain its children (or objects, for a leaf)
+// ----------------------------------------------------------------------------
+void AABBTree::updateNodeBox(unsigned node)
+{
+	node_t& n = nodes_[node];
+	n.box = box_t();
+	if (n.leaf)
+	{
+		for (unsigned a = n.left; a < n.left + n.right; a++)
+			n.box.extend(boxes_[objects_[a]]);
+	}
+	else
+	{
+		n.box.extend(nodes_[n.left].box);
+		n.box.extend(nodes_[n.right].box);
+	}
+}
+
+// ----------------------------------------------------------------------------
+// AABBTree::rayHitsBox
+//
+// Returns true if the ray from [origin] (with inverse direction [inv_dir])
+// hits [box] within [max_dist]. [entry_dist] is set to the distance the ray
+// enters the box (or 0 if it starts inside it)
+// ----------------------------------------------------------------------------
+bool AABBTree::rayHitsBox(const box_t& box, fpoint3_t origin, fpoint3_t inv_dir, double max_dist, double& entry_dist) const
+{
+	if (box.isEmpty())
+		return false;
+
+	double t_min = 0;
+	double t_max = max_dist;
+	auto slab = [&](double o, double inv, double b_min, double b_max)
+	{
+		double t1 = (b_min - o) * inv;
+		double t2 = (b_max - o) * inv;
+
+		// Ray parallel to and within the slab gives NaN (0 * inf), which
+		// shouldn't clip anything
+		if (t1 != t1 || t2 != t2)
+			return;
+
+		if (t1 > t2)
+			std::swap(t1, t2);
+		t_min = MAX(t_min, t1);
+		t_max = MIN(t_max, t2);
+	};
+	slab(origin.x, inv_dir.x, box.min.x, box.max.x);
+	slab(origin.y, inv_dir.y, box.min.y, box.max.y);
+	slab(origin.z, inv_dir.z, box.min.z, box.max.z);
+
+	entry_dist = t_min;
+	return t_min <= t_max;
+}
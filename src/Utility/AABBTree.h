@@ -0,0 +1,61 @@
+#pragma once
+
+#include <functional>
+
+// A bounding volume hierarchy of axis-aligned 3d boxes, for quickly finding
+// the boxes hit by a ray. Each box is identified by its index, and can be
+// changed after the tree is built - the tree is refit (not rebuilt) from the
+// changed box up to the root, so it stays valid but may become less efficient
+// if boxes move a long way. Boxes with min > max are empty and never hit
+class AABBTree
+{
+public:
+	struct box_t
+	{
+		fpoint3_t	min;
+		fpoint3_t	max;
+
+		box_t() : min{ 1, 1, 1 }, max{ 0, 0, 0 } {}
+		box_t(fpoint3_t min, fpoint3_t max) : min{ min }, max{ max } {}
+
+		bool	isEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+		void	extend(const box_t& box);
+		void	extend(double x, double y, double z);
+	};
+
+	AABBTree() {}
+	~AABBTree() {}
+
+	void	clear();
+	void	build(const vector<box_t>& boxes);
+	void	refit(unsigned index, const box_t& box);
+	void	intersectRay(
+				fpoint3_t origin,
+				fpoint3_t dir,
+				const double& max_dist,
+				const std::function<void(unsigned)>& func
+			) const;
+
+	unsigned		nObjects() const { return boxes_.size(); }
+	unsigned		nNodes() const { return nodes_.size(); }
+	const box_t&	box(unsigned index) const { return boxes_[index]; }
+
+private:
+	struct node_t
+	{
+		box_t		box;
+		int			parent;
+		unsigned	left;	// Child nodes (or first index in objects_ for leaves)
+		unsigned	right;	// Child nodes (or object count for leaves)
+		bool		leaf;
+	};
+
+	vector<box_t>		boxes_;
+	vector<node_t>		nodes_;
+	vector<unsigned>	objects_;	// Object indices, in leaf order
+	vector<unsigned>	leaves_;	// Leaf node for each object
+
+	unsigned	buildNode(unsigned first, unsigned last, int parent, const vector<fpoint3_t>& centres);
+	void		updateNodeBox(unsigned node);
+	bool		rayHitsBox(const box_t& box, fpoint3_t origin, fpoint3_t inv_dir, double max_dist, double& entry_dist) const;
+};
@@ -1,6 +1,7 @@
 
 #include "Main.h"
 #include "Polygon2D.h"
+#include "PolygonTriangulator.h"
 #include "OpenGL/GLTexture.h"
 #include "MapEditor/SLADEMap/SLADEMap.h"
 #include "MathStuff.h"
@@ -9,6 +10,7 @@
 Polygon2D::Polygon2D()
 {
 	vbo_update = 2;
+	triangles = false;
 	colour[0] = 1.0f;
 	colour[1] = 1.0f;
 	colour[2] = 1.0f;
@@ -81,6 +83,7 @@ void Polygon2D::clear()
 		delete subpolys[a];
 	subpolys.clear();
 	vbo_update = 2;
+	triangles = false;
 	texture = nullptr;
 }
 
@@ -99,7 +102,7 @@ bool Polygon2D::openSector(MapSector* sector)
 		return false;
 
 	// Init
-	PolygonSplitter splitter;
+	PolygonTriangulator triangulator;
 	clear();
 
 	// Get list of sides connected to this sector
@@ -115,17 +118,61 @@ bool Polygon2D::openSector(MapSector* sector)
 		if (!line || line->doubleSector())
 			continue;
 
-		// Add the edge to the splitter (direction depends on what side of the line this is)
+		// Add the edge to the triangulator (direction depends on what side of the line this is)
 		if (line->s1() == sides[a])
-			splitter.addEdge(line->v1()->xPos(), line->v1()->yPos(), line->v2()->xPos(), line->v2()->yPos());
+			triangulator.addEdge(line->v1()->xPos(), line->v1()->yPos(), line->v2()->xPos(), line->v2()->yPos());
 		else
-			splitter.addEdge(line->v2()->xPos(), line->v2()->yPos(), line->v1()->xPos(), line->v1()->yPos());
+			triangulator.addEdge(line->v2()->xPos(), line->v2()->yPos(), line->v1()->xPos(), line->v1()->yPos());
 	}
 
+	// Triangulate the sector, falling back to the old polygon splitter if
+	// nothing usable came out
+	if (!triangulator.triangulate() || triangulator.nTriangles() == 0)
+		return openSectorSplitter(sector);
+
+	// Add all triangles as a single sub-poly
+	auto& vertices = triangulator.vertices();
+	auto& indices = triangulator.triangles();
+	vector<fpoint2_t> tri_vertices(indices.size());
+	for (unsigned a = 0; a < indices.size(); a++)
+		tri_vertices[a] = vertices[indices[a]];
+	setTriangles(tri_vertices);
+
+	return true;
+}
+
+bool Polygon2D::openSectorSplitter(MapSector* sector)
+{
+	// Check sector was given
+	if (!sector)
+		return false;
+
+	// Init
+	PolygonSplitter splitter;
+	clear();
+
 	// Split the polygon into convex sub-polygons
+	splitter.openSector(sector);
 	return splitter.doSplitting(this);
 }
 
+void Polygon2D::setTriangles(const vector<fpoint2_t>& vertices)
+{
+	clear();
+
+	// Add all triangles (3 vertices each) as a single sub-poly
+	addSubPoly();
+	gl_polygon_t* poly = subpolys.back();
+	poly->n_vertices = vertices.size();
+	poly->vertices = new gl_vertex_t[vertices.size()];
+	for (unsigned a = 0; a < vertices.size(); a++)
+	{
+		poly->vertices[a].x = vertices[a].x;
+		poly->vertices[a].y = vertices[a].y;
+	}
+	triangles = true;
+}
+
 void Polygon2D::updateTextureCoords(double scale_x, double scale_y, double offset_x, double offset_y, double rotation)
 {
 	// Can't do this if there is no texture
@@ -221,7 +268,7 @@ void Polygon2D::render()
 	for (unsigned a = 0; a < subpolys.size(); a++)
 	{
 		gl_polygon_t* poly = subpolys[a];
-		glBegin(GL_TRIANGLE_FAN);
+		glBegin(triangles ? GL_TRIANGLES : GL_TRIANGLE_FAN);
 		for (unsigned v = 0; v < poly->n_vertices; v++)
 		{
 			glTexCoord2f(poly->vertices[v].tx, poly->vertices[v].ty);
@@ -237,6 +284,23 @@ void Polygon2D::renderWireframe()
 	for (unsigned a = 0; a < subpolys.size(); a++)
 	{
 		gl_polygon_t* poly = subpolys[a];
+
+		// Outline each triangle
+		if (triangles)
+		{
+			for (unsigned v = 0; v + 2 < poly->n_vertices; v += 3)
+			{
+				glBegin(GL_LINE_LOOP);
+				for (unsigned t = v; t < v + 3; t++)
+				{
+					glTexCoord2f(poly->vertices[t].tx, poly->vertices[t].ty);
+					glVertex2d(poly->vertices[t].x, poly->vertices[t].y);
+				}
+				glEnd();
+			}
+			continue;
+		}
+
 		glBegin(GL_LINE_LOOP);
 		for (unsigned v = 0; v < poly->n_vertices; v++)
 		{
@@ -252,7 +316,7 @@ void Polygon2D::renderVBO(bool colour)
 	// Render
 	//glColor4f(this->colour[0], this->colour[1], this->colour[2], this->colour[3]);
 	for (unsigned a = 0; a < subpolys.size(); a++)
-		glDrawArrays(GL_TRIANGLE_FAN, subpolys[a]->vbo_index, subpolys[a]->n_vertices);
+		glDrawArrays(triangles ? GL_TRIANGLES : GL_TRIANGLE_FAN, subpolys[a]->vbo_index, subpolys[a]->n_vertices);
 }
 
 void Polygon2D::renderWireframeVBO(bool colour)
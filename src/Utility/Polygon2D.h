@@ -36,6 +36,7 @@ private:
 	vector<gl_polygon_t*>	subpolys;
 	GLTexture*				texture;
 	float					colour[4];
+	bool					triangles;	// Sub-polys are lists of separate triangles rather than fans
 
 	int		vbo_update;
 
@@ -52,6 +53,7 @@ public:
 	void		setTexture(GLTexture* tex) { this->texture = tex; }
 	void		setColour(float r, float g, float b, float a);
 	bool		hasPolygon() { return !subpolys.empty(); }
+	bool		isTriangles() { return triangles; }
 	int			vboUpdate() { return vbo_update; }
 	void		setZ(float z);
 	void		setZ(plane_t plane);
@@ -64,6 +66,8 @@ public:
 	unsigned		totalVertices();
 
 	bool	openSector(MapSector* sector);
+	bool	openSectorSplitter(MapSector* sector);
+	void	setTriangles(const vector<fpoint2_t>& vertices);
 	void	updateTextureCoords(double scale_x = 1, double scale_y = 1, double offset_x = 0, double offset_y = 0, double rotation = 0);
 
 	unsigned	vboDataSize();
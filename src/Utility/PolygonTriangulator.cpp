@@ -0,0 +1,720 @@
+// ----------------------------------------------------------------------------
+// SLADE - It's a Doom Editor
+// Copyright(C) 2008 - 2017 Simon Judd
+//
+// Email:       sirjuddington@gmail.com
+// Web:         http://slade.mancubus.net
+// Filename:    PolygonTriangulator.cpp
+// Description: PolygonTriangulator class - triangulates polygons with holes
+//              from a set of directed edges using a monotone sweep
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301, USA.
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+//
+// Includes
+//
+// ----------------------------------------------------------------------------
+#include "Main.h"
+#include "PolygonTriangulator.h"
+
+
+// ----------------------------------------------------------------------------
+//
+// Functions
+//
+// ----------------------------------------------------------------------------
+namespace
+{
+	// Sweep order - by y, then x
+	bool sweepLess(const fpoint2_t& a, const fpoint2_t& b)
+	{
+		return a.y < b.y || (a.y == b.y && a.x < b.x);
+	}
+
+	// Returns the cross product of (b - a) and (c - a). Positive if [c] is to
+	// the left of the line from [a] to [b]
+	double cross(const fpoint2_t& a, const fpoint2_t& b, const fpoint2_t& c)
+	{
+		return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	}
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// PolygonTriangulator Class Functions
+//
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+// PolygonTriangulator::clear
+//
+// Clears all input edges and output triangles
+// ----------------------------------------------------------------------------
+void PolygonTriangulator::clear()
+{
+	input_.clear();
+	vertices_.clear();
+	triangles_.clear();
+	edges_.clear();
+	pieces_.clear();
+}
+
+// ----------------------------------------------------------------------------
+// PolygonTriangulator::addEdge
+//
+// Adds an edge from [x1,y1] to [x2,y2]. The area to the right of the edge is
+// considered 'inside'
+// ----------------------------------------------------------------------------
+void PolygonTriangulator::addEdge(double x1, double y1, double x2, double y2)
+{
+	input_.push_back({ fpoint2_t(x1, y1), fpoint2_t(x2, y2) });
+}
+
+// ----------------------------------------------------------------------------
+// PolygonTriangulator::triangulate
+//
+// Triangulates the area enclosed by the input edges. Returns false if there
+// was nothing to triangulate
+// ----------------------------------------------------------------------------
+bool PolygonTriangulator::triangulate()
+{
+	triangles_.clear();
+	pieces_.clear();
+	buildEdges();
+	if (edges_.empty())
+		return false;
+
+	// Get edges starting/ending at each vertex
+	unsigned n_verts = vertices_.size();
+	vector<unsigned> start_index(n_verts + 1, 0), end_index(n_verts + 1, 0);
+	for (auto& edge : edges_)
+	{
+		start_index[edge.lo + 1]++;
+		end_index[edge.hi + 1]++;
+	}
+	for (unsigned a = 0; a < n_verts; a++)
+	{
+		start_index[a + 1] += start_index[a];
+		end_index[a + 1] += end_index[a];
+	}
+	vector<int> starts(edges_.size()), ends(edges_.size());
+	vector<unsigned> start_fill(start_index.begin(), start_index.end() - 1);
+	vector<unsigned> end_fill(end_index.begin(), end_index.end() - 1);
+	for (unsigned a = 0; a < edges_.size(); a++)
+	{
+		starts[start_fill[edges_[a].lo]++] = a;
+		ends[end_fill[edges_[a].hi]++] = a;
+	}
+
+	// Sweep
+	ActiveEdges active(EdgeCompare{ this });
+	active_pos_.assign(edges_.size(), active.end());
+	vector<int> ending, starting;
+	for (unsigned v = 0; v < n_verts; v++)
+	{
+		ending.assign(ends.begin() + end_index[v], ends.begin() + end_index[v + 1]);
+		starting.assign(starts.begin() + start_index[v], starts.begin() + start_index[v + 1]);
+		if (ending.empty() && starting.empty())
+			continue;
+
+		sweep_vertex_ = v;
+		processVertex(v, active, ending, starting);
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+// PolygonTriangulator::buildEdges
+//
+// Builds the (sweep-ordered) vertex list and cleaned-up edge list from the
+// input edges
+// ----------------------------------------------------------------------------
+void PolygonTriangulator::buildEdges()
+{
+	edges_.clear();
+
+	// Get unique vertices, in sweep order
+	vertices_.clear();
+	vertices_.reserve(input_.size() * 2);
+	for (auto& edge : input_)
+	{
+		vertices_.push_back(edge.p1);
+		vertices_.push_back(edge.p2);
+	}
+	std::sort(vertices_.begin(), vertices_.end(), sweepLess);
+	vertices_.erase(
+		std::unique(
+			vertices_.begin(),
+			vertices_.end(),
+			[](const fpoint2_t& a, const fpoint2_t& b) { return a.x == b.x && a.y == b.y; }),
+		vertices_.end());
+
+	auto vertexIndex = [this](const fpoint2_t& p)
+	{
+		return (unsigned)(std::lower_bound(vertices_.begin(), vertices_.end(), p, sweepLess) - vertices_.begin());
+	};
+
+	// Add edges (ignoring zero-length ones)
+	vector<edge_t> raw;
+	raw.reserve(input_.size());
+	for (auto& edge : input_)
+	{
+		unsigned v1 = vertexIndex(edge.p1);
+		unsigned v2 = vertexIndex(edge.p2);
+		if (v1 == v2)
+			continue;
+
+		edge_t e;
+		e.lo = MIN(v1, v2);
+		e.hi = MAX(v1, v2);
+		e.winding = v1 < v2 ? 1 : -1;
+		e.winding_right = 0;
+		raw.push_back(e);
+	}
+
+	// Combine duplicate edges (opposite edges cancel each other out)
+	std::sort(raw.begin(), raw.end(), [](const edge_t& a, const edge_t& b)
+	{
+		return a.lo < b.lo || (a.lo == b.lo && a.hi < b.hi);
+	});
+	vector<edge_t> combined;
+	for (auto& edge : raw)
+	{
+		if (!combined.empty() && combined.back().lo == edge.lo && combined.back().hi == edge.hi)
+			combined.back().winding += edge.winding;
+		else
+			combined.push_back(edge);
+	}
+
+	// Remove dangling edges (unclosed lines can't enclose anything)
+	vector<unsigned> degree(vertices_.size(), 0);
+	vector<vector<unsigned>> vertex_edges(vertices_.size());
+	vector<bool> removed(combined.size(), false);
+	for (unsigned a = 0; a < combined.size(); a++)
+	{
+		if (combined[a].winding == 0)
+		{
+			removed[a] = true;
+			continue;
+		}
+
+		degree[combined[a].lo]++;
+		degree[combined[a].hi]++;
+		vertex_edges[combined[a].lo].push_back(a);
+		vertex_edges[combined[a].hi].push_back(a);
+	}
+	vector<unsigned> dangling;
+	for (unsigned a = 0; a < degree.size(); a++)
+		if (degree[a] == 1)
+			dangling.push_back(a);
+	while (!dangling.empty())
+	{
+		unsigned vertex = dangling.back();
+		dangling.pop_back();
+		for (unsigned e : vertex_edges[vertex])
+		{
+			if (removed[e])
+				continue;
+
+			removed[e] = true;
+			unsigned other = combined[e].lo == vertex ? combined[e].hi : combined[e].lo;
+			degree[vertex]--;
+			if (--degree[other] == 1)
+				dangling.push_back(other);
+		}
+	}
+
+	for (unsigned a = 0; a < combined.size(); a++)
+		if (!removed[a])
+			edges_.push_back(combined[a]);
+}
+
+// ----------------------------------------------------------------------------
+// PolygonTriangulator::edgeXAt
+//
+// Returns the x position of [edge] where it crosses the sweep line. An edge
+// index of -1 refers to the current sweep vertex itself
+// ----------------------------------------------------------------------------
+double PolygonTriangulator::edgeXAt(int edge) const
+{
+	const fpoint2_t& sweep = vertices_[sweep_vertex_];
+	if (edge < 0)
+		return sweep.x;
+
+	const edge_t& e = edges_[edge];
+	if (e.lo == sweep_vertex_ || e.hi == sweep_vertex_)
+		return sweep.x;
+
+	const fpoint2_t& lo = vertices_[e.lo];
+	const fpoint2_t& hi = vertices_[e.hi];
+
+	// Horizontal edges are treated as if the sweep line is very slightly
+	// tilted (matching the sweep order), so they cross it at the sweep vertex
+	if (lo.y == hi.y)
+		return MAX(lo.x, MIN(hi.x, sweep.x));
+
+	return lo.x + (sweep.y - lo.y) * (hi.x - lo.x) / (hi.y - lo.y);
+}
+
+// ----------------------------------------------------------------------------
+// PolygonTriangulator::edgeLeftOf
+//
+// Returns true if edge [left] is to the left of edge [right] at the current
+// sweep position
+// ----------------------------------------------------------------------------
+bool PolygonTriangulator::edgeLeftOf(int left, int right) const
+{
+	if (left == right)
+		return false;
+
+	double xl = edgeXAt(left);
+	double xr = edgeXAt(right);
+	if (xl != xr)
+		return xl < xr;
+
+	// Edges starting at the sweep vertex (or the vertex itself, -1) go to the
+	// right of any other edges crossing the same point
+	bool sl = left < 0 || edges_[left].lo == sweep_vertex_;
+	bool sr = right < 0 || edges_[right].lo == sweep_vertex_;
+	if (sl != sr)
+		return sr;
+	if (right < 0)
+		return true;
+	if (left < 0)
+		return false;
+
+	// Otherwise, the edge pointing furthest left (above the sweep line) is
+	// first
+	const edge_t& el = edges_[left];
+	const edge_t& er = edges_[right];
+	double dlx = vertices_[el.hi].x - vertices_[el.lo].x;
+	double dly = vertices_[el.hi].y - vertices_[el.lo].y;
+	double drx = vertices_[er.hi].x - vertices_[er.lo].x;
+	double dry = vertices_[er.hi].y - vertices_[er.lo].y;
+	double c = drx * dly - dry * dlx;
+	if (c != 0)
+		return c > 0;
+
+	return left < right;
+}
+
+// ----------------------------------------------------------------------------
+// PolygonTriangulator::processVertex
+//
+// Processes sweep event [vertex], where the [ending] edges end and the
+// [starting] edges begin. Updates the monotone pieces either side of the
+// vertex, splitting and merging them as needed
+// ----------------------------------------------------------------------------
+void PolygonTriangulator::processVertex(
+	unsigned vertex,
+	ActiveEdges& active,
+	const vector<int>& ending,
+	const vector<int>& starting)
+{
+	vector<int> left_pieces;	// Pieces continuing left of the vertex
+	vector<int> right_pieces;	// Pieces continuing right of the vertex
+	int left_edge = -1;
+
+	if (!ending.empty())
+	{
+		// Get the run of ending edges in the active list
+		auto first = active_pos_[ending[0]];
+		while (first != active.begin() && edges_[*std::prev(first)].hi == vertex)
+			--first;
+		vector<int> run;
+		for (auto i = first; i != active.end() && edges_[*i].hi == vertex; ++i)
+			run.push_back(*i);
+		if (first != active.begin())
+			left_edge = *std::prev(first);
+
+		// Area to the left of the ending edges - the vertex is on its right
+		if (left_edge >= 0 && !edges_[left_edge].pieces.empty())
+		{
+			auto& pieces = edges_[left_edge].pieces;
+			addToPiece(pieces[0], vertex, Chain::Right);
+			for (unsigned a = 1; a < pieces.size(); a++)
+				finishPiece(pieces[a], vertex);
+			left_pieces.push_back(pieces[0]);
+			pieces.clear();
+		}
+
+		// Areas between the ending edges close at the vertex
+		for (unsigned a = 0; a + 1 < run.size(); a++)
+			for (int piece : edges_[run[a]].pieces)
+				finishPiece(piece, vertex);
+
+		// Area to the right of the ending edges - the vertex is on its left
+		auto& pieces = edges_[run.back()].pieces;
+		if (!pieces.empty())
+		{
+			addToPiece(pieces.back(), vertex, Chain::Left);
+			for (unsigned a = 0; a + 1 < pieces.size(); a++)
+				finishPiece(pieces[a], vertex);
+			right_pieces.push_back(pieces.back());
+		}
+
+		// Remove ending edges
+		for (int edge : ending)
+		{
+			// (Can only happen with crossing edges)
+			if (std::find(run.begin(), run.end(), edge) == run.end())
+				for (int piece : edges_[edge].pieces)
+					finishPiece(piece, vertex);
+
+			edges_[edge].pieces.clear();
+			active.erase(active_pos_[edge]);
+			active_pos_[edge] = active.end();
+		}
+	}
+	else
+	{
+		// Find the area containing the vertex
+		auto right = active.lower_bound(-1);
+		if (right != active.begin())
+			left_edge = *std::prev(right);
+
+		if (left_edge >= 0 && !edges_[left_edge].pieces.empty() && !starting.empty())
+		{
+			auto& pieces = edges_[left_edge].pieces;
+			if (pieces.size() == 1)
+			{
+				// Split vertex, connect it to the last vertex added to the area
+				int piece = pieces[0];
+				unsigned helper = pieces_[piece].stack.back();
+				bool helper_left = pieces_[piece].chains.back() == Chain::Left;
+				int split = newPiece(helper);
+				if (helper_left)
+				{
+					addToPiece(piece, vertex, Chain::Left);
+					addToPiece(split, vertex, Chain::Right);
+					left_pieces.push_back(split);
+					right_pieces.push_back(piece);
+				}
+				else
+				{
+					addToPiece(piece, vertex, Chain::Right);
+					addToPiece(split, vertex, Chain::Left);
+					left_pieces.push_back(piece);
+					right_pieces.push_back(split);
+				}
+			}
+			else
+			{
+				// Area was split by earlier merge vertices, which all connect
+				// to this vertex
+				addToPiece(pieces.front(), vertex, Chain::Right);
+				addToPiece(pieces.back(), vertex, Chain::Left);
+				for (unsigned a = 1; a + 1 < pieces.size(); a++)
+					finishPiece(pieces[a], vertex);
+				left_pieces.push_back(pieces.front());
+				right_pieces.push_back(pieces.back());
+			}
+			pieces.clear();
+		}
+	}
+
+	// Add starting edges, left to right
+	if (!starting.empty())
+	{
+		vector<int> sorted = starting;
+		std::sort(sorted.begin(), sorted.end(), EdgeCompare{ this });
+		int winding = left_edge >= 0 ? edges_[left_edge].winding_right : 0;
+		for (int edge : sorted)
+		{
+			active_pos_[edge] = active.insert(edge).first;
+			winding += edges_[edge].winding;
+			edges_[edge].winding_right = winding;
+		}
+
+		auto& last_pieces = edges_[sorted.back()].pieces;
+		last_pieces.insert(last_pieces.end(), right_pieces.begin(), right_pieces.end());
+		right_pieces.clear();
+
+		for (int edge : sorted)
+		{
+			auto& pieces = edges_[edge].pieces;
+			bool inside = edges_[edge].winding_right > 0;
+			if (inside && pieces.empty())
+				pieces.push_back(newPiece(vertex));
+			else if (!inside && !pieces.empty())
+			{
+				for (int piece : pieces)
+					finishPiece(piece, vertex);
+				pieces.clear();
+			}
+		}
+	}
+
+	// Pieces to the left (and right, for a merge vertex) continue in the area
+	// right of the left edge
+	left_pieces.insert(left_pieces.end(), right_pieces.begin(), right_pieces.end());
+	if (left_edge < 0 || edges_[left_edge].winding_right <= 0)
+	{
+		for (int piece : left_pieces)
+			finishPiece(piece, vertex);
+	}
+	else
+	{
+		auto& pieces = edges_[left_edge].pieces;
+		pieces.insert(pieces.end(), left_pieces.begin(), left_pieces.end());
+		if (pieces.empty())
+			pieces.push_back(newPiece(vertex));
+	}
+}
+
+// ----------------------------------------------------------------------------
+// PolygonTriangulator::newPiece
+//
+// Starts a new monotone piece with [vertex] at the bottom, and returns its
+// index
+// ----------------------------------------------------------------------------
+int PolygonTriangulator::newPiece(unsigned vertex)
+{
+	pieces_.emplace_back();
+	pieces_.back().stack.push_back(vertex);
+	pieces_.back().chains.push_back(Chain::Bottom);
+	return pieces_.size() - 1;
+}
+
+// ----------------------------------------------------------------------------
+// PolygonTriangulator::addToPiece
+//
+// Adds [vertex] to [chain] of monotone [piece], adding any triangles that can
+// be completed
+// ----------------------------------------------------------------------------
+void PolygonTriangulator::addToPiece(int index, unsigned vertex, Chain chain)
+{
+	auto& stack = pieces_[index].stack;
+	auto& chains = pieces_[index].chains;
+	if (stack.size() < 2)
+	{
+		stack.push_back(vertex);
+		chains.push_back(chain);
+		return;
+	}
+
+	if (chains.back() != chain)
+	{
+		// Opposite chain, can connect to all vertices on the stack
+		for (unsigned a = 0; a + 1 < stack.size(); a++)
+			addTriangle(stack[a], stack[a + 1], vertex);
+
+		unsigned top = stack.back();
+		Chain top_chain = chains.back();
+		stack.assign({ top, vertex });
+		chains.assign({ top_chain, chain });
+	}
+	else
+	{
+		// Same chain, connect to stack vertices while the connection is
+		// inside the piece
+		const fpoint2_t& v = vertices_[vertex];
+		unsigned last = stack.back();
+		Chain last_chain = chains.back();
+		stack.pop_back();
+		chains.pop_back();
+		while (!stack.empty())
+		{
+			double c = cross(vertices_[stack.back()], v, vertices_[last]);
+			if (chain == Chain::Left ? c <= 0 : c >= 0)
+				break;
+
+			addTriangle(stack.back(), last, vertex);
+			last = stack.back();
+			last_chain = chains.back();
+			stack.pop_back();
+			chains.pop_back();
+		}
+
+		stack.push_back(last);
+		chains.push_back(last_chain);
+		stack.push_back(vertex);
+		chains.push_back(chain);
+	}
+}
+
+// ----------------------------------------------------------------------------
+// PolygonTriangulator::finishPiece
+//
+// Closes monotone [piece] with [vertex] at the top
+// ----------------------------------------------------------------------------
+void PolygonTriangulator::finishPiece(int index, unsigned vertex)
+{
+	auto& stack = pieces_[index].stack;
+	for (unsigned a = 0; a + 1 < stack.size(); a++)
+		addTriangle(stack[a], stack[a + 1], vertex);
+
+	stack.clear();
+	pieces_[index].chains.clear();
+}
+
+// ----------------------------------------------------------------------------
+// PolygonTriangulator::addTriangle
+//
+// Adds a triangle between [v1], [v2] and [v3] to the output (ordered
+// anticlockwise). Degenerate triangles are ignored
+// ----------------------------------------------------------------------------
+void PolygonTriangulator::addTriangle(unsigned v1, unsigned v2, unsigned v3)
+{
+	double c = cross(vertices_[v1], vertices_[v2], vertices_[v3]);
+	if (c == 0)
+		return;
+
+	triangles_.push_back(v1);
+	triangles_.push_back(c > 0 ? v2 : v3);
+	triangles_.push_back(c > 0 ? v3 : v2);
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// Testing
+//
+// ----------------------------------------------------------------------------
+#include "General/Console/Console.h"
+#include "MathStuff.h"
+#include <random>
+
+namespace
+{
+	// Checks the triangulation in [t] covers [area] exactly with
+	// anticlockwise triangles. If [grid] is given, also checks each triangle
+	// is within a filled cell of it
+	bool checkTriangulation(const PolygonTriangulator& t, double area, const vector<bool>* grid = nullptr, int grid_width = 0, int cell_size = 1)
+	{
+		auto& vertices = t.vertices();
+		auto& triangles = t.triangles();
+		double total = 0;
+		for (unsigned a = 0; a < triangles.size(); a += 3)
+		{
+			const fpoint2_t& p1 = vertices[triangles[a]];
+			const fpoint2_t& p2 = vertices[triangles[a + 1]];
+			const fpoint2_t& p3 = vertices[triangles[a + 2]];
+			double tri_area = cross(p1, p2, p3) * 0.5;
+			if (tri_area <= 0)
+				return false;
+			total += tri_area;
+
+			if (grid)
+			{
+				int cx = (int)floor((p1.x + p2.x + p3.x) / 3 / cell_size);
+				int cy = (int)floor((p1.y + p2.y + p3.y) / 3 / cell_size);
+				unsigned cell = cy * grid_width + cx;
+				if (cx < 0 || cy < 0 || cx >= grid_width || cell >= grid->size() || !(*grid)[cell])
+					return false;
+			}
+		}
+
+		return fabs(total - area) <= 1e-6 * MAX(1.0, area);
+	}
+}
+
+CONSOLE_COMMAND(test_triangulator, 0, false)
+{
+	long count = 1000;
+	long seed = 1;
+	if (args.size() > 0)
+		args[0].ToLong(&count);
+	if (args.size() > 1)
+		args[1].ToLong(&seed);
+
+	std::mt19937 rng(seed);
+	int failed_grid = 0;
+	int failed_star = 0;
+	for (long test = 0; test < count; test++)
+	{
+		// Random set of grid cells - shared edges cancel out, so this gives
+		// polygons with holes, touching corners and lots of collinear edges
+		PolygonTriangulator t;
+		int width = 1 + rng() % 10;
+		int height = 1 + rng() % 10;
+		vector<bool> grid(width * height);
+		int cells = 0;
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				if (rng() % 3 == 0)
+					continue;
+
+				grid[y * width + x] = true;
+				cells++;
+				double x1 = x * 64;
+				double y1 = y * 64;
+				double x2 = x1 + 64;
+				double y2 = y1 + 64;
+				t.addEdge(x1, y1, x1, y2);
+				t.addEdge(x1, y2, x2, y2);
+				t.addEdge(x2, y2, x2, y1);
+				t.addEdge(x2, y1, x1, y1);
+			}
+		}
+		t.triangulate();
+		if (!checkTriangulation(t, cells * 64 * 64, &grid, width, 64))
+			failed_grid++;
+
+		// Random star-shaped polygon (clockwise) with square holes
+		// (anticlockwise), on integer coordinates
+		t.clear();
+		vector<int> angles = { 0, 45, 90, 135, 180, 225, 270, 315 };
+		for (int a = rng() % 40; a > 0; a--)
+			angles.push_back(rng() % 360);
+		std::sort(angles.begin(), angles.end(), std::greater<int>());
+		angles.erase(std::unique(angles.begin(), angles.end()), angles.end());
+		vector<fpoint2_t> outline;
+		for (int angle : angles)
+		{
+			double radius = rng() % 4 == 0 ? 100 : 100 + rng() % 100;
+			double rad = angle * PI / 180.0;
+			outline.push_back(fpoint2_t(std::round(cos(rad) * radius), std::round(sin(rad) * radius)));
+		}
+		double area = 0;
+		for (unsigned a = 0; a < outline.size(); a++)
+		{
+			const fpoint2_t& p1 = outline[a];
+			const fpoint2_t& p2 = outline[(a + 1) % outline.size()];
+			t.addEdge(p1.x, p1.y, p2.x, p2.y);
+			area -= (p1.x * p2.y - p2.x * p1.y) * 0.5;
+		}
+		for (int a = rng() % 5; a > 0; a--)
+		{
+			double x1 = -60 + (a % 3) * 40;
+			double y1 = -40 + (a / 3) * 40 + (int)(rng() % 5);
+			double size = 5 + rng() % 25;
+			t.addEdge(x1, y1, x1 + size, y1);
+			t.addEdge(x1 + size, y1, x1 + size, y1 + size);
+			t.addEdge(x1 + size, y1 + size, x1, y1 + size);
+			t.addEdge(x1, y1 + size, x1, y1);
+			area -= size * size;
+		}
+		t.triangulate();
+		if (!checkTriangulation(t, area))
+			failed_star++;
+	}
+
+	Log::console(S_FMT(
+		"Triangulated %ld random grid polygons (%d failed) and %ld star polygons (%d failed)",
+		count,
+		failed_grid,
+		count,
+		failed_star
+	));
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <set>
+
+// Triangulates polygons (with any number of holes) given as a set of directed
+// edges, with the filled area to the right of each edge (ie. the same as the
+// front side of a map line). Edges don't need to be in any particular order.
+//
+// A sweep line is run over the vertices (sorted by y), splitting the filled
+// area into y-monotone pieces which are triangulated as the sweep goes, so
+// the whole process is O(n log n). Duplicate/zero-length edges and dangling
+// (unclosed) edge chains are removed first, and the filled area is
+// determined by winding number rather than traced outlines, so badly formed
+// input still gives a usable result
+class PolygonTriangulator
+{
+public:
+	PolygonTriangulator() {}
+	~PolygonTriangulator() {}
+
+	void	clear();
+	void	addEdge(double x1, double y1, double x2, double y2);
+	bool	triangulate();
+
+	unsigned	nEdges() const { return input_.size(); }
+
+	// Output - [triangles] has 3 indices into [vertices] per triangle, all
+	// ordered anticlockwise
+	const vector<fpoint2_t>&	vertices() const { return vertices_; }
+	const vector<unsigned>&		triangles() const { return triangles_; }
+	unsigned					nTriangles() const { return triangles_.size() / 3; }
+
+private:
+	struct input_edge_t
+	{
+		fpoint2_t	p1;
+		fpoint2_t	p2;
+	};
+
+	// An edge between vertices [lo] and [hi] (lo is first in sweep order)
+	struct edge_t
+	{
+		unsigned	lo;
+		unsigned	hi;
+		int			winding;		// +1 if the original edge went from lo to hi, -1 otherwise
+		int			winding_right;	// Winding number of the area to the right of the edge
+		vector<int>	pieces;			// Monotone pieces in the area to the right of the edge
+	};
+
+	// Orders active edges left-to-right along the sweep line
+	struct EdgeCompare
+	{
+		const PolygonTriangulator* triangulator;
+		bool operator()(int left, int right) const { return triangulator->edgeLeftOf(left, right); }
+	};
+	typedef std::set<int, EdgeCompare> ActiveEdges;
+
+	// A y-monotone piece of the filled area being triangulated
+	enum class Chain : uint8_t { Bottom, Left, Right };
+	struct piece_t
+	{
+		vector<unsigned>	stack;
+		vector<Chain>		chains;
+	};
+
+	vector<input_edge_t>			input_;
+	vector<fpoint2_t>				vertices_;
+	vector<unsigned>				triangles_;
+	vector<edge_t>					edges_;
+	vector<piece_t>					pieces_;
+	vector<ActiveEdges::iterator>	active_pos_;
+
+	// Current sweep position
+	unsigned	sweep_vertex_	= 0;
+
+	void	buildEdges();
+	double	edgeXAt(int edge) const;
+	bool	edgeLeftOf(int left, int right) const;
+	void	processVertex(unsigned vertex, ActiveEdges& active, const vector<int>& ending, const vector<int>& starting);
+
+	int		newPiece(unsigned vertex);
+	void	addToPiece(int piece, unsigned vertex, Chain chain);
+	void	finishPiece(int piece, unsigned vertex);
+	void	addTriangle(unsigned v1, unsigned v2, unsigned v3);
+};
@@ -0,0 +1,253 @@
+// ----------------------------------------------------------------------------
+// SLADE - It's a Doom Editor
+// Copyright(C) 2008 - 2017 Simon Judd
+//
+// Email:       sirjuddington@gmail.com
+// Web:         http://slade.mancubus.net
+// Filename:    SpatialGrid.cpp
+// Description: SpatialGrid class - a uniform grid of bounding boxes for
+//              finding the boxes that overlap a region
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301, USA.
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+//
+// Includes
+//
+// ----------------------------------------------------------------------------
+#include "Main.h"
+#include "SpatialGrid.h"
+
+
+// ----------------------------------------------------------------------------
+//
+// Variables
+//
+// ----------------------------------------------------------------------------
+namespace
+{
+	// Cell size limits (in map units)
+	const double	min_cell_size			= 32;
+	const double	max_cell_size			= 4096;
+
+	// Boxes overlapping more cells than this go in the 'large' list instead
+	const unsigned	max_cells_per_object	= 64;
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// Local Functions
+//
+// ----------------------------------------------------------------------------
+namespace
+{
+	// Returns true if [a] and [b] overlap (or touch)
+	bool overlaps(const bbox_t& a, const bbox_t& b)
+	{
+		return a.max.x >= b.min.x && a.min.x <= b.max.x && a.max.y >= b.min.y && a.min.y <= b.max.y;
+	}
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// SpatialGrid Class Functions
+//
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+// SpatialGrid::clear
+//
+// Clears all boxes and cells
+// ----------------------------------------------------------------------------
+void SpatialGrid::clear()
+{
+	boxes_.clear();
+	origin_x_ = 0;
+	origin_y_ = 0;
+	cell_size_ = 0;
+	columns_ = 0;
+	rows_ = 0;
+	cell_start_.clear();
+	cell_objects_.clear();
+	large_.clear();
+}
+
+// ----------------------------------------------------------------------------
+// SpatialGrid::build
+//
+// Builds the grid from [boxes]. Objects are identified by their index in
+// [boxes]
+// ----------------------------------------------------------------------------
+void SpatialGrid::build(const vector<bbox_t>& boxes)
+{
+	clear();
+	if (boxes.empty())
+		return;
+
+	// Get overall bounds
+	boxes_ = boxes;
+	bbox_t bounds = boxes_[0];
+	for (auto& box : boxes_)
+	{
+		if (box.min.x > box.max.x)
+			std::swap(box.min.x, box.max.x);
+		if (box.min.y > box.max.y)
+			std::swap(box.min.y, box.max.y);
+
+		bounds.min.x = MIN(bounds.min.x, box.min.x);
+		bounds.min.y = MIN(bounds.min.y, box.min.y);
+		bounds.max.x = MAX(bounds.max.x, box.max.x);
+		bounds.max.y = MAX(bounds.max.y, box.max.y);
+	}
+
+	// Pick a cell size giving a few objects per cell, and make sure long thin
+	// maps don't end up with a huge number of mostly empty cells
+	double width = bounds.max.x - bounds.min.x;
+	double height = bounds.max.y - bounds.min.y;
+	cell_size_ = sqrt(width * height / boxes_.size()) * 2;
+	cell_size_ = MAX(min_cell_size, MIN(max_cell_size, cell_size_));
+	double max_cells = boxes_.size() * 4.0 + 64;
+	while ((floor(width / cell_size_) + 1) * (floor(height / cell_size_) + 1) > max_cells)
+		cell_size_ *= 2;
+
+	origin_x_ = bounds.min.x;
+	origin_y_ = bounds.min.y;
+	columns_ = (unsigned)(width / cell_size_) + 1;
+	rows_ = (unsigned)(height / cell_size_) + 1;
+
+	// Count objects in each cell (count first, then fill, so each cell's list
+	// is in object order)
+	unsigned n_cells = columns_ * rows_;
+	cell_start_.assign(n_cells + 1, 0);
+	vector<uint8_t> is_large(boxes_.size(), 0);
+	for (unsigned a = 0; a < boxes_.size(); a++)
+	{
+		const bbox_t& box = boxes_[a];
+		int c1 = column(box.min.x);
+		int c2 = column(box.max.x);
+		int r1 = row(box.min.y);
+		int r2 = row(box.max.y);
+		if ((unsigned)((c2 - c1 + 1) * (r2 - r1 + 1)) > max_cells_per_object)
+		{
+			is_large[a] = 1;
+			large_.push_back(a);
+			continue;
+		}
+
+		for (int r = r1; r <= r2; r++)
+			for (int c = c1; c <= c2; c++)
+				cell_start_[r * columns_ + c + 1]++;
+	}
+	for (unsigned a = 0; a < n_cells; a++)
+		cell_start_[a + 1] += cell_start_[a];
+
+	// Fill cells
+	cell_objects_.resize(cell_start_[n_cells]);
+	vector<unsigned> cell_pos(cell_start_.begin(), cell_start_.end() - 1);
+	for (unsigned a = 0; a < boxes_.size(); a++)
+	{
+		if (is_large[a])
+			continue;
+
+		const bbox_t& box = boxes_[a];
+		int c1 = column(box.min.x);
+		int c2 = column(box.max.x);
+		int r1 = row(box.min.y);
+		int r2 = row(box.max.y);
+		for (int r = r1; r <= r2; r++)
+			for (int c = c1; c <= c2; c++)
+				cell_objects_[cell_pos[r * columns_ + c]++] = a;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// SpatialGrid::query
+//
+// Sets [out] to the (ascending) indices of all objects whose boxes overlap
+// [region]. Returns the number of objects checked to get there
+// ----------------------------------------------------------------------------
+unsigned SpatialGrid::query(const bbox_t& region, vector<unsigned>& out) const
+{
+	out.clear();
+	if (boxes_.empty())
+		return 0;
+
+	// Check large objects
+	unsigned visited = large_.size();
+	for (unsigned index : large_)
+		if (overlaps(boxes_[index], region))
+			out.push_back(index);
+
+	// Check cells overlapping the region
+	double grid_max_x = origin_x_ + columns_ * cell_size_;
+	double grid_max_y = origin_y_ + rows_ * cell_size_;
+	if (region.max.x >= origin_x_ && region.min.x <= grid_max_x &&
+		region.max.y >= origin_y_ && region.min.y <= grid_max_y)
+	{
+		int c1 = column(region.min.x);
+		int c2 = column(region.max.x);
+		int r1 = row(region.min.y);
+		int r2 = row(region.max.y);
+		for (int r = r1; r <= r2; r++)
+		{
+			for (int c = c1; c <= c2; c++)
+			{
+				unsigned cell = r * columns_ + c;
+				visited += cell_start_[cell + 1] - cell_start_[cell];
+				for (unsigned a = cell_start_[cell]; a < cell_start_[cell + 1]; a++)
+				{
+					const bbox_t& box = boxes_[cell_objects_[a]];
+					if (!overlaps(box, region))
+						continue;
+
+					// An object in more than one cell is only added from the
+					// first of its cells within the region
+					if (c == MAX(column(box.min.x), c1) && r == MAX(row(box.min.y), r1))
+						out.push_back(cell_objects_[a]);
+				}
+			}
+		}
+	}
+
+	std::sort(out.begin(), out.end());
+	return visited;
+}
+
+// ----------------------------------------------------------------------------
+// SpatialGrid::column
+//
+// Returns the grid column containing [x] (clamped to the grid)
+// ----------------------------------------------------------------------------
+int SpatialGrid::column(double x) const
+{
+	int c = (int)floor((x - origin_x_) / cell_size_);
+	return MAX(0, MIN((int)columns_ - 1, c));
+}
+
+// ----------------------------------------------------------------------------
+// SpatialGrid::row
+//
+// Returns the grid row containing [y] (clamped to the grid)
+// ----------------------------------------------------------------------------
+int SpatialGrid::row(double y) const
+{
+	int r = (int)floor((y - origin_y_) / cell_size_);
+	return MAX(0, MIN((int)rows_ - 1, r));
+}
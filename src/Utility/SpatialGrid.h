@@ -0,0 +1,35 @@
+#pragma once
+
+// A uniform grid over a set of bounding boxes, for quickly finding the boxes
+// that overlap a region. Each box is listed in every cell it overlaps, except
+// for boxes covering a large part of the grid, which are kept in a separate
+// list and always checked. The grid is built in one go and isn't updated
+// incrementally - it's quick enough to rebuild whenever the boxes change
+class SpatialGrid
+{
+public:
+	SpatialGrid() {}
+	~SpatialGrid() {}
+
+	void		clear();
+	void		build(const vector<bbox_t>& boxes);
+	unsigned	query(const bbox_t& region, vector<unsigned>& out) const;
+
+	unsigned	nObjects() const { return boxes_.size(); }
+	unsigned	nCells() const { return columns_ * rows_; }
+	double		cellSize() const { return cell_size_; }
+
+private:
+	vector<bbox_t>		boxes_;
+	double				origin_x_	= 0;
+	double				origin_y_	= 0;
+	double				cell_size_	= 0;
+	unsigned			columns_	= 0;
+	unsigned			rows_		= 0;
+	vector<unsigned>	cell_start_;	// Index into cell_objects_ for each cell (plus one past the end)
+	vector<unsigned>	cell_objects_;
+	vector<unsigned>	large_;
+
+	int		column(double x) const;
+	int		row(double y) const;
+};
@@ -0,0 +1,275 @@
+// ----------------------------------------------------------------------------
+// SLADE - It's a Doom Editor
+// Copyright(C) 2008 - 2017 Simon Judd
+//
+// Email:       sirjuddington@gmail.com
+// Web:         http://slade.mancubus.net
+// Filename:    ThreadPool.cpp
+// Description: A simple pool of persistent worker threads, used to run
+//              background tasks and to split up heavy loops (map loading,
+//              saving etc.) across all available cores.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301, USA.
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+//
+// Includes
+//
+// ----------------------------------------------------------------------------
+#include "Main.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+
+// ----------------------------------------------------------------------------
+//
+// Variables
+//
+// ----------------------------------------------------------------------------
+CVAR(Int, max_worker_threads, 0, CVAR_SAVE)
+
+namespace ThreadPool
+{
+	vector<std::thread>					workers;
+	std::deque<std::function<void()>>	tasks;
+	std::mutex							tasks_mutex;
+	std::condition_variable				tasks_cv;
+	bool								stopping = false;
+
+	// Shared state for a single parallelFor call
+	struct RangeJob
+	{
+		const std::function<void(size_t, size_t, unsigned)>*	func;
+		size_t					count;
+		size_t					range_size;
+		unsigned				n_ranges;
+		std::atomic<unsigned>	next_range;
+		std::atomic<unsigned>	done_ranges;
+		std::mutex				mutex;
+		std::condition_variable	cv;
+	};
+}
+
+
+// ----------------------------------------------------------------------------
+//
+// ThreadPool Namespace Functions
+//
+// ----------------------------------------------------------------------------
+namespace ThreadPool
+{
+	// ------------------------------------------------------------------------
+	// workerLoop
+	//
+	// Main loop for a worker thread, runs queued tasks until the pool is shut
+	// down
+	// ------------------------------------------------------------------------
+	void workerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(tasks_mutex);
+				tasks_cv.wait(lock, []() { return stopping || !tasks.empty(); });
+				if (stopping && tasks.empty())
+					return;
+
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+
+			task();
+		}
+	}
+
+	// ------------------------------------------------------------------------
+	// startWorkers
+	//
+	// Starts the worker threads if they aren't already running. Must be called
+	// with [tasks_mutex] locked
+	// ------------------------------------------------------------------------
+	void startWorkers()
+	{
+		if (!workers.empty() || stopping)
+			return;
+
+		// Always have at least one worker so background tasks can run
+		unsigned n_workers = MAX(1u, nThreads() - 1);
+		for (unsigned a = 0; a < n_workers; a++)
+			workers.emplace_back(workerLoop);
+	}
+
+	// ------------------------------------------------------------------------
+	// runRanges
+	//
+	// Processes ranges from [job] until there are none left
+	// ------------------------------------------------------------------------
+	void runRanges(RangeJob* job)
+	{
+		while (true)
+		{
+			unsigned range = job->next_range++;
+			if (range >= job->n_ranges)
+				return;
+
+			size_t begin = range * job->range_size;
+			size_t end = MIN(job->count, begin + job->range_size);
+			(*job->func)(begin, end, range);
+
+			if (++job->done_ranges == job->n_ranges)
+			{
+				std::lock_guard<std::mutex> lock(job->mutex);
+				job->cv.notify_all();
+			}
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+// ThreadPool::nThreads
+//
+// Returns the number of threads that will be used for parallel operations
+// (including the calling thread)
+// ----------------------------------------------------------------------------
+unsigned ThreadPool::nThreads()
+{
+	if (max_worker_threads > 0)
+		return max_worker_threads;
+
+	unsigned hw = std::thread::hardware_concurrency();
+	return hw > 0 ? hw : 1;
+}
+
+// ----------------------------------------------------------------------------
+// ThreadPool::shutdown
+//
+// Waits for all queued tasks to finish and stops the worker threads
+// ----------------------------------------------------------------------------
+void ThreadPool::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(tasks_mutex);
+		stopping = true;
+	}
+	tasks_cv.notify_all();
+
+	for (auto& worker : workers)
+		worker.join();
+	workers.clear();
+}
+
+// ----------------------------------------------------------------------------
+// ThreadPool::run
+//
+// Queues [task] to be run on a worker thread
+// ----------------------------------------------------------------------------
+void ThreadPool::run(const std::function<void()>& task)
+{
+	{
+		std::unique_lock<std::mutex> lock(tasks_mutex);
+
+		// Pool is shutting down, just run the task here (without the lock
+		// held, since the task may itself use the pool)
+		if (stopping)
+		{
+			lock.unlock();
+			task();
+			return;
+		}
+
+		startWorkers();
+		tasks.push_back(task);
+	}
+	tasks_cv.notify_one();
+}
+
+// ----------------------------------------------------------------------------
+// ThreadPool::parallelFor
+//
+// Calls [func](begin, end) for contiguous ranges covering [0, count) across
+// the worker threads, and waits for all of them to complete
+// ----------------------------------------------------------------------------
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t, size_t)>& func, size_t min_range)
+{
+	parallelForRanges(count, [&func](size_t begin, size_t end, unsigned) { func(begin, end); }, min_range);
+}
+
+// ----------------------------------------------------------------------------
+// ThreadPool::parallelForRanges
+//
+// Calls [func](begin, end, range) for contiguous ranges covering [0, count)
+// across the worker threads, and waits for all of them to complete. The
+// calling thread also processes ranges, so this is safe to call from within
+// a worker task. Returns the number of ranges used
+// ----------------------------------------------------------------------------
+unsigned ThreadPool::parallelForRanges(
+	size_t count,
+	const std::function<void(size_t, size_t, unsigned)>& func,
+	size_t min_range)
+{
+	if (count == 0)
+		return 0;
+
+	// Determine range count
+	if (min_range < 1) min_range = 1;
+	size_t n_ranges = MIN((size_t)nThreads(), (count + min_range - 1) / min_range);
+
+	// Not worth splitting up, just run it here
+	if (n_ranges <= 1)
+	{
+		func(0, count, 0);
+		return 1;
+	}
+
+	// Setup job
+	auto job = std::make_shared<RangeJob>();
+	job->func = &func;
+	job->count = count;
+	job->n_ranges = n_ranges;
+	job->range_size = (count + n_ranges - 1) / n_ranges;
+	job->n_ranges = (count + job->range_size - 1) / job->range_size;
+	job->next_range = 0;
+	job->done_ranges = 0;
+
+	// Queue helper tasks (any that start after all ranges are taken will
+	// simply exit)
+	{
+		std::lock_guard<std::mutex> lock(tasks_mutex);
+		if (!stopping)
+		{
+			startWorkers();
+			for (unsigned a = 1; a < job->n_ranges; a++)
+				tasks.push_back([job]() { runRanges(job.get()); });
+		}
+	}
+	tasks_cv.notify_all();
+
+	// Process ranges on this thread too
+	runRanges(job.get());
+
+	// Wait for ranges still being processed on other threads
+	std::unique_lock<std::mutex> lock(job->mutex);
+	job->cv.wait(lock, [&job]() { return job->done_ranges == job->n_ranges; });
+
+	return job->n_ranges;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <functional>
+
+namespace ThreadPool
+{
+	unsigned	nThreads();
+	void		shutdown();
+
+	// Runs [task] on a worker thread and returns immediately
+	void	run(const std::function<void()>& task);
+
+	// Splits [count] items into contiguous ranges and calls [func](begin, end)
+	// for each range across the worker threads, returning once all ranges are
+	// done. Ranges are never smaller than [min_range] items
+	void	parallelFor(
+				size_t count,
+				const std::function<void(size_t, size_t)>& func,
+				size_t min_range = 1
+			);
+
+	// Same as above, but [func] also receives the index of the range, and the
+	// number of ranges used is returned (always <= nThreads())
+	unsigned	parallelForRanges(
+					size_t count,
+					const std::function<void(size_t, size_t, unsigned)>& func,
+					size_t min_range = 1
+				);
+}